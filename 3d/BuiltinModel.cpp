@@ -3,6 +3,8 @@
 #include "Math/Vector.h"
 #include "OpenGLWrapper.h"
 
+#include <cmath>
+
 using namespace RoadRage;
 
 BuiltinModel::BuiltinModel()
@@ -15,35 +17,55 @@ BuiltinModel::~BuiltinModel()
 
 }
 
-BoxModel::BoxModel(ShaderManager& shaderManager)
-    : m_vao(new VertexArrayObject())
+struct BoxModel::Buffers {
+    std::shared_ptr<VertexBufferObject> vbo;
+    std::shared_ptr<ElementsBufferObject> ebo;
+    std::shared_ptr<VertexArrayObject> vao;
+};
+
+namespace {
+    // Owned by the boxes, so that they are gone with the last box.
+    std::weak_ptr<BoxModel::Buffers> g_boxBuffers;
+}
+
+BoxModel::BoxModel(ShaderManager& shaderManager, const Vector& in_color)
+    : m_pBuffers(g_boxBuffers.lock())
     , m_pShader(shaderManager.getOrLoadShader("StaticUni"))
 {
-    m_vbo.reset(new VertexBufferObject({ 1.0f, 1.0f,-1.0f,
-                                         1.0f,-1.0f,-1.0f,
-                                        -1.0f,-1.0f,-1.0f,
-                                        -1.0f, 1.0f,-1.0f,
-                                         1.0f, 1.0f, 1.0f,
-                                        -1.0f, 1.0f, 1.0f,
-                                        -1.0f,-1.0f, 1.0f,
-                                         1.0f,-1.0f, 1.0f}, 3));
-    m_ebo.reset(new ElementsBufferObject({0, 3, 2,
-                                          2, 1, 0,
-                                          4, 0, 1,
-                                          1, 7, 4,
-                                          6, 5, 4,
-                                          4, 7, 6,
-                                          2, 3, 5,
-                                          5, 6, 2,
-                                          3, 0, 4,
-                                          4, 5, 3,
-                                          6, 7, 1,
-                                          1, 2, 6}, 3));
-
-    m_vao->bind();
-    m_pShader->setVertexAttribute("aVertexPosition", *m_vbo);
-    m_ebo->bind();
-    m_vao->unbind();
+    m_material.set("uMaterialDiffuse", in_color);
+
+    if(m_pBuffers)
+        return;
+
+    m_pBuffers.reset(new Buffers());
+    m_pBuffers->vao.reset(new VertexArrayObject());
+    m_pBuffers->vbo.reset(new VertexBufferObject({ 1.0f, 1.0f,-1.0f,
+                                                   1.0f,-1.0f,-1.0f,
+                                                  -1.0f,-1.0f,-1.0f,
+                                                  -1.0f, 1.0f,-1.0f,
+                                                   1.0f, 1.0f, 1.0f,
+                                                  -1.0f, 1.0f, 1.0f,
+                                                  -1.0f,-1.0f, 1.0f,
+                                                   1.0f,-1.0f, 1.0f}, 3));
+    m_pBuffers->ebo.reset(new ElementsBufferObject(std::vector<uint16_t>{0, 3, 2,
+                                                                         2, 1, 0,
+                                                                         4, 0, 1,
+                                                                         1, 7, 4,
+                                                                         6, 5, 4,
+                                                                         4, 7, 6,
+                                                                         2, 3, 5,
+                                                                         5, 6, 2,
+                                                                         3, 0, 4,
+                                                                         4, 5, 3,
+                                                                         6, 7, 1,
+                                                                         1, 2, 6}, 3));
+
+    m_pBuffers->vao->bind();
+    m_pShader->setVertexAttribute("aVertexPosition", *m_pBuffers->vbo);
+    m_pBuffers->ebo->bind();
+    m_pBuffers->vao->unbind();
+
+    g_boxBuffers = m_pBuffers;
 }
 
 BoxModel::~BoxModel()
@@ -51,60 +73,67 @@ BoxModel::~BoxModel()
 
 }
 
-void BoxModel::render(const General4x4Matrix& in_vp)
+void BoxModel::submit(CommandList& io_cmds, const AffineMatrix& in_model, bool in_bCull) const
 {
-    m_pShader->bind();
-    m_vao->bind();
+    const ElementsBufferObject& ebo = *m_pBuffers->ebo;
+    io_cmds.submit(*m_pShader, Geometry(m_pBuffers->vao->id, GL_TRIANGLES, ebo.count, ebo.indexType), m_material, in_model, in_bCull ? this->radius() : -1.0f);
+}
 
-    m_pShader->setUniform("uMaterialDiffuse", Vector(1.0f, 0.0f, 0.0f));
-    m_pShader->setUniform("uModelViewProjectionMatrix", in_vp);
+float BoxModel::radius() const
+{
+    // The box goes from -1 to 1 along every axis.
+    return std::sqrt(3.0f);
+}
 
-    glDrawElements(GL_TRIANGLES, 12 * m_ebo->nComponents, GL_UNSIGNED_INT, 0);
+struct ImpostorModel::Buffers {
+    std::shared_ptr<VertexBufferObject> vbo;
+    std::shared_ptr<ElementsBufferObject> ebo;
+    std::shared_ptr<VertexArrayObject> vao;
+};
 
-    Shader::unbind();
-    VertexArrayObject::unbind();
+namespace {
+    std::weak_ptr<ImpostorModel::Buffers> g_impostorBuffers;
 }
 
-#define D_CSYS_SIZE 2.0f
-
-CsysModel::CsysModel(ShaderManager& pMgr)
-    : m_vao(new VertexArrayObject())
-    , m_pShader(pMgr.getOrLoadShader("StaticPosCol"))
+ImpostorModel::ImpostorModel(ShaderManager& shaderManager, const Vector& in_color)
+    : m_pBuffers(g_impostorBuffers.lock())
+    , m_pShader(shaderManager.getOrLoadShader("Impostor"))
 {
-    m_vbo.reset(new VertexBufferObject({   0.0f,   0.0f,   0.0f,
-                                         D_CSYS_SIZE,   0.0f,   0.0f,
-                                           0.0f, D_CSYS_SIZE,   0.0f,
-                                           0.0f,   0.0f, D_CSYS_SIZE,
-                                        -D_CSYS_SIZE,   0.0f,   0.0f,
-                                           0.0f,-D_CSYS_SIZE,   0.0f,
-                                           0.0f,   0.0f,-D_CSYS_SIZE}, 3));
-    m_ebo.reset(new ElementsBufferObject({0, 1,
-                                          0, 2,
-                                          0, 3,
-                                          0, 4,
-                                          0, 5,
-                                          0, 6}, 2));
-
-    m_vao->bind();
-    m_pShader->setVertexAttribute("aVertexPosition", *m_vbo);
-    m_ebo->bind();
-    m_vao->unbind();
+    m_material.set("uMaterialDiffuse", in_color);
+
+    if(m_pBuffers)
+        return;
+
+    // The shader turns the quad towards the camera.
+    m_pBuffers.reset(new Buffers());
+    m_pBuffers->vao.reset(new VertexArrayObject());
+    m_pBuffers->vbo.reset(new VertexBufferObject({-1.0f,-1.0f, 0.0f,
+                                                   1.0f,-1.0f, 0.0f,
+                                                   1.0f, 1.0f, 0.0f,
+                                                  -1.0f, 1.0f, 0.0f}, 3));
+    m_pBuffers->ebo.reset(new ElementsBufferObject(std::vector<uint16_t>{0, 1, 2,
+                                                                         2, 3, 0}, 3));
+
+    m_pBuffers->vao->bind();
+    m_pShader->setVertexAttribute("aVertexPosition", *m_pBuffers->vbo);
+    m_pBuffers->ebo->bind();
+    m_pBuffers->vao->unbind();
+
+    g_impostorBuffers = m_pBuffers;
 }
 
-CsysModel::~CsysModel()
+ImpostorModel::~ImpostorModel()
 {
 }
 
-void RoadRage::CsysModel::render(const RoadRage::General4x4Matrix& in_vp)
+void ImpostorModel::submit(CommandList& io_cmds, const AffineMatrix& in_model, bool in_bCull) const
 {
-    m_pShader->bind();
-    m_vao->bind();
-
-    m_pShader->setUniform("uModelViewProjectionMatrix", in_vp);
-    m_pShader->setUniform("uMax", Vector(D_CSYS_SIZE, D_CSYS_SIZE, D_CSYS_SIZE));
-
-    glDrawElements(GL_LINES, 6 * m_ebo->nComponents, GL_UNSIGNED_INT, 0);
+    const ElementsBufferObject& ebo = *m_pBuffers->ebo;
+    io_cmds.submit(*m_pShader, Geometry(m_pBuffers->vao->id, GL_TRIANGLES, ebo.count, ebo.indexType), m_material, in_model, in_bCull ? this->radius() : -1.0f);
+}
 
-    Shader::unbind();
-    VertexArrayObject::unbind();
+float ImpostorModel::radius() const
+{
+    // Wherever the camera is, the quad stays within the unit box's sphere.
+    return std::sqrt(3.0f);
 }
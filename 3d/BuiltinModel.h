@@ -1,5 +1,6 @@
 #pragma once
 
+#include "RenderQueue.h"
 #include "VertexArrayObject.h"
 #include "Shader.h"
 
@@ -13,41 +14,56 @@ public:
     BuiltinModel();
     virtual ~BuiltinModel();
 
-    virtual void render(const General4x4Matrix& in_vp) = 0;
+    /// Queues drawing the model placed at \a in_model.
+    /// \param in_bCull false if the caller already made sure it's visible.
+    virtual void submit(CommandList& io_cmds, const AffineMatrix& in_model, bool in_bCull = true) const = 0;
+    /// \return The radius of a sphere around the origin containing the model.
+    virtual float radius() const = 0;
 
 private:
     // No copying for now!
     BuiltinModel(const BuiltinModel&);
 };
 
+/// A box going from -1 to 1 along every axis.
 class BoxModel : public BuiltinModel {
 public:
-    BoxModel(ShaderManager& pMgr);
+    BoxModel(ShaderManager& pMgr, const Vector& in_color = Vector(1.0f, 0.0f, 0.0f));
     virtual ~BoxModel();
 
-    virtual void render(const General4x4Matrix& in_vp);
+    virtual void submit(CommandList& io_cmds, const AffineMatrix& in_model, bool in_bCull = true) const;
+    virtual float radius() const;
+
+    /// All boxes share the very same buffers, so they can be drawn together.
+    struct Buffers;
 
 private:
-    std::shared_ptr<VertexBufferObject> m_vbo;
-    std::shared_ptr<ElementsBufferObject> m_ebo;
-    std::shared_ptr<VertexArrayObject> m_vao;
+    std::shared_ptr<Buffers> m_pBuffers;
 
     Shader::Ptr m_pShader;
+    Material m_material;
 };
 
-class CsysModel : public BuiltinModel {
+/// A flat, camera-facing quad standing in for a model that is too far away for
+/// its details to be seen. It is as wide as the model's larger horizontal
+/// scale and as high as its vertical scale, so it covers the unit box the
+/// same way the model does.
+class ImpostorModel : public BuiltinModel {
 public:
-    CsysModel(ShaderManager& pMgr);
-    virtual ~CsysModel();
+    ImpostorModel(ShaderManager& pMgr, const Vector& in_color);
+    virtual ~ImpostorModel();
+
+    virtual void submit(CommandList& io_cmds, const AffineMatrix& in_model, bool in_bCull = true) const;
+    virtual float radius() const;
 
-    virtual void render(const General4x4Matrix& in_vp);
+    /// All impostors share the very same buffers, so they can be drawn together.
+    struct Buffers;
 
 private:
-    std::shared_ptr<VertexBufferObject> m_vbo;
-    std::shared_ptr<ElementsBufferObject> m_ebo;
-    std::shared_ptr<VertexArrayObject> m_vao;
+    std::shared_ptr<Buffers> m_pBuffers;
 
     Shader::Ptr m_pShader;
+    Material m_material;
 };
 
 }
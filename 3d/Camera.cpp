@@ -13,6 +13,16 @@ Camera::operator General4x4Matrix() const
     return m_cachedViewProj;
 }
 
+const AffineMatrix& Camera::view() const
+{
+    return m_cachedView;
+}
+
+const General4x4Matrix& Camera::proj() const
+{
+    return m_proj;
+}
+
 Camera& Camera::pos(Vector v)
 {
     m_pos = v;
@@ -73,6 +83,6 @@ void RoadRage::Camera::updateVPCache()
     // Thus, the camera is NOT placed at 1,0,0 - rather the scene is moved
     // by -1,0,0. This has the same effect, but opengl has no "camera".
 
-    AffineMatrix view = AffineMatrix::rotationQuat(m_rot) * AffineMatrix::translation(-m_pos) * AffineMatrix::rotationQuat(m_orbit) * AffineMatrix::translation(-m_orbitCenter);
-    m_cachedViewProj = m_proj * view;
+    m_cachedView = AffineMatrix::rotationQuat(m_rot) * AffineMatrix::translation(-m_pos) * AffineMatrix::rotationQuat(m_orbit) * AffineMatrix::translation(-m_orbitCenter);
+    m_cachedViewProj = m_proj * m_cachedView;
 }
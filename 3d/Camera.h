@@ -22,7 +22,10 @@ public:
     Camera& orbitCenter(Vector v);
     Vector orbitCenter() const;
 
+    /// \return The view-projection matrix.
     operator General4x4Matrix() const;
+    const AffineMatrix& view() const;
+    const General4x4Matrix& proj() const;
 
 protected:
     void updateVPCache();
@@ -34,6 +37,7 @@ private:
     Vector m_orbitCenter;
 
     General4x4Matrix m_proj;
+    AffineMatrix m_cachedView;
     General4x4Matrix m_cachedViewProj;
 };
 
@@ -0,0 +1,238 @@
+#include "DebugDraw.h"
+
+#if D_DEBUG_DRAW
+
+#include "Utilities/Math.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace RoadRage;
+
+/// Room for this many lines per frame in the beginning, it grows as needed.
+#define D_DEBUG_LINES_INITIAL 65536
+/// How many segments circles are made of.
+#define D_DEBUG_CIRCLE_SEGMENTS 24
+
+namespace {
+    struct DebugVertex {
+        float pos[3];
+        unsigned char color[4];
+    };
+
+    /// Every thread adds its lines to its own buffer, so that adding a line
+    /// never needs to lock anything.
+    struct LineBuffer {
+        std::vector<DebugVertex> vertices;
+    };
+
+    // All the threads' buffers, guarded by g_mutex. They are kept even when
+    // their thread ends, as a thread adding debug lines usually lives long.
+    std::mutex g_mutex;
+    std::vector<std::unique_ptr<LineBuffer>> g_buffers;
+    thread_local LineBuffer* t_pBuffer = 0;
+
+    LineBuffer& threadBuffer()
+    {
+        if(!t_pBuffer) {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            g_buffers.push_back(std::unique_ptr<LineBuffer>(new LineBuffer()));
+            t_pBuffer = g_buffers.back().get();
+        }
+        return *t_pBuffer;
+    }
+
+    void addVertex(std::vector<DebugVertex>& io_v, float x, float y, float z, const Vector& in_color)
+    {
+        DebugVertex v;
+        v.pos[0] = x; v.pos[1] = y; v.pos[2] = z;
+        v.color[0] = static_cast<unsigned char>(clamp(in_color.x(), 0.0f, 1.0f) * 255.0f);
+        v.color[1] = static_cast<unsigned char>(clamp(in_color.y(), 0.0f, 1.0f) * 255.0f);
+        v.color[2] = static_cast<unsigned char>(clamp(in_color.z(), 0.0f, 1.0f) * 255.0f);
+        v.color[3] = 255;
+        io_v.push_back(v);
+    }
+
+    /// \return The point (x, y, z) transformed by the column-major matrix \a m.
+    Vector transformed(const float* m, float x, float y, float z)
+    {
+        return Vector(m[0]*x + m[4]*y + m[8]*z  + m[12],
+                      m[1]*x + m[5]*y + m[9]*z  + m[13],
+                      m[2]*x + m[6]*y + m[10]*z + m[14]);
+    }
+
+    /// The 12 edges of a box, as pairs of indices into its 8 corners, where
+    /// bit 0, 1 and 2 of a corner's index tell if it's at the max x, y and z.
+    const unsigned g_boxEdges[24] = { 0,1, 2,3, 4,5, 6,7,
+                                      0,2, 1,3, 4,6, 5,7,
+                                      0,4, 1,5, 2,6, 3,7 };
+
+    void boxFromCorners(const Vector* in_corners, const Vector& in_color)
+    {
+        for(unsigned i = 0 ; i < 24 ; i += 2) {
+            debugLine(in_corners[g_boxEdges[i]], in_corners[g_boxEdges[i+1]], in_color);
+        }
+    }
+}
+
+void RoadRage::debugLine(const Vector& in_a, const Vector& in_b, const Vector& in_color)
+{
+    std::vector<DebugVertex>& v = threadBuffer().vertices;
+    addVertex(v, in_a.x(), in_a.y(), in_a.z(), in_color);
+    addVertex(v, in_b.x(), in_b.y(), in_b.z(), in_color);
+}
+
+void RoadRage::debugBox(const Vector& in_min, const Vector& in_max, const Vector& in_color)
+{
+    Vector corners[8];
+    for(unsigned i = 0 ; i < 8 ; ++i) {
+        corners[i] = Vector(i & 1 ? in_max.x() : in_min.x(),
+                            i & 2 ? in_max.y() : in_min.y(),
+                            i & 4 ? in_max.z() : in_min.z());
+    }
+    boxFromCorners(corners, in_color);
+}
+
+void RoadRage::debugBox(const AffineMatrix& in_model, const Vector& in_color)
+{
+    const float* m = in_model.array16f();
+    Vector corners[8];
+    for(unsigned i = 0 ; i < 8 ; ++i) {
+        corners[i] = transformed(m, i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+    }
+    boxFromCorners(corners, in_color);
+}
+
+void RoadRage::debugSphere(const Vector& in_center, float in_fRadius, const Vector& in_color)
+{
+    const float fStep = 360.0f*deg2rad / D_DEBUG_CIRCLE_SEGMENTS;
+    for(unsigned i = 0 ; i < D_DEBUG_CIRCLE_SEGMENTS ; ++i) {
+        float c0 = std::cos(i*fStep) * in_fRadius, s0 = std::sin(i*fStep) * in_fRadius;
+        float c1 = std::cos((i+1)*fStep) * in_fRadius, s1 = std::sin((i+1)*fStep) * in_fRadius;
+        debugLine(in_center + Vector(c0, s0, 0.0f), in_center + Vector(c1, s1, 0.0f), in_color);
+        debugLine(in_center + Vector(c0, 0.0f, s0), in_center + Vector(c1, 0.0f, s1), in_color);
+        debugLine(in_center + Vector(0.0f, c0, s0), in_center + Vector(0.0f, c1, s1), in_color);
+    }
+}
+
+void RoadRage::debugArrow(const Vector& in_from, const Vector& in_dir, const Vector& in_color)
+{
+    float fLen = in_dir.len();
+    if(fLen <= 0.0f)
+        return;
+
+    Vector to = in_from + in_dir;
+    debugLine(in_from, to, in_color);
+
+    // The head is made of two lines in the plane of the arrow and "up", or
+    // whatever else is not parallel to the arrow.
+    Vector dir = in_dir * (1.0f / fLen);
+    Vector side = dir.cross(std::fabs(dir.y()) < 0.99f ? Vector(0.0f, 1.0f, 0.0f) : Vector(1.0f, 0.0f, 0.0f)).normalized();
+    float fHead = std::min(0.25f * fLen, 0.5f);
+    debugLine(to, to - dir*fHead + side*(fHead*0.5f), in_color);
+    debugLine(to, to - dir*fHead - side*(fHead*0.5f), in_color);
+}
+
+void RoadRage::debugAxes(const AffineMatrix& in_model, float in_fSize)
+{
+    const float* m = in_model.array16f();
+    Vector o = transformed(m, 0.0f, 0.0f, 0.0f);
+    debugLine(o, transformed(m, in_fSize, 0.0f, 0.0f), Vector(1.0f, 0.0f, 0.0f));
+    debugLine(o, transformed(m, 0.0f, in_fSize, 0.0f), Vector(0.0f, 1.0f, 0.0f));
+    debugLine(o, transformed(m, 0.0f, 0.0f, in_fSize), Vector(0.0f, 0.0f, 1.0f));
+}
+
+void RoadRage::debugFrustum(const General4x4Matrix& in_viewProj, const Vector& in_color)
+{
+    // Bring the corners of the clip-space cube back to the world.
+    const float* im = in_viewProj.array16fInverse();
+    Vector corners[8];
+    for(unsigned i = 0 ; i < 8 ; ++i) {
+        float x = i & 1 ? 1.0f : -1.0f, y = i & 2 ? 1.0f : -1.0f, z = i & 4 ? 1.0f : -1.0f;
+        float w = im[3]*x + im[7]*y + im[11]*z + im[15];
+        corners[i] = transformed(im, x, y, z) * (1.0f / w);
+    }
+    boxFromCorners(corners, in_color);
+}
+
+DebugRenderer::DebugRenderer(ShaderManager& in_shadmgr)
+    : m_pShader(in_shadmgr.getOrLoadShader("Debug"))
+    , m_stream(D_DEBUG_LINES_INITIAL * 2 * sizeof(DebugVertex))
+    , m_vaoBuffer(0)
+    , m_nLines(0)
+{
+    this->setupVertexArray();
+}
+
+DebugRenderer::~DebugRenderer()
+{
+}
+
+void DebugRenderer::setupVertexArray()
+{
+    const GLint pos = Shader::attributeLocation("aVertexPosition");
+    const GLint color = Shader::attributeLocation("aVertexColor");
+
+    m_vao.bind();
+    glBindBuffer(GL_ARRAY_BUFFER, m_stream.id());
+    glEnableVertexAttribArray(pos);
+    glEnableVertexAttribArray(color);
+    glVertexAttribPointer(pos, 3, GL_FLOAT, GL_FALSE, sizeof(DebugVertex), reinterpret_cast<const GLvoid*>(offsetof(DebugVertex, pos)));
+    glVertexAttribPointer(color, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(DebugVertex), reinterpret_cast<const GLvoid*>(offsetof(DebugVertex, color)));
+    VertexArrayObject::unbind();
+    VertexBufferObject::unbind();
+
+    m_vaoBuffer = m_stream.id();
+}
+
+void DebugRenderer::flush()
+{
+    m_stream.beginFrame();
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+
+    std::size_t nVerts = 0;
+    for(auto i = g_buffers.begin() ; i != g_buffers.end() ; ++i) {
+        nVerts += (*i)->vertices.size();
+    }
+    m_nLines = nVerts / 2;
+
+    if(nVerts > 0) {
+        const std::size_t size = nVerts * sizeof(DebugVertex);
+        char* p = static_cast<char*>(m_stream.map(size, sizeof(DebugVertex)));
+        if(!p) {
+            // Rare enough to be allowed to wait for the GPU.
+            m_stream.resize(size * 2);
+            p = static_cast<char*>(m_stream.map(size, sizeof(DebugVertex)));
+        }
+
+        for(auto i = g_buffers.begin() ; i != g_buffers.end() ; ++i) {
+            std::vector<DebugVertex>& v = (*i)->vertices;
+            if(v.empty())
+                continue;
+
+            std::memcpy(p, &v[0], v.size() * sizeof(DebugVertex));
+            p += v.size() * sizeof(DebugVertex);
+            v.clear();
+        }
+        const std::size_t offset = m_stream.unmap();
+
+        if(m_vaoBuffer != m_stream.id())
+            this->setupVertexArray();
+
+        m_pShader->bind();
+        m_vao.bind();
+        glDrawArrays(GL_LINES, static_cast<GLint>(offset / sizeof(DebugVertex)), static_cast<GLsizei>(nVerts));
+        VertexArrayObject::unbind();
+        Shader::unbind();
+    }
+
+    m_stream.endFrame();
+}
+
+#endif
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "3d/Math/Matrix.h"
+#include "3d/Math/Vector.h"
+
+#include <cstddef>
+
+#if D_DEBUG_DRAW
+#  include "3d/Shader.h"
+#  include "3d/StreamBuffer.h"
+#  include "3d/VertexArrayObject.h"
+#endif
+
+/// The debug shapes below can be drawn from anywhere in the code, from any
+/// thread, at any time during a frame. They all end up in one vertex buffer
+/// which DebugRenderer draws with a single draw call at the end of the frame.\n
+/// Without D_DEBUG_DRAW (see the ROADRAGE_DEBUG_DRAW CMake option), all of
+/// this is compiled to nothing at all.\n
+/// Colors are given as (r, g, b) in [0, 1].
+
+namespace RoadRage {
+
+class ShaderManager;
+
+#if D_DEBUG_DRAW
+
+void debugLine(const Vector& in_a, const Vector& in_b, const Vector& in_color);
+/// An axis-aligned box going from \a in_min to \a in_max.
+void debugBox(const Vector& in_min, const Vector& in_max, const Vector& in_color);
+/// The box from -1 to 1 on every axis, transformed by \a in_model.
+void debugBox(const AffineMatrix& in_model, const Vector& in_color);
+/// Three circles, one around every axis.
+void debugSphere(const Vector& in_center, float in_fRadius, const Vector& in_color);
+/// An arrow from \a in_from to \a in_from + \a in_dir, like a velocity.
+void debugArrow(const Vector& in_from, const Vector& in_dir, const Vector& in_color);
+/// The x (red), y (green) and z (blue) axes of \a in_model, \a in_fSize long.
+void debugAxes(const AffineMatrix& in_model, float in_fSize);
+/// The frustum seen through \a in_viewProj, a camera for example.
+void debugFrustum(const General4x4Matrix& in_viewProj, const Vector& in_color);
+
+/// Draws all the debug shapes of the frame and forgets about them.
+class DebugRenderer {
+public:
+    /// Needs a current OpenGL context.
+    DebugRenderer(ShaderManager& in_shadmgr);
+    virtual ~DebugRenderer();
+
+    /// Draws everything that got added since the last flush, in one go. The
+    /// "Frame" uniform block needs to be up to date. Must be called from the
+    /// GL thread while no other thread is adding shapes.
+    void flush();
+
+    /// \return How many lines the last flush drew.
+    std::size_t lineCount() const { return m_nLines; }
+
+private:
+    // No copying!
+    DebugRenderer(const DebugRenderer&);
+    DebugRenderer& operator=(const DebugRenderer&);
+
+    void setupVertexArray();
+
+    Shader::Ptr m_pShader;
+    StreamBuffer m_stream;
+    VertexArrayObject m_vao;
+    /// The stream buffer the vertex array was set up for.
+    GLuint m_vaoBuffer;
+    std::size_t m_nLines;
+};
+
+#else
+
+inline void debugLine(const Vector&, const Vector&, const Vector&) {}
+inline void debugBox(const Vector&, const Vector&, const Vector&) {}
+inline void debugBox(const AffineMatrix&, const Vector&) {}
+inline void debugSphere(const Vector&, float, const Vector&) {}
+inline void debugArrow(const Vector&, const Vector&, const Vector&) {}
+inline void debugAxes(const AffineMatrix&, float) {}
+inline void debugFrustum(const General4x4Matrix&, const Vector&) {}
+
+class DebugRenderer {
+public:
+    DebugRenderer(ShaderManager&) {}
+    void flush() {}
+    std::size_t lineCount() const { return 0; }
+};
+
+#endif
+
+}
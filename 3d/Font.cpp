@@ -0,0 +1,89 @@
+#include "Font.h"
+
+#include <SFML/Graphics/Image.hpp>
+
+#include <algorithm>
+#include <vector>
+
+using namespace RoadRage;
+
+/// The width of the atlas, its height being whatever the glyphs need.
+#define D_FONT_ATLAS_WIDTH 256
+
+Font::Font(const sf::Font& in_font, unsigned in_size)
+    : FontMetrics(in_size, static_cast<float>(in_font.GetLineSpacing(in_size)))
+    , m_texture(0)
+{
+    // Let SFML (that is, FreeType) rasterize everything first, as its image
+    // may still grow while doing so.
+    std::vector<sf::Glyph> glyphs(D_FONT_CHAR_COUNT);
+    for(unsigned i = 0 ; i < D_FONT_CHAR_COUNT ; ++i) {
+        glyphs[i] = in_font.GetGlyph(D_FONT_FIRST_CHAR + i, in_size, false);
+    }
+    const sf::Image& page = in_font.GetImage(in_size);
+    const sf::Uint8* pixels = page.GetPixelsPtr();
+
+    // Then pack the glyphs into rows of our own, single-channel atlas, with
+    // a pixel of space around each so that they don't bleed into each other.
+    std::vector<int> x(D_FONT_CHAR_COUNT), y(D_FONT_CHAR_COUNT);
+    int penX = 1, penY = 1, rowHeight = 0;
+    for(unsigned i = 0 ; i < D_FONT_CHAR_COUNT ; ++i) {
+        const sf::IntRect& r = glyphs[i].SubRect;
+        if(penX + r.Width + 1 > D_FONT_ATLAS_WIDTH) {
+            penX = 1;
+            penY += rowHeight + 1;
+            rowHeight = 0;
+        }
+        x[i] = penX;
+        y[i] = penY;
+        penX += r.Width + 1;
+        rowHeight = std::max(rowHeight, r.Height);
+    }
+    const int h = penY + rowHeight + 1;
+
+    std::vector<unsigned char> atlas(D_FONT_ATLAS_WIDTH * h, 0);
+    for(unsigned i = 0 ; i < D_FONT_CHAR_COUNT ; ++i) {
+        const sf::IntRect& r = glyphs[i].SubRect;
+        for(int row = 0 ; row < r.Height ; ++row) {
+            for(int col = 0 ; col < r.Width ; ++col) {
+                // SFML's glyphs are white, only their alpha matters.
+                atlas[(y[i] + row) * D_FONT_ATLAS_WIDTH + x[i] + col] = pixels[((r.Top + row) * page.GetWidth() + r.Left + col) * 4 + 3];
+            }
+        }
+
+        const sf::IntRect& b = glyphs[i].Bounds;
+        Glyph& g = m_glyphs[i];
+        g.x0 = static_cast<float>(b.Left);
+        g.y0 = static_cast<float>(b.Top);
+        g.x1 = static_cast<float>(b.Left + b.Width);
+        g.y1 = static_cast<float>(b.Top + b.Height);
+        g.u0 = static_cast<float>(x[i]) / D_FONT_ATLAS_WIDTH;
+        g.v0 = static_cast<float>(y[i]) / h;
+        g.u1 = static_cast<float>(x[i] + r.Width) / D_FONT_ATLAS_WIDTH;
+        g.v1 = static_cast<float>(y[i] + r.Height) / h;
+        g.advance = static_cast<float>(glyphs[i].Advance);
+    }
+
+    for(unsigned i = 0 ; i < D_FONT_CHAR_COUNT ; ++i) {
+        for(unsigned j = 0 ; j < D_FONT_CHAR_COUNT ; ++j) {
+            m_kerning[i * D_FONT_CHAR_COUNT + j] = static_cast<signed char>(in_font.GetKerning(D_FONT_FIRST_CHAR + i, D_FONT_FIRST_CHAR + j, in_size));
+        }
+    }
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, D_FONT_ATLAS_WIDTH, h, 0, GL_RED, GL_UNSIGNED_BYTE, &atlas[0]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    // Text is drawn on whole pixels, which keeps it crisp.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+Font::~Font()
+{
+    glDeleteTextures(1, &m_texture);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "3d/FontMetrics.h"
+#include "3d/OpenGLWrapper.h"
+
+#include <SFML/Graphics/Font.hpp>
+
+#include <memory>
+
+namespace RoadRage {
+
+/// All glyphs of a font at one size, rasterized once into a single texture,
+/// the atlas. Drawing text then only needs quads picking the glyphs out of it.
+class Font : public FontMetrics {
+public:
+    typedef std::shared_ptr<Font> Ptr;
+
+    /// Rasterizes all glyphs of \a in_font at \a in_size pixels. Needs a
+    /// current OpenGL context.
+    Font(const sf::Font& in_font = sf::Font::GetDefaultFont(), unsigned in_size = 14);
+    virtual ~Font();
+
+    GLuint texture() const { return m_texture; }
+
+private:
+    // No copying!
+    Font(const Font&);
+    Font& operator=(const Font&);
+
+    /// A single-channel texture with the glyphs' coverage.
+    GLuint m_texture;
+};
+
+}
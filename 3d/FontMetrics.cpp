@@ -0,0 +1,44 @@
+#include "FontMetrics.h"
+
+#include "Utilities/i18n.h"
+
+#include <stdexcept>
+
+using namespace RoadRage;
+
+FontMetrics::FontMetrics(unsigned in_size, float in_fLineSpacing)
+    : m_size(in_size)
+    , m_fLineSpacing(in_fLineSpacing)
+    , m_glyphs(D_FONT_CHAR_COUNT, Glyph())
+    , m_kerning(D_FONT_CHAR_COUNT * D_FONT_CHAR_COUNT, 0)
+{
+}
+
+FontMetrics::FontMetrics(unsigned in_size, float in_fLineSpacing, const std::vector<Glyph>& in_glyphs)
+    : m_size(in_size)
+    , m_fLineSpacing(in_fLineSpacing)
+    , m_glyphs(in_glyphs)
+    , m_kerning(D_FONT_CHAR_COUNT * D_FONT_CHAR_COUNT, 0)
+{
+    if(m_glyphs.size() != D_FONT_CHAR_COUNT)
+        throw std::invalid_argument(_("A font needs a glyph for every character"));
+}
+
+FontMetrics::~FontMetrics()
+{
+}
+
+unsigned FontMetrics::index(unsigned char in_c)
+{
+    return in_c >= D_FONT_FIRST_CHAR ? in_c - D_FONT_FIRST_CHAR : '?' - D_FONT_FIRST_CHAR;
+}
+
+const FontMetrics::Glyph& FontMetrics::glyph(unsigned char in_c) const
+{
+    return m_glyphs[index(in_c)];
+}
+
+float FontMetrics::kerning(unsigned char in_first, unsigned char in_second) const
+{
+    return m_kerning[index(in_first) * D_FONT_CHAR_COUNT + index(in_second)];
+}
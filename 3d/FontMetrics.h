@@ -0,0 +1,59 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+/// The characters a font has glyphs for: all of Latin-1 that can be printed.
+/// Anything else is drawn as a question mark.
+#define D_FONT_FIRST_CHAR 32
+#define D_FONT_LAST_CHAR 255
+#define D_FONT_CHAR_COUNT (D_FONT_LAST_CHAR - D_FONT_FIRST_CHAR + 1)
+
+namespace RoadRage {
+
+/// Where the glyphs of a font at one size go and how far apart, which is all
+/// it takes to lay out text. The Font adds the atlas to draw them from.
+class FontMetrics {
+public:
+    typedef std::shared_ptr<const FontMetrics> Ptr;
+
+    /// Where a glyph is in the atlas and how to place it, in pixels.
+    struct Glyph {
+        /// The glyph's quad, relative to the pen on the baseline, y going down.
+        float x0, y0, x1, y1;
+        /// The glyph's quad in the atlas, in [0, 1].
+        float u0, v0, u1, v1;
+        /// How far the pen moves after this glyph.
+        float advance;
+    };
+
+    /// Metrics made up without any font, like for laying out text without a
+    /// GL context. No kerning.
+    /// \param in_glyphs One glyph per character, from D_FONT_FIRST_CHAR on.
+    FontMetrics(unsigned in_size, float in_fLineSpacing, const std::vector<Glyph>& in_glyphs);
+    virtual ~FontMetrics();
+
+    /// \return The glyph of the character \a in_c, or the one of '?' if this
+    ///         font doesn't have one.
+    const Glyph& glyph(unsigned char in_c) const;
+    /// \return What to add to the pen between \a in_first and \a in_second,
+    ///         in pixels. Usually negative, as in "AV".
+    float kerning(unsigned char in_first, unsigned char in_second) const;
+
+    float lineSpacing() const { return m_fLineSpacing; }
+    unsigned size() const { return m_size; }
+
+protected:
+    /// All glyphs empty and no kerning, for the Font to fill in.
+    FontMetrics(unsigned in_size, float in_fLineSpacing);
+
+    static unsigned index(unsigned char in_c);
+
+    unsigned m_size;
+    float m_fLineSpacing;
+    std::vector<Glyph> m_glyphs;
+    /// The kerning of every pair of characters, as they're few.
+    std::vector<signed char> m_kerning;
+};
+
+}
@@ -0,0 +1,63 @@
+#include "LodModel.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace RoadRage;
+
+LodModel::LodModel(float in_fHysteresis)
+    : m_fHysteresis(in_fHysteresis)
+    , m_fRadius(0.0f)
+{
+}
+
+LodModel::~LodModel()
+{
+}
+
+LodModel& LodModel::addLevel(const std::shared_ptr<BuiltinModel>& in_pModel, float in_fMinScreenSize)
+{
+    if(m_levels.size() >= D_MAX_LODS)
+        throw std::logic_error("Too many levels of detail, raise D_MAX_LODS");
+
+    Level l = { in_pModel, in_fMinScreenSize };
+    m_levels.push_back(l);
+    m_fRadius = std::max(m_fRadius, in_pModel->radius());
+    return *this;
+}
+
+unsigned LodModel::select(float in_fScreenSize, unsigned in_current) const
+{
+    const unsigned last = static_cast<unsigned>(m_levels.size()) - 1;
+    unsigned lod = std::min(in_current, last);
+
+    // Getting smaller: only switch to a coarser level once clearly below the
+    // threshold of the current one.
+    while(lod < last && in_fScreenSize < m_levels[lod].fMinScreenSize * (1.0f - m_fHysteresis)) {
+        ++lod;
+    }
+
+    // Getting bigger: only switch to a finer level once clearly above its threshold.
+    while(lod > 0 && in_fScreenSize > m_levels[lod-1].fMinScreenSize * (1.0f + m_fHysteresis)) {
+        --lod;
+    }
+
+    return lod;
+}
+
+void LodModel::submit(CommandList& io_cmds, const AffineMatrix& in_model, LodState& io_state) const
+{
+    if(m_levels.empty())
+        return;
+
+    // The selection happens right in the culling, which computes the size anyways.
+    float fScreenSize = 0.0f;
+    if(!io_cmds.cull(in_model, m_fRadius, fScreenSize))
+        return;
+
+    unsigned lod = this->select(fScreenSize, io_state.current);
+    io_state.current = static_cast<uint8_t>(lod);
+
+    m_levels[lod].pModel->submit(io_cmds, in_model, false);
+    io_cmds.countLod(lod == m_levels.size() - 1 ? D_MAX_LODS - 1 : lod);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "BuiltinModel.h"
+#include "RenderQueue.h"
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+namespace RoadRage {
+
+/// What a LodModel needs to remember per instance, between frames.
+struct LodState {
+    /// The level the instance was drawn with last.
+    uint8_t current;
+
+    LodState() : current(0) {}
+};
+
+/// A model with several levels of detail, from the most detailed one to an
+/// impostor. Which one gets drawn depends on how big the model is on screen.
+/// Around the thresholds, the level only changes once the size got a bit past
+/// them, so that models moving back and forth there don't flicker.
+class LodModel {
+public:
+    /// \param in_fHysteresis How far, relatively, the size must get past a
+    ///                       threshold for the level to change.
+    LodModel(float in_fHysteresis = 0.15f);
+    virtual ~LodModel();
+
+    /// Adds the next, coarser level. Levels need to be added from the most to
+    /// the least detailed one, the last one usually being an impostor.
+    /// \param in_fMinScreenSize The level is used while the model's bounding
+    ///                          sphere is at least this fraction of the
+    ///                          screen's height. Ignored for the last level.
+    LodModel& addLevel(const std::shared_ptr<BuiltinModel>& in_pModel, float in_fMinScreenSize);
+
+    /// Culls the model and queues drawing the right level, if it is visible.
+    /// This gets called for many instances in parallel, each having its own
+    /// \a io_state.
+    void submit(CommandList& io_cmds, const AffineMatrix& in_model, LodState& io_state) const;
+
+    /// \return The level to use for a size of \a in_fScreenSize on screen, when
+    ///         \a in_current was used until now.
+    unsigned select(float in_fScreenSize, unsigned in_current) const;
+
+    std::size_t levelCount() const { return m_levels.size(); }
+
+private:
+    // No copying!
+    LodModel(const LodModel&);
+    LodModel& operator=(const LodModel&);
+
+    struct Level {
+        std::shared_ptr<BuiltinModel> pModel;
+        float fMinScreenSize;
+    };
+
+    std::vector<Level> m_levels;
+    float m_fHysteresis;
+    /// The largest radius of all levels, used for culling.
+    float m_fRadius;
+};
+
+}
@@ -19,7 +19,6 @@ using namespace RoadRage;
 ////////////////////////////////////////////
 
 Vector::Vector()
-    : m_v(new float[4])
 {
     m_v[0] = 0.0f;
     m_v[1] = 0.0f;
@@ -28,7 +27,6 @@ Vector::Vector()
 }
 
 Vector::Vector(float in_v[3])
-    : m_v(new float[4])
 {
     m_v[0] = in_v[0];
     m_v[1] = in_v[1];
@@ -37,7 +35,6 @@ Vector::Vector(float in_v[3])
 }
 
 Vector::Vector(const Vector& in_v)
-    : m_v(new float[4])
 {
     m_v[0] = in_v.x();
     m_v[1] = in_v.y();
@@ -56,7 +53,6 @@ const Vector& Vector::operator=(const Vector& in_v)
 }
 
 Vector::Vector(float in_fX, float in_fY, float in_fZ)
-    : m_v(new float[4])
 {
     m_v[0] = in_fX;
     m_v[1] = in_fY;
@@ -65,7 +61,6 @@ Vector::Vector(float in_fX, float in_fY, float in_fZ)
 }
 
 Vector::Vector(float in_fX, float in_fY, float in_fZ, float in_fW)
-    : m_v(new float[4])
 {
     if(nearZero(in_fW)) {
         m_v[0] = in_fX;
@@ -81,7 +76,6 @@ Vector::Vector(float in_fX, float in_fY, float in_fZ, float in_fW)
 }
 
 Vector::Vector(const Vector& in_v, float in_fW)
-    : m_v(new float[4])
 {
     if(nearZero(in_fW)) {
         m_v[0] = in_v.x();
@@ -96,22 +90,8 @@ Vector::Vector(const Vector& in_v, float in_fW)
     }
 }
 
-Vector::Vector(Vector&& in_v)
-{
-    this->operator=(std::move(in_v));
-}
-
-const Vector& Vector::operator=(Vector&& in_v)
-{
-    m_v = in_v.m_v;
-    in_v.m_v = 0;
-
-    return *this;
-}
-
 Vector::~Vector()
 {
-    if(m_v) delete [] m_v;
 }
 
 ///////////////////////////////////////
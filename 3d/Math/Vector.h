@@ -90,13 +90,6 @@ public:
     /// \param in_v The vector to be copied.
     /// \return a const reference to myself that might be used as a rvalue.
     const Vector& operator=(const Vector& in_v);
-    /// Moves a vector.
-    /// \param in_v The vector to be moved.
-    Vector(Vector&& in_v);
-    /// Moves a vector.
-    /// \param in_v The vector to be moved.
-    /// \return a const reference to myself that might be used as a rvalue.
-    const Vector& operator=(Vector&& in_v);
     ~Vector();
 
     ///////////////////////////////////////
@@ -227,8 +220,9 @@ private:
     /// The three components of the vector.
     /// \note this array actually holds four components in case it needs to be
     ///       given to a function that requires that. The fourth component is
-    ///       always one though.
-    float* m_v;
+    ///       always one though. It's kept inline, as vectors are made and
+    ///       copied all the time, by the hundred thousands per frame.
+    float m_v[4];
 };
 
 ///////////////////////////
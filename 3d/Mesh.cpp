@@ -0,0 +1,123 @@
+#include "Mesh.h"
+
+#include "Utilities/i18n.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <stdexcept>
+
+using namespace RoadRage;
+
+Mesh::Mesh(const MeshData& in_data)
+    : m_vbo(new VertexBufferObject(in_data.vertices().data(), in_data.vertices().size()*sizeof(MeshVertex), sizeof(MeshVertex)))
+    , m_vao(new VertexArrayObject())
+    , m_fRadius(0.0f)
+{
+    for(auto i = in_data.vertices().begin() ; i != in_data.vertices().end() ; ++i) {
+        m_fRadius = std::max(m_fRadius, i->pos[0]*i->pos[0] + i->pos[1]*i->pos[1] + i->pos[2]*i->pos[2]);
+    }
+    m_fRadius = std::sqrt(m_fRadius);
+
+    if(in_data.hasShortIndices())
+        m_ebo.reset(new ElementsBufferObject(in_data.shortIndices(), 3));
+    else
+        m_ebo.reset(new ElementsBufferObject(in_data.indices(), 3));
+
+    // All shaders have the attributes at the same locations, so the vertex
+    // array works with whichever shader the mesh gets drawn with.
+    m_vao->bind();
+    m_vbo->bind();
+    const GLint pos = Shader::attributeLocation("aVertexPosition");
+    const GLint normal = Shader::attributeLocation("aVertexNormal");
+    const GLint uv = Shader::attributeLocation("aVertexTexCoord");
+    glEnableVertexAttribArray(pos);
+    glEnableVertexAttribArray(normal);
+    glEnableVertexAttribArray(uv);
+    glVertexAttribPointer(pos, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), reinterpret_cast<const GLvoid*>(offsetof(MeshVertex, pos)));
+    glVertexAttribPointer(normal, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), reinterpret_cast<const GLvoid*>(offsetof(MeshVertex, normal)));
+    glVertexAttribPointer(uv, 2, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), reinterpret_cast<const GLvoid*>(offsetof(MeshVertex, uv)));
+    m_ebo->bind();
+    m_vao->unbind();
+}
+
+Mesh::~Mesh()
+{
+}
+
+void Mesh::draw() const
+{
+    m_vao->bind();
+    glDrawElements(GL_TRIANGLES, m_ebo->count, m_ebo->indexType, 0);
+    VertexArrayObject::unbind();
+}
+
+Geometry Mesh::geometry() const
+{
+    return Geometry(m_vao->id, GL_TRIANGLES, m_ebo->count, m_ebo->indexType);
+}
+
+MeshModel::MeshModel(const Mesh::Ptr& in_pMesh, const Shader::Ptr& in_pShader, const Material& in_material)
+    : m_pMesh(in_pMesh)
+    , m_pShader(in_pShader)
+    , m_material(in_material)
+{
+}
+
+MeshModel::~MeshModel()
+{
+}
+
+void MeshModel::submit(CommandList& io_cmds, const AffineMatrix& in_model, bool in_bCull) const
+{
+    io_cmds.submit(*m_pShader, m_pMesh->geometry(), m_material, in_model, in_bCull ? this->radius() : -1.0f);
+}
+
+float MeshModel::radius() const
+{
+    return m_pMesh->radius();
+}
+
+MeshManager::MeshManager(const FileSystem& in_fs)
+    : m_fs(in_fs)
+{
+}
+
+MeshManager::~MeshManager()
+{
+}
+
+Mesh::Ptr MeshManager::getOrLoadMesh(const std::string& in_sName)
+{
+    auto i = m_mMeshes.find(in_sName);
+    if(i != m_mMeshes.end())
+        return i->second;
+
+    std::string full = std::string("Meshes/") + in_sName;
+    MeshData data;
+    FileView file = m_fs.read(full + ".rrmesh");
+    if(!file.valid() || !data.loadBinary(file.data(), file.size())) {
+        file = m_fs.read(full + ".obj");
+        if(!file.valid() || !data.loadObj(file.data(), file.size()))
+            throw std::runtime_error(_("The following file does not exist: ") + full + "[.rrmesh|.obj]");
+
+        // Raw meshes work, but they should really be optimized offline.
+        sf::Clock clock;
+        MeshData::Stats before = data.stats();
+        data.optimize();
+        MeshData::Stats after = data.stats();
+        std::cerr << _("Optimized the raw mesh ") << in_sName << _(" in ") << clock.GetElapsedTime()*1000.0f << "ms: "
+                  << before.nVertices << " -> " << after.nVertices << _(" vertices, ACMR ")
+                  << before.acmr << " -> " << after.acmr << std::endl;
+    }
+
+    if(data.indices().empty())
+        throw std::runtime_error(_("The following mesh is empty: ") + full);
+
+    m_mMeshes.insert(std::make_pair(in_sName, Mesh::Ptr(new Mesh(data))));
+
+    return m_mMeshes[in_sName];
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "BuiltinModel.h"
+#include "MeshData.h"
+#include "RenderQueue.h"
+#include "Shader.h"
+#include "VertexArrayObject.h"
+
+#include <map>
+#include <memory>
+#include <string>
+
+namespace RoadRage {
+
+/// A mesh that lives on the GPU: all vertex attributes interleaved in one
+/// vertex buffer and the smallest possible index type.
+class Mesh {
+public:
+    typedef std::shared_ptr<Mesh> Ptr;
+
+    /// Uploads \a in_data. It can be drawn with any shader, see Shader::attributeLocation.
+    Mesh(const MeshData& in_data);
+    virtual ~Mesh();
+
+    /// Draws the whole mesh. The shader and its uniforms need to be set up already.
+    void draw() const;
+
+    GLsizei indexCount() const { return m_ebo->count; }
+    /// \return What to hand to the RenderQueue for drawing the whole mesh.
+    Geometry geometry() const;
+    /// \return The radius of a sphere around the origin containing all vertices.
+    float radius() const { return m_fRadius; }
+
+private:
+    // No copying!
+    Mesh(const Mesh&);
+    Mesh& operator=(const Mesh&);
+
+    std::shared_ptr<VertexBufferObject> m_vbo;
+    std::shared_ptr<ElementsBufferObject> m_ebo;
+    std::shared_ptr<VertexArrayObject> m_vao;
+    float m_fRadius;
+};
+
+/// A mesh together with what to draw it with, so that it can be used wherever
+/// a model is expected, for example as a level of a LodModel.
+class MeshModel : public BuiltinModel {
+public:
+    MeshModel(const Mesh::Ptr& in_pMesh, const Shader::Ptr& in_pShader, const Material& in_material);
+    virtual ~MeshModel();
+
+    virtual void submit(CommandList& io_cmds, const AffineMatrix& in_model, bool in_bCull = true) const;
+    virtual float radius() const;
+
+private:
+    Mesh::Ptr m_pMesh;
+    Shader::Ptr m_pShader;
+    Material m_material;
+};
+
+/// This keeps track of all meshes loaded from disk, so that every mesh exists
+/// only once on the GPU, no matter how many entities use it.
+class MeshManager {
+public:
+    MeshManager(const FileSystem& in_fs);
+    virtual ~MeshManager();
+
+    /// Loads Meshes/<in_sName>.rrmesh, which is expected to be optimized
+    /// already, or Meshes/<in_sName>.obj which gets optimized on the fly.
+    /// \throws std::runtime_error if neither exists or can be read.
+    Mesh::Ptr getOrLoadMesh(const std::string& in_sName);
+
+private:
+    const FileSystem& m_fs;
+    std::map<std::string, Mesh::Ptr> m_mMeshes;
+};
+
+}
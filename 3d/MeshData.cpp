@@ -0,0 +1,454 @@
+#include "MeshData.h"
+
+#include "Utilities/Hash.h"
+#include "Utilities/i18n.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_map>
+
+using namespace RoadRage;
+
+#define D_MESH_MAGIC "RRMS"
+#define D_MESH_VERSION 1
+
+// The size of the vertex cache we optimize for. Being a bit bigger than the
+// real hardware's cache doesn't hurt much, while being smaller does.
+#define D_VCACHE_SIZE 32
+
+namespace {
+    struct BinaryHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t nVertices;
+        uint32_t nIndices;
+        uint32_t indexSize;
+    };
+
+    std::string extension(const std::string& in_sFile)
+    {
+        std::size_t dot = in_sFile.find_last_of('.');
+        return dot == std::string::npos ? "" : in_sFile.substr(dot + 1);
+    }
+
+    // Resolves a one-based, possibly negative (relative) OBJ index.
+    int objIndex(long i, std::size_t n)
+    {
+        return static_cast<int>(i < 0 ? static_cast<long>(n) + i : i - 1);
+    }
+
+    // The score of a vertex in Forsyth's algorithm: vertices that are in the
+    // cache and vertices with only few triangles left get preferred.
+    float vertexScore(int in_cachePos, uint32_t in_remaining)
+    {
+        if(in_remaining == 0)
+            return -1.0f;
+
+        float score = 0.0f;
+        if(in_cachePos >= 0) {
+            if(in_cachePos < 3) {
+                // The triangle we just emitted; don't make it too attractive
+                // to use these again, as it depends on the emission order.
+                score = 0.75f;
+            } else {
+                const float scaler = 1.0f / (D_VCACHE_SIZE - 3);
+                score = std::pow(1.0f - (in_cachePos - 3) * scaler, 1.5f);
+            }
+        }
+
+        // Boost vertices with few triangles left, so that we get rid of lone
+        // triangles early instead of leaving them for the end.
+        return score + 2.0f / std::sqrt(static_cast<float>(in_remaining));
+    }
+
+    struct VertexHash {
+        const std::vector<MeshVertex>* v;
+        std::size_t operator()(uint32_t i) const { return static_cast<std::size_t>(fnv1a(&(*v)[i], sizeof(MeshVertex))); }
+    };
+
+    struct VertexEqual {
+        const std::vector<MeshVertex>* v;
+        bool operator()(uint32_t a, uint32_t b) const { return std::memcmp(&(*v)[a], &(*v)[b], sizeof(MeshVertex)) == 0; }
+    };
+}
+
+bool MeshData::loadFile(const std::string& in_sFile)
+{
+    std::ifstream f(in_sFile.c_str(), std::ios::binary);
+    if(!f) return false;
+
+    std::vector<char> content((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    if(content.empty()) return false;
+
+    if(extension(in_sFile) == "obj")
+        return this->loadObj(&content[0], content.size());
+
+    return this->loadBinary(&content[0], content.size());
+}
+
+bool MeshData::loadObj(const char* in_data, std::size_t in_size)
+{
+    std::vector<float> positions, normals, uvs;
+    m_vertices.clear();
+    m_indices.clear();
+
+    // strtof and friends need null-terminated strings.
+    std::string text(in_data, in_size);
+    const char* p = text.c_str();
+
+    while(*p) {
+        const char* eol = std::strchr(p, '\n');
+        if(!eol) eol = p + std::strlen(p);
+
+        if(p[0] == 'v' && p[1] == ' ') {
+            char* end = const_cast<char*>(p) + 2;
+            for(int i = 0 ; i < 3 ; ++i) positions.push_back(std::strtof(end, &end));
+        } else if(p[0] == 'v' && p[1] == 'n' && p[2] == ' ') {
+            char* end = const_cast<char*>(p) + 3;
+            for(int i = 0 ; i < 3 ; ++i) normals.push_back(std::strtof(end, &end));
+        } else if(p[0] == 'v' && p[1] == 't' && p[2] == ' ') {
+            char* end = const_cast<char*>(p) + 3;
+            for(int i = 0 ; i < 2 ; ++i) uvs.push_back(std::strtof(end, &end));
+        } else if(p[0] == 'f' && p[1] == ' ') {
+            // Every corner becomes its own vertex, deduplicate merges them later.
+            std::size_t first = m_vertices.size();
+            char* end = const_cast<char*>(p) + 2;
+            bool bHasNormals = true;
+
+            while(end < eol) {
+                while(end < eol && (*end == ' ' || *end == '\t' || *end == '\r')) ++end;
+                if(end >= eol) break;
+
+                long iv = std::strtol(end, &end, 10), it = 0, in = 0;
+                if(*end == '/') {
+                    ++end;
+                    if(*end != '/') it = std::strtol(end, &end, 10);
+                    if(*end == '/') { ++end; in = std::strtol(end, &end, 10); }
+                }
+
+                int v = objIndex(iv, positions.size()/3);
+                if(iv == 0 || v < 0 || static_cast<std::size_t>(v) >= positions.size()/3)
+                    return false;
+
+                MeshVertex vert;
+                std::memset(&vert, 0, sizeof(vert));
+                std::copy(&positions[3*v], &positions[3*v] + 3, vert.pos);
+
+                int t = objIndex(it, uvs.size()/2);
+                if(it != 0 && t >= 0 && static_cast<std::size_t>(t) < uvs.size()/2)
+                    std::copy(&uvs[2*t], &uvs[2*t] + 2, vert.uv);
+
+                int n = objIndex(in, normals.size()/3);
+                if(in != 0 && n >= 0 && static_cast<std::size_t>(n) < normals.size()/3)
+                    std::copy(&normals[3*n], &normals[3*n] + 3, vert.normal);
+                else
+                    bHasNormals = false;
+
+                m_vertices.push_back(vert);
+            }
+
+            std::size_t nCorners = m_vertices.size() - first;
+            if(nCorners < 3)
+                return false;
+
+            // Triangulate as a fan.
+            for(std::size_t i = 2 ; i < nCorners ; ++i) {
+                m_indices.push_back(first);
+                m_indices.push_back(first + i - 1);
+                m_indices.push_back(first + i);
+            }
+
+            // Without normals, we use the face's normal, which gives flat shading.
+            if(!bHasNormals) {
+                const float* a = m_vertices[first].pos;
+                const float* b = m_vertices[first+1].pos;
+                const float* c = m_vertices[first+2].pos;
+                float u[3] = {b[0]-a[0], b[1]-a[1], b[2]-a[2]};
+                float w[3] = {c[0]-a[0], c[1]-a[1], c[2]-a[2]};
+                float nrm[3] = {u[1]*w[2]-u[2]*w[1], u[2]*w[0]-u[0]*w[2], u[0]*w[1]-u[1]*w[0]};
+                float len = std::sqrt(nrm[0]*nrm[0] + nrm[1]*nrm[1] + nrm[2]*nrm[2]);
+                if(len > 0.0f) { nrm[0] /= len; nrm[1] /= len; nrm[2] /= len; }
+
+                for(std::size_t i = first ; i < m_vertices.size() ; ++i) {
+                    std::copy(nrm, nrm + 3, m_vertices[i].normal);
+                }
+            }
+        }
+
+        p = *eol ? eol + 1 : eol;
+    }
+
+    return !m_indices.empty();
+}
+
+bool MeshData::loadBinary(const char* in_data, std::size_t in_size)
+{
+    BinaryHeader h;
+    if(in_size < sizeof(h))
+        return false;
+
+    std::memcpy(&h, in_data, sizeof(h));
+    if(std::memcmp(h.magic, D_MESH_MAGIC, 4) != 0 || h.version != D_MESH_VERSION || (h.indexSize != 2 && h.indexSize != 4))
+        return false;
+
+    std::size_t vertexBytes = h.nVertices * sizeof(MeshVertex);
+    std::size_t indexBytes = h.nIndices * h.indexSize;
+    if(in_size < sizeof(h) + vertexBytes + indexBytes)
+        return false;
+
+    const char* p = in_data + sizeof(h);
+    m_vertices.resize(h.nVertices);
+    if(h.nVertices > 0)
+        std::memcpy(&m_vertices[0], p, vertexBytes);
+    p += vertexBytes;
+
+    m_indices.resize(h.nIndices);
+    if(h.indexSize == 4) {
+        if(h.nIndices > 0)
+            std::memcpy(&m_indices[0], p, indexBytes);
+    } else {
+        const uint16_t* idx = reinterpret_cast<const uint16_t*>(p);
+        std::copy(idx, idx + h.nIndices, m_indices.begin());
+    }
+
+    return true;
+}
+
+std::vector<char> MeshData::toBinary() const
+{
+    BinaryHeader h;
+    std::memcpy(h.magic, D_MESH_MAGIC, 4);
+    h.version = D_MESH_VERSION;
+    h.nVertices = m_vertices.size();
+    h.nIndices = m_indices.size();
+    h.indexSize = this->indexSize();
+
+    std::size_t vertexBytes = m_vertices.size()*sizeof(MeshVertex);
+    std::vector<char> out(sizeof(h) + vertexBytes + m_indices.size()*h.indexSize);
+    char* p = &out[0];
+    std::memcpy(p, &h, sizeof(h));
+    p += sizeof(h);
+
+    if(!m_vertices.empty())
+        std::memcpy(p, &m_vertices[0], vertexBytes);
+    p += vertexBytes;
+
+    if(this->hasShortIndices()) {
+        std::vector<uint16_t> idx = this->shortIndices();
+        if(!idx.empty())
+            std::memcpy(p, &idx[0], idx.size()*sizeof(uint16_t));
+    } else if(!m_indices.empty()) {
+        std::memcpy(p, &m_indices[0], m_indices.size()*sizeof(uint32_t));
+    }
+
+    return out;
+}
+
+void MeshData::saveBinary(const std::string& in_sFile) const
+{
+    std::ofstream f(in_sFile.c_str(), std::ios::binary | std::ios::trunc);
+
+    std::vector<char> data = this->toBinary();
+    f.write(&data[0], data.size());
+
+    if(!f)
+        throw std::runtime_error(_("Failed to write the mesh file ") + in_sFile);
+}
+
+void MeshData::deduplicate()
+{
+    VertexHash hash = {&m_vertices};
+    VertexEqual equal = {&m_vertices};
+    std::unordered_map<uint32_t, uint32_t, VertexHash, VertexEqual> unique(m_vertices.size(), hash, equal);
+
+    std::vector<MeshVertex> vertices;
+    vertices.reserve(m_vertices.size());
+
+    std::vector<uint32_t> remap(m_vertices.size());
+    for(uint32_t i = 0 ; i < m_vertices.size() ; ++i) {
+        auto found = unique.find(i);
+        if(found == unique.end()) {
+            remap[i] = vertices.size();
+            unique.insert(std::make_pair(i, remap[i]));
+            vertices.push_back(m_vertices[i]);
+        } else {
+            remap[i] = found->second;
+        }
+    }
+
+    for(auto i = m_indices.begin() ; i != m_indices.end() ; ++i) {
+        *i = remap[*i];
+    }
+
+    // The map refers to the old vertices, so it has to go before we swap.
+    unique.clear();
+    m_vertices.swap(vertices);
+}
+
+void MeshData::optimizeVertexCache()
+{
+    const std::size_t nTris = m_indices.size() / 3;
+    const std::size_t nVerts = m_vertices.size();
+    if(nTris == 0)
+        return;
+
+    // For every vertex, the list of triangles still using it. They are all
+    // stored in one array, the not-yet-emitted ones at the front of each list.
+    std::vector<uint32_t> remaining(nVerts, 0);
+    for(auto i = m_indices.begin() ; i != m_indices.end() ; ++i) {
+        ++remaining[*i];
+    }
+
+    std::vector<uint32_t> offset(nVerts + 1, 0);
+    for(std::size_t v = 0 ; v < nVerts ; ++v) {
+        offset[v+1] = offset[v] + remaining[v];
+    }
+
+    std::vector<uint32_t> adjacency(m_indices.size());
+    std::vector<uint32_t> fill(offset.begin(), offset.end() - 1);
+    for(std::size_t t = 0 ; t < nTris ; ++t) {
+        for(int k = 0 ; k < 3 ; ++k) {
+            uint32_t v = m_indices[3*t + k];
+            adjacency[fill[v]++] = t;
+        }
+    }
+
+    std::vector<int> cachePos(nVerts, -1);
+    std::vector<float> vScore(nVerts);
+    for(std::size_t v = 0 ; v < nVerts ; ++v) {
+        vScore[v] = vertexScore(-1, remaining[v]);
+    }
+
+    std::vector<float> tScore(nTris);
+    std::vector<bool> emitted(nTris, false);
+    int bestTri = 0;
+    for(std::size_t t = 0 ; t < nTris ; ++t) {
+        tScore[t] = vScore[m_indices[3*t]] + vScore[m_indices[3*t+1]] + vScore[m_indices[3*t+2]];
+        if(tScore[t] > tScore[bestTri])
+            bestTri = t;
+    }
+
+    std::vector<uint32_t> out;
+    out.reserve(m_indices.size());
+    std::vector<uint32_t> cache, newCache;
+    cache.reserve(D_VCACHE_SIZE + 3);
+    newCache.reserve(D_VCACHE_SIZE + 3);
+    std::size_t scanCursor = 0;
+
+    for(std::size_t n = 0 ; n < nTris ; ++n) {
+        if(bestTri < 0) {
+            // Nothing in the cache is of any use anymore, just pick the next
+            // triangle that's left. This happens rarely, so a scan is fine.
+            while(emitted[scanCursor]) ++scanCursor;
+            bestTri = scanCursor;
+        }
+
+        const uint32_t* tri = &m_indices[3*bestTri];
+        emitted[bestTri] = true;
+        out.insert(out.end(), tri, tri + 3);
+
+        // Remove the triangle from its vertices' lists of remaining triangles.
+        for(int k = 0 ; k < 3 ; ++k) {
+            uint32_t v = tri[k];
+            uint32_t* begin = &adjacency[offset[v]];
+            uint32_t* last = begin + remaining[v] - 1;
+            *std::find(begin, last, static_cast<uint32_t>(bestTri)) = *last;
+            --remaining[v];
+        }
+
+        // The triangle's vertices move to the front of the LRU cache.
+        newCache.assign(tri, tri + 3);
+        for(auto i = cache.begin() ; i != cache.end() ; ++i) {
+            if(*i != tri[0] && *i != tri[1] && *i != tri[2])
+                newCache.push_back(*i);
+        }
+
+        for(std::size_t i = 0 ; i < newCache.size() ; ++i) {
+            uint32_t v = newCache[i];
+            cachePos[v] = i < D_VCACHE_SIZE ? static_cast<int>(i) : -1;
+            vScore[v] = vertexScore(cachePos[v], remaining[v]);
+        }
+
+        // Only the triangles touching the cache changed their score, and the
+        // best next triangle is very likely to be among them.
+        bestTri = -1;
+        float bestScore = -1.0f;
+        for(auto i = newCache.begin() ; i != newCache.end() ; ++i) {
+            for(uint32_t j = offset[*i] ; j < offset[*i] + remaining[*i] ; ++j) {
+                uint32_t t = adjacency[j];
+                tScore[t] = vScore[m_indices[3*t]] + vScore[m_indices[3*t+1]] + vScore[m_indices[3*t+2]];
+                if(tScore[t] > bestScore) {
+                    bestScore = tScore[t];
+                    bestTri = t;
+                }
+            }
+        }
+
+        if(newCache.size() > D_VCACHE_SIZE)
+            newCache.resize(D_VCACHE_SIZE);
+        cache.swap(newCache);
+    }
+
+    m_indices.swap(out);
+}
+
+void MeshData::optimizeVertexFetch()
+{
+    const uint32_t unused = static_cast<uint32_t>(-1);
+    std::vector<uint32_t> remap(m_vertices.size(), unused);
+    std::vector<MeshVertex> vertices;
+    vertices.reserve(m_vertices.size());
+
+    for(auto i = m_indices.begin() ; i != m_indices.end() ; ++i) {
+        if(remap[*i] == unused) {
+            remap[*i] = vertices.size();
+            vertices.push_back(m_vertices[*i]);
+        }
+        *i = remap[*i];
+    }
+
+    // Vertices not used by any triangle get dropped on the way.
+    m_vertices.swap(vertices);
+}
+
+void MeshData::optimize()
+{
+    this->deduplicate();
+    this->optimizeVertexCache();
+    this->optimizeVertexFetch();
+}
+
+MeshData::Stats MeshData::stats(std::size_t in_cacheSize) const
+{
+    Stats s;
+    s.nVertices = m_vertices.size();
+    s.nTriangles = m_indices.size() / 3;
+    s.vertexBytes = m_vertices.size() * sizeof(MeshVertex);
+    s.indexBytes = m_indices.size() * this->indexSize();
+
+    // Simulate a FIFO cache, which is what most hardware does.
+    std::deque<uint32_t> fifo;
+    std::size_t misses = 0;
+    for(auto i = m_indices.begin() ; i != m_indices.end() ; ++i) {
+        if(std::find(fifo.begin(), fifo.end(), *i) == fifo.end()) {
+            ++misses;
+            fifo.push_back(*i);
+            if(fifo.size() > in_cacheSize)
+                fifo.pop_front();
+        }
+    }
+    s.acmr = s.nTriangles ? static_cast<float>(misses) / s.nTriangles : 0.0f;
+
+    return s;
+}
+
+std::vector<uint16_t> MeshData::shortIndices() const
+{
+    return std::vector<uint16_t>(m_indices.begin(), m_indices.end());
+}
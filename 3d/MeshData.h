@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace RoadRage {
+
+/// The interleaved layout of a vertex as it lives in a vertex buffer.
+struct MeshVertex {
+    float pos[3];
+    float normal[3];
+    float uv[2];
+};
+
+/// This class holds the geometry of a mesh on the CPU side and implements all
+/// the processing we do on it before it goes to the GPU. It doesn't use
+/// OpenGL at all, so it can be used by offline tools too.
+class MeshData {
+public:
+    /// Some numbers about the mesh, mainly for comparing before/after optimizing.
+    struct Stats {
+        std::size_t nVertices;
+        std::size_t nTriangles;
+        std::size_t vertexBytes;
+        std::size_t indexBytes;
+        /// The Average Cache Miss Ratio, that is the number of vertices the
+        /// GPU has to transform per triangle. 0.5 is the ideal, 3 the worst.
+        float acmr;
+    };
+
+    /// Loads a mesh from a file, either a Wavefront OBJ (.obj) or our own
+    /// binary format (.rrmesh), depending on the extension.
+    /// \return false if the file doesn't exist or couldn't be parsed.
+    bool loadFile(const std::string& in_sFile);
+    /// Parses a Wavefront OBJ file that has been read to memory.
+    /// Polygons are triangulated as fans, missing normals are computed.
+    bool loadObj(const char* in_data, std::size_t in_size);
+    /// Reads a mesh stored in our own binary format from memory.
+    bool loadBinary(const char* in_data, std::size_t in_size);
+    /// Writes the mesh in our own binary format, using 16-bit indices if possible.
+    /// \throws std::runtime_error if the file can't be written.
+    void saveBinary(const std::string& in_sFile) const;
+    /// \return The mesh in our own binary format, as saveBinary would write it.
+    std::vector<char> toBinary() const;
+
+    /// Merges vertices that are bit-wise identical.
+    void deduplicate();
+    /// Reorders the triangles for a better post-transform vertex cache hit
+    /// rate (Tom Forsyth's linear-speed vertex cache optimisation).
+    void optimizeVertexCache();
+    /// Reorders the vertices in the order they are first used by the
+    /// triangles for a better pre-transform (memory) cache locality.
+    /// Do this after optimizeVertexCache.
+    void optimizeVertexFetch();
+    /// Does all of the above.
+    void optimize();
+
+    /// \return true if all indices fit into 16 bits.
+    bool hasShortIndices() const { return m_vertices.size() <= 0x10000; }
+    /// \return The size of an index in bytes: 2 or 4.
+    std::size_t indexSize() const { return this->hasShortIndices() ? 2 : 4; }
+    /// \param in_cacheSize The size of the FIFO cache to simulate.
+    Stats stats(std::size_t in_cacheSize = 16) const;
+
+    const std::vector<MeshVertex>& vertices() const { return m_vertices; }
+    const std::vector<uint32_t>& indices() const { return m_indices; }
+    /// \return The indices converted to 16 bits. Only valid if hasShortIndices.
+    std::vector<uint16_t> shortIndices() const;
+
+private:
+    std::vector<MeshVertex> m_vertices;
+    std::vector<uint32_t> m_indices;
+};
+
+}
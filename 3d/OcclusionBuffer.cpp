@@ -0,0 +1,398 @@
+#include "OcclusionBuffer.h"
+
+#include "3d/DebugDraw.h"
+#include "Utilities/ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
+using namespace RoadRage;
+
+/// How many rows a worker rasterizes at once. No triangle is split between
+/// workers in any other way, so this also is how finely the work is spread.
+#define D_OCCLUSION_STRIP 8
+/// How many levels of the hierarchy can be built from one strip alone.
+#define D_OCCLUSION_STRIP_LEVELS 3
+/// Occluders get clipped at this w, which is a bit in front of the camera.
+#define D_OCCLUSION_NEAR 0.1f
+
+namespace {
+    /// The corners of every face of a box, counter-clockwise seen from the
+    /// outside. Bit 0, 1 and 2 of a corner's index tell if it's at the max
+    /// x, y and z.
+    const unsigned g_boxFaces[6][4] = { { 0, 4, 6, 2 }, { 1, 3, 7, 5 },
+                                        { 0, 1, 5, 4 }, { 2, 6, 7, 3 },
+                                        { 0, 2, 3, 1 }, { 4, 5, 7, 6 } };
+
+    /// Transforms the corner \a in_i of the box [\a in_min, \a in_max] into
+    /// clip space, by the column-major \a m.
+    void clipCorner(const float* m, const Vector& in_min, const Vector& in_max, unsigned in_i, float* out_c)
+    {
+        const float x = in_i & 1 ? in_max.x() : in_min.x();
+        const float y = in_i & 2 ? in_max.y() : in_min.y();
+        const float z = in_i & 4 ? in_max.z() : in_min.z();
+        for(unsigned j = 0 ; j < 4 ; ++j) {
+            out_c[j] = m[j]*x + m[4+j]*y + m[8+j]*z + m[12+j];
+        }
+    }
+}
+
+OcclusionBuffer::OcclusionBuffer()
+    : m_bDebug(false)
+{
+    std::fill(m_viewProj, m_viewProj + 16, 0.0f);
+    for(unsigned l = 0 ; l < D_OCCLUSION_LEVELS ; ++l) {
+        m_levels[l].resize(levelWidth(l) * levelHeight(l), 0.0f);
+    }
+}
+
+OcclusionBuffer::~OcclusionBuffer()
+{
+}
+
+void OcclusionBuffer::render(const General4x4Matrix& in_viewProj, const std::vector<Occluder>& in_occluders, ThreadPool& io_workers)
+{
+    std::copy(in_viewProj.array16f(), in_viewProj.array16f() + 16, m_viewProj);
+
+    m_faces.resize(io_workers.size());
+    for(auto i = m_faces.begin() ; i != m_faces.end() ; ++i) {
+        i->clear();
+    }
+
+    // First, every worker transforms, clips and sets up faces on its own.
+    io_workers.parallelFor(in_occluders.size(), [this, &in_occluders](std::size_t in_begin, std::size_t in_end, unsigned in_worker) {
+        for(std::size_t i = in_begin ; i < in_end ; ++i) {
+            this->setup(in_occluders[i], m_faces[in_worker]);
+        }
+    }, 64);
+
+    // Then, every worker rasterizes all of them into its own rows.
+    io_workers.parallelFor(D_OCCLUSION_HEIGHT / D_OCCLUSION_STRIP, [this](std::size_t in_begin, std::size_t in_end, unsigned) {
+        for(std::size_t i = in_begin ; i < in_end ; ++i) {
+            this->rasterize(static_cast<unsigned>(i));
+        }
+    }, 1);
+
+    // The coarsest levels are too small to be worth spreading.
+    for(unsigned l = D_OCCLUSION_STRIP_LEVELS + 1 ; l < D_OCCLUSION_LEVELS ; ++l) {
+        this->reduce(l, 0, levelHeight(l));
+    }
+
+    if(m_bDebug) {
+        for(auto i = in_occluders.begin() ; i != in_occluders.end() ; ++i) {
+            debugBox(i->min, i->max, Vector(0.5f, 0.5f, 0.5f));
+        }
+    }
+}
+
+void OcclusionBuffer::setup(const Occluder& in_occluder, std::vector<Face>& out_faces) const
+{
+    float corners[8][4];
+    unsigned allOut = ~0u;
+    for(unsigned i = 0 ; i < 8 ; ++i) {
+        float* c = corners[i];
+        clipCorner(m_viewProj, in_occluder.min, in_occluder.max, i, c);
+
+        unsigned out = 0;
+        if(c[0] < -c[3]) out |= 1;
+        if(c[0] >  c[3]) out |= 2;
+        if(c[1] < -c[3]) out |= 4;
+        if(c[1] >  c[3]) out |= 8;
+        if(c[3] < D_OCCLUSION_NEAR) out |= 16;
+        allOut &= out;
+    }
+
+    // All corners outside of the same plane: the box is entirely out of view.
+    if(allOut)
+        return;
+
+    for(unsigned f = 0 ; f < 6 ; ++f) {
+        // Clipping a face at the near plane may give it one more corner.
+        float poly[5][4];
+        unsigned n = 0;
+        for(unsigned i = 0 ; i < 4 ; ++i) {
+            const float* a = corners[g_boxFaces[f][i]];
+            const float* b = corners[g_boxFaces[f][(i+1) % 4]];
+            const bool bAIn = a[3] >= D_OCCLUSION_NEAR;
+            const bool bBIn = b[3] >= D_OCCLUSION_NEAR;
+
+            if(bAIn) {
+                std::copy(a, a + 4, poly[n++]);
+            }
+            if(bAIn != bBIn) {
+                const float t = (D_OCCLUSION_NEAR - a[3]) / (b[3] - a[3]);
+                for(unsigned j = 0 ; j < 4 ; ++j) {
+                    poly[n][j] = a[j] + t * (b[j] - a[j]);
+                }
+                ++n;
+            }
+        }
+
+        if(n >= 3)
+            this->addFace(poly, n, out_faces);
+    }
+}
+
+void OcclusionBuffer::addFace(const float (*in_v)[4], unsigned in_n, std::vector<Face>& out_faces) const
+{
+    float x[5], y[5], iw[5];
+    for(unsigned i = 0 ; i < in_n ; ++i) {
+        iw[i] = 1.0f / in_v[i][3];
+        x[i] = (in_v[i][0] * iw[i] * 0.5f + 0.5f) * D_OCCLUSION_WIDTH;
+        y[i] = (in_v[i][1] * iw[i] * 0.5f + 0.5f) * D_OCCLUSION_HEIGHT;
+    }
+
+    // Back-facing faces are always behind front-facing ones of the same
+    // occluder, so they're skipped, together with the degenerate ones. While
+    // at it, find the biggest triangle of the fan for the depth's plane.
+    float fArea = 0.0f, fBest = 0.0f;
+    unsigned best = 2;
+    for(unsigned i = 2 ; i < in_n ; ++i) {
+        const float fTri = (x[i-1] - x[0]) * (y[i] - y[0]) - (y[i-1] - y[0]) * (x[i] - x[0]);
+        fArea += fTri;
+        if(fTri > fBest) {
+            fBest = fTri;
+            best = i;
+        }
+    }
+    if(fArea <= 0.0f || fBest <= 0.0f)
+        return;
+
+    Face f;
+    f.minX = f.minY = std::numeric_limits<int>::max();
+    f.maxX = f.maxY = std::numeric_limits<int>::min();
+    for(unsigned i = 0 ; i < in_n ; ++i) {
+        f.minX = std::min(f.minX, static_cast<int>(std::floor(x[i])));
+        f.minY = std::min(f.minY, static_cast<int>(std::floor(y[i])));
+        f.maxX = std::max(f.maxX, static_cast<int>(std::ceil(x[i])));
+        f.maxY = std::max(f.maxY, static_cast<int>(std::ceil(y[i])));
+    }
+    f.minX = std::max(f.minX, 0);
+    f.minY = std::max(f.minY, 0);
+    f.maxX = std::min(f.maxX, D_OCCLUSION_WIDTH - 1);
+    f.maxY = std::min(f.maxY, D_OCCLUSION_HEIGHT - 1);
+    if(f.minX > f.maxX || f.minY > f.maxY)
+        return;
+
+    // Edge i goes from vertex i to the next one and is positive on its left,
+    // where the inside is. Only pixels entirely covered may hide anything, or
+    // we'd close the gaps between buildings, so the edges are moved inwards
+    // by half a pixel's extent along them.
+    for(unsigned i = 0 ; i < 5 ; ++i) {
+        if(i < in_n) {
+            const unsigned j = (i + 1) % in_n;
+            f.a[i] = y[i] - y[j];
+            f.b[i] = x[j] - x[i];
+            f.c[i] = -(f.a[i] * x[i] + f.b[i] * y[i]) - 0.5f * (std::fabs(f.a[i]) + std::fabs(f.b[i]));
+        } else {
+            f.a[i] = f.b[i] = 0.0f;
+            f.c[i] = 1.0f;
+        }
+    }
+
+    // 1/w is linear in screen space, and the face is flat, so one triangle's
+    // barycentric coordinates give the plane for all of it. The depth then
+    // gets moved back to the farthest one within a pixel.
+    const unsigned t[3] = { 0, best - 1, best };
+    float ta[3], tb[3], tc[3];
+    for(unsigned i = 0 ; i < 3 ; ++i) {
+        const unsigned i0 = t[i], i1 = t[(i + 1) % 3];
+        ta[i] = y[i0] - y[i1];
+        tb[i] = x[i1] - x[i0];
+        tc[i] = -(ta[i] * x[i0] + tb[i] * y[i0]);
+    }
+    const float fInvArea = 1.0f / fBest;
+    f.dzdx = (ta[1] * iw[t[0]] + ta[2] * iw[t[1]] + ta[0] * iw[t[2]]) * fInvArea;
+    f.dzdy = (tb[1] * iw[t[0]] + tb[2] * iw[t[1]] + tb[0] * iw[t[2]]) * fInvArea;
+    f.z0   = (tc[1] * iw[t[0]] + tc[2] * iw[t[1]] + tc[0] * iw[t[2]]) * fInvArea;
+    f.z0 -= 0.5f * (std::fabs(f.dzdx) + std::fabs(f.dzdy));
+
+    out_faces.push_back(f);
+}
+
+void OcclusionBuffer::rasterize(unsigned in_strip)
+{
+    const int y0 = in_strip * D_OCCLUSION_STRIP;
+    const int y1 = y0 + D_OCCLUSION_STRIP - 1;
+
+    std::fill(m_levels[0].begin() + y0 * D_OCCLUSION_WIDTH, m_levels[0].begin() + (y1 + 1) * D_OCCLUSION_WIDTH, 0.0f);
+
+    for(auto list = m_faces.begin() ; list != m_faces.end() ; ++list) {
+        for(auto f = list->begin() ; f != list->end() ; ++f) {
+            if(f->maxY >= y0 && f->minY <= y1)
+                this->rasterize(*f, y0, y1);
+        }
+    }
+
+    for(unsigned l = 1 ; l <= D_OCCLUSION_STRIP_LEVELS ; ++l) {
+        this->reduce(l, y0 >> l, (y1 + 1) >> l);
+    }
+}
+
+void OcclusionBuffer::rasterize(const Face& f, int in_y0, int in_y1)
+{
+    const int y0 = std::max(f.minY, in_y0);
+    const int y1 = std::min(f.maxY, in_y1);
+    // Starting on a multiple of four is fine as the width is one too, and the
+    // edge functions take care of the pixels left of the face.
+    const int x0 = f.minX & ~3;
+    const int x1 = f.maxX;
+
+#if defined(__SSE2__)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 px0 = _mm_add_ps(_mm_set1_ps(static_cast<float>(x0)), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+
+    __m128 a[5], step[5];
+    for(unsigned i = 0 ; i < 5 ; ++i) {
+        a[i] = _mm_set1_ps(f.a[i]);
+        step[i] = _mm_set1_ps(4.0f * f.a[i]);
+    }
+    const __m128 dzdx = _mm_set1_ps(f.dzdx);
+    const __m128 zStep = _mm_set1_ps(4.0f * f.dzdx);
+
+    for(int y = y0 ; y <= y1 ; ++y) {
+        const float py = y + 0.5f;
+        float* row = &m_levels[0][y * D_OCCLUSION_WIDTH];
+
+        __m128 e[5];
+        for(unsigned i = 0 ; i < 5 ; ++i) {
+            e[i] = _mm_add_ps(_mm_mul_ps(a[i], px0), _mm_set1_ps(f.b[i] * py + f.c[i]));
+        }
+        __m128 z = _mm_add_ps(_mm_mul_ps(dzdx, px0), _mm_set1_ps(f.dzdy * py + f.z0));
+
+        for(int x = x0 ; x <= x1 ; x += 4) {
+            __m128 inside = _mm_and_ps(_mm_cmpge_ps(e[0], zero), _mm_cmpge_ps(e[1], zero));
+            inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpge_ps(e[2], zero), _mm_cmpge_ps(e[3], zero)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(e[4], zero));
+            if(_mm_movemask_ps(inside)) {
+                const __m128 old = _mm_loadu_ps(row + x);
+                const __m128 nearest = _mm_max_ps(old, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+            }
+
+            for(unsigned i = 0 ; i < 5 ; ++i) {
+                e[i] = _mm_add_ps(e[i], step[i]);
+            }
+            z = _mm_add_ps(z, zStep);
+        }
+    }
+#else
+    for(int y = y0 ; y <= y1 ; ++y) {
+        const float py = y + 0.5f;
+        float* row = &m_levels[0][y * D_OCCLUSION_WIDTH];
+
+        for(int x = x0 ; x <= x1 ; ++x) {
+            const float px = x + 0.5f;
+            bool bInside = true;
+            for(unsigned i = 0 ; i < 5 && bInside ; ++i) {
+                bInside = f.a[i]*px + f.b[i]*py + f.c[i] >= 0.0f;
+            }
+            if(bInside)
+                row[x] = std::max(row[x], f.z0 + f.dzdx*px + f.dzdy*py);
+        }
+    }
+#endif
+}
+
+void OcclusionBuffer::reduce(unsigned in_level, unsigned in_y0, unsigned in_y1)
+{
+    const std::vector<float>& src = m_levels[in_level - 1];
+    std::vector<float>& dst = m_levels[in_level];
+    const unsigned srcW = levelWidth(in_level - 1);
+    const unsigned w = levelWidth(in_level);
+
+    // Keep the farthest depth, so that whatever is in front of a texel is in
+    // front of everything that texel covers.
+    for(unsigned y = in_y0 ; y < in_y1 ; ++y) {
+        const float* r0 = &src[2*y * srcW];
+        const float* r1 = r0 + srcW;
+        for(unsigned x = 0 ; x < w ; ++x) {
+            dst[y*w + x] = std::min(std::min(r0[2*x], r0[2*x+1]), std::min(r1[2*x], r1[2*x+1]));
+        }
+    }
+}
+
+bool OcclusionBuffer::visible(const Vector& in_min, const Vector& in_max) const
+{
+    float minX = D_OCCLUSION_WIDTH, minY = D_OCCLUSION_HEIGHT;
+    float maxX = 0.0f, maxY = 0.0f;
+    float fNearest = 0.0f;
+    for(unsigned i = 0 ; i < 8 ; ++i) {
+        float c[4];
+        clipCorner(m_viewProj, in_min, in_max, i, c);
+        if(c[3] < D_OCCLUSION_NEAR)
+            return true;
+
+        const float iw = 1.0f / c[3];
+        const float x = (c[0] * iw * 0.5f + 0.5f) * D_OCCLUSION_WIDTH;
+        const float y = (c[1] * iw * 0.5f + 0.5f) * D_OCCLUSION_HEIGHT;
+        minX = std::min(minX, x); maxX = std::max(maxX, x);
+        minY = std::min(minY, y); maxY = std::max(maxY, y);
+        fNearest = std::max(fNearest, iw);
+    }
+
+    if(maxX < 0.0f || maxY < 0.0f || minX >= D_OCCLUSION_WIDTH || minY >= D_OCCLUSION_HEIGHT)
+        return true;
+
+    const int x0 = std::max(0, static_cast<int>(minX));
+    const int y0 = std::max(0, static_cast<int>(minY));
+    const int x1 = std::min(D_OCCLUSION_WIDTH - 1, static_cast<int>(maxX));
+    const int y1 = std::min(D_OCCLUSION_HEIGHT - 1, static_cast<int>(maxY));
+
+    // Go up the hierarchy until the box covers at most 4x4 texels.
+    unsigned l = 0;
+    while(l + 1 < D_OCCLUSION_LEVELS && ((x1 >> l) - (x0 >> l) >= 4 || (y1 >> l) - (y0 >> l) >= 4)) {
+        ++l;
+    }
+
+    const std::vector<float>& level = m_levels[l];
+    const int w = levelWidth(l);
+    for(int y = y0 >> l ; y <= y1 >> l ; ++y) {
+        for(int x = x0 >> l ; x <= x1 >> l ; ++x) {
+            // Something of this texel is farther away than the box's nearest
+            // point, so it might be seen there.
+            if(level[y*w + x] <= fNearest)
+                return true;
+        }
+    }
+
+    if(m_bDebug)
+        debugBox(in_min, in_max, Vector(1.0f, 0.0f, 1.0f));
+
+    return false;
+}
+
+std::size_t OcclusionBuffer::faceCount() const
+{
+    std::size_t n = 0;
+    for(auto i = m_faces.begin() ; i != m_faces.end() ; ++i) {
+        n += i->size();
+    }
+    return n;
+}
+
+bool OcclusionBuffer::writeImage(const std::string& in_sFile, unsigned in_level) const
+{
+    const std::vector<float>& level = m_levels[std::min(in_level, D_OCCLUSION_LEVELS - 1u)];
+    const unsigned w = levelWidth(std::min(in_level, D_OCCLUSION_LEVELS - 1u));
+    const unsigned h = static_cast<unsigned>(level.size()) / w;
+    const float fMax = std::max(*std::max_element(level.begin(), level.end()), 1e-6f);
+
+    std::ofstream f(in_sFile.c_str(), std::ios::binary | std::ios::trunc);
+    f << "P5\n" << w << " " << h << "\n255\n";
+
+    // Images go top to bottom, the buffer bottom to top.
+    for(unsigned y = h ; y-- > 0 ; ) {
+        for(unsigned x = 0 ; x < w ; ++x) {
+            f.put(static_cast<char>(level[y*w + x] / fMax * 255.0f));
+        }
+    }
+
+    return static_cast<bool>(f);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "3d/Math/Matrix.h"
+#include "3d/Math/Vector.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// The resolution the occluders get rasterized at. Only big things hide
+/// others, so a low resolution does, and keeps it cheap.
+#define D_OCCLUSION_WIDTH 256
+#define D_OCCLUSION_HEIGHT 128
+/// How many levels the hierarchical depth buffer has, the full resolution
+/// being the first one.
+#define D_OCCLUSION_LEVELS 6
+
+namespace RoadRage {
+
+class ThreadPool;
+
+/// An axis-aligned box hiding whatever is behind it, usually a building.
+struct Occluder {
+    Vector min;
+    Vector max;
+
+    Occluder(const Vector& in_min = Vector(), const Vector& in_max = Vector()) : min(in_min), max(in_max) {}
+};
+
+/// A small depth buffer the occluders get rasterized into on the CPU, every
+/// frame, so that entities hidden behind them never even enter the render
+/// queue. This works the same without any GPU at all, and doesn't have the
+/// frame of latency occlusion queries have.\n
+/// The occluders' faces are rasterized four pixels at a time with SSE, and
+/// the rows of the buffer are split among the workers. Once done, it gets
+/// reduced into a hierarchy of ever coarser levels, each texel keeping the
+/// farthest depth of the four below it. Testing a box then only needs to look
+/// at a handful of texels of the level matching the box's size on screen.\n
+/// What is stored is 1/w, which is linear in screen space and bigger for
+/// nearer things. 0 means there's nothing.
+class OcclusionBuffer {
+public:
+    OcclusionBuffer();
+    virtual ~OcclusionBuffer();
+
+    /// Clears the buffer and rasterizes \a in_occluders, as seen through
+    /// \a in_viewProj, into it, using \a io_workers.
+    void render(const General4x4Matrix& in_viewProj, const std::vector<Occluder>& in_occluders, ThreadPool& io_workers);
+
+    /// Tests whether an axis-aligned box could be seen. Errs on the side of
+    /// visibility: boxes crossing the near plane or outside of the screen are
+    /// always visible, it's the frustum culling's job to get rid of those.\n
+    /// This only reads the buffer and thus may be called from many threads at
+    /// once, as long as it's not during render.
+    /// \return false if the box is hidden behind the occluders for sure.
+    bool visible(const Vector& in_min, const Vector& in_max) const;
+
+    /// When enabled, the occluders and the boxes found hidden get debug-drawn.
+    void debug(bool in_bDebug) { m_bDebug = in_bDebug; }
+    bool debug() const { return m_bDebug; }
+
+    /// \return How many faces the last render rasterized.
+    std::size_t faceCount() const;
+
+    /// Writes the level \a in_level of the buffer as a grayscale PGM image,
+    /// nearer being brighter, for looking at what the culling sees.
+    /// \return false if the file can't be written.
+    bool writeImage(const std::string& in_sFile, unsigned in_level = 0) const;
+
+    static unsigned levelWidth(unsigned in_level) { return D_OCCLUSION_WIDTH >> in_level; }
+    static unsigned levelHeight(unsigned in_level) { return D_OCCLUSION_HEIGHT >> in_level; }
+
+private:
+    // No copying!
+    OcclusionBuffer(const OcclusionBuffer&);
+    OcclusionBuffer& operator=(const OcclusionBuffer&);
+
+    /// A face of an occluder in pixel coordinates, ready to be rasterized. A
+    /// box's face, once clipped at the near plane, has up to five edges.
+    struct Face {
+        /// The edge functions, as e = a*x + b*y + c, positive inside. Faces
+        /// with less edges have the remaining ones always positive.
+        float a[5], b[5], c[5];
+        /// The plane of 1/w, as z = z0 + dzdx*x + dzdy*y.
+        float z0, dzdx, dzdy;
+        /// The bounding rectangle, in pixels, inclusive.
+        int minX, minY, maxX, maxY;
+    };
+
+    void setup(const Occluder& in_occluder, std::vector<Face>& out_faces) const;
+    void addFace(const float (*in_v)[4], unsigned in_n, std::vector<Face>& out_faces) const;
+    void rasterize(unsigned in_strip);
+    void rasterize(const Face& in_face, int in_y0, int in_y1);
+    void reduce(unsigned in_level, unsigned in_y0, unsigned in_y1);
+
+    /// The view-projection matrix of the current frame, column-major.
+    float m_viewProj[16];
+    /// The faces of the current frame, set up by every worker on its own.
+    std::vector<std::vector<Face>> m_faces;
+    /// All levels of the hierarchy, the first being the full resolution.
+    std::vector<float> m_levels[D_OCCLUSION_LEVELS];
+    bool m_bDebug;
+};
+
+}
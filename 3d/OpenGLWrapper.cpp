@@ -332,3 +332,154 @@ GLAPI void APIENTRY glGenVertexArrays(GLsizei n, GLuint *arrays)
 
     return proc(n, arrays);
 }
+
+GLAPI void APIENTRY glGetProgramBinary(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, GLvoid *binary)
+{
+    static PFNGLGETPROGRAMBINARYPROC proc = (PFNGLGETPROGRAMBINARYPROC)glGetProcAddress("glGetProgramBinary");
+    if(!proc) { throw std::runtime_error(D_NOT_SUP_ERR + "OpenGL Program Binaries"); }
+
+    return proc(program, bufSize, length, binaryFormat, binary);
+}
+
+GLAPI void APIENTRY glProgramBinary(GLuint program, GLenum binaryFormat, const GLvoid *binary, GLsizei length)
+{
+    static PFNGLPROGRAMBINARYPROC proc = (PFNGLPROGRAMBINARYPROC)glGetProcAddress("glProgramBinary");
+    if(!proc) { throw std::runtime_error(D_NOT_SUP_ERR + "OpenGL Program Binaries"); }
+
+    return proc(program, binaryFormat, binary, length);
+}
+
+GLAPI void APIENTRY glProgramParameteri(GLuint program, GLenum pname, GLint value)
+{
+    static PFNGLPROGRAMPARAMETERIPROC proc = (PFNGLPROGRAMPARAMETERIPROC)glGetProcAddress("glProgramParameteri");
+    if(!proc) { throw std::runtime_error(D_NOT_SUP_ERR + "OpenGL Program Binaries"); }
+
+    return proc(program, pname, value);
+}
+
+GLAPI void APIENTRY glBindAttribLocation(GLuint program, GLuint index, const GLchar *name)
+{
+    static PFNGLBINDATTRIBLOCATIONPROC proc = (PFNGLBINDATTRIBLOCATIONPROC)glGetProcAddress("glBindAttribLocation");
+    if(!proc) { throw std::runtime_error(D_NOT_SUP_ERR + "Modern OpenGL Shaders"); }
+
+    return proc(program, index, name);
+}
+
+GLAPI void APIENTRY glMaxShaderCompilerThreadsKHR(GLuint count)
+{
+    // The ARB version is the very same thing.
+    static PFNGLMAXSHADERCOMPILERTHREADSKHRPROC proc = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glGetProcAddress("glMaxShaderCompilerThreadsKHR");
+    static PFNGLMAXSHADERCOMPILERTHREADSKHRPROC procARB = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glGetProcAddress("glMaxShaderCompilerThreadsARB");
+    if(!proc && !procARB) { throw std::runtime_error(D_NOT_SUP_ERR + "Parallel Shader Compilation"); }
+
+    return proc ? proc(count) : procARB(count);
+}
+
+GLAPI void APIENTRY glBufferSubData (GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid *data)
+{
+    static PFNGLBUFFERSUBDATAPROC proc = (PFNGLBUFFERSUBDATAPROC)glGetProcAddress("glBufferSubData");
+    if(!proc) { throw std::runtime_error(D_NOT_SUP_ERR + "OpenGL Buffer Objects"); }
+
+    return proc(target, offset, size, data);
+}
+
+GLAPI void APIENTRY glBindBufferBase (GLenum target, GLuint index, GLuint buffer)
+{
+    static PFNGLBINDBUFFERBASEPROC proc = (PFNGLBINDBUFFERBASEPROC)glGetProcAddress("glBindBufferBase");
+    if(!proc) { throw std::runtime_error(D_NOT_SUP_ERR + "OpenGL Uniform Buffer Objects"); }
+
+    return proc(target, index, buffer);
+}
+
+GLAPI void APIENTRY glBindBufferRange (GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    static PFNGLBINDBUFFERRANGEPROC proc = (PFNGLBINDBUFFERRANGEPROC)glGetProcAddress("glBindBufferRange");
+    if(!proc) { throw std::runtime_error(D_NOT_SUP_ERR + "OpenGL Uniform Buffer Objects"); }
+
+    return proc(target, index, buffer, offset, size);
+}
+
+GLAPI GLuint APIENTRY glGetUniformBlockIndex (GLuint program, const GLchar *uniformBlockName)
+{
+    static PFNGLGETUNIFORMBLOCKINDEXPROC proc = (PFNGLGETUNIFORMBLOCKINDEXPROC)glGetProcAddress("glGetUniformBlockIndex");
+    if(!proc) { throw std::runtime_error(D_NOT_SUP_ERR + "OpenGL Uniform Buffer Objects"); }
+
+    return proc(program, uniformBlockName);
+}
+
+GLAPI void APIENTRY glUniformBlockBinding (GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding)
+{
+    static PFNGLUNIFORMBLOCKBINDINGPROC proc = (PFNGLUNIFORMBLOCKBINDINGPROC)glGetProcAddress("glUniformBlockBinding");
+    if(!proc) { throw std::runtime_error(D_NOT_SUP_ERR + "OpenGL Uniform Buffer Objects"); }
+
+    return proc(program, uniformBlockIndex, uniformBlockBinding);
+}
+
+GLAPI GLvoid* APIENTRY glMapBufferRange (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    static PFNGLMAPBUFFERRANGEPROC proc = (PFNGLMAPBUFFERRANGEPROC)glGetProcAddress("glMapBufferRange");
+    if(!proc) { throw std::runtime_error(D_NOT_SUP_ERR + "OpenGL Buffer Mapping"); }
+
+    return proc(target, offset, length, access);
+}
+
+GLAPI GLboolean APIENTRY glUnmapBuffer (GLenum target)
+{
+    static PFNGLUNMAPBUFFERPROC proc = (PFNGLUNMAPBUFFERPROC)glGetProcAddress("glUnmapBuffer");
+    if(!proc) { throw std::runtime_error(D_NOT_SUP_ERR + "OpenGL Buffer Mapping"); }
+
+    return proc(target);
+}
+
+GLAPI void APIENTRY glBufferStorage(GLenum target, GLsizeiptr size, const GLvoid *data, GLbitfield flags)
+{
+    static PFNGLBUFFERSTORAGEPROC proc = (PFNGLBUFFERSTORAGEPROC)glGetProcAddress("glBufferStorage");
+    if(!proc) { throw std::runtime_error(D_NOT_SUP_ERR + "OpenGL Immutable Buffer Storage"); }
+
+    return proc(target, size, data, flags);
+}
+
+GLAPI GLsync APIENTRY glFenceSync (GLenum condition, GLbitfield flags)
+{
+    static PFNGLFENCESYNCPROC proc = (PFNGLFENCESYNCPROC)glGetProcAddress("glFenceSync");
+    if(!proc) { throw std::runtime_error(D_NOT_SUP_ERR + "OpenGL Sync Objects"); }
+
+    return proc(condition, flags);
+}
+
+GLAPI GLenum APIENTRY glClientWaitSync (GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+    static PFNGLCLIENTWAITSYNCPROC proc = (PFNGLCLIENTWAITSYNCPROC)glGetProcAddress("glClientWaitSync");
+    if(!proc) { throw std::runtime_error(D_NOT_SUP_ERR + "OpenGL Sync Objects"); }
+
+    return proc(sync, flags, timeout);
+}
+
+GLAPI void APIENTRY glDeleteSync (GLsync sync)
+{
+    static PFNGLDELETESYNCPROC proc = (PFNGLDELETESYNCPROC)glGetProcAddress("glDeleteSync");
+    if(!proc) { throw std::runtime_error(D_NOT_SUP_ERR + "OpenGL Sync Objects"); }
+
+    return proc(sync);
+}
+
+GLAPI void APIENTRY glDrawElementsInstanced (GLenum mode, GLsizei count, GLenum type, const GLvoid *indices, GLsizei primcount)
+{
+    static PFNGLDRAWELEMENTSINSTANCEDPROC proc = (PFNGLDRAWELEMENTSINSTANCEDPROC)glGetProcAddress("glDrawElementsInstanced");
+    if(!proc) { throw std::runtime_error(D_NOT_SUP_ERR + "OpenGL Instanced Drawing"); }
+
+    return proc(mode, count, type, indices, primcount);
+}
+
+bool RoadRage::isGLExtensionSupported(const std::string& in_sName)
+{
+    GLint n = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+    for(GLint i = 0 ; i < n ; ++i) {
+        const GLubyte* ext = glGetStringi(GL_EXTENSIONS, i);
+        if(ext && in_sName == reinterpret_cast<const char*>(ext))
+            return true;
+    }
+
+    return false;
+}
@@ -4,6 +4,8 @@
 #define GL3_PROTOTYPES 1
 #include <SFML/OpenGL.hpp>
 
+#include <string>
+
 // Avoid further inclusion of older opengl headers.
 #define __GL_H__ 1
 #define __gl_h_ 1
@@ -163,4 +165,32 @@ typedef void (APIENTRYP PFNGLDELETEVERTEXARRAYSPROC) (GLsizei n, const GLuint *a
 GLAPI void APIENTRY glDeleteVertexArrays(GLsizei n, const GLuint *arrays);
 typedef void (APIENTRYP PFNGLGENVERTEXARRAYSPROC) (GLsizei n, GLuint *arrays);
 GLAPI void APIENTRY glGenVertexArrays(GLsizei n, GLuint *arrays);
-#endif
\ No newline at end of file
+#endif
+
+// Extensions that are too recent for our gl3.h.
+
+// GL_KHR_parallel_shader_compile (and the equivalent ARB version)
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR           0x91B1
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC) (GLuint count);
+GLAPI void APIENTRY glMaxShaderCompilerThreadsKHR(GLuint count);
+#endif
+
+// GL_ARB_buffer_storage
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT              0x0040
+#define GL_MAP_COHERENT_BIT                0x0080
+#define GL_DYNAMIC_STORAGE_BIT             0x0100
+#define GL_CLIENT_STORAGE_BIT              0x0200
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC) (GLenum target, GLsizeiptr size, const GLvoid *data, GLbitfield flags);
+GLAPI void APIENTRY glBufferStorage(GLenum target, GLsizeiptr size, const GLvoid *data, GLbitfield flags);
+#endif
+
+namespace RoadRage {
+
+/// Extensions may only be used after checking for them here, as calling a
+/// function of an unsupported extension throws.
+bool isGLExtensionSupported(const std::string& in_sName);
+
+}
@@ -0,0 +1,349 @@
+#include "RenderQueue.h"
+
+#include "Camera.h"
+#include "OcclusionBuffer.h"
+#include "Shader.h"
+
+#include "Utilities/Hash.h"
+#include "Utilities/Math.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace RoadRage;
+
+/// Depths further away than this all sort the same.
+#define D_SORT_MAX_DEPTH 1000.0f
+
+Geometry::Geometry(GLuint in_vao, GLenum in_mode, GLsizei in_count, GLenum in_indexType)
+    : vao(in_vao)
+    , mode(in_mode)
+    , count(in_count)
+    , indexType(in_indexType)
+{
+}
+
+bool Geometry::operator==(const Geometry& o) const
+{
+    return vao == o.vao && mode == o.mode && count == o.count && indexType == o.indexType;
+}
+
+Material::Material()
+    : m_sortId(0)
+{
+}
+
+Material& Material::set(const std::string& in_sName, const Vector& in_v)
+{
+    m_values.push_back(std::make_pair(in_sName, in_v));
+
+    uint64_t h = fnv1aSeed;
+    for(auto i = m_values.begin() ; i != m_values.end() ; ++i) {
+        h = fnv1a(i->first, h);
+        h = fnv1a(i->second.array3f(), 3*sizeof(float), h);
+    }
+    m_sortId = static_cast<uint16_t>(h ^ (h >> 16) ^ (h >> 32) ^ (h >> 48));
+
+    return *this;
+}
+
+void Material::apply(Shader& in_shader) const
+{
+    for(auto i = m_values.begin() ; i != m_values.end() ; ++i) {
+        // The fallback shader doesn't have any of them, but quietly ignores that.
+        if(!in_shader.ready() || in_shader.hasUniform(i->first))
+            in_shader.setUniform(i->first, i->second);
+    }
+}
+
+bool Material::operator==(const Material& o) const
+{
+    if(m_sortId != o.m_sortId || m_values.size() != o.m_values.size())
+        return false;
+
+    for(std::size_t i = 0 ; i < m_values.size() ; ++i) {
+        if(m_values[i].first != o.m_values[i].first
+        || std::memcmp(m_values[i].second.array3f(), o.m_values[i].second.array3f(), 3*sizeof(float)) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+CommandList::CommandList()
+    : m_fProjScale(1.0f)
+    , m_pOcclusion(0)
+    , m_nCulled(0)
+    , m_nOccluded(0)
+{
+    std::fill(m_lodCounts, m_lodCounts + D_MAX_LODS, 0);
+}
+
+void CommandList::begin(const AffineMatrix& in_view, const General4x4Matrix& in_viewProj, float in_fProjScale, const OcclusionBuffer* in_pOcclusion)
+{
+    m_view = in_view;
+    m_fProjScale = in_fProjScale;
+    m_pOcclusion = in_pOcclusion;
+    m_packets.clear();
+    m_transforms.clear();
+    m_nCulled = 0;
+    m_nOccluded = 0;
+    std::fill(m_lodCounts, m_lodCounts + D_MAX_LODS, 0);
+
+    // The planes come straight out of the rows of the view-projection matrix.
+    const float* m = in_viewProj.array16f();
+    for(unsigned i = 0 ; i < 6 ; ++i) {
+        const unsigned row = i / 2;
+        const float sign = i % 2 == 0 ? 1.0f : -1.0f;
+        for(unsigned j = 0 ; j < 4 ; ++j) {
+            m_planes[i][j] = m[4*j + 3] + sign * m[4*j + row];
+        }
+
+        float len = std::sqrt(m_planes[i][0]*m_planes[i][0] + m_planes[i][1]*m_planes[i][1] + m_planes[i][2]*m_planes[i][2]);
+        for(unsigned j = 0 ; j < 4 ; ++j) {
+            m_planes[i][j] /= len;
+        }
+    }
+}
+
+bool CommandList::cull(const AffineMatrix& in_model, float in_fRadius, float& out_fScreenSize)
+{
+    const float* m = in_model.array16f();
+
+    // Scaling makes the sphere bigger, take the largest axis.
+    float fScale2 = std::max(m[0]*m[0] + m[1]*m[1] + m[2]*m[2],
+                    std::max(m[4]*m[4] + m[5]*m[5] + m[6]*m[6],
+                             m[8]*m[8] + m[9]*m[9] + m[10]*m[10]));
+    float fRadius = in_fRadius * std::sqrt(fScale2);
+
+    for(unsigned i = 0 ; i < 6 ; ++i) {
+        if(m_planes[i][0]*m[12] + m_planes[i][1]*m[13] + m_planes[i][2]*m[14] + m_planes[i][3] < -fRadius) {
+            ++m_nCulled;
+            return false;
+        }
+    }
+
+    // The box around the sphere is what gets tested against the occluders.
+    if(m_pOcclusion && !m_pOcclusion->visible(Vector(m[12] - fRadius, m[13] - fRadius, m[14] - fRadius),
+                                              Vector(m[12] + fRadius, m[13] + fRadius, m[14] + fRadius))) {
+        ++m_nCulled;
+        ++m_nOccluded;
+        return false;
+    }
+
+    // The screen goes from -1 to 1, hence no factor 2 for the diameter.
+    const float* v = m_view.array16f();
+    float fDepth = -(v[2]*m[12] + v[6]*m[13] + v[10]*m[14] + v[14]);
+    out_fScreenSize = fDepth > fRadius ? fRadius * m_fProjScale / fDepth : 1.0f;
+    return true;
+}
+
+void CommandList::submit(Shader& in_shader, const Geometry& in_geometry, const Material& in_material, const AffineMatrix& in_model, float in_fRadius, RenderLayer::Enum in_layer)
+{
+    float fScreenSize = 0.0f;
+    if(in_fRadius >= 0.0f && !this->cull(in_model, in_fRadius, fScreenSize))
+        return;
+
+    // Only the z of the object's origin in view space is needed.
+    const float* m = in_model.array16f();
+    const float* v = m_view.array16f();
+    float fDepth = -(v[2]*m[12] + v[6]*m[13] + v[10]*m[14] + v[14]);
+
+    DrawPacket p;
+    p.key = RenderQueue::makeKey(in_layer, static_cast<uint16_t>(in_shader.id()), static_cast<uint16_t>(in_geometry.vao), in_material.sortId(), fDepth);
+    p.pShader = &in_shader;
+    p.geometry = in_geometry;
+    p.pMaterial = &in_material;
+    p.transform = static_cast<uint32_t>(m_transforms.size());
+    p.pModel = 0;
+
+    m_packets.push_back(p);
+    m_transforms.push_back(in_model);
+}
+
+RenderQueue::RenderQueue(unsigned in_nLists)
+    : m_nDraws(0)
+{
+    for(unsigned i = 0 ; i < std::max(1u, in_nLists) ; ++i) {
+        m_lists.push_back(std::unique_ptr<CommandList>(new CommandList()));
+    }
+}
+
+RenderQueue::~RenderQueue()
+{
+}
+
+uint64_t RenderQueue::makeKey(RenderLayer::Enum in_layer, uint16_t in_shader, uint16_t in_geometry, uint16_t in_material, float in_fDepth)
+{
+    float fDepth = clamp(in_fDepth / D_SORT_MAX_DEPTH, 0.0f, 1.0f);
+    uint64_t key = static_cast<uint64_t>(in_layer) << 62;
+
+    if(in_layer == RenderLayer::Transparent) {
+        // |63-62 layer|61-32 inverted depth|31-16 shader|15-0 material|
+        // Blending needs back to front, state changes come second.
+        uint64_t depth = static_cast<uint64_t>((1.0f - fDepth) * 0x3FFFFFFF);
+        key |= depth << 32;
+        key |= static_cast<uint64_t>(in_shader) << 16;
+        key |= in_material;
+    } else {
+        // |63-62 layer|61-46 shader|45-30 geometry|29-14 material|13-0 depth|
+        // Shader changes are the most expensive ones. Front to back in the
+        // end, so that the depth test rejects as much as possible.
+        uint64_t depth = static_cast<uint64_t>(fDepth * 0x3FFF);
+        key |= static_cast<uint64_t>(in_shader) << 46;
+        key |= static_cast<uint64_t>(in_geometry) << 30;
+        key |= static_cast<uint64_t>(in_material) << 14;
+        key |= depth;
+    }
+
+    return key;
+}
+
+void RenderQueue::begin(const Camera& in_cam, const OcclusionBuffer* in_pOcclusion)
+{
+    for(auto i = m_lists.begin() ; i != m_lists.end() ; ++i) {
+        (*i)->begin(in_cam.view(), in_cam, in_cam.proj().array16f()[5], in_pOcclusion);
+    }
+}
+
+std::size_t RenderQueue::culledCount() const
+{
+    std::size_t n = 0;
+    for(auto i = m_lists.begin() ; i != m_lists.end() ; ++i) {
+        n += (*i)->culledCount();
+    }
+    return n;
+}
+
+std::size_t RenderQueue::occludedCount() const
+{
+    std::size_t n = 0;
+    for(auto i = m_lists.begin() ; i != m_lists.end() ; ++i) {
+        n += (*i)->occludedCount();
+    }
+    return n;
+}
+
+std::size_t RenderQueue::lodCount(unsigned in_lod) const
+{
+    std::size_t n = 0;
+    for(auto i = m_lists.begin() ; i != m_lists.end() ; ++i) {
+        n += (*i)->lodCount(in_lod);
+    }
+    return n;
+}
+
+void RenderQueue::merge()
+{
+    m_packets.clear();
+    for(auto i = m_lists.begin() ; i != m_lists.end() ; ++i) {
+        const CommandList& list = **i;
+        for(auto p = list.m_packets.begin() ; p != list.m_packets.end() ; ++p) {
+            m_packets.push_back(*p);
+            m_packets.back().pModel = &list.m_transforms[p->transform];
+        }
+    }
+}
+
+void RenderQueue::sort()
+{
+    // A least-significant-digit radix sort on the keys, one byte at a time.
+    // It only moves the packets' indices around, not the packets themselves.
+    const std::size_t n = m_packets.size();
+    m_order.resize(n);
+    m_scratch.resize(n);
+    for(std::size_t i = 0 ; i < n ; ++i) {
+        m_order[i] = static_cast<uint32_t>(i);
+    }
+
+    for(unsigned shift = 0 ; shift < 64 ; shift += 8) {
+        std::size_t counts[256] = {0};
+        for(std::size_t i = 0 ; i < n ; ++i) {
+            ++counts[(m_packets[i].key >> shift) & 0xFF];
+        }
+
+        // Most bytes are the same for all the keys, those passes can be skipped.
+        if(n == 0 || counts[(m_packets[0].key >> shift) & 0xFF] == n)
+            continue;
+
+        std::size_t offsets[256];
+        std::size_t sum = 0;
+        for(unsigned b = 0 ; b < 256 ; ++b) {
+            offsets[b] = sum;
+            sum += counts[b];
+        }
+
+        for(std::size_t i = 0 ; i < n ; ++i) {
+            uint32_t idx = m_order[i];
+            m_scratch[offsets[(m_packets[idx].key >> shift) & 0xFF]++] = idx;
+        }
+        m_order.swap(m_scratch);
+    }
+}
+
+bool RenderQueue::batchable(const DrawPacket& a, const DrawPacket& b) const
+{
+    return a.pShader == b.pShader
+        && a.geometry == b.geometry
+        && (a.pMaterial == b.pMaterial || *a.pMaterial == *b.pMaterial);
+}
+
+void RenderQueue::execute()
+{
+    m_nDraws = 0;
+    m_objects.clear();
+    this->merge();
+    this->sort();
+
+    // First lay out the transforms batch by batch, so they can be sent at once.
+    struct Batch {
+        std::size_t first;  ///< Into m_order.
+        std::size_t count;
+        std::size_t slot;   ///< The first object slot.
+    };
+    std::vector<Batch> batches;
+    for(std::size_t i = 0 ; i < m_order.size() ; ) {
+        Batch b = { i, 0, m_objects.beginBatch() };
+        const DrawPacket& head = m_packets[m_order[i]];
+        while(i < m_packets.size() && b.count < D_MAX_INSTANCES && this->batchable(head, m_packets[m_order[i]])) {
+            m_objects.add(*m_packets[m_order[i]].pModel);
+            ++b.count;
+            ++i;
+        }
+        batches.push_back(b);
+    }
+    m_objects.upload();
+
+    // Then draw them, only changing the state that needs to be changed.
+    Shader* pShader = 0;
+    const Material* pMaterial = 0;
+    GLuint vao = 0;
+    for(auto i = batches.begin() ; i != batches.end() ; ++i) {
+        const DrawPacket& p = m_packets[m_order[i->first]];
+
+        bool bNewShader = p.pShader != pShader;
+        if(bNewShader) {
+            pShader = p.pShader;
+            pShader->bind();
+        }
+
+        if(bNewShader || !(p.pMaterial == pMaterial || *p.pMaterial == *pMaterial)) {
+            pMaterial = p.pMaterial;
+            pMaterial->apply(*pShader);
+        }
+
+        if(p.geometry.vao != vao) {
+            vao = p.geometry.vao;
+            glBindVertexArray(vao);
+        }
+
+        m_objects.bind(i->slot);
+        glDrawElementsInstanced(p.geometry.mode, p.geometry.count, p.geometry.indexType, 0, static_cast<GLsizei>(i->count));
+        ++m_nDraws;
+    }
+
+    Shader::unbind();
+    VertexArrayObject::unbind();
+    m_objects.endFrame();
+}
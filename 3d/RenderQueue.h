@@ -0,0 +1,190 @@
+#pragma once
+
+#include "3d/OpenGLWrapper.h"
+#include "3d/UniformBuffer.h"
+#include "3d/Math/Matrix.h"
+#include "3d/Math/Vector.h"
+
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// How many levels of detail a model may have, including the impostor.
+#define D_MAX_LODS 4
+
+namespace RoadRage {
+
+class Camera;
+class OcclusionBuffer;
+class Shader;
+
+/// What to draw: a vertex array object and how to draw its elements.
+struct Geometry {
+    GLuint vao;
+    GLenum mode;      ///< GL_TRIANGLES, GL_LINES, ...
+    GLsizei count;    ///< The amount of indices.
+    GLenum indexType; ///< GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+
+    Geometry(GLuint in_vao = 0, GLenum in_mode = GL_TRIANGLES, GLsizei in_count = 0, GLenum in_indexType = GL_UNSIGNED_SHORT);
+
+    bool operator==(const Geometry& o) const;
+};
+
+/// The uniform values that are the same for everything drawn with it. Two
+/// materials with the same values are the same material and get batched.
+class Material {
+public:
+    Material();
+
+    Material& set(const std::string& in_sName, const Vector& in_v);
+
+    /// Sets all of the values on the currently bound \a in_shader.
+    void apply(Shader& in_shader) const;
+    /// \return A short identifier of the values, for sorting.
+    uint16_t sortId() const { return m_sortId; }
+
+    bool operator==(const Material& o) const;
+
+private:
+    std::vector<std::pair<std::string, Vector>> m_values;
+    uint16_t m_sortId;
+};
+
+/// Where in the frame something gets drawn. Layers are drawn in this order.
+namespace RenderLayer {
+    enum Enum {
+        Opaque = 0,      ///< Sorted by state, then front to back.
+        Transparent = 1, ///< Sorted back to front only.
+        Overlay = 2,     ///< Drawn last, sorted by state.
+    };
+}
+
+/// Everything that's needed to draw one thing once.
+struct DrawPacket {
+    uint64_t key;
+    Shader* pShader;
+    Geometry geometry;
+    const Material* pMaterial;
+    /// Index of the model matrix in the list's transforms.
+    uint32_t transform;
+    /// Only set once the list got merged into the queue.
+    const AffineMatrix* pModel;
+};
+
+/// The packets generated by one thread. Every thread fills a list of its own,
+/// without any locking, and the RenderQueue merges them all for drawing. This
+/// is also where the culling and the building of the sort keys happen, so
+/// that those get spread over the threads too.
+class CommandList {
+public:
+    CommandList();
+
+    /// Queues drawing \a in_geometry with \a in_shader and \a in_material,
+    /// placed in the world by \a in_model. The material must live until the
+    /// end of the frame. This doesn't touch OpenGL and may be called from
+    /// any thread, as long as every thread has its own list.
+    /// \param in_fRadius The radius of a sphere around the model's origin,
+    ///                   in model space, that contains all of it. Models not
+    ///                   in the view get culled, unless this is negative.
+    void submit(Shader& in_shader, const Geometry& in_geometry, const Material& in_material, const AffineMatrix& in_model, float in_fRadius = -1.0f, RenderLayer::Enum in_layer = RenderLayer::Opaque);
+
+    /// Does the culling part of submit on its own, for those who need to know
+    /// how big a model is on screen before choosing what to submit.
+    /// \param out_fScreenSize Set to the height of the model's bounding
+    ///                        sphere on screen, as a fraction of the screen's
+    ///                        height, if it is visible.
+    /// \return false if the model got culled, by the frustum or by occlusion,
+    ///         which is counted.
+    bool cull(const AffineMatrix& in_model, float in_fRadius, float& out_fScreenSize);
+    /// Counts one model drawn at level of detail \a in_lod, for the stats.
+    void countLod(unsigned in_lod) { ++m_lodCounts[in_lod < D_MAX_LODS ? in_lod : D_MAX_LODS-1]; }
+
+    std::size_t packetCount() const { return m_packets.size(); }
+    std::size_t culledCount() const { return m_nCulled; }
+    std::size_t occludedCount() const { return m_nOccluded; }
+    std::size_t lodCount(unsigned in_lod) const { return m_lodCounts[in_lod]; }
+
+private:
+    friend class RenderQueue;
+
+    void begin(const AffineMatrix& in_view, const General4x4Matrix& in_viewProj, float in_fProjScale, const OcclusionBuffer* in_pOcclusion);
+
+    /// The view matrix of the current frame, for computing depths.
+    AffineMatrix m_view;
+    /// The view frustum's planes, as (a, b, c, d) with the normals inwards.
+    float m_planes[6][4];
+    /// What the projection scales heights at distance 1 by.
+    float m_fProjScale;
+    /// What hides models in the current frame, if anything.
+    const OcclusionBuffer* m_pOcclusion;
+
+    std::vector<DrawPacket> m_packets;
+    std::vector<AffineMatrix> m_transforms;
+    std::size_t m_nCulled;
+    std::size_t m_nOccluded;
+    std::size_t m_lodCounts[D_MAX_LODS];
+};
+
+/// Game code doesn't talk to OpenGL for drawing anymore, it submits packets
+/// describing what to draw into the command lists of this queue instead. Once
+/// everything got submitted, the lists get merged and the packets sorted by a
+/// 64-bit key built out of the layer, shader, geometry, material and depth so
+/// that state changes are rare. Then, runs of packets sharing all state are
+/// drawn with a single instanced draw.
+class RenderQueue {
+public:
+    /// \param in_nLists How many command lists to have, usually one per worker.
+    RenderQueue(unsigned in_nLists = 1);
+    virtual ~RenderQueue();
+
+    /// Starts collecting a new frame, seen through \a in_cam.
+    /// \param in_pOcclusion If given, models it hides get culled. It must be
+    ///                      rendered already and stay untouched until all
+    ///                      lists are filled.
+    void begin(const Camera& in_cam, const OcclusionBuffer* in_pOcclusion = 0);
+    /// \return The command list \a in_i, which is for one thread's use only.
+    CommandList& list(unsigned in_i = 0) { return *m_lists[in_i]; }
+    unsigned listCount() const { return static_cast<unsigned>(m_lists.size()); }
+    /// Merges all lists, sorts and draws everything submitted since begin.
+    void execute();
+
+    /// \return The amount of packets drawn by the last execute.
+    std::size_t packetCount() const { return m_packets.size(); }
+    /// \return The amount of packets culled in the last frame, including the
+    ///         ones hidden by occluders.
+    std::size_t culledCount() const;
+    /// \return The amount of packets hidden by occluders in the last frame.
+    std::size_t occludedCount() const;
+    /// \return The amount of models drawn at level of detail \a in_lod in the
+    ///         last frame, the last level being the impostors.
+    std::size_t lodCount(unsigned in_lod) const;
+    /// \return The amount of draw calls the last execute needed.
+    std::size_t drawCount() const { return m_nDraws; }
+
+    /// Builds the sort key, exposed for those wanting to sort their own stuff alike.
+    /// \param in_fDepth The view-space distance, which only its order matters of.
+    static uint64_t makeKey(RenderLayer::Enum in_layer, uint16_t in_shader, uint16_t in_geometry, uint16_t in_material, float in_fDepth);
+
+private:
+    // No copying!
+    RenderQueue(const RenderQueue&);
+    RenderQueue& operator=(const RenderQueue&);
+
+    void merge();
+    void sort();
+    bool batchable(const DrawPacket& a, const DrawPacket& b) const;
+
+    std::vector<std::unique_ptr<CommandList>> m_lists;
+    /// All the lists' packets, after merging.
+    std::vector<DrawPacket> m_packets;
+    /// The order of the packets after sorting, and the sort's scratch space.
+    std::vector<uint32_t> m_order;
+    std::vector<uint32_t> m_scratch;
+
+    ObjectUniforms m_objects;
+    std::size_t m_nDraws;
+};
+
+}
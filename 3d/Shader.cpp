@@ -3,10 +3,15 @@
 #include "3d/Math/Vector.h"
 #include "3d/Math/Quaternion.h"
 #include "3d/Math/Matrix.h"
+#include "3d/UniformBuffer.h"
+#include "Utilities/Hash.h"
+#include "Utilities/Path.h"
 #include "Utilities/i18n.h"
 
+#include <SFML/System/Clock.hpp>
+
 #include <iostream>
-#include <fstream>
+#include <set>
 #include <stdexcept>
 #include <Utilities/String.h>
 
@@ -184,49 +189,148 @@ bool didProgramLink(GLuint id)
     return (bLinked == GL_TRUE) && (id != 0);
 }
 
-Shader::Shader(const std::string& in_sName, const std::string& in_sSourceCodeVert, const std::string& in_sSourceCodeFrag)
+namespace {
+    // The attributes every shader has at the same location, see Shader::attributeLocation.
+    const char* const g_attribLocations[] = {"aVertexPosition", "aVertexNormal", "aVertexTexCoord", "aVertexColor", "aVertexLabel"};
+}
+
+GLint Shader::attributeLocation(const std::string& in_sName)
 {
-    // This allows us to use RAII and exception-safety.
-    struct CompiledShader {
-        GLuint id;
-        CompiledShader(GLenum type) : id(glCreateShader(type)) {}
-        ~CompiledShader() {glDeleteShader(id);}
+    for(GLint i = 0 ; i < static_cast<GLint>(sizeof(g_attribLocations)/sizeof(g_attribLocations[0])) ; ++i) {
+        if(in_sName == g_attribLocations[i])
+            return i;
+    }
 
-        operator GLuint() const {return id;}
-    };
+    return -1;
+}
+
+Shader::Shader(const std::string& in_sName, Shader* in_pFallback)
+    : m_sName(in_sName)
+    , m_id(0)
+    , m_bFromCache(false)
+    , m_pFallback(in_pFallback)
+    , m_pendingProgram(0)
+    , m_pendingVert(0)
+    , m_pendingFrag(0)
+    , m_pendingHash(0)
+{
+}
+
+Shader::Shader(const std::string& in_sName, const FileView& in_sourceVert, const FileView& in_sourceFrag, ShaderCache& in_cache)
+    : m_sName(in_sName)
+    , m_id(0)
+    , m_bFromCache(false)
+    , m_pFallback(0)
+    , m_pendingProgram(0)
+    , m_pendingVert(0)
+    , m_pendingFrag(0)
+    , m_pendingHash(0)
+{
+    this->beginCompile(in_sourceVert, in_sourceFrag, in_cache);
+    if(!this->endCompile(in_cache))
+        throw std::runtime_error(_("Failed to compile the shader ") + in_sName);
+}
+
+void Shader::beginCompile(const FileView& in_sourceVert, const FileView& in_sourceFrag, ShaderCache& in_cache)
+{
+    m_pendingHash = fnv1a(in_sourceVert.data(), in_sourceVert.size());
+    m_pendingHash = fnv1a(in_sourceFrag.data(), in_sourceFrag.size(), m_pendingHash);
+
+    // A cached binary is as good as linked already.
+    m_pendingProgram = in_cache.load(m_pendingHash);
+    if(m_pendingProgram != 0)
+        return;
+
+    m_pendingVert = glCreateShader(GL_VERTEX_SHADER);
+    m_pendingFrag = glCreateShader(GL_FRAGMENT_SHADER);
+
+    // The sources aren't null-terminated when they come from the archive.
+    const char *srcVert = in_sourceVert.data();
+    const char *srcFrag = in_sourceFrag.data();
+    GLint lenVert = static_cast<GLint>(in_sourceVert.size());
+    GLint lenFrag = static_cast<GLint>(in_sourceFrag.size());
+    glShaderSource(m_pendingVert, 1, &srcVert, &lenVert);
+    glShaderSource(m_pendingFrag, 1, &srcFrag, &lenFrag);
+    glCompileShader(m_pendingVert);
+    glCompileShader(m_pendingFrag);
+
+    // Now, link those shaders to a program. We don't check whether they
+    // compiled before, as that would make us wait for the compiler. If they
+    // didn't, linking fails and we check why in endCompile.
+    m_pendingProgram = glCreateProgram();
+    glAttachShader(m_pendingProgram, m_pendingVert);
+    glAttachShader(m_pendingProgram, m_pendingFrag);
+
+    // Say that the fragment shader "out" variable "Color" is the output to
+    // the screen (0). This, and the attribute locations, only have an effect
+    // if done before linking.
+    glBindFragDataLocation(m_pendingProgram, 0, "Color");
+    for(GLuint i = 0 ; i < sizeof(g_attribLocations)/sizeof(g_attribLocations[0]) ; ++i) {
+        glBindAttribLocation(m_pendingProgram, i, g_attribLocations[i]);
+    }
+    in_cache.prepare(m_pendingProgram);
 
-    CompiledShader vert(GL_VERTEX_SHADER);
-    CompiledShader frag(GL_FRAGMENT_SHADER);
+    glLinkProgram(m_pendingProgram);
+}
 
-    const char *srcVert = in_sSourceCodeVert.c_str();
-    const char *srcFrag = in_sSourceCodeFrag.c_str();
-    glShaderSource(vert, 1, &srcVert, 0);
-    glShaderSource(frag, 1, &srcFrag, 0);
-    glCompileShader(vert);
-    glCompileShader(frag);
+bool Shader::compileDone() const
+{
+    GLint bDone = GL_TRUE;
+    if(m_pendingVert != 0)
+        glGetProgramiv(m_pendingProgram, GL_COMPLETION_STATUS_KHR, &bDone);
 
-    // We always get the info log, it might contain some useful warnings!
-    checkShaderLog(vert, in_sName + ".vert");
-    checkShaderLog(frag, in_sName + ".frag");
+    return bDone == GL_TRUE;
+}
 
-    // If there was an error, we throw it as an exception.
-    if(!didShaderCompile(vert)) { throw std::runtime_error(_("Failed to compile the shader ") + in_sName + ".vert"); }
-    if(!didShaderCompile(frag)) { throw std::runtime_error(_("Failed to compile the shader ") + in_sName + ".frag"); }
+bool Shader::endCompile(ShaderCache& in_cache)
+{
+    // Coming from the cache, it is linked already.
+    if(m_pendingVert == 0) {
+        this->adopt(m_pendingProgram);
+        m_bFromCache = true;
+        m_pendingProgram = 0;
+        return true;
+    }
 
-    // Now, link those shaders to a program.
-    m_id = glCreateProgram();
-    glAttachShader(m_id, vert);
-    glAttachShader(m_id, frag);
-    glLinkProgram(m_id);
+    // We always get the info log, it might contain some useful warnings!
+    checkShaderLog(m_pendingVert, m_sName + ".vert");
+    checkShaderLog(m_pendingFrag, m_sName + ".frag");
+    checkProgramLog(m_pendingProgram, m_sName);
+
+    bool bOk = didShaderCompile(m_pendingVert) && didShaderCompile(m_pendingFrag) && didProgramLink(m_pendingProgram);
+
+    // The program keeps what it needs of them.
+    glDeleteShader(m_pendingVert);
+    glDeleteShader(m_pendingFrag);
+    m_pendingVert = m_pendingFrag = 0;
+
+    if(bOk) {
+        in_cache.store(m_pendingHash, m_pendingProgram);
+        this->adopt(m_pendingProgram);
+        m_bFromCache = false;
+    } else {
+        glDeleteProgram(m_pendingProgram);
+    }
+
+    m_pendingProgram = 0;
+    return bOk;
+}
 
-    checkProgramLog(m_id, in_sName);
-    if(!didProgramLink(m_id)) { throw std::runtime_error(_("Failed to link the shader ") + in_sName); }
+void Shader::adopt(GLuint in_program)
+{
+    if(m_id != 0)
+        glDeleteProgram(m_id);
 
-    // Say that the fragment shader "out" variable "Color" is the output to the screen (0).
-    glBindFragDataLocation(m_id, 0, "Color");
+    m_id = in_program;
+    m_attribs.clear();
+    m_uniforms.clear();
+    this->introspect();
+}
 
-    // If all that worked, we query all attributes and all uniforms that are
-    // available in the program and store their informations.
+void Shader::introspect()
+{
+    // We query all attributes and all uniforms that are available in the
+    // program and store their informations.
 
     // First the attributes:
     GLint nAttribs = 0, nLongestAttrib = 0;
@@ -262,6 +366,11 @@ Shader::Shader(const std::string& in_sName, const std::string& in_sSourceCodeVer
         // Same story here as for the attribs... Crazy shit!
         id = glGetUniformLocation(m_id, sName.c_str());
 
+        // Those living in a uniform block have no location, they are set
+        // through the block's buffer, see below.
+        if(id < 0)
+            continue;
+
         m_uniforms.insert(std::make_pair(sName, Uniform(sName, id, type, size)));
 
         // In case it is an array, we get the id of every single array entry...
@@ -272,6 +381,18 @@ Shader::Shader(const std::string& in_sName, const std::string& in_sSourceCodeVer
             m_uniforms.at(sName).arrayIds.push_back(glGetUniformLocation(m_id, (sName + "[" + to_s(i) + "]").c_str()));
         }
     }
+
+    // And finally, connect the shared uniform blocks to their binding points.
+    this->bindUniformBlock("Frame", UniformBlock::Frame);
+    this->bindUniformBlock("Object", UniformBlock::Object);
+    this->bindUniformBlock("Labels", UniformBlock::Labels);
+}
+
+void Shader::bindUniformBlock(const std::string& in_sName, GLuint in_binding)
+{
+    GLuint idx = glGetUniformBlockIndex(m_id, in_sName.c_str());
+    if(idx != GL_INVALID_INDEX)
+        glUniformBlockBinding(m_id, idx, in_binding);
 }
 
 Shader::~Shader()
@@ -279,11 +400,19 @@ Shader::~Shader()
     if(m_id != 0) {
         glDeleteProgram(m_id);
     }
+
+    // Deleting zeroes is fine for OpenGL.
+    glDeleteShader(m_pendingVert);
+    glDeleteShader(m_pendingFrag);
+    glDeleteProgram(m_pendingProgram);
 }
 
 void Shader::bind()
 {
-    glUseProgram(m_id);
+    if(this->ready() || !m_pFallback)
+        glUseProgram(m_id);
+    else
+        m_pFallback->bind();
 }
 
 void Shader::unbind()
@@ -305,6 +434,20 @@ Uniform Shader::getUniform(const std::string& in_sName)
     return i->second;
 }
 
+Uniform* Shader::activeUniform(const std::string& in_sName)
+{
+    if(!this->ready() && m_pFallback) {
+        auto i = m_pFallback->m_uniforms.find(in_sName);
+        return i == m_pFallback->m_uniforms.end() ? 0 : &i->second;
+    }
+
+    auto i = m_uniforms.find(in_sName);
+    if(i == m_uniforms.end())
+        throw std::runtime_error(_("Trying to access an inexistent uniform"));
+
+    return &i->second;
+}
+
 bool Shader::hasVertexAttribute(const std::string& in_sName) const
 {
     return m_attribs.find(in_sName) != m_attribs.end();
@@ -314,13 +457,36 @@ bool Shader::hasVertexAttribute(const std::string& in_sName) const
 /// \return true if the bind succeeded, false else.
 bool Shader::setVertexAttribute(const std::string& in_sName, const RoadRage::VertexBufferObject& in_buffer)
 {
+    return this->setVertexAttribute(in_sName, in_buffer, in_buffer.nComponents, 0);
+}
+
+/// This method binds one attribute out of a buffer of interleaved vertices
+/// to a certain attribute of the shader.
+/// \param in_nComponents The amount of floats making up the attribute.
+/// \param in_offset The offset of the attribute within a vertex, in bytes.
+/// \return true if the bind succeeded, false else.
+bool Shader::setVertexAttribute(const std::string& in_sName, const RoadRage::VertexBufferObject& in_buffer, GLint in_nComponents, std::size_t in_offset)
+{
+    // Without the program, we can't check much. All we know is where the
+    // common attributes will end up.
+    if(!this->ready()) {
+        GLint loc = Shader::attributeLocation(in_sName);
+        if(loc < 0)
+            return false;
+
+        glEnableVertexAttribArray(loc);
+        in_buffer.bind();
+        glVertexAttribPointer(loc, in_nComponents, in_buffer.type, in_buffer.normalize, in_buffer.stride, reinterpret_cast<const GLvoid*>(in_offset));
+        return true;
+    }
+
     auto i = m_attribs.find(in_sName);
     if(i == m_attribs.end())
         return false;
 
     // Do some verifications
     if(in_buffer.type == GL_FLOAT) {
-        switch(in_buffer.nComponents) {
+        switch(in_nComponents) {
         case 1:
             if(i->second.type != GL_FLOAT)
                 return false;
@@ -344,7 +510,7 @@ bool Shader::setVertexAttribute(const std::string& in_sName, const RoadRage::Ver
 
     glEnableVertexAttribArray(i->second.id);
     in_buffer.bind();
-    glVertexAttribPointer(i->second.id, in_buffer.nComponents, in_buffer.type, in_buffer.normalize, in_buffer.stride, NULL);
+    glVertexAttribPointer(i->second.id, in_nComponents, in_buffer.type, in_buffer.normalize, in_buffer.stride, reinterpret_cast<const GLvoid*>(in_offset));
 
     return true;
 }
@@ -360,69 +526,96 @@ char Shader::fastNrToChar(uint8_t nr)
 void Shader::setUniform(const std::string& in_sName, const RoadRage::Vector& in_v, GLint iArrayElement)
 {
     try {
-        this->getUniform(in_sName).set(in_v, iArrayElement);
+        if(Uniform* u = this->activeUniform(in_sName))
+            u->set(in_v, iArrayElement);
     } catch(const std::exception& e) { std::cerr << e.what() << std::endl; }
 }
 
 void Shader::setUniform(const std::string& in_sName, const RoadRage::Quaternion& in_v, GLint iArrayElement)
 {
     try {
-        this->getUniform(in_sName).set(in_v, iArrayElement);
+        if(Uniform* u = this->activeUniform(in_sName))
+            u->set(in_v, iArrayElement);
     } catch(const std::exception& e) { std::cerr << e.what() << std::endl; }
 }
 
 void Shader::setUniform(const std::string& in_sName, const RoadRage::General4x4Matrix& in_v, bool in_bTranspose, GLint iArrayElement)
 {
     try {
-        this->getUniform(in_sName).set(in_v, in_bTranspose, iArrayElement);
+        if(Uniform* u = this->activeUniform(in_sName))
+            u->set(in_v, in_bTranspose, iArrayElement);
     } catch(const std::exception& e) { std::cerr << e.what() << std::endl; }
 }
 
 void Shader::setUniform(const std::string& in_sName, const RoadRage::AffineMatrix& in_v, bool in_bTranspose, GLint iArrayElement)
 {
     try {
-        this->getUniform(in_sName).set(in_v, in_bTranspose, iArrayElement);
+        if(Uniform* u = this->activeUniform(in_sName))
+            u->set(in_v, in_bTranspose, iArrayElement);
     } catch(const std::exception& e) { std::cerr << e.what() << std::endl; }
 }
 
 void Shader::setUniformInverse(const std::string& in_sName, const RoadRage::General4x4Matrix& in_v, bool in_bTranspose, GLint iArrayElement)
 {
     try {
-        this->getUniform(in_sName).setInverse(in_v, in_bTranspose, iArrayElement);
+        if(Uniform* u = this->activeUniform(in_sName))
+            u->setInverse(in_v, in_bTranspose, iArrayElement);
     } catch(const std::exception& e) { std::cerr << e.what() << std::endl; }
 }
 
 void Shader::setUniformInverse(const std::string& in_sName, const RoadRage::AffineMatrix& in_v, bool in_bTranspose, GLint iArrayElement)
 {
     try {
-        this->getUniform(in_sName).setInverse(in_v, in_bTranspose, iArrayElement);
+        if(Uniform* u = this->activeUniform(in_sName))
+            u->setInverse(in_v, in_bTranspose, iArrayElement);
     } catch(const std::exception& e) { std::cerr << e.what() << std::endl; }
 }
 
 void Shader::setUniformSampler(const std::string& in_sName, unsigned int in_texUnit, GLint iArrayElement)
 {
     try {
-        this->getUniform(in_sName).setSampler(in_texUnit, iArrayElement);
+        if(Uniform* u = this->activeUniform(in_sName))
+            u->setSampler(in_texUnit, iArrayElement);
     } catch(const std::exception& e) { std::cerr << e.what() << std::endl; }
 }
 
-ShaderManager::ShaderManager()
-{
+namespace {
+    // What gets used while the real shaders are still compiling. This one
+    // needs no files and is compiled right when the manager gets created.
+    const char g_fallbackVert[] =
+        "#version 140\n"
+        "in vec3 aVertexPosition;\n"
+        "layout(std140) uniform Frame { mat4 uView; mat4 uProj; mat4 uViewProj; float uTime; };\n"
+        "layout(std140) uniform Object { mat4 uModels[256]; };\n"
+        "void main() { gl_Position = uViewProj * uModels[gl_InstanceID] * vec4(aVertexPosition, 1.0); }\n";
+    const char g_fallbackFrag[] =
+        "#version 140\n"
+        "out vec4 oColor;\n"
+        "void main() { oColor = vec4(0.5, 0.5, 0.5, 1.0); }\n";
 }
 
-ShaderManager::~ShaderManager()
+ShaderManager::ShaderManager(const FileSystem& in_fs)
+    : m_fs(in_fs)
+    , m_cache(getUserDir() + "/shadercache")
+    , m_bParallel(isGLExtensionSupported("GL_KHR_parallel_shader_compile") || isGLExtensionSupported("GL_ARB_parallel_shader_compile"))
+    , m_pFallback(new Shader("Fallback", FileView(g_fallbackVert, sizeof(g_fallbackVert)-1), FileView(g_fallbackFrag, sizeof(g_fallbackFrag)-1), m_cache))
+    , m_bQuit(false)
+    , m_thread(&ShaderManager::ioThread, this)
 {
+    // Let the driver use as many threads as it likes.
+    if(m_bParallel)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
 }
 
-std::string getFileContent(const std::string& in_sFile)
+ShaderManager::~ShaderManager()
 {
-    std::ifstream f(in_sFile.c_str());
-    if(!f) return "";
-
-    std::stringstream ss;
-    ss << f.rdbuf();
-
-    return ss.str();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bQuit = true;
+        m_requests.clear();
+    }
+    m_wakeup.notify_one();
+    m_thread.join();
 }
 
 Shader::Ptr ShaderManager::getOrLoadShader(const std::string& in_sName)
@@ -431,16 +624,157 @@ Shader::Ptr ShaderManager::getOrLoadShader(const std::string& in_sName)
     if(i != m_mShaders.end())
         return i->second;
 
-    // We need to load the shaders from files.
-    std::string full = std::string("Data/Shaders/") + in_sName;
-    std::string sVert = getFileContent(full + ".vert");
-    std::string sFrag = getFileContent(full + ".frag");
+    Shader::Ptr pShader(new Shader(in_sName, m_pFallback.get()));
+    m_mShaders.insert(std::make_pair(in_sName, pShader));
+    this->requestLoad(pShader, false);
 
-    if(sVert.empty() || sFrag.empty()) {
-        throw std::runtime_error(_("The following file does not exist: ") + full + "[.vert|.frag]");
+    return pShader;
+}
+
+void ShaderManager::requestLoad(const Shader::Ptr& in_pShader, bool in_bReload)
+{
+    Job job;
+    job.pShader = in_pShader;
+    job.fRequested = m_clock.GetElapsedTime();
+    job.bReload = in_bReload;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests.push_back(job);
     }
+    m_wakeup.notify_one();
+}
 
-    m_mShaders.insert(std::make_pair(in_sName, Shader::Ptr(new Shader(in_sName, sVert, sFrag))));
+void ShaderManager::enableHotReload()
+{
+    m_pWatcher.reset(new FileWatcher(m_fs.loosePath("Shaders")));
+    if(!m_pWatcher->valid()) {
+        std::cerr << _("Can't watch the shaders for changes, hot-reloading is disabled.") << std::endl;
+        m_pWatcher.reset();
+    }
+}
+
+void ShaderManager::checkForChanges()
+{
+    std::vector<std::string> changed = m_pWatcher->changes();
+    std::set<std::string> names;
+    for(auto i = changed.begin() ; i != changed.end() ; ++i) {
+        std::size_t dot = i->find_last_of('.');
+        if(dot == std::string::npos)
+            continue;
+
+        std::string ext = i->substr(dot + 1);
+        if(ext == "vert" || ext == "frag")
+            names.insert(i->substr(0, dot));
+    }
+
+    // Shaders nobody asked for yet will be loaded fresh anyways.
+    for(auto i = names.begin() ; i != names.end() ; ++i) {
+        auto shader = m_mShaders.find(*i);
+        if(shader != m_mShaders.end()) {
+            std::cerr << _("Reloading the shader ") << *i << std::endl;
+            this->requestLoad(shader->second, true);
+        }
+    }
+}
+
+void ShaderManager::update()
+{
+    if(m_pWatcher)
+        this->checkForChanges();
+
+    std::deque<Job> loaded;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        loaded.swap(m_loaded);
+    }
+
+    // First kick off all compiles, so the driver can work on all of them at
+    // once, and only then look at the ones that might be done.
+    std::deque<Job> busy;
+    for(auto i = loaded.begin() ; i != loaded.end() ; ++i) {
+        if(i->vert.size() == 0 || i->frag.size() == 0) {
+            std::cerr << _("The following file does not exist: ") << "Shaders/" << i->pShader->name() << "[.vert|.frag]" << std::endl;
+            continue;
+        }
+
+        // A file changed again while the shader is still being compiled.
+        if(i->pShader->compiling()) {
+            busy.push_back(*i);
+            continue;
+        }
+
+        i->pShader->beginCompile(i->vert, i->frag, m_cache);
+        m_compiling.push_back(*i);
+    }
 
-    return m_mShaders[in_sName];
+    // Those have to wait for the next frame.
+    if(!busy.empty()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_loaded.insert(m_loaded.begin(), busy.begin(), busy.end());
+    }
+
+    // Without parallel compilation, the driver might compile within the calls
+    // above or only when we ask for the result. Either way, it blocks here.
+    for(auto i = m_compiling.begin() ; i != m_compiling.end() ; ) {
+        if(m_bParallel && !i->pShader->compileDone()) {
+            ++i;
+            continue;
+        }
+
+        this->finish(*i);
+        i = m_compiling.erase(i);
+    }
+}
+
+void ShaderManager::finish(const Job& in_job)
+{
+    const Shader::Ptr& pShader = in_job.pShader;
+    if(!pShader->endCompile(m_cache)) {
+        std::cerr << _("Failed to compile the shader ") << pShader->name()
+                  << (pShader->ready() ? _(", keeping the previous version") : _(", using the fallback")) << std::endl;
+        return;
+    }
+
+    std::cerr << (pShader->fromCache() ? _("Loaded the cached shader ") : _("Compiled the shader "))
+              << pShader->name() << _(" in ") << (m_clock.GetElapsedTime() - in_job.fRequested)*1000.0f << "ms" << std::endl;
+}
+
+std::size_t ShaderManager::pendingCount() const
+{
+    std::size_t n = m_compiling.size();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return n + m_requests.size() + m_loaded.size();
+}
+
+void ShaderManager::ioThread()
+{
+    while(true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while(!m_bQuit && m_requests.empty())
+                m_wakeup.wait(lock);
+
+            if(m_bQuit)
+                return;
+
+            job = m_requests.front();
+            m_requests.pop_front();
+        }
+
+        // When reloading, it's the loose files that changed, not the archive.
+        std::string full = std::string("Shaders/") + job.pShader->name();
+        if(job.bReload) {
+            job.vert = m_fs.readLoose(full + ".vert");
+            job.frag = m_fs.readLoose(full + ".frag");
+        }
+        if(!job.vert.valid())
+            job.vert = m_fs.read(full + ".vert");
+        if(!job.frag.valid())
+            job.frag = m_fs.read(full + ".frag");
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_loaded.push_back(job);
+    }
 }
@@ -1,10 +1,19 @@
 #pragma once
 
+#include "3d/ShaderCache.h"
 #include "3d/VertexArrayObject.h"
+#include "Utilities/FileSystem.h"
+#include "Utilities/FileWatcher.h"
 
+#include <SFML/System/Clock.hpp>
+
+#include <condition_variable>
+#include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace RoadRage {
@@ -43,13 +52,17 @@ struct Uniform {
 };
 
 /// This class represents a fully-linked shader composed of a vertex shader,
-/// a fragment shader and optionally a geometry shader.
+/// a fragment shader and optionally a geometry shader.\n
+/// Shaders get compiled in the background, so a shader handle might not be
+/// ready yet. Until it is, binding it and setting its uniforms use the shader
+/// manager's fallback shader instead, which draws everything in plain grey.
 class Shader {
 public:
     virtual ~Shader();
 
     bool hasVertexAttribute(const std::string& in_sAttribName) const;
     bool setVertexAttribute(const std::string& in_sAttribName, const VertexBufferObject& in_buffer);
+    bool setVertexAttribute(const std::string& in_sAttribName, const VertexBufferObject& in_buffer, GLint in_nComponents, std::size_t in_offset);
 
     bool hasUniform(const std::string& in_sName) const;
     Uniform getUniform(const std::string& in_sName);
@@ -66,6 +79,17 @@ public:
     static void unbind();
 
     GLuint id() const {return m_id;};
+    const std::string& name() const {return m_sName;};
+    /// \return true once the program is linked and can be used.
+    bool ready() const {return m_id != 0;};
+    /// \return true if the program came out of the binary cache.
+    bool fromCache() const {return m_bFromCache;};
+
+    /// All shaders get the vertex attributes of these names bound to the
+    /// same locations. This way, vertex arrays can be set up before the
+    /// shader is ready and work with the fallback shader too.
+    /// \return The location of the attribute \a in_sName, -1 if it has none.
+    static GLint attributeLocation(const std::string& in_sName);
 
     typedef std::shared_ptr<Shader> Ptr;
 
@@ -73,12 +97,45 @@ private:
     friend class ShaderManager;
 
     // I belong to the shader manager.
-    Shader(const std::string& in_sName, const std::string& in_sSourceCodeVert, const std::string& in_sSourceCodeFrag);
+    Shader(const std::string& in_sName, Shader* in_pFallback);
+    // This one compiles right away and throws if that fails.
+    Shader(const std::string& in_sName, const FileView& in_sourceVert, const FileView& in_sourceFrag, ShaderCache& in_cache);
+
+    /// Hands the sources to the driver and starts linking, without waiting
+    /// for either of them to finish.
+    void beginCompile(const FileView& in_sourceVert, const FileView& in_sourceFrag, ShaderCache& in_cache);
+    /// \return true between beginCompile and endCompile.
+    bool compiling() const {return m_pendingProgram != 0;};
+    /// \return true if waiting for the compilation to finish won't block.
+    bool compileDone() const;
+    /// Waits for the compilation to finish and starts using the new program.
+    /// \return false if it failed, in which case the current program is kept.
+    bool endCompile(ShaderCache& in_cache);
+    /// Starts using the already linked \a in_program.
+    void adopt(GLuint in_program);
+    void introspect();
+    /// Makes the block \a in_sName read from binding point \a in_binding,
+    /// if the program uses that block at all.
+    void bindUniformBlock(const std::string& in_sName, GLuint in_binding);
+
+    /// \return The uniform to set, which is the fallback's if not ready yet, or
+    ///         0 if the fallback doesn't have it.
+    /// \throws std::runtime_error if we are ready but don't have it.
+    Uniform* activeUniform(const std::string& in_sName);
 
     char fastNrToChar(uint8_t nr);
 
+    std::string m_sName;
     GLuint m_id;        ///< Contains the OpenGL ID of the compiled shader.
+    bool m_bFromCache;
     std::string m_sLog; ///< Might contain infos/warnings/errors about the shader.
+    Shader* m_pFallback;
+
+    // What's being compiled right now, between beginCompile and endCompile.
+    GLuint m_pendingProgram;
+    GLuint m_pendingVert;
+    GLuint m_pendingFrag;
+    uint64_t m_pendingHash;
 
     std::map<std::string, VertexAttribute> m_attribs;
     std::map<std::string, Uniform> m_uniforms;
@@ -86,15 +143,67 @@ private:
 
 /// This is the shader manager that keeps track of all existing shaders,
 /// creates new shaders, combines them and deletes them.\n
+/// The shader sources are read on a background thread and all compiles are
+/// started right away, so that the driver can work on them in parallel
+/// (KHR_parallel_shader_compile) while the game goes on.
 class ShaderManager {
 public:
-    ShaderManager();
+    /// Needs a current OpenGL context, as it compiles the fallback shader.
+    ShaderManager(const FileSystem& in_fs);
     virtual ~ShaderManager();
 
+    /// \return The shader named \a in_sName, which might not be ready yet.
     Shader::Ptr getOrLoadShader(const std::string& in_sName);
+    /// Starts compiling the shaders whose sources arrived and finishes those
+    /// that are done. Call this once per frame from the GL thread.
+    void update();
+    /// \return The amount of shaders that aren't ready yet.
+    std::size_t pendingCount() const;
+
+    /// From now on, watches the loose shader files. Whenever one of them
+    /// changes, the shaders using it get recompiled in the background and the
+    /// new program replaces the old one in the existing handles. If the new
+    /// version fails to compile, the old one is kept.
+    void enableHotReload();
 
 private:
+    // No copying!
+    ShaderManager(const ShaderManager&);
+    ShaderManager& operator=(const ShaderManager&);
+
+    struct Job {
+        Shader::Ptr pShader;
+        float fRequested;
+        bool bReload;
+        FileView vert;
+        FileView frag;
+    };
+
+    void requestLoad(const Shader::Ptr& in_pShader, bool in_bReload);
+    void checkForChanges();
+    void ioThread();
+    void finish(const Job& in_job);
+
+    const FileSystem& m_fs;
+    ShaderCache m_cache;
+    bool m_bParallel;
+    sf::Clock m_clock;
+
+    Shader::Ptr m_pFallback;
     std::map<std::string, Shader::Ptr> m_mShaders;
+    std::unique_ptr<FileWatcher> m_pWatcher;
+    /// Those whose compilation got started, only touched by the GL thread.
+    std::vector<Job> m_compiling;
+
+    // Communication with the I/O thread, all guarded by m_mutex.
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::deque<Job> m_requests;
+    std::deque<Job> m_loaded;
+    bool m_bQuit;
+
+    // Must come last, as it starts running within the constructor.
+    std::thread m_thread;
 };
 
 }
@@ -0,0 +1,162 @@
+#include "ShaderCache.h"
+
+#include "Utilities/Hash.h"
+#include "Utilities/Path.h"
+#include "Utilities/i18n.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+using namespace RoadRage;
+
+#define D_SHADER_CACHE_MAGIC "RRSC"
+#define D_SHADER_CACHE_VERSION 1
+
+namespace {
+    struct CacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceHash;
+        uint64_t driverHash;
+        uint32_t format;
+        uint32_t length;
+    };
+
+    std::string glString(GLenum in_name)
+    {
+        const GLubyte* s = glGetString(in_name);
+        return s ? reinterpret_cast<const char*>(s) : "";
+    }
+}
+
+ShaderCache::ShaderCache(const std::string& in_sDir)
+    : m_sDir(in_sDir)
+    , m_driverHash(fnv1a(glString(GL_VENDOR) + "\n" + glString(GL_RENDERER) + "\n" + glString(GL_VERSION)))
+    , m_bEnabled(false)
+{
+    // Program binaries are core since OpenGL 4.1, but that's an extension too.
+    if(isGLExtensionSupported("GL_ARB_get_program_binary")) {
+        GLint nFormats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nFormats);
+        m_bEnabled = nFormats > 0 && createDirectories(m_sDir);
+    }
+
+    if(!m_bEnabled)
+        std::cerr << _("The shader cache is disabled, all shaders get compiled at every start.") << std::endl;
+}
+
+ShaderCache::~ShaderCache()
+{
+}
+
+std::string ShaderCache::fileFor(uint64_t in_sourceHash) const
+{
+    uint64_t key = fnv1a(&in_sourceHash, sizeof(in_sourceHash), m_driverHash);
+
+    char name[17];
+    std::sprintf(name, "%016llx", static_cast<unsigned long long>(key));
+    return m_sDir + "/" + name + ".bin";
+}
+
+GLuint ShaderCache::load(uint64_t in_sourceHash)
+{
+    if(!m_bEnabled)
+        return 0;
+
+    std::string sFile = this->fileFor(in_sourceHash);
+    std::ifstream f(sFile.c_str(), std::ios::binary);
+    if(!f)
+        return 0;
+
+    std::vector<char> content((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    f.close();
+
+    // Even though the key is a hash of both, a collision shouldn't give us
+    // some other shader, so check them too.
+    CacheHeader h;
+    bool bValid = content.size() >= sizeof(h);
+    if(bValid) {
+        std::memcpy(&h, &content[0], sizeof(h));
+        bValid = std::memcmp(h.magic, D_SHADER_CACHE_MAGIC, 4) == 0
+              && h.version == D_SHADER_CACHE_VERSION
+              && h.sourceHash == in_sourceHash
+              && h.driverHash == m_driverHash
+              && h.length == content.size() - sizeof(h);
+    }
+
+    GLuint id = 0;
+    if(bValid) {
+        id = glCreateProgram();
+        glProgramBinary(id, h.format, &content[0] + sizeof(h), h.length);
+
+        // The driver is free to reject a binary at any time, for example
+        // after an update that didn't change the version string.
+        GLint bLinked = GL_FALSE;
+        glGetProgramiv(id, GL_LINK_STATUS, &bLinked);
+        if(bLinked != GL_TRUE) {
+            glDeleteProgram(id);
+            id = 0;
+        }
+    }
+
+    if(id == 0) {
+        std::cerr << _("Dropping the stale shader cache entry ") << sFile << std::endl;
+        std::remove(sFile.c_str());
+    }
+
+    return id;
+}
+
+void ShaderCache::prepare(GLuint in_program)
+{
+    if(m_bEnabled)
+        glProgramParameteri(in_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ShaderCache::store(uint64_t in_sourceHash, GLuint in_program)
+{
+    if(!m_bEnabled)
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(in_program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length <= 0)
+        return;
+
+    CacheHeader h;
+    std::vector<char> content(sizeof(h) + length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(in_program, length, &written, &format, &content[0] + sizeof(h));
+    if(written <= 0)
+        return;
+
+    std::memcpy(h.magic, D_SHADER_CACHE_MAGIC, 4);
+    h.version = D_SHADER_CACHE_VERSION;
+    h.sourceHash = in_sourceHash;
+    h.driverHash = m_driverHash;
+    h.format = format;
+    h.length = written;
+    std::memcpy(&content[0], &h, sizeof(h));
+
+    // Write it aside first, so that a crash never leaves a half-written binary.
+    std::string sFile = this->fileFor(in_sourceHash);
+    std::string sTmp = sFile + ".tmp";
+    {
+        std::ofstream f(sTmp.c_str(), std::ios::binary | std::ios::trunc);
+        f.write(&content[0], sizeof(h) + written);
+        if(!f) {
+            std::cerr << _("Failed to write the shader cache entry ") << sTmp << std::endl;
+            return;
+        }
+    }
+
+#if defined(_MSC_VER)
+    std::remove(sFile.c_str());
+#endif
+    std::rename(sTmp.c_str(), sFile.c_str());
+}
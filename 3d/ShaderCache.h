@@ -0,0 +1,49 @@
+#pragma once
+
+#include "3d/OpenGLWrapper.h"
+
+#include <stdint.h>
+#include <string>
+
+namespace RoadRage {
+
+/// Keeps the linked shader programs on disk across runs, using the driver's
+/// program binaries, so that a shader only ever gets compiled once per driver.\n
+/// The binaries are keyed by the hash of the shader's source and by the
+/// vendor, renderer and version of the driver, so updating either of them
+/// simply results in a miss.
+class ShaderCache {
+public:
+    /// Must be created with a current OpenGL context, as it asks the driver
+    /// whether it supports program binaries at all.
+    /// \param in_sDir Where the binaries are stored.
+    ShaderCache(const std::string& in_sDir);
+    virtual ~ShaderCache();
+
+    /// \return false if the driver can't give us binaries. The cache then
+    ///         simply never hits and never stores anything.
+    bool enabled() const { return m_bEnabled; }
+
+    /// Tries to create a program out of the binary stored for \a in_sourceHash.
+    /// \return The ready-to-use program or 0 if there is none or the driver
+    ///         rejected it, in which case the stale binary is removed.
+    GLuint load(uint64_t in_sourceHash);
+    /// Call this on a program before linking it, so the driver keeps what
+    /// store needs.
+    void prepare(GLuint in_program);
+    /// Stores the binary of the freshly linked program \a in_program.
+    void store(uint64_t in_sourceHash, GLuint in_program);
+
+private:
+    // No copying!
+    ShaderCache(const ShaderCache&);
+    ShaderCache& operator=(const ShaderCache&);
+
+    std::string fileFor(uint64_t in_sourceHash) const;
+
+    std::string m_sDir;
+    uint64_t m_driverHash;
+    bool m_bEnabled;
+};
+
+}
@@ -0,0 +1,133 @@
+#include "StreamBuffer.h"
+
+using namespace RoadRage;
+
+StreamBuffer::StreamBuffer(std::size_t in_sizePerFrame)
+    : m_id(0)
+    , m_frameSize(in_sizePerFrame)
+    , m_bCanPersist(isGLExtensionSupported("GL_ARB_buffer_storage"))
+    , m_pPersistent(0)
+    , m_frame(0)
+    , m_head(0)
+    , m_mapped(0)
+{
+    for(unsigned i = 0 ; i < D_STREAM_FRAMES ; ++i) {
+        m_fences[i] = 0;
+    }
+
+    this->create();
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    this->destroy();
+}
+
+void StreamBuffer::create()
+{
+    // The copy-write target is only used because it doesn't interfere with
+    // anything, binding to the element array target would change the VAO.
+    glGenBuffers(1, &m_id);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_id);
+
+    const std::size_t size = m_frameSize * D_STREAM_FRAMES;
+    if(m_bCanPersist) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, size, NULL, flags);
+        m_pPersistent = static_cast<char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+    } else {
+        glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    m_head = m_frame * m_frameSize;
+    m_mapped = m_head;
+}
+
+void StreamBuffer::destroy()
+{
+    for(unsigned i = 0 ; i < D_STREAM_FRAMES ; ++i) {
+        this->wait(i);
+    }
+
+    if(m_pPersistent) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_id);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        m_pPersistent = 0;
+    }
+
+    glDeleteBuffers(1, &m_id);
+    m_id = 0;
+}
+
+void StreamBuffer::wait(unsigned in_frame)
+{
+    GLsync& fence = m_fences[in_frame];
+    if(!fence)
+        return;
+
+    // Only flush the first time round, after that the commands are on their way.
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    while(glClientWaitSync(fence, flags, 1000000) == GL_TIMEOUT_EXPIRED) {
+        flags = 0;
+    }
+
+    glDeleteSync(fence);
+    fence = 0;
+}
+
+void StreamBuffer::beginFrame()
+{
+    m_frame = (m_frame + 1) % D_STREAM_FRAMES;
+    this->wait(m_frame);
+
+    m_head = m_frame * m_frameSize;
+    m_mapped = m_head;
+}
+
+void StreamBuffer::endFrame()
+{
+    if(m_fences[m_frame])
+        glDeleteSync(m_fences[m_frame]);
+    m_fences[m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void* StreamBuffer::map(std::size_t in_size, std::size_t in_alignment)
+{
+    std::size_t start = (m_head + in_alignment - 1) / in_alignment * in_alignment;
+    if(start + in_size > (m_frame + 1) * m_frameSize)
+        return 0;
+
+    m_mapped = start;
+    m_head = start + in_size;
+
+    if(m_pPersistent)
+        return m_pPersistent + start;
+
+    // The fences already make sure the GPU doesn't use this range anymore,
+    // so there's no need to let the driver synchronize.
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_id);
+    void* p = glMapBufferRange(GL_COPY_WRITE_BUFFER, start, in_size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return p;
+}
+
+std::size_t StreamBuffer::unmap()
+{
+    if(!m_pPersistent) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_id);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    return m_mapped;
+}
+
+void StreamBuffer::resize(std::size_t in_sizePerFrame)
+{
+    this->destroy();
+    m_frameSize = in_sizePerFrame;
+    this->create();
+}
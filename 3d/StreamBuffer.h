@@ -0,0 +1,74 @@
+#pragma once
+
+#include "3d/OpenGLWrapper.h"
+
+#include <cstddef>
+
+/// How many frames the CPU may be ahead of the GPU. Every one of them gets
+/// its own part of a StreamBuffer.
+#define D_STREAM_FRAMES 3
+
+namespace RoadRage {
+
+/// A buffer for data that is written anew every frame, like per-object
+/// uniforms, debug lines or text. It is split in D_STREAM_FRAMES parts which
+/// are used in turn, and a fence at the end of every frame tells when the GPU
+/// is done with a part. Thus writing never has to wait for the GPU to finish
+/// drawing from the buffer, as long as it isn't more than D_STREAM_FRAMES
+/// frames behind.\n
+/// With ARB_buffer_storage, the buffer is mapped once for its whole lifetime.
+/// Else, the written range is mapped unsynchronized for each write.\n
+/// The buffer isn't bound to any target, use its id() with whatever needs it.
+class StreamBuffer {
+public:
+    /// \param in_sizePerFrame How many bytes can be written every frame.
+    StreamBuffer(std::size_t in_sizePerFrame);
+    virtual ~StreamBuffer();
+
+    /// Switches to the next part of the buffer. This only waits if the GPU is
+    /// still drawing from what was written D_STREAM_FRAMES frames ago.
+    void beginFrame();
+    /// Call this once all of this frame's draws using the buffer got issued.
+    void endFrame();
+
+    /// Reserves \a in_size bytes of this frame's part, starting at a multiple
+    /// of \a in_alignment, which is what UBO offsets need for example.
+    /// \return Where to write them until unmap, 0 if this frame's part is full.
+    void* map(std::size_t in_size, std::size_t in_alignment = 16);
+    /// \return The offset in the buffer of what got written since map.
+    std::size_t unmap();
+
+    /// Recreates the buffer with room for \a in_sizePerFrame bytes per frame,
+    /// waiting for the GPU to be done with the old one. Everything written so
+    /// far in this frame is lost, so only do this when map failed.
+    void resize(std::size_t in_sizePerFrame);
+
+    GLuint id() const { return m_id; }
+    std::size_t sizePerFrame() const { return m_frameSize; }
+    /// \return true if the buffer is persistently mapped.
+    bool persistent() const { return m_pPersistent != 0; }
+
+private:
+    // No copying!
+    StreamBuffer(const StreamBuffer&);
+    StreamBuffer& operator=(const StreamBuffer&);
+
+    void create();
+    void destroy();
+    void wait(unsigned in_frame);
+
+    GLuint m_id;
+    std::size_t m_frameSize;
+    bool m_bCanPersist;
+    char* m_pPersistent;
+
+    /// The part of the buffer written to in the current frame.
+    unsigned m_frame;
+    GLsync m_fences[D_STREAM_FRAMES];
+    /// Where the next map starts looking for room.
+    std::size_t m_head;
+    /// Where the current map started.
+    std::size_t m_mapped;
+};
+
+}
@@ -0,0 +1,243 @@
+#include "TextLayout.h"
+
+#include "Utilities/i18n.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using namespace RoadRage;
+
+/// Every label's slot has room for at least this many glyphs.
+#define D_LABEL_MIN_GLYPHS 8
+
+TextLayout::TextLayout(const FontMetrics::Ptr& in_pFont)
+    : m_pFont(in_pFont)
+    , m_nLabels(0)
+    , m_nGlyphs(0)
+    , m_bMoved(false)
+    , m_bDirty(false)
+    , m_bRebuilt(false)
+    , m_bMovedSince(false)
+    , m_nRebuilds(0)
+    , m_nPatches(0)
+{
+}
+
+TextLayout::~TextLayout()
+{
+}
+
+TextLayout::Label TextLayout::add(const std::string& in_sText, float in_x, float in_y, const Vector& in_color)
+{
+    Label l;
+    if(!m_free.empty()) {
+        l = m_free.back();
+        m_free.pop_back();
+    } else {
+        if(m_labels.size() >= D_MAX_LABELS)
+            throw std::runtime_error(_("Too many labels at once"));
+
+        l = m_labels.size();
+        m_labels.push_back(LabelData());
+        m_labels[l].first = m_labels[l].capacity = 0;
+        m_labels[l].bPatch = false;
+        m_positions.resize(m_labels.size() * 4, 0.0f);
+    }
+
+    LabelData& d = m_labels[l];
+    d.sText = in_sText;
+    d.color = in_color;
+    d.bAlive = true;
+    ++m_nLabels;
+
+    this->layout(l);
+    this->pos(l, in_x, in_y);
+    this->show(l, true);
+    return l;
+}
+
+void TextLayout::remove(Label in_label)
+{
+    // Its slot stays where it is, hidden, until the label gets reused.
+    LabelData& d = m_labels[in_label];
+    d.bAlive = false;
+    d.sText.clear();
+    m_nGlyphs -= d.vertices.size() / 6;
+    d.vertices.clear();
+    --m_nLabels;
+    m_free.push_back(in_label);
+
+    this->show(in_label, false);
+}
+
+void TextLayout::text(Label in_label, const std::string& in_sText)
+{
+    LabelData& d = m_labels[in_label];
+    if(d.sText == in_sText)
+        return;
+
+    d.sText = in_sText;
+    this->layout(in_label);
+}
+
+void TextLayout::color(Label in_label, const Vector& in_color)
+{
+    LabelData& d = m_labels[in_label];
+    if(d.color == in_color)
+        return;
+
+    d.color = in_color;
+    this->layout(in_label);
+}
+
+void TextLayout::pos(Label in_label, float in_x, float in_y)
+{
+    float* p = &m_positions[in_label * 4];
+    // Glyphs drawn between pixels would be blurry, or broken with nearest filtering.
+    p[0] = std::floor(in_x + 0.5f);
+    p[1] = std::floor(in_y + 0.5f);
+    m_bMoved = true;
+}
+
+void TextLayout::show(Label in_label, bool in_bShow)
+{
+    m_positions[in_label * 4 + 2] = in_bShow ? 1.0f : 0.0f;
+    m_bMoved = true;
+}
+
+Vector TextLayout::measure(const std::string& in_sText) const
+{
+    float x = 0.0f, w = 0.0f, h = m_pFont->lineSpacing();
+    for(std::size_t i = 0 ; i < in_sText.size() ; ++i) {
+        const unsigned char c = in_sText[i];
+        if(c == '\n') {
+            x = 0.0f;
+            h += m_pFont->lineSpacing();
+            continue;
+        }
+
+        if(i > 0 && in_sText[i-1] != '\n')
+            x += m_pFont->kerning(in_sText[i-1], c);
+        x += m_pFont->glyph(c).advance;
+        w = std::max(w, x);
+    }
+
+    return Vector(w, h, 0.0f);
+}
+
+void TextLayout::layout(Label in_label)
+{
+    LabelData& d = m_labels[in_label];
+    m_nGlyphs -= d.vertices.size() / 6;
+    d.vertices.clear();
+    d.vertices.reserve(d.sText.size() * 6);
+
+    Vertex v;
+    v.color[0] = static_cast<uint8_t>(std::max(0.0f, std::min(d.color.x(), 1.0f)) * 255.0f);
+    v.color[1] = static_cast<uint8_t>(std::max(0.0f, std::min(d.color.y(), 1.0f)) * 255.0f);
+    v.color[2] = static_cast<uint8_t>(std::max(0.0f, std::min(d.color.z(), 1.0f)) * 255.0f);
+    v.color[3] = 255;
+    v.label = static_cast<uint16_t>(in_label);
+    v.padding = 0;
+
+    // The pen starts on the first line's baseline.
+    float penX = 0.0f, penY = static_cast<float>(m_pFont->size());
+    for(std::size_t i = 0 ; i < d.sText.size() ; ++i) {
+        const unsigned char c = d.sText[i];
+        if(c == '\n') {
+            penX = 0.0f;
+            penY += m_pFont->lineSpacing();
+            continue;
+        }
+
+        if(i > 0 && d.sText[i-1] != '\n')
+            penX += m_pFont->kerning(d.sText[i-1], c);
+
+        const FontMetrics::Glyph& g = m_pFont->glyph(c);
+        if(g.x1 > g.x0) {
+            // Two triangles, (0, 1, 2) and (2, 1, 3) of the quad's corners.
+            const float xs[2] = { penX + g.x0, penX + g.x1 }, ys[2] = { penY + g.y0, penY + g.y1 };
+            const float us[2] = { g.u0, g.u1 }, vs[2] = { g.v0, g.v1 };
+            const unsigned corners[6] = { 0, 1, 2, 2, 1, 3 };
+            for(unsigned k = 0 ; k < 6 ; ++k) {
+                const unsigned cx = corners[k] & 1, cy = corners[k] >> 1;
+                v.pos[0] = xs[cx];
+                v.pos[1] = ys[cy];
+                v.texCoord[0] = static_cast<uint16_t>(us[cx] * 65535.0f);
+                v.texCoord[1] = static_cast<uint16_t>(vs[cy] * 65535.0f);
+                d.vertices.push_back(v);
+            }
+        }
+
+        penX += g.advance;
+    }
+    m_nGlyphs += d.vertices.size() / 6;
+
+    // Overwriting the slot is enough as long as the glyphs fit in there.
+    if(m_bDirty)
+        return;
+
+    if(d.capacity == 0 || d.vertices.size() > d.capacity) {
+        m_bDirty = true;
+    } else if(!d.bPatch) {
+        d.bPatch = true;
+        m_patches.push_back(in_label);
+    }
+}
+
+void TextLayout::update()
+{
+    m_bRebuilt = false;
+    m_patched.clear();
+    if(m_bDirty)
+        this->rebuild();
+    else if(!m_patches.empty())
+        this->patch();
+
+    m_bMovedSince = m_bMoved;
+    m_bMoved = false;
+}
+
+void TextLayout::rebuild()
+{
+    Vertex degenerate;
+    std::memset(&degenerate, 0, sizeof(degenerate));
+
+    // Give every label, even the dead ones waiting to be reused, a slot with
+    // some room to grow. The unused part of the slots collapses to a point.
+    m_vertices.clear();
+    for(auto i = m_labels.begin() ; i != m_labels.end() ; ++i) {
+        const std::size_t nGlyphs = i->vertices.size() / 6;
+        i->first = m_vertices.size();
+        i->capacity = std::max<std::size_t>(nGlyphs + nGlyphs / 2, D_LABEL_MIN_GLYPHS) * 6;
+        i->bPatch = false;
+
+        m_vertices.insert(m_vertices.end(), i->vertices.begin(), i->vertices.end());
+        degenerate.label = static_cast<uint16_t>(i - m_labels.begin());
+        m_vertices.resize(i->first + i->capacity, degenerate);
+    }
+    m_patches.clear();
+
+    m_bDirty = false;
+    m_bRebuilt = true;
+    ++m_nRebuilds;
+}
+
+void TextLayout::patch()
+{
+    Vertex degenerate;
+    std::memset(&degenerate, 0, sizeof(degenerate));
+
+    for(auto i = m_patches.begin() ; i != m_patches.end() ; ++i) {
+        LabelData& d = m_labels[*i];
+        degenerate.label = static_cast<uint16_t>(*i);
+        std::copy(d.vertices.begin(), d.vertices.end(), m_vertices.begin() + d.first);
+        std::fill(m_vertices.begin() + d.first + d.vertices.size(), m_vertices.begin() + d.first + d.capacity, degenerate);
+        m_patched.push_back(std::make_pair(d.first, d.capacity));
+        d.bPatch = false;
+        ++m_nPatches;
+    }
+    m_patches.clear();
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "3d/FontMetrics.h"
+#include "3d/Math/Vector.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// How many labels may exist at once. This has to be the size of the array
+/// in the "Labels" block and keep it within 16KiB.
+#define D_MAX_LABELS 1024
+
+namespace RoadRage {
+
+/// All the text on screen, HUD and debug labels alike, laid out into one
+/// vertex buffer, which the TextRenderer draws. Every piece of text is a
+/// label, which stays until it gets removed. A label's glyphs only get laid
+/// out again when its text or color changes. Each label owns a slot of the
+/// vertex buffer with some room to spare, so that changed text usually only
+/// overwrites its slot; the whole buffer only gets rebuilt when a label
+/// outgrows it or new slots are needed. Moving labels around, like the ones
+/// floating over entities do every frame, only changes their positions.\n
+/// None of this needs a GL context.
+class TextLayout {
+public:
+    /// Identifies a label. They're reused once removed.
+    typedef std::size_t Label;
+
+    /// This has to match the attributes of the Text shader.
+    struct Vertex {
+        float pos[2];         ///< Relative to the label's top left, in pixels.
+        uint16_t texCoord[2]; ///< Normalized.
+        uint8_t color[4];
+        uint16_t label;       ///< The index into the "Labels" block.
+        uint16_t padding;
+    };
+
+    TextLayout(const FontMetrics::Ptr& in_pFont);
+    virtual ~TextLayout();
+
+    /// Creates a new label, shown at (\a in_x, \a in_y) pixels from the top
+    /// left of the screen.
+    /// \throws std::runtime_error if there are D_MAX_LABELS labels already.
+    Label add(const std::string& in_sText = std::string(), float in_x = 0.0f, float in_y = 0.0f, const Vector& in_color = Vector(1.0f, 1.0f, 1.0f));
+    void remove(Label in_label);
+
+    /// Changes what \a in_label says. Setting the same text again is free.
+    void text(Label in_label, const std::string& in_sText);
+    void color(Label in_label, const Vector& in_color);
+    /// Moves the top left of \a in_label to (\a in_x, \a in_y), in pixels.
+    void pos(Label in_label, float in_x, float in_y);
+    /// Hides or shows \a in_label without forgetting it.
+    void show(Label in_label, bool in_bShow);
+
+    /// \return How big \a in_sText is on screen, in pixels, as (w, h, 0).
+    Vector measure(const std::string& in_sText) const;
+
+    /// Brings the vertex buffer up to date with the labels, by rebuilding it
+    /// or only overwriting the slots of the labels that changed, whichever
+    /// does. What it did is told by rebuilt, patched and moved until the
+    /// next update.
+    void update();
+    /// All labels' slots, one after the other, as of the last update.
+    const std::vector<Vertex>& vertices() const { return m_vertices; }
+    /// \return Whether the last update laid out the whole vertex buffer anew.
+    bool rebuilt() const { return m_bRebuilt; }
+    /// \return The slots the last update overwrote, as (first, count) in
+    ///         vertices, if it didn't rebuild.
+    const std::vector<std::pair<std::size_t, std::size_t>>& patched() const { return m_patched; }
+    /// \return Whether any label moved, showed up or got hidden until the last update.
+    bool moved() const { return m_bMovedSince; }
+    /// (x, y, shown, unused) of every label, as it goes into the "Labels" block.
+    const std::vector<float>& positions() const { return m_positions; }
+
+    std::size_t labelCount() const { return m_nLabels; }
+    /// \return The amount of glyphs of all labels.
+    std::size_t glyphCount() const { return m_nGlyphs; }
+    /// \return How many times the whole vertex buffer got rebuilt so far.
+    std::size_t rebuildCount() const { return m_nRebuilds; }
+    /// \return How many times a single label's slot got updated so far.
+    std::size_t patchCount() const { return m_nPatches; }
+
+private:
+    // No copying!
+    TextLayout(const TextLayout&);
+    TextLayout& operator=(const TextLayout&);
+
+    struct LabelData {
+        std::string sText;
+        Vector color;
+        bool bAlive;
+        /// The laid-out glyphs, in label space.
+        std::vector<Vertex> vertices;
+        /// The label's slot in the vertex buffer, in vertices. The part of it
+        /// not used by glyphs is degenerate triangles.
+        std::size_t first, capacity;
+        /// Whether the slot is waiting to be overwritten.
+        bool bPatch;
+    };
+
+    void layout(Label in_label);
+    void rebuild();
+    void patch();
+
+    FontMetrics::Ptr m_pFont;
+
+    std::vector<LabelData> m_labels;
+    std::vector<Label> m_free;
+    std::size_t m_nLabels;
+    std::size_t m_nGlyphs;
+    /// The labels whose slot needs to be overwritten on the next update.
+    std::vector<Label> m_patches;
+    std::vector<float> m_positions;
+    bool m_bMoved;
+
+    std::vector<Vertex> m_vertices;
+    /// Whether the slots need to be laid out anew.
+    bool m_bDirty;
+    bool m_bRebuilt;
+    std::vector<std::pair<std::size_t, std::size_t>> m_patched;
+    bool m_bMovedSince;
+    std::size_t m_nRebuilds;
+    std::size_t m_nPatches;
+};
+
+}
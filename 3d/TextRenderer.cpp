@@ -0,0 +1,113 @@
+#include "TextRenderer.h"
+
+#include "3d/UniformBuffer.h"
+
+#include <cstddef>
+
+using namespace RoadRage;
+
+TextRenderer::TextRenderer(ShaderManager& in_shadmgr, const Font::Ptr& in_pFont)
+    : TextLayout(in_pFont)
+    , m_pFont(in_pFont)
+    , m_pShader(in_shadmgr.getOrLoadShader("Text"))
+    , m_vbo(0)
+    , m_ubo(0)
+    , m_vboCapacity(0)
+{
+    glGenBuffers(1, &m_vbo);
+
+    glGenBuffers(1, &m_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, D_MAX_LABELS * 4 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    this->setupVertexArray();
+}
+
+TextRenderer::~TextRenderer()
+{
+    glDeleteBuffers(1, &m_ubo);
+    glDeleteBuffers(1, &m_vbo);
+}
+
+void TextRenderer::setupVertexArray()
+{
+    const GLint pos = Shader::attributeLocation("aVertexPosition");
+    const GLint uv = Shader::attributeLocation("aVertexTexCoord");
+    const GLint color = Shader::attributeLocation("aVertexColor");
+    const GLint label = Shader::attributeLocation("aVertexLabel");
+
+    m_vao.bind();
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glEnableVertexAttribArray(pos);
+    glEnableVertexAttribArray(uv);
+    glEnableVertexAttribArray(color);
+    glEnableVertexAttribArray(label);
+    glVertexAttribPointer(pos, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<const GLvoid*>(offsetof(Vertex, pos)));
+    glVertexAttribPointer(uv, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(Vertex), reinterpret_cast<const GLvoid*>(offsetof(Vertex, texCoord)));
+    glVertexAttribPointer(color, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), reinterpret_cast<const GLvoid*>(offsetof(Vertex, color)));
+    // Small integers are exact as floats, which saves us glVertexAttribIPointer.
+    glVertexAttribPointer(label, 1, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(Vertex), reinterpret_cast<const GLvoid*>(offsetof(Vertex, label)));
+    VertexArrayObject::unbind();
+    VertexBufferObject::unbind();
+}
+
+void TextRenderer::draw(unsigned in_screenWidth, unsigned in_screenHeight)
+{
+    // Nothing sensible to fall back to while the shader is still compiling.
+    if(!m_pShader->ready())
+        return;
+
+    // Uploading whatever the layout changed, which usually is little.
+    this->update();
+    const std::vector<Vertex>& vertices = this->vertices();
+    if(this->rebuilt() && !vertices.empty()) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        if(vertices.size() > m_vboCapacity) {
+            m_vboCapacity = vertices.size() + vertices.size() / 2;
+            glBufferData(GL_ARRAY_BUFFER, m_vboCapacity * sizeof(Vertex), NULL, GL_DYNAMIC_DRAW);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(Vertex), &vertices[0]);
+        VertexBufferObject::unbind();
+    } else if(!this->patched().empty()) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        for(auto i = this->patched().begin() ; i != this->patched().end() ; ++i) {
+            glBufferSubData(GL_ARRAY_BUFFER, i->first * sizeof(Vertex), i->second * sizeof(Vertex), &vertices[i->first]);
+        }
+        VertexBufferObject::unbind();
+    }
+
+    if(vertices.empty())
+        return;
+
+    if(this->moved() || this->rebuilt()) {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_ubo);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, this->positions().size() * sizeof(float), &this->positions()[0]);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+    glBindBufferBase(GL_UNIFORM_BUFFER, UniformBlock::Labels, m_ubo);
+
+    const GLboolean bDepthTest = glIsEnabled(GL_DEPTH_TEST);
+    const GLboolean bBlend = glIsEnabled(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    m_pShader->bind();
+    m_pShader->setUniform("uScreenSize", Vector(static_cast<float>(in_screenWidth), static_cast<float>(in_screenHeight), 0.0f));
+    m_pShader->setUniformSampler("uAtlas", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_pFont->texture());
+
+    m_vao.bind();
+    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices.size()));
+    VertexArrayObject::unbind();
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    Shader::unbind();
+
+    if(bDepthTest)
+        glEnable(GL_DEPTH_TEST);
+    if(!bBlend)
+        glDisable(GL_BLEND);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "3d/Font.h"
+#include "3d/Shader.h"
+#include "3d/TextLayout.h"
+#include "3d/VertexArrayObject.h"
+
+#include <cstddef>
+
+namespace RoadRage {
+
+/// Draws all the text on screen, as the TextLayout it is has it, with one
+/// draw call. Only the slots of the labels that changed get uploaded, and
+/// moving labels only updates their position in the "Labels" uniform block:
+/// \code
+/// layout(std140) uniform Labels {
+///     vec4 uLabels[D_MAX_LABELS]; // x, y, shown, unused
+/// };
+/// \endcode
+class TextRenderer : public TextLayout {
+public:
+    /// Needs a current OpenGL context.
+    TextRenderer(ShaderManager& in_shadmgr, const Font::Ptr& in_pFont);
+    virtual ~TextRenderer();
+
+    /// Draws all shown labels on top of everything, at once.
+    void draw(unsigned in_screenWidth, unsigned in_screenHeight);
+
+private:
+    // No copying!
+    TextRenderer(const TextRenderer&);
+    TextRenderer& operator=(const TextRenderer&);
+
+    void setupVertexArray();
+
+    Font::Ptr m_pFont;
+    Shader::Ptr m_pShader;
+
+    GLuint m_vbo;
+    GLuint m_ubo;
+    VertexArrayObject m_vao;
+    std::size_t m_vboCapacity;
+};
+
+}
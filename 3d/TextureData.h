@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace RoadRage {
+
+/// The layout of a cooked texture (.rrtex) as written by roadrage_cook:
+/// this header followed by the pixels of every mipmap level, starting with the
+/// biggest one and halving both sides down to 1x1. The pixels are RGBA8 in the
+/// row order the image decoder gives them, the top row of the image first.
+/// glTexImage2D takes the first row for t = 0, so a texture loaded as it is
+/// has t going down the image, as with an sf::Image.
+struct TextureHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t nLevels;
+    uint32_t reserved;
+};
+
+static const char* const TextureMagic = "RRTX";
+static const uint32_t TextureVersion = 1;
+
+}
@@ -0,0 +1,132 @@
+#include "UniformBuffer.h"
+
+#include "Camera.h"
+
+#include <cstring>
+
+using namespace RoadRage;
+
+/// The amount of objects we make room for in the beginning, it grows as needed.
+#define D_OBJECT_UNIFORMS_INITIAL 1024
+
+namespace {
+    // These have to match the std140 layout of the blocks in the shaders.
+    struct FrameData {
+        float view[16];
+        float proj[16];
+        float viewProj[16];
+        float time;
+        float padding[3];
+    };
+
+    struct ObjectData {
+        float model[16];
+    };
+}
+
+FrameUniforms::FrameUniforms()
+    : m_id(0)
+{
+    glGenBuffers(1, &m_id);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_id);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+FrameUniforms::~FrameUniforms()
+{
+    glDeleteBuffers(1, &m_id);
+}
+
+void FrameUniforms::update(const Camera& in_cam, float in_fTime)
+{
+    FrameData data;
+    std::memcpy(data.view, in_cam.view().array16f(), sizeof(data.view));
+    std::memcpy(data.proj, in_cam.proj().array16f(), sizeof(data.proj));
+    std::memcpy(data.viewProj, static_cast<General4x4Matrix>(in_cam).array16f(), sizeof(data.viewProj));
+    data.time = in_fTime;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_id);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(data), &data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, UniformBlock::Frame, m_id);
+}
+
+namespace {
+    std::size_t uniformAlignment()
+    {
+        GLint align = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+        return align > 0 ? align : 1;
+    }
+}
+
+ObjectUniforms::ObjectUniforms()
+    : m_align(uniformAlignment())
+    , m_stream(sizeof(ObjectData) * D_OBJECT_UNIFORMS_INITIAL)
+    , m_base(0)
+{
+}
+
+ObjectUniforms::~ObjectUniforms()
+{
+}
+
+void ObjectUniforms::clear()
+{
+    m_staging.clear();
+}
+
+std::size_t ObjectUniforms::count() const
+{
+    return m_staging.size() / sizeof(ObjectData);
+}
+
+std::size_t ObjectUniforms::beginBatch()
+{
+    // Leave some slots empty, for the batch to start at an aligned offset.
+    while(m_staging.size() % m_align != 0) {
+        m_staging.resize(m_staging.size() + sizeof(ObjectData));
+    }
+
+    return this->count();
+}
+
+std::size_t ObjectUniforms::add(const AffineMatrix& in_model)
+{
+    std::size_t slot = this->count();
+    m_staging.resize(m_staging.size() + sizeof(ObjectData));
+    std::memcpy(&m_staging[slot*sizeof(ObjectData)], in_model.array16f(), sizeof(ObjectData));
+    return slot;
+}
+
+void ObjectUniforms::upload()
+{
+    m_stream.beginFrame();
+    if(m_staging.empty())
+        return;
+
+    // The whole block gets bound for every batch, even the last one, so there
+    // needs to be room for a full block after it.
+    const std::size_t size = m_staging.size() + sizeof(ObjectData) * D_MAX_INSTANCES;
+    void* p = m_stream.map(size, m_align);
+    if(!p) {
+        // This is rare enough to be allowed to wait for the GPU.
+        m_stream.resize(size * 2);
+        p = m_stream.map(size, m_align);
+    }
+
+    std::memcpy(p, &m_staging[0], m_staging.size());
+    m_base = m_stream.unmap();
+}
+
+void ObjectUniforms::bind(std::size_t in_firstSlot) const
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, UniformBlock::Object, m_stream.id(), m_base + in_firstSlot*sizeof(ObjectData), sizeof(ObjectData) * D_MAX_INSTANCES);
+}
+
+void ObjectUniforms::endFrame()
+{
+    m_stream.endFrame();
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "3d/OpenGLWrapper.h"
+#include "3d/Math/Matrix.h"
+#include "3d/StreamBuffer.h"
+
+#include <cstddef>
+#include <vector>
+
+/// How many objects one draw can have at most. This has to be the size of the
+/// array in the "Object" block and keep the block within the 16KiB that every
+/// driver supports.
+#define D_MAX_INSTANCES 256
+
+namespace RoadRage {
+
+class Camera;
+
+/// The binding points of the uniform blocks all our shaders share. Shaders
+/// just declare the blocks by name, Shader connects them to these points.
+namespace UniformBlock {
+    enum Enum {
+        Frame = 0,  ///< The "Frame" block, see FrameUniforms.
+        Object = 1, ///< The "Object" block, see ObjectUniforms.
+        Labels = 2, ///< The "Labels" block, see TextRenderer.
+    };
+}
+
+/// Everything that stays the same during a whole frame. Shaders get it through
+/// \code
+/// layout(std140) uniform Frame {
+///     mat4 uView;
+///     mat4 uProj;
+///     mat4 uViewProj;
+///     float uTime;
+/// };
+/// \endcode
+class FrameUniforms {
+public:
+    FrameUniforms();
+    virtual ~FrameUniforms();
+
+    /// Uploads the camera and time of this frame and binds the block. This is
+    /// meant to be done only once per frame.
+    void update(const Camera& in_cam, float in_fTime);
+
+private:
+    // No copying!
+    FrameUniforms(const FrameUniforms&);
+    FrameUniforms& operator=(const FrameUniforms&);
+
+    GLuint m_id;
+};
+
+/// The per-object data, which shaders get through
+/// \code
+/// layout(std140) uniform Object {
+///     mat4 uModels[D_MAX_INSTANCES];
+/// };
+/// mat4 uModel = uModels[gl_InstanceID];
+/// \endcode
+/// The objects come in batches, every batch being drawn by one instanced draw.
+/// The data of all objects of a frame gets collected first and streamed to the
+/// GPU in a single go. Then, every draw only points the block to its batch.
+class ObjectUniforms {
+public:
+    ObjectUniforms();
+    virtual ~ObjectUniforms();
+
+    /// Forgets about all objects, to start collecting the next frame's.
+    void clear();
+    /// Starts a new batch, which may hold up to D_MAX_INSTANCES objects.
+    /// \return The slot of the batch's first object.
+    std::size_t beginBatch();
+    /// \return The slot of the object with model matrix \a in_model.
+    std::size_t add(const AffineMatrix& in_model);
+    /// Sends all the objects added since clear to the GPU.
+    void upload();
+    /// Makes the "Object" block start at the object in \a in_firstSlot.
+    void bind(std::size_t in_firstSlot) const;
+    /// Call this once all of this frame's objects got drawn.
+    void endFrame();
+
+    std::size_t count() const;
+
+private:
+    // No copying!
+    ObjectUniforms(const ObjectUniforms&);
+    ObjectUniforms& operator=(const ObjectUniforms&);
+
+    /// Every batch needs to start at a multiple of the driver's alignment.
+    std::size_t m_align;
+    StreamBuffer m_stream;
+    /// Where this frame's slots start in m_stream.
+    std::size_t m_base;
+    std::vector<char> m_staging;
+};
+
+}
@@ -15,6 +15,19 @@ VertexBufferObject::VertexBufferObject(const std::vector<float>& in_buf, GLint i
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
+VertexBufferObject::VertexBufferObject(const void* in_data, std::size_t in_size, GLsizei in_stride, GLenum in_usage)
+    : id(0)
+    , nComponents(0) // Given per attribute when binding to a shader.
+    , type(GL_FLOAT)
+    , normalize(GL_FALSE)
+    , stride(in_stride)
+{
+    glGenBuffers(1, &this->id);
+    glBindBuffer(GL_ARRAY_BUFFER, this->id);
+    glBufferData(GL_ARRAY_BUFFER, in_size, in_data, in_usage);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 void VertexBufferObject::bind() const
 {
     glBindBuffer(GL_ARRAY_BUFFER, this->id);
@@ -36,6 +49,8 @@ ElementsBufferObject::ElementsBufferObject(const std::vector<int>& in_buf, GLint
     , type(GL_INT)
     , normalize(in_normalize)
     , stride(nComponents*sizeof(int))
+    , indexType(GL_UNSIGNED_INT)
+    , count(in_buf.size())
 {
     glGenBuffers(1, &this->id);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->id);
@@ -43,6 +58,36 @@ ElementsBufferObject::ElementsBufferObject(const std::vector<int>& in_buf, GLint
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
+ElementsBufferObject::ElementsBufferObject(const std::vector<uint16_t>& in_buf, GLint in_nComponents, GLenum in_usage)
+    : id(0)
+    , nComponents(in_nComponents)
+    , type(GL_UNSIGNED_SHORT)
+    , normalize(GL_FALSE)
+    , stride(nComponents*sizeof(uint16_t))
+    , indexType(GL_UNSIGNED_SHORT)
+    , count(in_buf.size())
+{
+    glGenBuffers(1, &this->id);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->id);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, in_buf.size()*sizeof(uint16_t), in_buf.data(), in_usage);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+ElementsBufferObject::ElementsBufferObject(const std::vector<uint32_t>& in_buf, GLint in_nComponents, GLenum in_usage)
+    : id(0)
+    , nComponents(in_nComponents)
+    , type(GL_UNSIGNED_INT)
+    , normalize(GL_FALSE)
+    , stride(nComponents*sizeof(uint32_t))
+    , indexType(GL_UNSIGNED_INT)
+    , count(in_buf.size())
+{
+    glGenBuffers(1, &this->id);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->id);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, in_buf.size()*sizeof(uint32_t), in_buf.data(), in_usage);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
 void ElementsBufferObject::bind() const
 {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->id);
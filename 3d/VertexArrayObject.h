@@ -2,6 +2,7 @@
 
 #include "3d/OpenGLWrapper.h"
 
+#include <stdint.h>
 #include <vector>
 
 namespace RoadRage {
@@ -14,6 +15,9 @@ struct VertexBufferObject {
     GLsizei stride;
 
     VertexBufferObject(const std::vector<float>& in_buf, GLint in_nComponents, GLenum in_usage = GL_STATIC_DRAW);
+    /// Creates a buffer holding interleaved vertices of \a in_stride bytes
+    /// each. The attributes are picked out of it when binding it to a shader.
+    VertexBufferObject(const void* in_data, std::size_t in_size, GLsizei in_stride, GLenum in_usage = GL_STATIC_DRAW);
     virtual ~VertexBufferObject();
 
     void bind() const;
@@ -26,8 +30,14 @@ struct ElementsBufferObject {
     GLenum type;
     GLboolean normalize;
     GLsizei stride;
+    GLenum indexType; ///< What to pass to glDrawElements: GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+    GLsizei count;    ///< The amount of indices stored in the buffer.
 
     ElementsBufferObject(const std::vector<int>& in_buf, GLint in_nComponents, GLenum in_usage = GL_STATIC_DRAW, GLboolean in_normalize = GL_FALSE);
+    /// 16-bit indices take half the memory and bandwidth; use them whenever
+    /// there are no more than 65536 vertices.
+    ElementsBufferObject(const std::vector<uint16_t>& in_buf, GLint in_nComponents, GLenum in_usage = GL_STATIC_DRAW);
+    ElementsBufferObject(const std::vector<uint32_t>& in_buf, GLint in_nComponents, GLenum in_usage = GL_STATIC_DRAW);
     virtual ~ElementsBufferObject();
 
     void bind() const;
@@ -2,18 +2,85 @@
 
 #include "Utilities/String.h"
 
-#include <SFML/Window/VideoMode.hpp>
-
 using namespace RoadRage;
 
-RoadRageDefaultSettings::RoadRageDefaultSettings()
+RoadRageDefaultSettings::RoadRageDefaultSettings(unsigned in_width, unsigned in_height)
 {
-    sf::VideoMode defaultMode = sf::VideoMode::GetDesktopMode();
-
-    add("Width", to_s(defaultMode.Width));
-    add("Height", to_s(defaultMode.Height));
+    add("Width", to_s(in_width));
+    add("Height", to_s(in_height));
     add("Fullscreen", "1");
     add("AntiAliasing", "2");
+
+    // World streaming: the side length of a chunk in meters, how many chunks
+    // around the avatar are kept alive, how much memory they may use in MB
+    // and how many milliseconds per frame we may spend creating them.
+    add("ChunkSize", "32");
+    add("ChunkRadius", "3");
+    add("ChunkMemoryBudget", "64");
+    add("ChunkUploadBudget", "2");
+
+    // The archive made by roadrage_cook. Loose files in Data/ are used for
+    // anything that isn't in there.
+    add("AssetArchive", "Data.rrpak");
+
+    // Recompile shaders as soon as their loose files in Data/Shaders change.
+    // That polls the files, so it's for developing shaders only.
+    add("ShaderHotReload", "0");
+
+    // How many threads share the work of a frame, 0 meaning one per core.
+    add("WorkerThreads", "0");
+
+    // Don't draw what's hidden behind buildings, which is found out on the
+    // CPU. The debug view shows the buildings and everything they hide.
+    add("OcclusionCulling", "1");
+    add("OcclusionDebug", "0");
+
+    // Debug labels floating over the entities near the camera. The benchmark
+    // adds that many more labels jumping around the screen, 0 meaning none.
+    add("EntityLabels", "0");
+    add("TextBenchmarkLabels", "0");
+
+    // The roads the AI traffic drives on, generated over that many chunks
+    // around the origin when the level doesn't come with them, how many
+    // routes through them are remembered, and whether to draw their lanes.
+    add("RoadNetworkRadius", "32");
+    add("RouteCacheSize", "4096");
+    add("RoadDebug", "0");
+
+    // How many cars the computer drives around, how many frames pass between
+    // two decisions of each driver, and how many meters from all players
+    // they may be before they're left to decide less often.
+    add("TrafficCars", "2000");
+    add("TrafficDecisionFrames", "6");
+    add("TrafficActiveRadius", "250");
+
+    // Whether the avatar drives with real vehicle physics rather than the
+    // simple ones, and how many times a second they are stepped, up to 1000.
+    add("VehiclePhysics", "1");
+    add("VehicleSubstepRate", "1000");
+
+    // Playing on a server rather than alone: its address, empty meaning to
+    // play alone, and port. The server simulates that many ticks a second and
+    // tells each player about the traffic within that many meters of them,
+    // sending them no more than that many bytes a second.
+    add("Server", "");
+    add("ServerPort", "4242");
+    add("ServerTickRate", "30");
+    add("SnapshotRadius", "150");
+    add("SnapshotBandwidth", "32768");
+
+    // On a server, the other cars are shown that many seconds in the past,
+    // in between the snapshots around then, to ride out late and lost ones.
+    // The own car is driven right away and corrected when the server
+    // disagrees, replaying up to that many ticks of input on top.
+    add("InterpolationDelay", "0.1");
+    add("PredictionReplayLimit", "32");
+    // For trying out how playing on a bad network is: makes everything to and
+    // from the server take that many seconds longer, give or take the jitter,
+    // and get lost with that chance.
+    add("NetLatency", "0");
+    add("NetJitter", "0");
+    add("NetLoss", "0");
 }
 
 RoadRageDefaultSettings::~RoadRageDefaultSettings()
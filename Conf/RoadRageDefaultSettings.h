@@ -6,7 +6,9 @@ namespace RoadRage {
     class RoadRageDefaultSettings : public DefaultOptions
     {
     public:
-        RoadRageDefaultSettings();
+        /// \param in_width, in_height The default resolution, which the game
+        ///        takes from the desktop. The server has none, and no use for it.
+        RoadRageDefaultSettings(unsigned in_width = 800, unsigned in_height = 600);
         ~RoadRageDefaultSettings();
     };
 
@@ -0,0 +1,12 @@
+#version 140
+precision highp float;
+precision lowp int;
+
+smooth in vec4 Color;
+
+out vec4 oColor;
+
+void main ()
+{
+    oColor = Color;
+}
@@ -0,0 +1,22 @@
+#version 140
+precision highp float;
+precision lowp int;
+
+in vec3 aVertexPosition;
+in vec4 aVertexColor;
+
+layout(std140) uniform Frame {
+    mat4 uView;
+    mat4 uProj;
+    mat4 uViewProj;
+    float uTime;
+};
+
+// The lines come in world space already.
+smooth out vec4 Color;
+
+void main()
+{
+    Color = aVertexColor;
+    gl_Position = uViewProj * vec4(aVertexPosition, 1.0);
+}
@@ -0,0 +1,34 @@
+#version 140
+precision highp float;
+precision lowp int;
+
+in vec3 aVertexPosition;
+
+layout(std140) uniform Frame {
+    mat4 uView;
+    mat4 uProj;
+    mat4 uViewProj;
+    float uTime;
+};
+
+layout(std140) uniform Object {
+    mat4 uModels[256];
+};
+
+invariant gl_Position;
+
+void main()
+{
+    mat4 model = uModels[gl_InstanceID];
+
+    // The camera's right and up directions in world space are the first two
+    // rows of the view matrix, as it has no scaling.
+    vec3 right = vec3(uView[0][0], uView[1][0], uView[2][0]);
+    vec3 up = vec3(uView[0][1], uView[1][1], uView[2][1]);
+
+    float width = max(length(model[0].xyz), length(model[2].xyz));
+    float height = length(model[1].xyz);
+
+    vec3 pos = model[3].xyz + right * aVertexPosition.x * width + up * aVertexPosition.y * height;
+    gl_Position = uViewProj * vec4(pos, 1.0);
+}
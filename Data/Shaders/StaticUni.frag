@@ -1,4 +1,4 @@
-#version 130
+#version 140
 precision highp float;
 precision lowp int;
 
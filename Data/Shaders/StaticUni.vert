@@ -1,15 +1,24 @@
-#version 130
+#version 140
 precision highp float;
 precision lowp int;
 
 in vec3 aVertexPosition;
 
-uniform mat4 uModelViewProjectionMatrix = mat4(1.0);
+layout(std140) uniform Frame {
+    mat4 uView;
+    mat4 uProj;
+    mat4 uViewProj;
+    float uTime;
+};
+
+layout(std140) uniform Object {
+    mat4 uModels[256];
+};
 
 invariant gl_Position;
 
 void main()
 {
-    gl_Position = uModelViewProjectionMatrix * vec4(aVertexPosition, 1.0);
+    gl_Position = uViewProj * uModels[gl_InstanceID] * vec4(aVertexPosition, 1.0);
 //     gl_Position = vec4(0.5, 0.5, 0.0, 1.0);
 }
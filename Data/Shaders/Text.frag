@@ -0,0 +1,16 @@
+#version 140
+precision highp float;
+precision lowp int;
+
+uniform sampler2D uAtlas;
+
+smooth in vec2 TexCoord;
+flat in vec4 Color;
+
+out vec4 oColor;
+
+void main ()
+{
+    // The atlas only holds the glyphs' coverage.
+    oColor = vec4(Color.rgb, Color.a * texture(uAtlas, TexCoord).r);
+}
@@ -0,0 +1,32 @@
+#version 140
+precision highp float;
+precision lowp int;
+
+in vec2 aVertexPosition;
+in vec2 aVertexTexCoord;
+in vec4 aVertexColor;
+in float aVertexLabel;
+
+// x, y, shown, unused of every label, see TextRenderer.
+layout(std140) uniform Labels {
+    vec4 uLabels[1024];
+};
+
+uniform vec2 uScreenSize;
+
+smooth out vec2 TexCoord;
+flat out vec4 Color;
+
+void main()
+{
+    vec4 label = uLabels[int(aVertexLabel)];
+    TexCoord = aVertexTexCoord;
+    Color = aVertexColor;
+
+    // The positions are in pixels from the top left of the screen.
+    vec2 pos = (label.xy + aVertexPosition) / uScreenSize * 2.0 - 1.0;
+    pos.y = -pos.y;
+
+    // Hidden labels end up behind the far plane, where they get clipped.
+    gl_Position = vec4(pos, label.z > 0.5 ? 0.0 : 2.0, 1.0);
+}
@@ -1,12 +1,14 @@
 #include "Avatar.h"
 
-#include <SFML/Window/Input.hpp>
-
 using namespace RoadRage;
 
-Avatar::Avatar(ShaderManager& shadmgr)
-    : Car(Vector(), Vector())
-    , m_model(shadmgr)
+Entity Avatar::create(Entities& io_entities, uint32_t in_id)
+{
+    return io_entities.create(Transform(), Driving(), Player(in_id));
+}
+
+Avatar::Avatar(Entities& io_entities, Entity in_entity)
+    : Car(io_entities, in_entity)
 {
 }
 
@@ -14,21 +16,23 @@ Avatar::~Avatar()
 {
 }
 
-void Avatar::input(const sf::Input& in_input)
+void Avatar::control(const CarInput& in_input)
 {
-    if(in_input.IsKeyDown(sf::Key::Left)) {
+    this->player().input = in_input;
+
+    if(in_input.steering > 0) {
         this->steeringVel(45.0f*deg2rad);
-    } else if(in_input.IsKeyDown(sf::Key::Right)) {
+    } else if(in_input.steering < 0) {
         this->steeringVel(-45.0f*deg2rad);
     } else {
         // If no direction key is pressed, strive to drive straight.
         this->steeringVel(-this->steeringAngle()*5.f);
     }
 
-    if(in_input.IsKeyDown(sf::Key::Up)) {
+    if(in_input.pedals > 0) {
         this->state(CarState::Driving);
 //         this->accel(this->accel() + 0.1f);
-    } else if(in_input.IsKeyDown(sf::Key::Down)) {
+    } else if(in_input.pedals < 0) {
         this->state(CarState::Breaking);
 //         this->accel(-this->speed()*2.f);
     } else {
@@ -37,13 +41,3 @@ void Avatar::input(const sf::Input& in_input)
 //         this->accel(-this->speed()*0.5f);
     }
 }
-
-void Avatar::think(const RoadRage::GameClock& clock)
-{
-    Car::think(clock);
-}
-
-void RoadRage::Avatar::render(const RoadRage::GameClock& /*clock*/, const General4x4Matrix& in_viewProj)
-{
-    m_model.render(in_viewProj * this->getModelMatrix());
-}
@@ -1,25 +1,43 @@
 #pragma once
 
 #include "Car.h"
+#include "CarInput.h"
 #include "GameClock.h"
 
-#include "3d/BuiltinModel.h"
-
-#include <SFML/Window/Input.hpp>
+#include <stdint.h>
 
 namespace RoadRage {
 
+/// Makes a car that of a player, whose input it keeps.
+struct Player {
+    /// \param in_id Tells the players apart, the same on the server and all
+    ///              clients.
+    explicit Player(uint32_t in_id) : id(in_id) {}
+
+    uint32_t id;
+    /// The last input given.
+    CarInput input;
+};
+
+/// The car of a player, be it the local one or another one over the network.
 class Avatar : public Car {
 public:
-    Avatar(ShaderManager& shadmgr);
+    /// Adds a new player's car, standing at the origin, to \a io_entities.
+    static Entity create(Entities& io_entities, uint32_t in_id);
+
+    Avatar(Entities& io_entities, Entity in_entity);
     virtual ~Avatar();
 
-    void input(const sf::Input& in_input);
-    void think(const GameClock& clock);
-    void render(const GameClock& clock, const General4x4Matrix& in_viewProj);
+    /// Steers and drives as the player says.
+    void control(const CarInput& in_input);
+
+    uint32_t id() const { return this->player().id; }
+    /// \return The last input given.
+    const CarInput& input() const { return this->player().input; }
 
 private:
-    BoxModel m_model;
+    Player& player() { return *m_pEntities->get<Player>(m_entity); }
+    const Player& player() const { return *m_pEntities->get<Player>(m_entity); }
 };
 
 }
@@ -0,0 +1,19 @@
+#include "Building.h"
+
+using namespace RoadRage;
+
+Building::Building(const Vector& in_min, const Vector& in_max, ShaderManager& shadmgr)
+    : m_model(shadmgr, Vector(0.6f, 0.6f, 0.6f))
+    , m_matrix(AffineMatrix::translation((in_min + in_max) * 0.5f) * AffineMatrix::scale((in_max - in_min) * 0.5f))
+    , m_occluder(in_min, in_max)
+{
+}
+
+Building::~Building()
+{
+}
+
+void Building::submit(CommandList& io_cmds) const
+{
+    m_model.submit(io_cmds, m_matrix);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "3d/BuiltinModel.h"
+#include "3d/OcclusionBuffer.h"
+#include "3d/Math/Matrix.h"
+#include "3d/Math/Vector.h"
+
+namespace RoadRage {
+
+/// A plain block of a building, which hides whatever is behind it. Buildings
+/// never move nor think, so they aren't entities, only something to draw.
+class Building {
+public:
+    /// The building fills the axis-aligned box from \a in_min to \a in_max.
+    Building(const Vector& in_min, const Vector& in_max, ShaderManager& shadmgr);
+    virtual ~Building();
+
+    void submit(CommandList& io_cmds) const;
+
+    /// \return The box used for occlusion culling, which is the whole building.
+    const Occluder& occluder() const { return m_occluder; }
+
+private:
+    BoxModel m_model;
+    AffineMatrix m_matrix;
+    Occluder m_occluder;
+};
+
+}
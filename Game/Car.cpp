@@ -6,20 +6,30 @@
 
 using namespace RoadRage;
 
-Car::Car(Vector in_pos, Vector in_vel, Vector in_accel, float in_orientation, float in_angularVel, float in_angularAccel, Vector in_scale, Vector in_scaleVel, Vector in_scaleAccel)
-    : MobileEntity(in_pos, in_vel, in_accel, in_orientation, in_angularVel, in_angularAccel, in_scale, in_scaleVel, in_scaleAccel)
-    , StateMachine<CarState::Enum>(CarState::Standing)
-    , m_steeringAngle(0.0f)
-    , m_speed(0.0f)
-    , m_accel(0.0f)
-    , m_maxSteeringAngle(45.0f*deg2rad)
-    , m_maxSteeringVel(360.0f*deg2rad)
-    , m_maxSpeed(120.0f*kmh2ms)
-    , m_minSpeed(0.0f)
-    , m_maxAccel(20.0f*kmhs2mss)
-    , m_minAccel(-50.0f*kmhs2mss)
+Driving::Driving()
+    : state(CarState::Standing)
+    , steeringAngle(0.0f)
+    , steeringVel(0.0f)
+    , speed(0.0f)
+    , accel(0.0f)
+    , maxSteeringAngle(45.0f*deg2rad)
+    , maxSteeringVel(360.0f*deg2rad)
+    , maxSpeed(120.0f*kmh2ms)
+    , minSpeed(0.0f)
+    , maxAccel(20.0f*kmhs2mss)
+    , minAccel(-50.0f*kmhs2mss)
 {
+}
 
+Entity Car::create(Entities& io_entities, const Transform& in_transform)
+{
+    return io_entities.create(in_transform, Driving());
+}
+
+Car::Car(Entities& io_entities, Entity in_entity)
+    : m_pEntities(&io_entities)
+    , m_entity(in_entity)
+{
 }
 
 Car::~Car()
@@ -28,10 +38,19 @@ Car::~Car()
 
 void Car::think(const GameClock& in_clock)
 {
-    switch(this->state()) {
+    if(this->physics()) {
+        this->simulate(in_clock);
+        return;
+    }
+
+    // The car's own components, which the setters below change, too.
+    Transform& t = this->transform();
+    const Driving& d = this->driving();
+
+    switch(d.state) {
     case CarState::Driving:
         // If we are driving, constantly increase the acceleration.
-        this->accel(this->accel() + 5.0f*kmhs2mss*in_clock.deltaT());
+        this->accel(d.accel + 5.0f*kmhs2mss*in_clock.deltaT());
         break;
     case CarState::Breaking:
         // I say, we break with a constant force.
@@ -40,7 +59,7 @@ void Car::think(const GameClock& in_clock)
     case CarState::Rolling:
         // They say the amount of friction is proportional to the velocity...
         static const float fDynFrictionCoeff = 1.0f;
-        this->accel(-this->speed()*fDynFrictionCoeff);
+        this->accel(-d.speed*fDynFrictionCoeff);
         break;
     case CarState::Standing:
         break;
@@ -49,36 +68,34 @@ void Car::think(const GameClock& in_clock)
     }
 
     // Update the speed according to the acceleration
-    this->speed(this->speed() + this->accel() * in_clock.deltaT());
+    this->speed(d.speed + d.accel * in_clock.deltaT());
 
     // Update the steering angle according to the steering velocity.
-    this->steeringAngle(this->steeringAngle() + this->steeringVel() * in_clock.deltaT());
+    this->steeringAngle(d.steeringAngle + d.steeringVel * in_clock.deltaT());
 
     // Now update the "driving velocity" vector, that is the velocity solely
     // by driving action, not affected by collisions and the like.
-    Vector drivingVel = Vector(0.0f, 0.0f, -1.0f) * this->speed();
-    drivingVel = Quaternion::rotation(0.0f, 1.0f, 0.0f, this->steeringAngle()).rotate(drivingVel);
-
-    // First do all the normal calculations, without considering the "driving".
-    MobileEntity::think(in_clock);
-
-    // Then, add the "driving" movements on top of it.
-    this->pos(this->pos() + drivingVel * in_clock.deltaT());
+    Vector drivingVel = Vector(0.0f, 0.0f, -1.0f) * d.speed;
+    drivingVel = Quaternion::rotation(0.0f, 1.0f, 0.0f, d.steeringAngle).rotate(drivingVel);
 
-    /// TODO: use the steering angle for the tires, not the whole car!
-    if(std::abs(this->steeringAngle()) < this->maxSteeringAngle())
-        this->ori(this->ori() + this->steeringVel() * in_clock.deltaT());
+    // Cars have no motion of their own but the "driving" one.
+    t.pos += drivingVel * in_clock.deltaT();
 
+    // Without physics, the steering angle is the heading of the whole car,
+    // which turns along with it. That's all the traffic needs, and what
+    // CarBatch does by the thousand; only VehicleModel steers the wheels.
+    if(std::abs(d.steeringAngle) < d.maxSteeringAngle)
+        t.ori = wrapAngle(t.ori + d.steeringVel * in_clock.deltaT());
 
     // After the thinking, we may have entered a new state.
-    switch(this->state()) {
+    switch(d.state) {
     case CarState::Driving:
         break;
     case CarState::Breaking:
         break;
     case CarState::Rolling:
         // May it be that we're done with rolling?
-        if(this->speed() < 1.0f*kmh2ms)
+        if(d.speed < 1.0f*kmh2ms)
             this->state(CarState::Standing);
         break;
     case CarState::Standing:
@@ -88,9 +105,122 @@ void Car::think(const GameClock& in_clock)
     }
 }
 
+Car& Car::physics(const VehicleParams& in_params, float in_fSubstepRate)
+{
+    VehicleModel& physics = m_pEntities->add(m_entity, VehicleModel(in_params, in_fSubstepRate));
+    physics.place(this->pos().x(), this->pos().z(), this->ori(), this->speed());
+    this->maxSteeringAngle(in_params.maxSteering);
+    return *this;
+}
+
+const VehicleModel* Car::physics() const
+{
+    return m_pEntities->get<VehicleModel>(m_entity);
+}
+
+VehicleModel* Car::physics()
+{
+    return m_pEntities->get<VehicleModel>(m_entity);
+}
+
+float Car::heading() const
+{
+    const VehicleModel* pPhysics = this->physics();
+    return pPhysics ? pPhysics->heading() : this->steeringAngle();
+}
+
+Car& Car::place(const Vector& in_pos, float in_fOri, float in_fSpeed)
+{
+    this->pos(in_pos);
+    this->ori(in_fOri);
+    this->driving().speed = in_fSpeed;
+    if(VehicleModel* pPhysics = this->physics())
+        pPhysics->place(in_pos.x(), in_pos.z(), in_fOri, in_fSpeed);
+    return *this;
+}
+
+void Car::simulate(const GameClock& in_clock)
+{
+    VehicleModel& physics = *this->physics();
+    this->steeringAngle(this->steeringAngle() + this->steeringVel() * in_clock.deltaT());
+
+    // The states are what the driver does with the pedals.
+    float fThrottle = 0.0f, fBrake = 0.0f;
+    switch(this->state()) {
+    case CarState::Driving:
+        fThrottle = 1.0f;
+        break;
+    case CarState::Breaking:
+    case CarState::Standing:
+        fBrake = 1.0f;
+        break;
+    case CarState::Rolling:
+    case CarState::Destroyed:
+        break;
+    }
+    physics.controls(fThrottle, fBrake, this->steeringAngle());
+    physics.advance(in_clock.deltaT());
+
+    // The physics take care of all the motion, the car's own too.
+    this->pos(Vector(physics.x(), this->pos().y(), physics.z()));
+    this->ori(physics.heading());
+    this->driving().speed = physics.forwardSpeed();
+    this->driving().accel = physics.forwardAccel();
+
+    if(this->state() == CarState::Rolling && this->speed() < 1.0f*kmh2ms)
+        this->state(CarState::Standing);
+}
+
+const Vector& Car::pos() const
+{
+    return this->transform().pos;
+}
+
+Car& Car::pos(const Vector& v)
+{
+    this->transform().pos = v;
+    return *this;
+}
+
+float Car::ori() const
+{
+    return this->transform().ori;
+}
+
+Car& Car::ori(float v)
+{
+    this->transform().ori = wrapAngle(v);
+    return *this;
+}
+
+const Vector& Car::scale() const
+{
+    return this->transform().scale;
+}
+
+CarState::Enum Car::state() const
+{
+    return this->driving().state;
+}
+
+CarState::Enum Car::state(CarState::Enum next)
+{
+    // If we are already in that state, just don't change.
+    const CarState::Enum old = this->state();
+    if(old == next)
+        return old;
+
+    // Both the state we leave and the one we enter may refuse.
+    if(!this->onLeavingCurrentState() || !this->onEnteringNewState(next))
+        return old;
+
+    this->driving().state = next;
+    return old;
+}
+
 float Car::steeringAngle() const
 {
-    return m_steeringAngle;
+    return this->driving().steeringAngle;
 }
 
 Car& Car::steeringAngle(float v)
@@ -99,18 +229,19 @@ Car& Car::steeringAngle(float v)
     while(v < -360.0f*deg2rad) v += 360.0f*deg2rad;
 
     // For very small angles (<1°), we just stick to 0°.
-    if(nearZero(v, 1.0f*deg2rad) && nearZero(this->steeringVel()))
+    Driving& d = this->driving();
+    if(nearZero(v, 1.0f*deg2rad) && nearZero(d.steeringVel))
         v = 0.0f;
 
-    clamp(v, -this->maxSteeringAngle(), this->maxSteeringAngle());
+    clamp(v, -d.maxSteeringAngle, d.maxSteeringAngle);
 
-    m_steeringAngle = v;
+    d.steeringAngle = v;
     return *this;
 }
 
 float Car::steeringVel() const
 {
-    return m_steeringVel;
+    return this->driving().steeringVel;
 }
 
 Car& Car::steeringVel(float v)
@@ -119,41 +250,44 @@ Car& Car::steeringVel(float v)
     if(nearZero(v, .1f*deg2rad))
         v = 0.0f;
 
-    clamp(v, -this->maxSteeringVel(), this->maxSteeringVel());
+    Driving& d = this->driving();
+    clamp(v, -d.maxSteeringVel, d.maxSteeringVel);
 
-    m_steeringVel = v;
+    d.steeringVel = v;
     return *this;
 }
 
 float Car::speed() const
 {
-    return m_speed;
+    return this->driving().speed;
 }
 
 Car& Car::speed(float v)
 {
-    clamp(v, this->minSpeed(), this->maxSpeed());
+    Driving& d = this->driving();
+    clamp(v, d.minSpeed, d.maxSpeed);
 
-    m_speed = v;
+    d.speed = v;
     return *this;
 }
 
 float Car::accel() const
 {
-    return m_accel;
+    return this->driving().accel;
 }
 
 Car& Car::accel(float v)
 {
-    clamp(v, this->minAccel(), this->maxAccel());
+    Driving& d = this->driving();
+    clamp(v, d.minAccel, d.maxAccel);
 
-    m_accel = v;
+    d.accel = v;
     return *this;
 }
 
 float Car::maxSteeringAngle() const
 {
-    return m_maxSteeringAngle;
+    return this->driving().maxSteeringAngle;
 }
 
 Car& Car::maxSteeringAngle(float v)
@@ -161,69 +295,69 @@ Car& Car::maxSteeringAngle(float v)
     while(v > 360.0f*deg2rad) v -= 360.0f*deg2rad;
     while(v < -360.0f*deg2rad) v += 360.0f*deg2rad;
 
-    m_maxSteeringAngle = v;
+    this->driving().maxSteeringAngle = v;
 
     return *this;
 }
 
 float Car::maxSteeringVel() const
 {
-    return m_maxSteeringVel;
+    return this->driving().maxSteeringVel;
 }
 
 Car& Car::maxSteeringVel(float v)
 {
-    m_maxSteeringVel = v;
+    this->driving().maxSteeringVel = v;
     return *this;
 }
 
 float Car::maxSpeed() const
 {
-    return m_maxSpeed;
+    return this->driving().maxSpeed;
 }
 
 Car& Car::maxSpeed(float v)
 {
-    m_maxSpeed = v;
+    this->driving().maxSpeed = v;
     return *this;
 }
 
 float Car::minSpeed() const
 {
-    return m_minSpeed;
+    return this->driving().minSpeed;
 }
 
 Car& Car::minSpeed(float v)
 {
-    m_minSpeed = v;
+    this->driving().minSpeed = v;
     return *this;
 }
 
 float Car::maxAccel() const
 {
-    return m_maxAccel;
+    return this->driving().maxAccel;
 }
 
 Car& Car::maxAccel(float v)
 {
-    m_maxAccel = v;
+    this->driving().maxAccel = v;
     return *this;
 }
 
 float Car::minAccel() const
 {
-    return m_minAccel;
+    return this->driving().minAccel;
 }
 
 Car& Car::minAccel(float v)
 {
-    m_minAccel = v;
+    this->driving().minAccel = v;
     return *this;
 }
 
 bool Car::onLeavingCurrentState()
 {
-    return StateMachine<CarState::Enum>::onLeavingCurrentState();
+    return true;
 }
 
 bool Car::onEnteringNewState(CarState::Enum next)
@@ -243,5 +377,5 @@ bool Car::onEnteringNewState(CarState::Enum next)
         break;
     }
 
-    return StateMachine<CarState::Enum>::onEnteringNewState(next);
+    return true;
 }
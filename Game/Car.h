@@ -1,8 +1,8 @@
 #pragma once
 
-#include "Game/Entity.h"
-
-#include "Utilities/StateMachine.h"
+#include "Game/Entities.h"
+#include "Game/GameClock.h"
+#include "Game/VehicleModel.h"
 
 namespace RoadRage {
 
@@ -16,13 +16,75 @@ namespace CarState {
     };
 }
 
-class Car : public MobileEntity, public StateMachine<RoadRage::CarState::Enum> {
+/// How a car drives: what the driver does with the pedals, which is the
+/// state, and with the steering wheel, what comes of it and how far either
+/// may go. A car is an entity with a Transform and this, and a VehicleModel
+/// if it drives with physics.
+struct Driving {
+    Driving();
+
+    CarState::Enum state;
+    float steeringAngle;
+    float steeringVel;
+    float speed;
+    float accel;
+
+    float maxSteeringAngle;
+    float maxSteeringVel;
+    float maxSpeed;
+    float minSpeed;
+    float maxAccel;
+    float minAccel;
+};
+
+/// A handle to a car among the Entities, to drive that one car by, as the
+/// players' cars are. It stays good for as long as the car is there, and is
+/// cheap to make and copy. The many cars of the traffic get moved all at
+/// once by a CarBatch instead.
+class Car {
 public:
+    /// Adds a new car standing at \a in_transform to \a io_entities.
+    static Entity create(Entities& io_entities, const Transform& in_transform);
 
-    Car(Vector in_pos, Vector in_vel, Vector in_accel = Vector(0.0f, 0.0f, 0.0f), float in_orientation = 0.0f, float in_angularVel = 0.0f, float in_angularAccel = 0.0f, Vector in_scale = Vector(1.0f, 1.0f, 1.0f), Vector in_scaleVel = Vector(0.0f, 0.0f, 0.0f), Vector in_scaleAccel = Vector(0.0f, 0.0f, 0.0f));
+    Car(Entities& io_entities, Entity in_entity);
     virtual ~Car();
 
-    virtual void think(const RoadRage::GameClock& in_clock);
+    Entity entity() const { return m_entity; }
+
+    /// Drives on for a frame: with the physics, if the car has them, else
+    /// the cheap way the traffic drives, the steering angle being the
+    /// heading of the whole car.
+    void think(const RoadRage::GameClock& in_clock);
+
+    /// From now on, drives with the given physics, stepped \a in_fSubstepRate
+    /// times a second, rather than the simple ones of think. The steering
+    /// angle then is that of the front wheels, not the car's heading.
+    Car& physics(const VehicleParams& in_params, float in_fSubstepRate);
+    /// \return The physics the car drives with, if any.
+    const VehicleModel* physics() const;
+    VehicleModel* physics();
+    /// \return Where the car drives to, in the same sense as the steering angle.
+    float heading() const;
+    /// Puts the car at \a in_pos, facing \a in_fOri and going \a in_fSpeed
+    /// straight ahead, its physics included, as told by the server.
+    Car& place(const Vector& in_pos, float in_fOri, float in_fSpeed);
+
+    const Vector& pos() const;
+    Car& pos(const Vector& v);
+    float ori() const;
+    Car& ori(float v);
+    const Vector& scale() const;
+
+    /// \return The car's components, to get at all of it at once.
+    Transform& transform() { return *m_pEntities->get<Transform>(m_entity); }
+    const Transform& transform() const { return *m_pEntities->get<Transform>(m_entity); }
+    Driving& driving() { return *m_pEntities->get<Driving>(m_entity); }
+    const Driving& driving() const { return *m_pEntities->get<Driving>(m_entity); }
+
+    CarState::Enum state() const;
+    /// Changes to state \a next, if both the current and the next one agree.
+    /// \return The state before.
+    CarState::Enum state(CarState::Enum next);
 
     float speed() const;
     Car& speed(float v);
@@ -56,18 +118,11 @@ protected:
     virtual bool onLeavingCurrentState();
     virtual bool onEnteringNewState(CarState::Enum next);
 
+    Entities* m_pEntities;
+    Entity m_entity;
+
 private:
-    float m_steeringAngle;
-    float m_steeringVel;
-    float m_speed;
-    float m_accel;
-
-    float m_maxSteeringAngle;
-    float m_maxSteeringVel;
-    float m_maxSpeed;
-    float m_minSpeed;
-    float m_maxAccel;
-    float m_minAccel;
+    void simulate(const RoadRage::GameClock& in_clock);
 };
 
 }
@@ -0,0 +1,230 @@
+#include "CarBatch.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
+using namespace RoadRage;
+
+// The same constants Car::think and the setters use.
+#define D_CAR_FULL_TURN (360.0f*deg2rad)
+#define D_CAR_DRIVING_JERK (5.0f*kmhs2mss)
+#define D_CAR_BREAKING_ACCEL (-50.0f*kmhs2mss)
+#define D_CAR_ROLLING_FRICTION 1.0f
+#define D_CAR_STANDING_SPEED (1.0f*kmh2ms)
+#define D_CAR_STEERING_SNAP (1.0f*deg2rad)
+#define D_CAR_STEERING_VEL_SNAP static_cast<float>(D_FTS_EPSILON)
+
+#if defined(__SSE2__)
+/// Sine and cosine of four angles at once, good to about a float's
+/// precision for angles of a few turns: reduced to an octant around 0, where
+/// a polynomial takes over, the same way the Cephes library does.
+static inline void sincos4(__m128 in_x, __m128& out_sin, __m128& out_cos)
+{
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+    const __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2), four = _mm_set1_epi32(4);
+
+    __m128 signSin = _mm_and_ps(in_x, signMask);
+    __m128 x = _mm_andnot_ps(signMask, in_x);
+
+    // Which octant, rounded up to an even one.
+    __m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f)));
+    j = _mm_and_si128(_mm_add_epi32(j, one), _mm_set1_epi32(~1));
+    const __m128 y = _mm_cvtepi32_ps(j);
+
+    signSin = _mm_xor_ps(signSin, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, four), 29)));
+    const __m128 signCos = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(j, two), four), 29));
+    const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, two), _mm_setzero_si128()));
+
+    // x - y * pi/4, in three steps for precision.
+    x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(0.78515625f)));
+    x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(2.4187564849853515625e-4f)));
+    x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(3.77489497744594108e-8f)));
+    const __m128 z = _mm_mul_ps(x, x);
+
+    __m128 c = _mm_set1_ps(2.443315711809948e-5f);
+    c = _mm_add_ps(_mm_mul_ps(c, z), _mm_set1_ps(-1.388731625493765e-3f));
+    c = _mm_add_ps(_mm_mul_ps(c, z), _mm_set1_ps(4.166664568298827e-2f));
+    c = _mm_mul_ps(_mm_mul_ps(c, z), z);
+    c = _mm_add_ps(_mm_sub_ps(c, _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+    __m128 s = _mm_set1_ps(-1.9515295891e-4f);
+    s = _mm_add_ps(_mm_mul_ps(s, z), _mm_set1_ps(8.3321608736e-3f));
+    s = _mm_add_ps(_mm_mul_ps(s, z), _mm_set1_ps(-1.6666654611e-1f));
+    s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, z), x), x);
+
+    out_sin = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c)), signSin);
+    out_cos = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s)), signCos);
+}
+
+static inline __m128 select(__m128 in_mask, __m128 in_a, __m128 in_b)
+{
+    return _mm_or_ps(_mm_and_ps(in_mask, in_a), _mm_andnot_ps(in_mask, in_b));
+}
+
+static inline __m128 clamp4(__m128 in_v, __m128 in_min, __m128 in_max)
+{
+    return _mm_max_ps(_mm_min_ps(in_v, in_max), in_min);
+}
+#endif
+
+CarBatch::CarBatch()
+{
+}
+
+CarBatch::~CarBatch()
+{
+}
+
+void CarBatch::resize(std::size_t in_n)
+{
+    m_state.resize(in_n);
+    m_speed.resize(in_n); m_accel.resize(in_n);
+    m_steering.resize(in_n); m_steeringVel.resize(in_n);
+    m_minSpeed.resize(in_n); m_maxSpeed.resize(in_n);
+    m_minAccel.resize(in_n); m_maxAccel.resize(in_n);
+    m_maxSteering.resize(in_n);
+    m_ori.resize(in_n);
+    m_x.resize(in_n); m_y.resize(in_n); m_z.resize(in_n);
+}
+
+void CarBatch::load(std::size_t in_i, const Transform& in_transform, const Driving& in_driving)
+{
+    m_state[in_i] = in_driving.state;
+    m_speed[in_i] = in_driving.speed;
+    m_accel[in_i] = in_driving.accel;
+    m_steering[in_i] = in_driving.steeringAngle;
+    m_steeringVel[in_i] = in_driving.steeringVel;
+    m_minSpeed[in_i] = in_driving.minSpeed;
+    m_maxSpeed[in_i] = in_driving.maxSpeed;
+    m_minAccel[in_i] = in_driving.minAccel;
+    m_maxAccel[in_i] = in_driving.maxAccel;
+    m_maxSteering[in_i] = in_driving.maxSteeringAngle;
+    m_ori[in_i] = in_transform.ori;
+
+    const Vector& p = in_transform.pos;
+    m_x[in_i] = p.x(); m_y[in_i] = p.y(); m_z[in_i] = p.z();
+}
+
+void CarBatch::store(std::size_t in_i, Transform& out_transform, Driving& out_driving) const
+{
+    // Only ever from rolling to standing, which step already did all of
+    // Car::state's work for.
+    out_driving.state = static_cast<CarState::Enum>(m_state[in_i]);
+    out_driving.speed = m_speed[in_i];
+    out_driving.accel = m_accel[in_i];
+    out_driving.steeringAngle = m_steering[in_i];
+    out_transform.ori = m_ori[in_i];
+    out_transform.pos = Vector(m_x[in_i], m_y[in_i], m_z[in_i]);
+}
+
+void CarBatch::step(std::size_t in_begin, std::size_t in_end, float in_fDeltaT)
+{
+    std::size_t i = in_begin;
+
+#if defined(__SSE2__)
+    const __m128 dt = _mm_set1_ps(in_fDeltaT);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 fullTurn = _mm_set1_ps(D_CAR_FULL_TURN);
+    for( ; i + 4 <= in_end ; i += 4) {
+        const __m128i state = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&m_state[i]));
+        const __m128 driving = _mm_castsi128_ps(_mm_cmpeq_epi32(state, _mm_set1_epi32(CarState::Driving)));
+        const __m128 breaking = _mm_castsi128_ps(_mm_cmpeq_epi32(state, _mm_set1_epi32(CarState::Breaking)));
+        const __m128 rolling = _mm_castsi128_ps(_mm_cmpeq_epi32(state, _mm_set1_epi32(CarState::Rolling)));
+        const __m128 minSpeed = _mm_loadu_ps(&m_minSpeed[i]), maxSpeed = _mm_loadu_ps(&m_maxSpeed[i]);
+        const __m128 minAccel = _mm_loadu_ps(&m_minAccel[i]), maxAccel = _mm_loadu_ps(&m_maxAccel[i]);
+        const __m128 maxSteering = _mm_loadu_ps(&m_maxSteering[i]);
+        const __m128 steeringVel = _mm_loadu_ps(&m_steeringVel[i]);
+        __m128 speed = _mm_loadu_ps(&m_speed[i]);
+        __m128 accel = _mm_loadu_ps(&m_accel[i]);
+
+        // The acceleration of every state, only set (and clamped) by the
+        // ones that have one.
+        __m128 a = select(driving, _mm_add_ps(accel, _mm_set1_ps(D_CAR_DRIVING_JERK * in_fDeltaT)),
+                   select(breaking, _mm_set1_ps(D_CAR_BREAKING_ACCEL),
+                                    _mm_sub_ps(zero, _mm_mul_ps(speed, _mm_set1_ps(D_CAR_ROLLING_FRICTION)))));
+        accel = select(_mm_or_ps(driving, _mm_or_ps(breaking, rolling)), clamp4(a, minAccel, maxAccel), accel);
+        speed = clamp4(_mm_add_ps(speed, _mm_mul_ps(accel, dt)), minSpeed, maxSpeed);
+
+        // The steering angle, wrapped, snapped to straight and clamped.
+        __m128 steering = _mm_add_ps(_mm_loadu_ps(&m_steering[i]), _mm_mul_ps(steeringVel, dt));
+        steering = _mm_sub_ps(steering, _mm_and_ps(_mm_cmpgt_ps(steering, fullTurn), fullTurn));
+        steering = _mm_add_ps(steering, _mm_and_ps(_mm_cmplt_ps(steering, _mm_sub_ps(zero, fullTurn)), fullTurn));
+        const __m128 straight = _mm_and_ps(_mm_cmplt_ps(_mm_and_ps(steering, absMask), _mm_set1_ps(D_CAR_STEERING_SNAP)),
+                                           _mm_cmplt_ps(_mm_and_ps(steeringVel, absMask), _mm_set1_ps(D_CAR_STEERING_VEL_SNAP)));
+        steering = clamp4(_mm_andnot_ps(straight, steering), _mm_sub_ps(zero, maxSteering), maxSteering);
+
+        // Driving along the steering angle.
+        __m128 sin, cos;
+        sincos4(steering, sin, cos);
+        const __m128 distance = _mm_mul_ps(speed, dt);
+        _mm_storeu_ps(&m_x[i], _mm_sub_ps(_mm_loadu_ps(&m_x[i]), _mm_mul_ps(sin, distance)));
+        _mm_storeu_ps(&m_z[i], _mm_sub_ps(_mm_loadu_ps(&m_z[i]), _mm_mul_ps(cos, distance)));
+
+        // The whole car turns with the steering, until it's at its limit.
+        const __m128 turning = _mm_cmplt_ps(_mm_and_ps(steering, absMask), maxSteering);
+        __m128 ori = _mm_add_ps(_mm_loadu_ps(&m_ori[i]), _mm_and_ps(turning, _mm_mul_ps(steeringVel, dt)));
+        ori = _mm_sub_ps(ori, _mm_and_ps(_mm_cmpgt_ps(ori, fullTurn), fullTurn));
+        ori = _mm_add_ps(ori, _mm_and_ps(_mm_cmplt_ps(ori, _mm_sub_ps(zero, fullTurn)), fullTurn));
+
+        // Done rolling?
+        const __m128 stop = _mm_and_ps(rolling, _mm_cmplt_ps(speed, _mm_set1_ps(D_CAR_STANDING_SPEED)));
+        accel = select(stop, clamp4(zero, minAccel, maxAccel), accel);
+        speed = select(stop, clamp4(zero, minSpeed, maxSpeed), speed);
+        const __m128i standing = _mm_set1_epi32(CarState::Standing);
+        const __m128i stopped = _mm_castps_si128(stop);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&m_state[i]),
+                         _mm_or_si128(_mm_and_si128(stopped, standing), _mm_andnot_si128(stopped, state)));
+
+        _mm_storeu_ps(&m_speed[i], speed);
+        _mm_storeu_ps(&m_accel[i], accel);
+        _mm_storeu_ps(&m_steering[i], steering);
+        _mm_storeu_ps(&m_ori[i], ori);
+    }
+#endif
+
+    for( ; i < in_end ; ++i) {
+        this->stepOne(i, in_fDeltaT);
+    }
+}
+
+void CarBatch::stepOne(std::size_t in_i, float in_fDeltaT)
+{
+    const std::size_t i = in_i;
+    const int32_t state = m_state[i];
+    if(state == CarState::Driving)
+        m_accel[i] = clamp(m_accel[i] + D_CAR_DRIVING_JERK * in_fDeltaT, m_minAccel[i], m_maxAccel[i]);
+    else if(state == CarState::Breaking)
+        m_accel[i] = clamp(D_CAR_BREAKING_ACCEL, m_minAccel[i], m_maxAccel[i]);
+    else if(state == CarState::Rolling)
+        m_accel[i] = clamp(-m_speed[i] * D_CAR_ROLLING_FRICTION, m_minAccel[i], m_maxAccel[i]);
+    m_speed[i] = clamp(m_speed[i] + m_accel[i] * in_fDeltaT, m_minSpeed[i], m_maxSpeed[i]);
+
+    float steering = m_steering[i] + m_steeringVel[i] * in_fDeltaT;
+    if(steering > D_CAR_FULL_TURN) steering -= D_CAR_FULL_TURN;
+    if(steering < -D_CAR_FULL_TURN) steering += D_CAR_FULL_TURN;
+    if(nearZero(steering, D_CAR_STEERING_SNAP) && nearZero(m_steeringVel[i]))
+        steering = 0.0f;
+    m_steering[i] = steering = clamp(steering, -m_maxSteering[i], m_maxSteering[i]);
+
+    const float distance = m_speed[i] * in_fDeltaT;
+    m_x[i] -= std::sin(steering) * distance;
+    m_z[i] -= std::cos(steering) * distance;
+
+    if(std::abs(steering) < m_maxSteering[i]) {
+        float ori = m_ori[i] + m_steeringVel[i] * in_fDeltaT;
+        if(ori > D_CAR_FULL_TURN) ori -= D_CAR_FULL_TURN;
+        if(ori < -D_CAR_FULL_TURN) ori += D_CAR_FULL_TURN;
+        m_ori[i] = ori;
+    }
+
+    if(state == CarState::Rolling && m_speed[i] < D_CAR_STANDING_SPEED) {
+        m_state[i] = CarState::Standing;
+        m_accel[i] = clamp(0.0f, m_minAccel[i], m_maxAccel[i]);
+        m_speed[i] = clamp(0.0f, m_minSpeed[i], m_maxSpeed[i]);
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Car.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+namespace RoadRage {
+
+/// Moves many cars at once, the way Car::think moves each one: the same
+/// acceleration per state, the same clamping of the acceleration, speed and
+/// steering angle, and the same switch from rolling to standing.\n
+/// The cars get loaded into a structure of arrays, stepped four at a time
+/// with SSE where available, and stored back. That skips the setters,
+/// vectors and quaternions Car::think goes through for every single car.\n
+/// Only the driving is done here: the cars must not drive with a
+/// VehicleModel, which the computer-driven ones never do.\n
+/// Different ranges of cars may be loaded, stepped and stored by different
+/// threads at the same time.
+class CarBatch {
+public:
+    CarBatch();
+    virtual ~CarBatch();
+
+    /// Makes room for \a in_n cars.
+    void resize(std::size_t in_n);
+    std::size_t size() const { return m_speed.size(); }
+
+    /// Copies the state of a car into slot \a in_i.
+    void load(std::size_t in_i, const Transform& in_transform, const Driving& in_driving);
+    /// Copies slot \a in_i back into a car.
+    void store(std::size_t in_i, Transform& out_transform, Driving& out_driving) const;
+
+    /// Moves the cars in slots [\a in_begin, \a in_end) by \a in_fDeltaT seconds.
+    void step(std::size_t in_begin, std::size_t in_end, float in_fDeltaT);
+
+private:
+    // No copying!
+    CarBatch(const CarBatch&);
+    CarBatch& operator=(const CarBatch&);
+
+    void stepOne(std::size_t in_i, float in_fDeltaT);
+
+    std::vector<int32_t> m_state;
+    std::vector<float> m_speed, m_accel;
+    std::vector<float> m_steering, m_steeringVel;
+    std::vector<float> m_minSpeed, m_maxSpeed;
+    std::vector<float> m_minAccel, m_maxAccel;
+    std::vector<float> m_maxSteering;
+    std::vector<float> m_ori;
+    std::vector<float> m_x, m_y, m_z;
+};
+
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace RoadRage {
+
+/// What a player does with their car during a frame, which is all a client
+/// tells the server.
+struct CarInput {
+    int8_t steering; ///< 1 to steer left, -1 right, 0 to strive to go straight.
+    int8_t pedals;   ///< 1 to drive, -1 to brake, 0 to let it roll.
+
+    CarInput() : steering(0), pedals(0) {}
+    CarInput(int8_t in_steering, int8_t in_pedals) : steering(in_steering), pedals(in_pedals) {}
+};
+
+}
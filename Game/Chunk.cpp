@@ -0,0 +1,215 @@
+#include "Chunk.h"
+#include "RoadNetwork.h"
+
+#include "Utilities/i18n.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <stdint.h>
+
+using namespace RoadRage;
+
+#define D_CHUNK_MAGIC "RRCH"
+#define D_CHUNK_VERSION 2
+
+// The average amount of civilians living in one chunk. There are between
+// none and twice that many.
+#define D_CIVILIANS_PER_CHUNK 8
+
+// What a civilian costs us besides its components: its slot among the
+// entities, and the room the chunks of its archetype keep free.
+#define D_CIVILIAN_EXTRA_FOOTPRINT 32
+// Same for a building, which shares its buffers with all other buildings.
+#define D_BUILDING_EXTRA_FOOTPRINT 256
+
+// Besides the streets of D_STREET_WIDTH, the rest of the chunk is split into
+// 2x2 lots with a building on each.
+// How far buildings stay away from the borders of their lot, in meters.
+#define D_LOT_MARGIN 1.0f
+#define D_BUILDING_MIN_HEIGHT 6.0f
+#define D_BUILDING_MAX_HEIGHT 40.0f
+
+/// \return A number in [0, 1), the same with every standard library.
+static float unit(std::mt19937& io_engine)
+{
+    return (io_engine() >> 8) * (1.0f / 16777216.0f);
+}
+
+ChunkCoord ChunkCoord::fromWorld(const Vector& in_pos, float in_fChunkSize)
+{
+    return ChunkCoord(static_cast<int>(std::floor(in_pos.x() / in_fChunkSize)),
+                      static_cast<int>(std::floor(in_pos.z() / in_fChunkSize)));
+}
+
+bool ChunkData::load(const char* in_data, std::size_t in_size)
+{
+    const std::size_t headerSize = 4 + sizeof(uint32_t) + 2*sizeof(int32_t) + sizeof(uint32_t);
+    if(in_size < headerSize || std::memcmp(in_data, D_CHUNK_MAGIC, 4) != 0)
+        return false;
+
+    uint32_t version = 0, count = 0;
+    int32_t x = 0, z = 0;
+    const char* p = in_data + 4;
+    std::memcpy(&version, p, sizeof(version)); p += sizeof(version);
+    std::memcpy(&x, p, sizeof(x)); p += sizeof(x);
+    std::memcpy(&z, p, sizeof(z)); p += sizeof(z);
+    std::memcpy(&count, p, sizeof(count)); p += sizeof(count);
+    if(version != D_CHUNK_VERSION || (in_size - headerSize) / sizeof(CivilianSpawn) < count)
+        return false;
+
+    this->coord = ChunkCoord(x, z);
+    this->civilians.resize(count);
+    if(count > 0)
+        std::memcpy(&this->civilians[0], p, count*sizeof(CivilianSpawn));
+    p += count*sizeof(CivilianSpawn);
+
+    // The buildings follow the civilians, in the same way.
+    const std::size_t left = in_size - headerSize - count*sizeof(CivilianSpawn);
+    if(left < sizeof(uint32_t))
+        return false;
+    std::memcpy(&count, p, sizeof(count)); p += sizeof(count);
+    if((left - sizeof(uint32_t)) / sizeof(BuildingSpawn) < count)
+        return false;
+
+    this->buildings.resize(count);
+    if(count > 0)
+        std::memcpy(&this->buildings[0], p, count*sizeof(BuildingSpawn));
+
+    return true;
+}
+
+void ChunkData::save(const std::string& in_sFile) const
+{
+    std::ofstream f(in_sFile.c_str(), std::ios::binary | std::ios::trunc);
+
+    uint32_t version = D_CHUNK_VERSION, count = this->civilians.size();
+    int32_t x = this->coord.x, z = this->coord.z;
+    f.write(D_CHUNK_MAGIC, 4);
+    f.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    f.write(reinterpret_cast<const char*>(&x), sizeof(x));
+    f.write(reinterpret_cast<const char*>(&z), sizeof(z));
+    f.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    if(count > 0)
+        f.write(reinterpret_cast<const char*>(&this->civilians[0]), count*sizeof(CivilianSpawn));
+
+    count = this->buildings.size();
+    f.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    if(count > 0)
+        f.write(reinterpret_cast<const char*>(&this->buildings[0]), count*sizeof(BuildingSpawn));
+
+    if(!f)
+        throw std::runtime_error(_("Failed to write the chunk file ") + in_sFile);
+}
+
+void ChunkData::generate(float in_fChunkSize, unsigned int in_seed)
+{
+    // Every chunk gets its own engine, seeded by its coordinates, which makes
+    // the content independent of the order in which chunks get generated.
+    // mt19937 gives the same numbers everywhere, its distributions don't.
+    std::mt19937 engine(in_seed ^ (static_cast<unsigned>(this->coord.x) * 73856093u)
+                                ^ (static_cast<unsigned>(this->coord.z) * 19349663u));
+    const float fStreet = std::min(D_STREET_WIDTH, in_fChunkSize);
+
+    const float x0 = this->coord.x * in_fChunkSize;
+    const float z0 = this->coord.z * in_fChunkSize;
+
+    // Civilians walk on the streets, either one.
+    this->civilians.resize(engine() % (2*D_CIVILIANS_PER_CHUNK + 1));
+    for(auto i = this->civilians.begin() ; i != this->civilians.end() ; ++i) {
+        const bool bAlongX = (engine() & 1) != 0;
+        const float fAlong = unit(engine) * in_fChunkSize;
+        const float fAcross = unit(engine) * fStreet;
+        i->pos[0] = x0 + (bAlongX ? fAlong : fAcross);
+        i->pos[1] = 0.0f;
+        i->pos[2] = z0 + (bAlongX ? fAcross : fAlong);
+        i->vel[0] = i->vel[1] = i->vel[2] = 0.0f;
+        i->ori = 0.0f;
+        i->oriVel = 0.0f;
+    }
+
+    // And the rest of the chunk is made of buildings.
+    const float fLot = (in_fChunkSize - fStreet) * 0.5f;
+    this->buildings.clear();
+    if(fLot <= 2.0f*D_LOT_MARGIN)
+        return;
+
+    for(unsigned i = 0 ; i < 4 ; ++i) {
+        const float x = x0 + fStreet + (i & 1 ? fLot : 0.0f);
+        const float z = z0 + fStreet + (i & 2 ? fLot : 0.0f);
+        BuildingSpawn b = { { x + D_LOT_MARGIN, 0.0f, z + D_LOT_MARGIN },
+                            { x + fLot - D_LOT_MARGIN,
+                              D_BUILDING_MIN_HEIGHT + unit(engine) * (D_BUILDING_MAX_HEIGHT - D_BUILDING_MIN_HEIGHT),
+                              z + fLot - D_LOT_MARGIN } };
+        this->buildings.push_back(b);
+    }
+}
+
+std::size_t ChunkData::memoryUsage() const
+{
+    return sizeof(ChunkData) + this->civilians.capacity() * sizeof(CivilianSpawn)
+                             + this->buildings.capacity() * sizeof(BuildingSpawn);
+}
+
+Chunk::Chunk(ChunkData* in_pData, Civilians& io_civilians)
+    : m_coord(in_pData->coord)
+    , m_pData(in_pData)
+    , m_nextSpawn(0)
+    , m_civilians(io_civilians)
+{
+    m_civs.reserve(in_pData->civilians.size());
+    m_buildings.reserve(in_pData->buildings.size());
+}
+
+Chunk::~Chunk()
+{
+    for(auto i = m_civs.begin() ; i != m_civs.end() ; ++i) {
+        m_civilians.destroy(*i);
+    }
+    for(auto i = m_buildings.begin() ; i != m_buildings.end() ; ++i) {
+        delete *i;
+    }
+
+    delete m_pData;
+}
+
+bool Chunk::finalizeStep(ShaderManager& in_shadmgr)
+{
+    if(this->finalized())
+        return false;
+
+    // First all civilians, then all buildings.
+    const std::size_t nCivs = m_pData->civilians.size();
+    if(m_nextSpawn < nCivs) {
+        const CivilianSpawn& s = m_pData->civilians[m_nextSpawn++];
+        m_civs.push_back(m_civilians.spawn(Vector(s.pos[0], s.pos[1], s.pos[2]),
+                                           Vector(s.vel[0], s.vel[1], s.vel[2]),
+                                           s.ori, s.oriVel));
+    } else if(m_nextSpawn < nCivs + m_pData->buildings.size()) {
+        const BuildingSpawn& s = m_pData->buildings[m_nextSpawn++ - nCivs];
+        m_buildings.push_back(new Building(Vector(s.min[0], s.min[1], s.min[2]),
+                                           Vector(s.max[0], s.max[1], s.max[2]), in_shadmgr));
+    }
+
+    // Once everything is alive, the spawn data isn't needed anymore.
+    if(m_nextSpawn >= nCivs + m_pData->buildings.size()) {
+        delete m_pData;
+        m_pData = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+std::size_t Chunk::memoryUsage() const
+{
+    const std::size_t civilian = sizeof(Transform) + sizeof(Motion) + sizeof(Civilian) + sizeof(LodState);
+    std::size_t n = sizeof(Chunk) + m_civs.capacity() * (sizeof(Entity) + civilian + D_CIVILIAN_EXTRA_FOOTPRINT)
+                                  + m_buildings.capacity() * (sizeof(Building*) + sizeof(Building) + D_BUILDING_EXTRA_FOOTPRINT);
+    if(m_pData)
+        n += m_pData->memoryUsage();
+    return n;
+}
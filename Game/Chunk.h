@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Building.h"
+#include "Civilian.h"
+
+#include "3d/Math/Vector.h"
+
+#include <string>
+#include <vector>
+
+namespace RoadRage {
+
+/// Identifies one cell of the world's XZ grid. A chunk covers the area
+/// [x*size, (x+1)*size) x [z*size, (z+1)*size).
+struct ChunkCoord {
+    int x;
+    int z;
+
+    ChunkCoord(int in_x = 0, int in_z = 0) : x(in_x), z(in_z) {}
+
+    /// \return The coordinate of the chunk containing the world position \a in_pos.
+    static ChunkCoord fromWorld(const Vector& in_pos, float in_fChunkSize);
+
+    /// \return The square of the distance, in chunks, between this and \a o.
+    int distSq(const ChunkCoord& o) const { return (x-o.x)*(x-o.x) + (z-o.z)*(z-o.z); }
+
+    bool operator==(const ChunkCoord& o) const { return x == o.x && z == o.z; }
+    bool operator!=(const ChunkCoord& o) const { return !this->operator==(o); }
+    bool operator<(const ChunkCoord& o) const { return x < o.x || (x == o.x && z < o.z); }
+};
+
+/// Everything we need to know in order to spawn a civilian. This is the
+/// on-disk representation, which is why it only holds plain floats.
+struct CivilianSpawn {
+    float pos[3];
+    float vel[3];
+    float ori;
+    float oriVel;
+};
+
+/// A building, as the box it fills. Also the on-disk representation.
+struct BuildingSpawn {
+    float min[3];
+    float max[3];
+};
+
+/// The CPU-side content of a chunk, as it is read from disk or generated.
+/// This is what the I/O thread produces; it holds no OpenGL resources at all.
+struct ChunkData {
+    ChunkCoord coord;
+    std::vector<CivilianSpawn> civilians;
+    std::vector<BuildingSpawn> buildings;
+
+    /// Reads the chunk from the content of a chunk file.
+    /// \return false if it is not a valid chunk.
+    bool load(const char* in_data, std::size_t in_size);
+    /// Writes the chunk to \a in_sFile.
+    /// \throws std::runtime_error if the file can't be written.
+    void save(const std::string& in_sFile) const;
+    /// Procedurally fills the chunk. The same coordinate and seed always
+    /// result in the same content, so chunks may be dropped and re-generated.
+    void generate(float in_fChunkSize, unsigned int in_seed);
+
+    /// \return An estimation of the memory this data occupies, in bytes.
+    std::size_t memoryUsage() const;
+};
+
+/// A chunk that has been (or is being) brought to life on the GL thread.
+class Chunk {
+public:
+    /// The chunk's civilians get spawned among \a io_civilians.
+    Chunk(ChunkData* in_pData, Civilians& io_civilians);
+    ~Chunk();
+
+    const ChunkCoord& coord() const { return m_coord; }
+
+    /// Creates the next entity of this chunk, including its GPU resources.
+    /// Must be called from the GL thread.
+    /// \return false once everything has been created.
+    bool finalizeStep(ShaderManager& in_shadmgr);
+    /// \return true once all entities of this chunk are alive.
+    bool finalized() const { return m_pData == NULL; }
+
+    const std::vector<Entity>& civilians() const { return m_civs; }
+    const std::vector<Building*>& buildings() const { return m_buildings; }
+
+    /// \return An estimation of the memory this chunk occupies, in bytes.
+    /// This includes the not-yet-finalized data as well as the GPU buffers.
+    std::size_t memoryUsage() const;
+
+private:
+    // No copying!
+    Chunk(const Chunk&);
+    Chunk& operator=(const Chunk&);
+
+    ChunkCoord m_coord;
+    ChunkData* m_pData; ///< NULL once finalized.
+    std::size_t m_nextSpawn;
+
+    Civilians& m_civilians;
+    std::vector<Entity> m_civs;
+    std::vector<Building*> m_buildings;
+};
+
+}
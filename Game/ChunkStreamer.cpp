@@ -0,0 +1,243 @@
+#include "ChunkStreamer.h"
+
+#include "Utilities/Hash.h"
+#include "Utilities/String.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <vector>
+
+using namespace RoadRage;
+
+// Chunks are only dropped once they are this many chunks further away than
+// the loading radius. This avoids loading and unloading the same chunk over
+// and over again when driving along a chunk border.
+#define D_UNLOAD_HYSTERESIS 1
+
+// How much we expect a chunk to cost, as long as we have no chunk to measure.
+#define D_DEFAULT_CHUNK_FOOTPRINT (64*1024)
+
+namespace {
+    struct NearerTo {
+        ChunkCoord center;
+        NearerTo(const ChunkCoord& c) : center(c) {}
+        bool operator()(const ChunkCoord& a, const ChunkCoord& b) const {
+            return a.distSq(center) < b.distSq(center);
+        }
+    };
+}
+
+ChunkStreamer::ChunkStreamer(const FileSystem& in_fs, const std::string& in_sDir, float in_fChunkSize, int in_iRadius, std::size_t in_memoryBudget, ShaderManager& in_shadmgr, Civilians& io_civilians)
+    : m_fs(in_fs)
+    , m_sDir(in_sDir)
+    , m_fChunkSize(in_fChunkSize)
+    , m_iRadius(in_iRadius)
+    , m_memoryBudget(in_memoryBudget)
+    , m_shadmgr(in_shadmgr)
+    , m_civilians(io_civilians)
+    , m_center(0, 0)
+    , m_bQuit(false)
+    , m_thread(&ChunkStreamer::ioThread, this)
+{
+}
+
+ChunkStreamer::~ChunkStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bQuit = true;
+        m_requests.clear();
+    }
+    m_wakeup.notify_one();
+    m_thread.join();
+
+    for(auto i = m_loaded.begin() ; i != m_loaded.end() ; ++i) {
+        delete *i;
+    }
+
+    for(auto i = m_chunks.begin() ; i != m_chunks.end() ; ++i) {
+        delete i->second;
+    }
+}
+
+void ChunkStreamer::update(const Vector& in_center)
+{
+    m_center = ChunkCoord::fromWorld(in_center, m_fChunkSize);
+
+    // First, get rid of everything that got out of reach.
+    const int dropRadius = m_iRadius + D_UNLOAD_HYSTERESIS;
+    for(auto i = m_chunks.begin() ; i != m_chunks.end() ; ) {
+        if(i->first.distSq(m_center) > dropRadius*dropRadius)
+            this->unload(i++);
+        else
+            ++i;
+    }
+
+    std::vector<ChunkCoord> obsolete;
+    for(auto i = m_pending.begin() ; i != m_pending.end() ; ++i) {
+        if(i->second && i->first.distSq(m_center) > dropRadius*dropRadius) {
+            i->second = false;
+            obsolete.push_back(i->first);
+        }
+    }
+
+    // Then, find out what we'd like to have, nearest first.
+    std::vector<ChunkCoord> wanted;
+    for(int z = m_center.z - m_iRadius ; z <= m_center.z + m_iRadius ; ++z) {
+        for(int x = m_center.x - m_iRadius ; x <= m_center.x + m_iRadius ; ++x) {
+            ChunkCoord c(x, z);
+            if(c.distSq(m_center) <= m_iRadius*m_iRadius)
+                wanted.push_back(c);
+        }
+    }
+    std::sort(wanted.begin(), wanted.end(), NearerTo(m_center));
+
+    // Guess what the chunks we are about to request will cost us.
+    std::size_t used = this->memoryUsage();
+    std::size_t perChunk = m_chunks.empty() ? D_DEFAULT_CHUNK_FOOTPRINT : used / m_chunks.size();
+    std::size_t expected = used + m_pending.size() * perChunk;
+
+    std::vector<ChunkCoord> requests;
+    for(auto i = wanted.begin() ; i != wanted.end() ; ++i) {
+        if(m_chunks.find(*i) != m_chunks.end())
+            continue;
+
+        auto pending = m_pending.find(*i);
+        if(pending != m_pending.end()) {
+            // It came back into reach before it even arrived.
+            pending->second = true;
+            continue;
+        }
+
+        // As we go nearest-first, this drops the farthest chunks when running
+        // out of memory, which are the least important ones.
+        if(expected + perChunk > m_memoryBudget)
+            break;
+
+        expected += perChunk;
+        m_pending[*i] = true;
+        requests.push_back(*i);
+    }
+
+    if(obsolete.empty() && requests.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // No need to read what we won't need anyway.
+        for(auto i = obsolete.begin() ; i != obsolete.end() ; ++i) {
+            auto queued = std::find(m_requests.begin(), m_requests.end(), *i);
+            if(queued != m_requests.end()) {
+                m_requests.erase(queued);
+                m_pending.erase(*i);
+            }
+        }
+
+        m_requests.insert(m_requests.end(), requests.begin(), requests.end());
+    }
+    m_wakeup.notify_one();
+}
+
+void ChunkStreamer::finalize(float in_fTimeBudget)
+{
+    sf::Clock clock;
+
+    // Take over everything the I/O thread has prepared for us.
+    std::deque<ChunkData*> loaded;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        loaded.swap(m_loaded);
+    }
+
+    for(auto i = loaded.begin() ; i != loaded.end() ; ++i) {
+        auto pending = m_pending.find((*i)->coord);
+        if(pending == m_pending.end() || !pending->second) {
+            // We changed our mind while it was being read.
+            delete *i;
+        } else {
+            m_chunks[(*i)->coord] = new Chunk(*i, m_civilians);
+        }
+
+        if(pending != m_pending.end())
+            m_pending.erase(pending);
+    }
+
+    // Now, bring the nearest chunks to life first, one entity at a time, until
+    // the time is up. We always do at least one step in order to progress.
+    std::vector<ChunkCoord> todo;
+    for(auto i = m_chunks.begin() ; i != m_chunks.end() ; ++i) {
+        if(!i->second->finalized())
+            todo.push_back(i->first);
+    }
+    std::sort(todo.begin(), todo.end(), NearerTo(m_center));
+
+    for(auto i = todo.begin() ; i != todo.end() ; ++i) {
+        Chunk* pChunk = m_chunks[*i];
+        do {
+            pChunk->finalizeStep(m_shadmgr);
+        } while(!pChunk->finalized() && clock.GetElapsedTime() < in_fTimeBudget);
+
+        if(clock.GetElapsedTime() >= in_fTimeBudget)
+            break;
+    }
+}
+
+std::size_t ChunkStreamer::memoryUsage() const
+{
+    std::size_t n = 0;
+    for(auto i = m_chunks.begin() ; i != m_chunks.end() ; ++i) {
+        n += i->second->memoryUsage();
+    }
+    return n;
+}
+
+void ChunkStreamer::unload(Chunks::iterator in_chunk)
+{
+    // This releases the GPU resources, which is why it can't happen on the
+    // I/O thread. Deleting buffers is cheap though, compared to creating them.
+    delete in_chunk->second;
+    m_chunks.erase(in_chunk);
+}
+
+void ChunkStreamer::ioThread()
+{
+    while(true) {
+        ChunkCoord coord;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while(!m_bQuit && m_requests.empty()) {
+                m_wakeup.wait(lock);
+            }
+
+            if(m_bQuit)
+                return;
+
+            coord = m_requests.front();
+            m_requests.pop_front();
+        }
+
+        ChunkData* pData = this->read(coord);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_loaded.push_back(pData);
+    }
+}
+
+ChunkData* ChunkStreamer::read(const ChunkCoord& in_coord) const
+{
+    ChunkData* pData = new ChunkData;
+    pData->coord = in_coord;
+
+    FileView file = m_fs.read(m_sDir + "/" + to_s(in_coord.x) + "_" + to_s(in_coord.z) + ".chunk");
+    // A file of another chunk, copied or renamed, would never fill this one
+    // and replace the other one in finalize, so it counts as none.
+    if(!file.valid() || !pData->load(file.data(), file.size()) || pData->coord != in_coord) {
+        // Every level has its own city, but always the same one.
+        pData->coord = in_coord;
+        pData->generate(m_fChunkSize, static_cast<unsigned>(fnv1a(m_sDir)));
+    }
+
+    return pData;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Chunk.h"
+
+#include "Utilities/FileSystem.h"
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace RoadRage {
+
+/// This keeps the chunks of the world that lie around a center point (usually
+/// the avatar) in memory and drops the ones that are too far away.\n
+/// Reading (or generating) a chunk happens on a background I/O thread, while
+/// bringing its entities to life, which creates OpenGL buffers, happens on
+/// the GL thread in small time-sliced steps. This way, streaming in new parts
+/// of the city never causes a hitch in the framerate.
+class ChunkStreamer {
+public:
+    typedef std::map<ChunkCoord, Chunk*> Chunks;
+
+    /// \param in_sDir The directory containing the level's chunk files, within
+    ///                \a in_fs. Chunks that have no file in there are
+    ///                procedurally generated.
+    /// \param in_fChunkSize The length of a chunk's side, in meters.
+    /// \param in_iRadius The radius, in chunks, of the area kept in memory.
+    /// \param in_memoryBudget The maximum amount of bytes we may use for chunks.
+    /// \param io_civilians Where the chunks' civilians get spawned.
+    ChunkStreamer(const FileSystem& in_fs, const std::string& in_sDir, float in_fChunkSize, int in_iRadius, std::size_t in_memoryBudget, ShaderManager& in_shadmgr, Civilians& io_civilians);
+    ~ChunkStreamer();
+
+    /// Requests the chunks around \a in_center to be loaded and drops those
+    /// that got out of reach. Must be called from the GL thread.
+    void update(const Vector& in_center);
+    /// Brings the loaded chunks to life until \a in_fTimeBudget seconds are
+    /// used up. Must be called from the GL thread.
+    void finalize(float in_fTimeBudget);
+
+    /// \return All chunks currently living on the GL thread, whether they
+    ///         are completely finalized or not.
+    const Chunks& chunks() const { return m_chunks; }
+
+    /// \return An estimation of the memory all chunks occupy, in bytes.
+    std::size_t memoryUsage() const;
+    float chunkSize() const { return m_fChunkSize; }
+
+private:
+    // No copying!
+    ChunkStreamer(const ChunkStreamer&);
+    ChunkStreamer& operator=(const ChunkStreamer&);
+
+    void ioThread();
+    ChunkData* read(const ChunkCoord& in_coord) const;
+    void unload(Chunks::iterator in_chunk);
+
+    const FileSystem& m_fs;
+    std::string m_sDir;
+    float m_fChunkSize;
+    int m_iRadius;
+    std::size_t m_memoryBudget;
+    ShaderManager& m_shadmgr;
+    Civilians& m_civilians;
+
+    /// The chunk the center was in at the last update.
+    ChunkCoord m_center;
+
+    /// The chunks that are alive on the GL thread. Only touched by the GL thread.
+    Chunks m_chunks;
+    /// The chunks that are queued or being read by the I/O thread.
+    std::map<ChunkCoord, bool> m_pending;
+
+    // Communication with the I/O thread, all guarded by m_mutex.
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::deque<ChunkCoord> m_requests;
+    std::deque<ChunkData*> m_loaded;
+    bool m_bQuit;
+
+    std::thread m_thread;
+};
+
+}
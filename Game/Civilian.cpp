@@ -1,27 +1,63 @@
 #include "Civilian.h"
 
-#include <3d/Math/Matrix.h>
-
-#include <SFML/System/Clock.hpp>
+#include <cmath>
 
 using namespace RoadRage;
 
-Civilian::Civilian(Vector pos, Vector vel, float orientation, float angularVel, ShaderManager& shadmgr)
-    : MobileEntity(pos, vel, Vector(0.0f, 0.0f, 0.0f), orientation, angularVel, 0.0f, Vector(0.1f, 0.5f, 1.0f))
-    , m_model(shadmgr)
+Civilians::Civilians(Entities& io_entities, Crowd& io_crowd)
+    : m_entities(io_entities)
+    , m_crowd(io_crowd)
+{
+}
+
+Civilians::~Civilians()
 {
 }
 
-Civilian::~Civilian()
+Entity Civilians::spawn(const Vector& in_pos, const Vector& in_vel, float in_fOri, float in_fAngularVel)
 {
+    // Civilians travel at constant speed for now!
+    return m_entities.create(Transform(in_pos, in_fOri, Vector(0.1f, 0.5f, 1.0f)),
+                             Motion(in_vel, in_fAngularVel), Civilian(), LodState());
 }
 
-void Civilian::think(const GameClock& clock)
+void Civilians::destroy(Entity in_civilian)
 {
-    MobileEntity::think(clock);
+    const Civilian* pCiv = m_entities.get<Civilian>(in_civilian);
+    if(pCiv && pCiv->bInCrowd)
+        m_crowd.remove(pCiv->agent);
+    m_entities.destroy(in_civilian);
 }
 
-void Civilian::render(const GameClock& /*clock*/, const General4x4Matrix& in_viewProj)
+void Civilians::join()
 {
-    m_model.render(in_viewProj * this->getModelMatrix());
+    Crowd& crowd = m_crowd;
+    m_entities.each<Transform, Civilian>([&crowd](Entity, Transform& io_transform, Civilian& io_civ) {
+        if(io_civ.bInCrowd)
+            return;
+        io_civ.agent = crowd.add(io_transform.pos);
+        io_civ.bInCrowd = true;
+    });
+}
+
+void Civilians::think(const GameClock& clock, ThreadPool& io_workers)
+{
+    const Crowd& crowd = m_crowd;
+    const float fDeltaT = clock.deltaT();
+    m_entities.eachChunk<Transform, Motion, Civilian>(io_workers,
+        [&crowd, fDeltaT](unsigned, std::size_t in_n, const Entity*, Transform* io_transforms, Motion* io_motions, Civilian* in_civs) {
+        for(std::size_t i = 0 ; i < in_n ; ++i) {
+            if(!in_civs[i].bInCrowd) {
+                io_motions[i].move(io_transforms[i], fDeltaT);
+                continue;
+            }
+
+            // The crowd did the walking already, we only face where we're going.
+            const Vector v = crowd.vel(in_civs[i].agent);
+            io_transforms[i].pos = crowd.pos(in_civs[i].agent);
+            io_motions[i].vel = v;
+            if(v.x()*v.x() + v.z()*v.z() > 0.01f)
+                io_transforms[i].ori = std::atan2(v.x(), v.z());
+        }
+    });
 }
@@ -1,22 +1,53 @@
 #pragma once
 
-#include "Entity.h"
+#include "Crowd.h"
+#include "Entities.h"
+#include "GameClock.h"
 
-#include "3d/BuiltinModel.h"
+#include "3d/LodModel.h"
 
 namespace RoadRage {
 
-class Civilian : public MobileEntity {
+/// Makes an entity a civilian, which walks around with the crowd once it
+/// joined it, and on its own, at constant speed, before.
+struct Civilian {
+    Civilian() : agent(0), bInCrowd(false) {}
+
+    Crowd::Agent agent;
+    bool bInCrowd;
+};
+
+/// All the civilians, which are entities having a Transform, a Motion, a
+/// Civilian and a LodState, the latter only ever touched by the one worker
+/// submitting that civilian. They all look alike, so the Level draws them
+/// with the same model.
+class Civilians {
 public:
-    // Civilians travel at constant speed for now!
-    Civilian(Vector pos, Vector vel, float orientation, float angularVel, ShaderManager& shadmgr);
-    virtual ~Civilian();
+    /// The civilians are made among \a io_entities and walk with \a io_crowd,
+    /// which both must outlive them.
+    Civilians(Entities& io_entities, Crowd& io_crowd);
+    virtual ~Civilians();
 
-    virtual void think(const GameClock& clock);
-    virtual void render(const GameClock& clock, const General4x4Matrix& in_viewProj);
+    /// Adds a new civilian, which isn't in the crowd yet.
+    Entity spawn(const Vector& in_pos, const Vector& in_vel, float in_fOri, float in_fAngularVel);
+    /// Removes \a in_civilian, which leaves the crowd.
+    void destroy(Entity in_civilian);
+
+    /// Lets all civilians that aren't in the crowd yet join it.
+    void join();
+    /// Moves the civilians on, the ones in the crowd to where it walked
+    /// them, spread over \a io_workers.
+    void think(const GameClock& clock, ThreadPool& io_workers);
+
+    std::size_t size() const { return m_entities.count<Civilian>(); }
 
 private:
-    BoxModel m_model;
+    // No copying!
+    Civilians(const Civilians&);
+    Civilians& operator=(const Civilians&);
+
+    Entities& m_entities;
+    Crowd& m_crowd;
 };
 
 }
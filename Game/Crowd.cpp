@@ -0,0 +1,280 @@
+#include "Crowd.h"
+
+#include "Utilities/ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace RoadRage;
+
+/// How close agents come to each other before they start pushing each other
+/// away, in meters. This is also the size of the spatial hash's cells.
+#define D_CROWD_RADIUS 1.0f
+/// Nobody looks at more neighbours than this, which bounds the cost of
+/// dense crowds.
+#define D_CROWD_MAX_NEIGHBORS 8
+/// How hard agents avoid each other, relative to their walking speed.
+#define D_CROWD_PUSH 1.5f
+/// How quickly agents reach the velocity they want, in 1/s.
+#define D_CROWD_STEERING 4.0f
+/// Agents closer to their goal than this have reached it, in meters.
+#define D_CROWD_ARRIVAL 2.0f
+/// The range of walking speeds, in m/s.
+#define D_CROWD_MIN_SPEED 1.1f
+#define D_CROWD_MAX_SPEED 1.6f
+
+/// Scrambles the bits of \a in_x, for random numbers that need no state and
+/// thus can be drawn from any thread.
+static inline uint32_t mix(uint32_t in_x)
+{
+    in_x ^= in_x >> 16;
+    in_x *= 0x7feb352du;
+    in_x ^= in_x >> 15;
+    in_x *= 0x846ca68bu;
+    in_x ^= in_x >> 16;
+    return in_x;
+}
+
+Crowd::Crowd()
+    : m_nAgents(0)
+    , m_bucketMask(0)
+    , m_nArrivals(0)
+    , m_stepCount(0)
+{
+}
+
+Crowd::~Crowd()
+{
+}
+
+Crowd::Agent Crowd::add(const Vector& in_pos)
+{
+    Agent a;
+    if(!m_free.empty()) {
+        a = m_free.back();
+        m_free.pop_back();
+    } else {
+        a = static_cast<Agent>(m_slot.size());
+        m_slot.push_back(0);
+    }
+
+    // New agents go to the end, the next step sorts them in.
+    const uint32_t r = mix(a ^ mix(m_stepCount));
+    m_slot[a] = static_cast<uint32_t>(m_x.size());
+    m_x.push_back(in_pos.x());
+    m_z.push_back(in_pos.z());
+    m_vx.push_back(0.0f);
+    m_vz.push_back(0.0f);
+    // The goal is picked among however many there are when it gets used.
+    m_goal.push_back(static_cast<uint16_t>(r));
+    m_speed.push_back(D_CROWD_MIN_SPEED + (D_CROWD_MAX_SPEED - D_CROWD_MIN_SPEED) * static_cast<float>(r >> 16) / 65535.0f);
+    m_agent.push_back(a);
+    m_alive.push_back(1);
+    ++m_nAgents;
+    return a;
+}
+
+void Crowd::remove(Agent in_agent)
+{
+    // It stays in there until the next step sorts it out.
+    m_alive[m_slot[in_agent]] = 0;
+    m_free.push_back(in_agent);
+    --m_nAgents;
+}
+
+void Crowd::navigation(const NavGrid& in_grid, const std::vector<Vector>& in_goals, ThreadPool& io_workers)
+{
+    m_grid = in_grid;
+    m_fields.resize(in_goals.size());
+
+    // Every field is independent of the others.
+    io_workers.parallelFor(in_goals.size(), [this, &in_goals](std::size_t in_begin, std::size_t in_end, unsigned) {
+        for(std::size_t i = in_begin ; i < in_end ; ++i) {
+            m_fields[i].compute(m_grid, in_goals[i]);
+        }
+    }, 1);
+}
+
+uint32_t Crowd::bucket(int in_x, int in_z) const
+{
+    // Neighbouring cells along x end up in neighbouring buckets, so that a
+    // row of cells can be looked at all at once.
+    return (static_cast<uint32_t>(in_z) * 19349663u + static_cast<uint32_t>(in_x)) & m_bucketMask;
+}
+
+void Crowd::sort()
+{
+    // Twice as many buckets as agents keeps the collisions rare.
+    const std::size_t n = m_x.size();
+    uint32_t nBuckets = 1024;
+    while(nBuckets < 2 * n)
+        nBuckets *= 2;
+    m_bucketMask = nBuckets - 1;
+
+    // A counting sort of the agents by bucket, which leaves the dead out.
+    m_bucketStart.assign(nBuckets + 1, 0);
+    m_bucketOf.resize(n);
+    for(std::size_t i = 0 ; i < n ; ++i) {
+        if(!m_alive[i])
+            continue;
+
+        const uint32_t b = this->bucket(static_cast<int>(std::floor(m_x[i] * (1.0f / D_CROWD_RADIUS))),
+                                        static_cast<int>(std::floor(m_z[i] * (1.0f / D_CROWD_RADIUS))));
+        m_bucketOf[i] = b;
+        ++m_bucketStart[b + 1];
+    }
+    for(uint32_t b = 0 ; b < nBuckets ; ++b) {
+        m_bucketStart[b + 1] += m_bucketStart[b];
+    }
+
+    m_order.resize(m_nAgents);
+    std::vector<uint32_t> cursor(m_bucketStart.begin(), m_bucketStart.end() - 1);
+    for(std::size_t i = 0 ; i < n ; ++i) {
+        if(m_alive[i])
+            m_order[cursor[m_bucketOf[i]]++] = static_cast<uint32_t>(i);
+    }
+
+    // Then move the agents there. As the order hardly changes between two
+    // steps, this mostly reads straight through memory.
+    m_nextX.resize(m_nAgents); m_nextZ.resize(m_nAgents);
+    m_nextVx.resize(m_nAgents); m_nextVz.resize(m_nAgents);
+    m_nextGoal.resize(m_nAgents);
+    m_nextSpeed.resize(m_nAgents);
+    m_nextAgent.resize(m_nAgents);
+    for(std::size_t k = 0 ; k < m_nAgents ; ++k) {
+        const uint32_t i = m_order[k];
+        m_nextX[k] = m_x[i]; m_nextZ[k] = m_z[i];
+        m_nextVx[k] = m_vx[i]; m_nextVz[k] = m_vz[i];
+        m_nextGoal[k] = m_goal[i];
+        m_nextSpeed[k] = m_speed[i];
+        m_nextAgent[k] = m_agent[i];
+        m_slot[m_agent[i]] = static_cast<uint32_t>(k);
+    }
+    m_x.swap(m_nextX); m_z.swap(m_nextZ);
+    m_vx.swap(m_nextVx); m_vz.swap(m_nextVz);
+    m_goal.swap(m_nextGoal);
+    m_speed.swap(m_nextSpeed);
+    m_agent.swap(m_nextAgent);
+    m_alive.assign(m_nAgents, 1);
+}
+
+void Crowd::step(float in_fDeltaT, ThreadPool& io_workers)
+{
+    if(m_nAgents == 0)
+        return;
+
+    this->sort();
+
+    m_workerArrivals.assign(io_workers.size(), 0);
+    io_workers.parallelFor(m_nAgents, [this, in_fDeltaT](std::size_t in_begin, std::size_t in_end, unsigned in_worker) {
+        this->move(in_begin, in_end, in_worker, in_fDeltaT);
+    }, 1024);
+
+    m_x.swap(m_nextX);
+    m_z.swap(m_nextZ);
+    m_vx.swap(m_nextVx);
+    m_vz.swap(m_nextVz);
+    for(auto i = m_workerArrivals.begin() ; i != m_workerArrivals.end() ; ++i) {
+        m_nArrivals += *i;
+    }
+    ++m_stepCount;
+}
+
+void Crowd::move(std::size_t in_begin, std::size_t in_end, unsigned in_worker, float in_fDeltaT)
+{
+    const std::size_t nGoals = m_fields.size();
+    const float fSteer = std::min(1.0f, D_CROWD_STEERING * in_fDeltaT);
+    const float fInvRadius = 1.0f / D_CROWD_RADIUS;
+
+    for(std::size_t k = in_begin ; k < in_end ; ++k) {
+        const float x = m_x[k], z = m_z[k];
+        float vx = m_vx[k], vz = m_vz[k];
+        const float fSpeed = m_speed[k];
+
+        // Where the flow field of our goal wants us to go.
+        float wantX = 0.0f, wantZ = 0.0f;
+        unsigned cell = 0;
+        const bool bOnGrid = m_grid.cell(x, z, cell);
+        if(bOnGrid && nGoals > 0) {
+            unsigned goal = m_goal[k] % nGoals;
+            const FlowField& field = m_fields[goal];
+            const float gx = field.goal().x() - x, gz = field.goal().z() - z;
+            if(gx*gx + gz*gz < D_CROWD_ARRIVAL*D_CROWD_ARRIVAL && nGoals > 1) {
+                // Only this agent's own goal is written, nobody else reads it.
+                goal = (goal + 1 + mix(m_agent[k] ^ mix(m_stepCount)) % (nGoals - 1)) % nGoals;
+                m_goal[k] = static_cast<uint16_t>(goal);
+                ++m_workerArrivals[in_worker];
+            }
+
+            m_fields[goal].dir(cell, wantX, wantZ);
+            wantX *= fSpeed;
+            wantZ *= fSpeed;
+        }
+
+        // And away from the ones too close, looking at the 3x3 cells around,
+        // one row of three at a time.
+        float pushX = 0.0f, pushZ = 0.0f;
+        unsigned nNeighbors = 0;
+        const int cx = static_cast<int>(std::floor(x * fInvRadius)), cz = static_cast<int>(std::floor(z * fInvRadius));
+        for(int dz = -1 ; dz <= 1 && nNeighbors < D_CROWD_MAX_NEIGHBORS ; ++dz) {
+            const uint32_t b = this->bucket(cx - 1, cz + dz);
+            // The row may wrap around the end of the buckets, that's rare.
+            const uint32_t nRows = b + 3 <= m_bucketMask + 1 ? 1 : 3;
+            for(uint32_t row = 0 ; row < nRows ; ++row) {
+                const uint32_t b0 = nRows == 1 ? b : ((b + row) & m_bucketMask);
+                const uint32_t end = m_bucketStart[b0 + (nRows == 1 ? 3 : 1)];
+                for(uint32_t j = m_bucketStart[b0] ; j < end && nNeighbors < D_CROWD_MAX_NEIGHBORS ; ++j) {
+                    if(j == k)
+                        continue;
+
+                    const float ox = x - m_x[j], oz = z - m_z[j];
+                    const float d2 = ox*ox + oz*oz;
+                    if(d2 >= D_CROWD_RADIUS*D_CROWD_RADIUS)
+                        continue;
+
+                    ++nNeighbors;
+                    if(d2 < 1e-6f) {
+                        // Standing on top of each other; split up either way.
+                        pushX += k < j ? 1.0f : -1.0f;
+                        continue;
+                    }
+
+                    // Stronger the closer they are, up to one.
+                    const float d = std::sqrt(d2);
+                    const float w = (D_CROWD_RADIUS - d) * fInvRadius / d;
+                    pushX += ox * w;
+                    pushZ += oz * w;
+                }
+            }
+        }
+        wantX += pushX * D_CROWD_PUSH * fSpeed;
+        wantZ += pushZ * D_CROWD_PUSH * fSpeed;
+
+        // Steer towards that, without ever running.
+        vx += (wantX - vx) * fSteer;
+        vz += (wantZ - vz) * fSteer;
+        const float v2 = vx*vx + vz*vz, fMax = fSpeed * 1.5f;
+        if(v2 > fMax*fMax) {
+            const float s = fMax / std::sqrt(v2);
+            vx *= s;
+            vz *= s;
+        }
+
+        // Buildings stop us, but we slide along their walls. Whoever got
+        // pushed into one may leave it, though.
+        float nx = x + vx * in_fDeltaT, nz = z + vz * in_fDeltaT;
+        unsigned next;
+        if(!(bOnGrid && m_grid.blocked(cell))) {
+            if(m_grid.cell(nx, z, next) && m_grid.blocked(next)) {
+                nx = x;
+                vx = 0.0f;
+            }
+            if(m_grid.cell(nx, nz, next) && m_grid.blocked(next)) {
+                nz = z;
+                vz = 0.0f;
+            }
+        }
+
+        m_nextX[k] = nx; m_nextZ[k] = nz; m_nextVx[k] = vx; m_nextVz[k] = vz;
+    }
+}
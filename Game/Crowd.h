@@ -0,0 +1,93 @@
+#pragma once
+
+#include "NavGrid.h"
+
+#include "3d/Math/Vector.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+namespace RoadRage {
+
+class ThreadPool;
+
+/// Moves many pedestrians at once, each one walking towards one of a few
+/// shared goals. The way there comes from the goal's FlowField, the local
+/// avoidance of the others from a spatial hash of everybody's position that
+/// gets rebuilt every step.\n
+/// The agents are stored as a structure of arrays, sorted by the bucket of
+/// the spatial hash they're in, so that neighbours are next to each other in
+/// memory, too. As people don't move far in a step, that order barely changes
+/// from one step to the next. Each step is split into batches over the
+/// workers; an agent only ever reads the state of the last step and writes
+/// its own, so the batches need no locking at all.
+class Crowd {
+public:
+    /// Identifies an agent. They're reused once removed.
+    typedef uint32_t Agent;
+
+    Crowd();
+    virtual ~Crowd();
+
+    /// Adds an agent standing at \a in_pos, heading for a random goal.
+    Agent add(const Vector& in_pos);
+    void remove(Agent in_agent);
+
+    /// Sets the walkable area and the goals everybody walks between, which
+    /// computes their flow fields using \a io_workers. The agents keep the
+    /// index of their goal, so it's best to keep their amount.
+    void navigation(const NavGrid& in_grid, const std::vector<Vector>& in_goals, ThreadPool& io_workers);
+
+    /// Moves every agent by \a in_fDeltaT seconds, using \a io_workers.
+    void step(float in_fDeltaT, ThreadPool& io_workers);
+
+    Vector pos(Agent in_agent) const { return Vector(m_x[m_slot[in_agent]], 0.0f, m_z[m_slot[in_agent]]); }
+    Vector vel(Agent in_agent) const { return Vector(m_vx[m_slot[in_agent]], 0.0f, m_vz[m_slot[in_agent]]); }
+
+    std::size_t agentCount() const { return m_nAgents; }
+    const NavGrid& grid() const { return m_grid; }
+    const std::vector<FlowField>& fields() const { return m_fields; }
+    /// \return How many times an agent reached its goal, in total.
+    std::size_t arrivals() const { return m_nArrivals; }
+
+private:
+    // No copying!
+    Crowd(const Crowd&);
+    Crowd& operator=(const Crowd&);
+
+    void sort();
+    void move(std::size_t in_begin, std::size_t in_end, unsigned in_worker, float in_fDeltaT);
+    uint32_t bucket(int in_x, int in_z) const;
+
+    // The state of every agent, in the order of the spatial hash. The next
+    // step is written to separate arrays, which then get swapped in.
+    std::vector<float> m_x, m_z, m_vx, m_vz;
+    std::vector<float> m_nextX, m_nextZ, m_nextVx, m_nextVz;
+    std::vector<uint16_t> m_goal, m_nextGoal;
+    /// How fast the agent likes to walk, in m/s.
+    std::vector<float> m_speed, m_nextSpeed;
+    std::vector<Agent> m_agent, m_nextAgent;
+    std::vector<uint8_t> m_alive;
+
+    /// Where every agent is in the arrays above.
+    std::vector<uint32_t> m_slot;
+    std::vector<Agent> m_free;
+    std::size_t m_nAgents;
+
+    NavGrid m_grid;
+    std::vector<FlowField> m_fields;
+
+    /// The agents of bucket b are [m_bucketStart[b], m_bucketStart[b+1]).
+    std::vector<uint32_t> m_bucketStart;
+    std::vector<uint32_t> m_bucketOf;
+    std::vector<uint32_t> m_order;
+    uint32_t m_bucketMask;
+
+    /// The arrivals of every worker during the current step.
+    std::vector<std::size_t> m_workerArrivals;
+    std::size_t m_nArrivals;
+    uint32_t m_stepCount;
+};
+
+}
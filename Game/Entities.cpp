@@ -0,0 +1,223 @@
+#include "Entities.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <stdexcept>
+
+using namespace RoadRage;
+
+/// The size of the chunks the archetypes keep their entities in, in bytes.
+/// About what fits into the L1 cache, even with a few of them at once.
+#define D_ENTITY_CHUNK_SIZE 16384
+/// Every component type takes one bit of an archetype's mask.
+#define D_ENTITY_MAX_TYPES 64
+/// No entity lives in an archetype of this number.
+#define D_ENTITY_NO_ARCHETYPE 0xffffffffu
+
+/// How many component types there are, of all Entities.
+static std::atomic<unsigned> g_nTypes(0);
+
+Entities::Entities()
+    : m_nAlive(0)
+{
+}
+
+Entities::~Entities()
+{
+    for(std::size_t i = 0 ; i < m_slots.size() ; ++i) {
+        if(m_slots[i].archetype != D_ENTITY_NO_ARCHETYPE)
+            this->destroy(Entity(static_cast<uint32_t>(i), m_slots[i].generation));
+    }
+    for(auto i = m_archetypes.begin() ; i != m_archetypes.end() ; ++i) {
+        for(auto j = (*i)->chunks.begin() ; j != (*i)->chunks.end() ; ++j) {
+            std::free(*j);
+        }
+        delete *i;
+    }
+}
+
+Entities::Type* Entities::types()
+{
+    static Type s_types[D_ENTITY_MAX_TYPES];
+    return s_types;
+}
+
+unsigned Entities::registerType(const Type& in_type)
+{
+    // Whoever gets to know the id afterwards, through Entities::type, sees
+    // the type written, too.
+    const unsigned id = g_nTypes++;
+    if(id >= D_ENTITY_MAX_TYPES)
+        throw std::runtime_error("Too many component types");
+    Entities::types()[id] = in_type;
+    return id;
+}
+
+void Entities::destroy(Entity in_entity)
+{
+    if(!this->alive(in_entity))
+        return;
+
+    Slot& s = m_slots[in_entity.index];
+    const Archetype& arch = *m_archetypes[s.archetype];
+    for(std::size_t i = 0 ; i < arch.types.size() ; ++i) {
+        Entities::types()[arch.types[i]].destroy(this->at(s, arch.types[i]));
+    }
+    this->vacate(s);
+
+    s.archetype = D_ENTITY_NO_ARCHETYPE;
+    ++s.generation;
+    m_free.push_back(in_entity.index);
+    --m_nAlive;
+}
+
+bool Entities::alive(Entity in_entity) const
+{
+    return in_entity.index < m_slots.size() && m_slots[in_entity.index].generation == in_entity.generation
+        && m_slots[in_entity.index].archetype != D_ENTITY_NO_ARCHETYPE;
+}
+
+std::size_t Entities::memoryUsage() const
+{
+    std::size_t n = sizeof(Entities) + m_slots.capacity() * sizeof(Slot) + m_free.capacity() * sizeof(uint32_t);
+    for(auto i = m_archetypes.begin() ; i != m_archetypes.end() ; ++i) {
+        n += sizeof(Archetype) + (*i)->chunks.size() * D_ENTITY_CHUNK_SIZE;
+    }
+    return n;
+}
+
+uint32_t Entities::archetype(Mask in_mask)
+{
+    for(std::size_t i = 0 ; i < m_archetypes.size() ; ++i) {
+        if(m_archetypes[i]->mask == in_mask)
+            return static_cast<uint32_t>(i);
+    }
+
+    Archetype* pArch = new Archetype;
+    pArch->mask = in_mask;
+    pArch->count = 0;
+    std::size_t rowSize = sizeof(Entity);
+    for(unsigned t = 0 ; t < D_ENTITY_MAX_TYPES ; ++t) {
+        pArch->column[t] = -1;
+        if(in_mask & (Mask(1) << t)) {
+            pArch->column[t] = static_cast<int>(pArch->types.size());
+            pArch->types.push_back(t);
+            rowSize += Entities::types()[t].size;
+        }
+    }
+
+    // As many rows as fit in a chunk, with the columns aligned.
+    pArch->capacity = D_ENTITY_CHUNK_SIZE / rowSize + 1;
+    std::size_t end = 0;
+    do {
+        --pArch->capacity;
+        pArch->offsets.clear();
+        end = pArch->capacity * sizeof(Entity);
+        for(auto t = pArch->types.begin() ; t != pArch->types.end() ; ++t) {
+            end = (end + Entities::types()[*t].align - 1) / Entities::types()[*t].align * Entities::types()[*t].align;
+            pArch->offsets.push_back(end);
+            end += pArch->capacity * Entities::types()[*t].size;
+        }
+    } while(end > D_ENTITY_CHUNK_SIZE && pArch->capacity > 1);
+
+    m_archetypes.push_back(pArch);
+    return static_cast<uint32_t>(m_archetypes.size() - 1);
+}
+
+Entity Entities::allocate(uint32_t in_archetype)
+{
+    if(m_free.empty()) {
+        Slot s = { D_ENTITY_NO_ARCHETYPE, 0, 0, 0 };
+        m_slots.push_back(s);
+        m_free.push_back(static_cast<uint32_t>(m_slots.size() - 1));
+    }
+    const uint32_t index = m_free.back();
+    m_free.pop_back();
+
+    Archetype& arch = *m_archetypes[in_archetype];
+    Slot& s = m_slots[index];
+    s.archetype = in_archetype;
+    s.chunk = static_cast<uint32_t>(arch.count / arch.capacity);
+    s.row = static_cast<uint32_t>(arch.count % arch.capacity);
+    if(s.chunk == arch.chunks.size()) {
+        unsigned char* pChunk = static_cast<unsigned char*>(std::malloc(D_ENTITY_CHUNK_SIZE));
+        if(!pChunk)
+            throw std::bad_alloc();
+        arch.chunks.push_back(pChunk);
+    }
+    ++arch.count;
+    ++m_nAlive;
+
+    const Entity e(index, s.generation);
+    reinterpret_cast<Entity*>(arch.chunks[s.chunk])[s.row] = e;
+    return e;
+}
+
+void Entities::migrate(Slot& io_slot, uint32_t in_archetype)
+{
+    const Entity e(static_cast<uint32_t>(&io_slot - &m_slots[0]), io_slot.generation);
+    const Slot from = io_slot;
+    const Archetype& src = *m_archetypes[from.archetype];
+
+    // A new row at the end of the other archetype, under the same handle.
+    Archetype& to = *m_archetypes[in_archetype];
+    io_slot.archetype = in_archetype;
+    io_slot.chunk = static_cast<uint32_t>(to.count / to.capacity);
+    io_slot.row = static_cast<uint32_t>(to.count % to.capacity);
+    if(io_slot.chunk == to.chunks.size()) {
+        unsigned char* pChunk = static_cast<unsigned char*>(std::malloc(D_ENTITY_CHUNK_SIZE));
+        if(!pChunk)
+            throw std::bad_alloc();
+        to.chunks.push_back(pChunk);
+    }
+    ++to.count;
+    reinterpret_cast<Entity*>(to.chunks[io_slot.chunk])[io_slot.row] = e;
+
+    for(std::size_t i = 0 ; i < src.types.size() ; ++i) {
+        const unsigned t = src.types[i];
+        if(to.column[t] >= 0)
+            Entities::types()[t].relocate(this->at(io_slot, t), this->at(from, t));
+        else
+            Entities::types()[t].destroy(this->at(from, t));
+    }
+    this->vacate(from);
+}
+
+void Entities::vacate(const Slot& in_slot)
+{
+    Archetype& arch = *m_archetypes[in_slot.archetype];
+    const std::size_t last = arch.count - 1;
+    Slot moved = { in_slot.archetype, static_cast<uint32_t>(last / arch.capacity),
+                   static_cast<uint32_t>(last % arch.capacity), 0 };
+
+    if(moved.chunk != in_slot.chunk || moved.row != in_slot.row) {
+        const Entity e = reinterpret_cast<Entity*>(arch.chunks[moved.chunk])[moved.row];
+        for(auto t = arch.types.begin() ; t != arch.types.end() ; ++t) {
+            Entities::types()[*t].relocate(this->at(in_slot, *t), this->at(moved, *t));
+        }
+        reinterpret_cast<Entity*>(arch.chunks[in_slot.chunk])[in_slot.row] = e;
+        m_slots[e.index].chunk = in_slot.chunk;
+        m_slots[e.index].row = in_slot.row;
+    }
+
+    --arch.count;
+    if(moved.row == 0) {
+        std::free(arch.chunks.back());
+        arch.chunks.pop_back();
+    }
+}
+
+void* Entities::at(const Slot& in_slot, unsigned in_type) const
+{
+    const Archetype& arch = *m_archetypes[in_slot.archetype];
+    const int c = arch.column[in_type];
+    if(c < 0)
+        return 0;
+    return arch.chunks[in_slot.chunk] + arch.offsets[c] + in_slot.row * Entities::types()[in_type].size;
+}
+
+std::size_t Entities::rows(const Archetype& in_archetype, std::size_t in_chunk) const
+{
+    return std::min(in_archetype.capacity, in_archetype.count - in_chunk * in_archetype.capacity);
+}
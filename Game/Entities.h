@@ -0,0 +1,155 @@
+#pragma once
+
+#include "Entity.h"
+
+#include "Utilities/ThreadPool.h"
+
+#include <cstddef>
+#include <new>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace RoadRage {
+
+/// All the entities there are, and all their components. An entity is only
+/// a handle, what it is and does comes from the components it has: any
+/// struct may be one, an entity has at most one of each type.\n
+/// Entities with the same set of component types share an archetype, which
+/// stores them in chunks of a fixed size: all the components of one type of
+/// a chunk next to each other, the entities in the same order in each. Going
+/// through all entities that have some of the types thus means going through
+/// the chunks of all archetypes that have them, which is what systems do,
+/// chunk by chunk, and spread over the workers if they like. Removing an
+/// entity moves the last one of its archetype into its place; giving it a
+/// component or taking one away moves it to another archetype.\n
+/// Adding and removing entities and components may only be done by one
+/// thread at a time, and not while going through them. Pointers to
+/// components are only good until then, handles for as long as the entity
+/// lives.
+class Entities {
+public:
+    Entities();
+    virtual ~Entities();
+
+    /// \return A new entity with all of \a in_components, which must all be
+    ///         of different types.
+    template<class C, class... Cs>
+    Entity create(C in_component, Cs... in_components);
+    /// Removes \a in_entity and all its components, if it's still there.
+    void destroy(Entity in_entity);
+    /// \return Whether \a in_entity is still there.
+    bool alive(Entity in_entity) const;
+
+    /// \return The component of type T of \a in_entity, or 0 if it has none
+    ///         or is gone.
+    template<class T>
+    T* get(Entity in_entity);
+    template<class T>
+    const T* get(Entity in_entity) const;
+    /// Gives \a in_entity \a in_component, replacing the one it has, if any.
+    template<class T>
+    T& add(Entity in_entity, T in_component);
+    /// Takes the component of type T away from \a in_entity, if it has one.
+    template<class T>
+    void remove(Entity in_entity);
+
+    /// Calls \a in_f(Entity, Cs&...) for every entity having all of Cs.
+    template<class... Cs, class F>
+    void each(F in_f);
+    /// Calls \a in_f(unsigned worker, std::size_t n, const Entity*, Cs*...)
+    /// for every chunk of entities having all of Cs, which are n entities
+    /// and their components, spread over \a io_workers.
+    template<class... Cs, class F>
+    void eachChunk(ThreadPool& io_workers, F in_f);
+
+    /// \return How many entities there are, and how many having all of Cs.
+    std::size_t size() const { return m_nAlive; }
+    template<class... Cs>
+    std::size_t count() const;
+    /// \return How many bytes all entities take, their components included.
+    std::size_t memoryUsage() const;
+
+private:
+    // No copying!
+    Entities(const Entities&);
+    Entities& operator=(const Entities&);
+
+    /// Which component types an archetype has, one bit each.
+    typedef uint64_t Mask;
+
+    /// What it takes to handle the components of a type without knowing it.
+    struct Type {
+        std::size_t size;
+        std::size_t align;
+        /// Moves the component at \a io_src to \a out_dst, which is raw memory.
+        void (*relocate)(void* out_dst, void* io_src);
+        void (*destroy)(void* io_p);
+    };
+
+    /// All entities having exactly the types of mask. Chunk c holds the
+    /// entities [c*capacity, (c+1)*capacity), all chunks but the last full.
+    struct Archetype {
+        Mask mask;
+        /// Which of the types the chunks' columns hold, and where in them
+        /// they start. The entities' handles come first.
+        std::vector<unsigned> types;
+        std::vector<std::size_t> offsets;
+        /// Which column type t is in, or -1. There are 64 types at most, as
+        /// many as the mask has bits.
+        int column[64];
+        std::size_t capacity;
+        std::vector<unsigned char*> chunks;
+        std::size_t count;
+    };
+
+    /// Where an entity lives, if it does.
+    struct Slot {
+        uint32_t archetype;
+        uint32_t chunk;
+        uint32_t row;
+        uint32_t generation;
+    };
+
+    /// \return The id of type T, which is given out the first time it's asked for.
+    template<class T>
+    static unsigned type();
+    template<class T>
+    static void relocate(void* out_dst, void* io_src);
+    template<class T>
+    static void destroy(void* io_p);
+    /// All types registered so far, by all Entities.
+    static Type* types();
+    static unsigned registerType(const Type& in_type);
+    template<class... Cs>
+    static Mask mask();
+
+    template<class F, class... Ps>
+    static void run(F& in_f, std::size_t in_n, const Entity* in_entities, Ps*... in_components);
+
+    /// \return The archetype having exactly \a in_mask, made if need be.
+    uint32_t archetype(Mask in_mask);
+    /// Makes room for a new entity in archetype \a in_archetype.
+    Entity allocate(uint32_t in_archetype);
+    /// Gives the entity in \a io_slot a new row in \a in_archetype, taking
+    /// along the components both have, and dropping the others.
+    void migrate(Slot& io_slot, uint32_t in_archetype);
+    /// Fills the row of \a in_slot with the last entity of its archetype. Its
+    /// components must be gone already.
+    void vacate(const Slot& in_slot);
+    void* at(const Slot& in_slot, unsigned in_type) const;
+    std::size_t rows(const Archetype& in_archetype, std::size_t in_chunk) const;
+
+    std::vector<Archetype*> m_archetypes;
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_free;
+    std::size_t m_nAlive;
+
+    /// The chunks a parallel eachChunk goes through.
+    std::vector<std::pair<const Archetype*, std::size_t>> m_jobs;
+};
+
+#include "Entities.inl"
+
+}
@@ -0,0 +1,142 @@
+template<class T>
+unsigned Entities::type()
+{
+    // Registered once, on first use, which may be by any thread.
+    static const Type t = { sizeof(T), std::alignment_of<T>::value, &Entities::relocate<T>, &Entities::destroy<T> };
+    static const unsigned id = Entities::registerType(t);
+    return id;
+}
+
+template<class T>
+void Entities::relocate(void* out_dst, void* io_src)
+{
+    T* pSrc = static_cast<T*>(io_src);
+    new(out_dst) T(std::move(*pSrc));
+    pSrc->~T();
+}
+
+template<class T>
+void Entities::destroy(void* io_p)
+{
+    static_cast<T*>(io_p)->~T();
+}
+
+template<class... Cs>
+Entities::Mask Entities::mask()
+{
+    const unsigned types[] = { 0, Entities::type<Cs>()... };
+    Mask m = 0;
+    for(std::size_t i = 1 ; i < sizeof(types) / sizeof(types[0]) ; ++i) {
+        m |= Mask(1) << types[i];
+    }
+    return m;
+}
+
+template<class C, class... Cs>
+Entity Entities::create(C in_component, Cs... in_components)
+{
+    const Entity e = this->allocate(this->archetype(Entities::mask<C, Cs...>()));
+    const Slot& s = m_slots[e.index];
+    new(this->at(s, Entities::type<C>())) C(std::move(in_component));
+    const int constructed[] = { 0, (new(this->at(s, Entities::type<Cs>())) Cs(std::move(in_components)), 0)... };
+    (void)constructed;
+    return e;
+}
+
+template<class T>
+T* Entities::get(Entity in_entity)
+{
+    return const_cast<T*>(static_cast<const Entities*>(this)->get<T>(in_entity));
+}
+
+template<class T>
+const T* Entities::get(Entity in_entity) const
+{
+    if(!this->alive(in_entity))
+        return 0;
+    const Slot& s = m_slots[in_entity.index];
+    return static_cast<const T*>(this->at(s, Entities::type<T>()));
+}
+
+template<class T>
+T& Entities::add(Entity in_entity, T in_component)
+{
+    if(T* p = this->get<T>(in_entity)) {
+        *p = std::move(in_component);
+        return *p;
+    }
+
+    Slot& s = m_slots[in_entity.index];
+    this->migrate(s, this->archetype(m_archetypes[s.archetype]->mask | Entities::mask<T>()));
+    return *new(this->at(s, Entities::type<T>())) T(std::move(in_component));
+}
+
+template<class T>
+void Entities::remove(Entity in_entity)
+{
+    if(!this->get<T>(in_entity))
+        return;
+
+    Slot& s = m_slots[in_entity.index];
+    this->migrate(s, this->archetype(m_archetypes[s.archetype]->mask & ~Entities::mask<T>()));
+}
+
+template<class F, class... Ps>
+void Entities::run(F& in_f, std::size_t in_n, const Entity* in_entities, Ps*... in_components)
+{
+    for(std::size_t i = 0 ; i < in_n ; ++i) {
+        in_f(in_entities[i], in_components[i]...);
+    }
+}
+
+template<class... Cs, class F>
+void Entities::each(F in_f)
+{
+    const Mask m = Entities::mask<Cs...>();
+    for(std::size_t a = 0 ; a < m_archetypes.size() ; ++a) {
+        const Archetype& arch = *m_archetypes[a];
+        if((arch.mask & m) != m)
+            continue;
+        for(std::size_t c = 0 ; c < arch.chunks.size() ; ++c) {
+            unsigned char* pChunk = arch.chunks[c];
+            Entities::run(in_f, this->rows(arch, c), reinterpret_cast<const Entity*>(pChunk),
+                          reinterpret_cast<Cs*>(pChunk + arch.offsets[arch.column[Entities::type<Cs>()]])...);
+        }
+    }
+}
+
+template<class... Cs, class F>
+void Entities::eachChunk(ThreadPool& io_workers, F in_f)
+{
+    const Mask m = Entities::mask<Cs...>();
+    m_jobs.clear();
+    for(std::size_t a = 0 ; a < m_archetypes.size() ; ++a) {
+        if((m_archetypes[a]->mask & m) != m)
+            continue;
+        for(std::size_t c = 0 ; c < m_archetypes[a]->chunks.size() ; ++c) {
+            m_jobs.push_back(std::make_pair(m_archetypes[a], c));
+        }
+    }
+
+    // A chunk is plenty of work already.
+    io_workers.parallelFor(m_jobs.size(), [this, &in_f](std::size_t in_begin, std::size_t in_end, unsigned in_worker) {
+        for(std::size_t j = in_begin ; j < in_end ; ++j) {
+            const Archetype& arch = *m_jobs[j].first;
+            unsigned char* pChunk = arch.chunks[m_jobs[j].second];
+            in_f(in_worker, this->rows(arch, m_jobs[j].second), reinterpret_cast<const Entity*>(pChunk),
+                 reinterpret_cast<Cs*>(pChunk + arch.offsets[arch.column[Entities::type<Cs>()]])...);
+        }
+    }, 1);
+}
+
+template<class... Cs>
+std::size_t Entities::count() const
+{
+    const Mask m = Entities::mask<Cs...>();
+    std::size_t n = 0;
+    for(std::size_t a = 0 ; a < m_archetypes.size() ; ++a) {
+        if((m_archetypes[a]->mask & m) == m)
+            n += m_archetypes[a]->count;
+    }
+    return n;
+}
@@ -1,75 +1,54 @@
 #pragma once
 
-#include "GameClock.h"
-
 #include "3d/Math/Vector.h"
 #include "3d/Math/Matrix.h"
 
-namespace RoadRage {
-
-class VisibleEntity {
-public:
-    VisibleEntity(Vector in_pos, float in_orientation = 0.0f, Vector in_scale = Vector(1.0f, 1.0f, 1.0f));
-    virtual ~VisibleEntity();
-
-    virtual void render(const GameClock& in_clock, const General4x4Matrix& in_viewProj) = 0;
-
-    Vector pos() const;
-    VisibleEntity& pos(Vector v);
-    float ori() const;
-    VisibleEntity& ori(float v);
-    Vector scale() const;
-    VisibleEntity& scale(Vector v);
+#include <stdint.h>
 
-protected:
-    AffineMatrix getModelMatrix() const;
+namespace RoadRage {
 
-private:
-    VisibleEntity& recalcCachedModelMatrix();
+/// Tells one of the Entities apart from all others, even from the ones that
+/// were there before: once an entity is gone, its index gets reused with the
+/// next generation, so that handles to the old one don't find the new one.
+struct Entity {
+    uint32_t index;
+    uint32_t generation;
 
-    Vector m_position;
-    float m_fOrientation;
-    Vector m_scale;
+    /// No entity at all.
+    Entity() : index(0xffffffffu), generation(0) {}
+    Entity(uint32_t in_index, uint32_t in_generation) : index(in_index), generation(in_generation) {}
 
-    AffineMatrix m_cachedModelMatrix;
+    bool operator==(const Entity& o) const { return index == o.index && generation == o.generation; }
+    bool operator!=(const Entity& o) const { return !this->operator==(o); }
+    bool operator<(const Entity& o) const { return index < o.index || (index == o.index && generation < o.generation); }
 };
 
-class ThinkingEntity {
-public:
-    ThinkingEntity();
-    virtual ~ThinkingEntity();
+/// Where an entity is, which way it faces and how big it is.
+struct Transform {
+    Transform(const Vector& in_pos = Vector(), float in_fOri = 0.0f, const Vector& in_scale = Vector(1.0f, 1.0f, 1.0f));
 
-    virtual void think(const GameClock& in_clock) = 0;
-};
+    /// \return The entity's model matrix.
+    AffineMatrix matrix() const;
 
-class MobileEntity : public VisibleEntity, public ThinkingEntity {
-public:
-    MobileEntity(Vector in_pos, Vector in_vel, Vector in_accel = Vector(0.0f, 0.0f, 0.0f), float in_orientation = 0.0f, float in_angularVel = 0.0f, float in_angularAccel = 0.0f, Vector in_scale = Vector(1.0f, 1.0f, 1.0f), Vector in_scaleVel = Vector(0.0f, 0.0f, 0.0f), Vector in_scaleAccel = Vector(0.0f, 0.0f, 0.0f));
-    virtual ~MobileEntity();
+    Vector pos;
+    /// Around the Y axis, in radians, within a turn either way.
+    float ori;
+    Vector scale;
+};
 
-    virtual void think(const GameClock& in_clock);
-    virtual void render(const GameClock& in_clock, const General4x4Matrix& in_viewProj) = 0;
+/// How an entity moves on its own, if nothing else moves it.
+struct Motion {
+    Motion(const Vector& in_vel = Vector(), float in_fAngularVel = 0.0f);
 
-    Vector vel() const;
-    MobileEntity& vel(Vector v);
-    Vector accel() const;
-    MobileEntity& accel(Vector v);
-    float angularVel() const;
-    MobileEntity& angularVel(float v);
-    float angularAccel() const;
-    MobileEntity& angularAccel(float v);
-    Vector scaleVel() const;
-    MobileEntity& scaleVel(Vector v);
-    Vector scaleAccel() const;
-    MobileEntity& scaleAccel(Vector v);
+    /// Moves \a io_transform on by \a in_fDeltaT seconds.
+    void move(Transform& io_transform, float in_fDeltaT) const;
 
-private:
-    Vector m_velocity;
-    Vector m_acceleration;
-    float m_fAngularVelocity;
-    float m_fAngularAcceleration;
-    Vector m_scaleVelocity;
-    Vector m_scaleAcceleration;
+    Vector vel;
+    /// In radians per second.
+    float angularVel;
 };
 
+/// \return \a in_fAngle, whole turns taken off until it's within one turn either way.
+float wrapAngle(float in_fAngle);
+
 }
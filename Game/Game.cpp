@@ -1,24 +1,62 @@
 #include "Game.h"
 
 #include "Utilities/String.h"
+#include "Utilities/i18n.h"
 
-#include <SFML/Graphics/Text.hpp>
+#include <SFML/System/Clock.hpp>
+
+#include <cstdlib>
+#include <stdexcept>
 
 using namespace RoadRage;
 
-Game::Game(Level::Ptr in_pLevel, const sf::Input& in_input)
+/// Entities farther away from the camera than this don't get a label, in m.
+#define D_ENTITY_LABEL_DISTANCE 100.0f
+
+Game::Game(const Configuration& in_settings, Level::Ptr in_pLevel, const sf::Input& in_input, Client* in_pClient)
     : m_clock()
     , m_pLevel(in_pLevel)
     , m_input(in_input)
+    , m_pClient(in_pClient)
+    , m_pSession(in_pClient ? new Session(in_settings, *in_pClient, in_pLevel->world()) : 0)
+    , m_pFont(new Font())
+    , m_text(in_pLevel->shaderManager(), m_pFont)
+    , m_hud(m_text.add(std::string(), 0.0f, 0.0f))
+    , m_fTextTime(0.0f)
+    , m_bEntityLabels(to<bool>(in_settings.get("EntityLabels")))
 {
+    const std::size_t nBenchmark = to<std::size_t>(in_settings.get("TextBenchmarkLabels"));
+    for(std::size_t i = 0 ; i < nBenchmark ; ++i) {
+        m_benchmarkLabels.push_back(m_text.add("Label " + to_s(i), 0.0f, 0.0f, Vector(1.0f, 1.0f, 0.0f)));
+    }
 }
 
 void Game::think()
 {
     m_clock.tick();
 
-    m_pLevel->avatar().input(m_input);
+    CarInput input;
+    if(m_input.IsKeyDown(sf::Key::Left))
+        input.steering = 1;
+    else if(m_input.IsKeyDown(sf::Key::Right))
+        input.steering = -1;
+    if(m_input.IsKeyDown(sf::Key::Up))
+        input.pedals = 1;
+    else if(m_input.IsKeyDown(sf::Key::Down))
+        input.pedals = -1;
+
+    // On a server, the world is however it says it is, but for the avatar,
+    // which is ahead of it.
+    if(m_pSession) {
+        if(m_pClient->lost())
+            throw std::runtime_error(_("Lost the connection to the server."));
+        m_pSession->think(m_clock.deltaT(), input);
+    } else {
+        m_pLevel->avatar().control(input);
+    }
     m_pLevel->think(m_clock);
+    if(m_pSession)
+        m_pSession->apply();
 }
 
 void Game::render(sf::RenderTarget& in_rt)
@@ -43,5 +81,97 @@ void Game::render(sf::RenderTarget& in_rt)
         "Avatar speed: " + to_s(avatar.speed()) + " (" + to_s(avatar.speed()*ms2kmh) + "km/h)" + "\n" +
         "Avatar pos: " + avatar.pos().to_s() + " (m,m,m)\n" +
         "Avatar state: " + state + "\n";
-    in_rt.Draw(sf::Text(sDbg));
+
+    const RenderQueue& queue = m_pLevel->renderQueue();
+    sDbg += "Draws: " + to_s(queue.drawCount()) + ", packets: " + to_s(queue.packetCount()) + ", culled: " + to_s(queue.culledCount()) + " (" + to_s(queue.occludedCount()) + " occluded)\n";
+    sDbg += "LODs:";
+    for(unsigned i = 0 ; i < D_MAX_LODS ; ++i) {
+        sDbg += " " + to_s(queue.lodCount(i));
+    }
+    sDbg += "\n";
+    const Traffic& traffic = m_pLevel->traffic();
+    const RoutePlanner& routes = m_pLevel->routes();
+    sDbg += "Traffic: " + to_s(traffic.cars().size()) + " cars, " + to_s(traffic.active()) + " active, "
+          + to_s(traffic.decisions()) + " decisions in "
+          + to_s(traffic.decisionTime() * 1000.0f) + "ms, " + to_s(traffic.time() * 1000.0f) + "ms total, routes "
+          + to_s(routes.hits()) + " cached/" + to_s(routes.misses()) + " searched\n";
+    if(m_pSession) {
+        const Prediction& prediction = m_pSession->prediction();
+        sDbg += "Server: player " + to_s(m_pClient->player()) + " of " + to_s(m_pLevel->world().players().size())
+              + ", tick " + to_s(m_pSession->snapshot().tick) + ", " + to_s(m_pClient->bytesReceived() / 1024) + "kB in, "
+              + to_s(m_pClient->bytesSent() / 1024) + "kB out\n";
+        sDbg += "Prediction: " + to_s(prediction.pending()) + " ticks ahead, " + to_s(prediction.corrections())
+              + " corrections, " + to_s(prediction.error()) + "m off last, worst replay " + to_s(prediction.worstReplay())
+              + " ticks in " + to_s(prediction.worstReplayTime() * 1000.0f) + "ms\n";
+    }
+    sDbg += "Text: " + to_s(m_text.labelCount()) + " labels, " + to_s(m_text.glyphCount()) + " glyphs, "
+          + to_s(m_text.rebuildCount()) + " rebuilds, " + to_s(m_text.patchCount()) + " patches, "
+          + to_s(m_fTextTime * 1000.0f) + "ms\n";
+
+    sf::Clock clock;
+    if(m_bEntityLabels)
+        this->updateEntityLabels(in_rt.GetWidth(), in_rt.GetHeight());
+    if(!m_benchmarkLabels.empty())
+        this->updateBenchmarkLabels(in_rt.GetWidth(), in_rt.GetHeight());
+
+    // All text on screen goes out in a single draw.
+    m_text.text(m_hud, sDbg);
+    m_text.draw(in_rt.GetWidth(), in_rt.GetHeight());
+    m_fTextTime = clock.GetElapsedTime();
+}
+
+void Game::updateEntityLabels(unsigned in_w, unsigned in_h)
+{
+    const General4x4Matrix viewProj = m_pLevel->camera();
+    const float* m = viewProj.array16f();
+
+    // Entities keep their label as long as they stay in view, the ones that
+    // left get theirs removed afterwards.
+    std::map<Entity, TextRenderer::Label> seen;
+    m_pLevel->world().entities().each<Transform>([this, m, in_w, in_h, &seen](Entity in_entity, const Transform& in_transform) {
+        const Vector& p = in_transform.pos;
+        const float w = m[3]*p.x() + m[7]*p.y() + m[11]*p.z() + m[15];
+        if(w < 0.1f || w > D_ENTITY_LABEL_DISTANCE)
+            return;
+
+        const float x = (m[0]*p.x() + m[4]*p.y() + m[8]*p.z() + m[12]) / w;
+        const float y = (m[1]*p.x() + m[5]*p.y() + m[9]*p.z() + m[13]) / w;
+        if(x < -1.0f || x > 1.0f || y < -1.0f || y > 1.0f)
+            return;
+
+        // Whole meters, so that the text only changes once in a while.
+        const std::string sText = to_s(static_cast<int>(p.x())) + " " + to_s(static_cast<int>(p.z()));
+
+        TextRenderer::Label label;
+        auto old = m_entityLabels.find(in_entity);
+        if(old != m_entityLabels.end()) {
+            label = old->second;
+            m_entityLabels.erase(old);
+            m_text.text(label, sText);
+        } else if(m_text.labelCount() < D_MAX_LABELS) {
+            label = m_text.add(sText);
+        } else {
+            return;
+        }
+
+        m_text.pos(label, (x * 0.5f + 0.5f) * in_w, (0.5f - y * 0.5f) * in_h);
+        seen[in_entity] = label;
+    });
+
+    for(auto i = m_entityLabels.begin() ; i != m_entityLabels.end() ; ++i) {
+        m_text.remove(i->second);
+    }
+    m_entityLabels.swap(seen);
+}
+
+void Game::updateBenchmarkLabels(unsigned in_w, unsigned in_h)
+{
+    // Everything moves every frame, like labels over moving entities would,
+    // and one of them changes its text, without outgrowing its slot.
+    for(auto i = m_benchmarkLabels.begin() ; i != m_benchmarkLabels.end() ; ++i) {
+        m_text.pos(*i, static_cast<float>(std::rand() % in_w), static_cast<float>(std::rand() % in_h));
+    }
+
+    const std::size_t i = std::rand() % m_benchmarkLabels.size();
+    m_text.text(m_benchmarkLabels[i], (std::rand() % 2 ? "Label " : "LABEL ") + to_s(i));
 }
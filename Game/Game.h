@@ -3,24 +3,53 @@
 #include "GameClock.h"
 #include "Level.h"
 
+#include "Net/Client.h"
+#include "Net/Session.h"
+
+#include "3d/Font.h"
+#include "3d/TextRenderer.h"
+#include "Conf/Configuration.h"
+
 #include <SFML/Window/Input.hpp>
 #include <SFML/Graphics/RenderTarget.hpp>
 
+#include <map>
+#include <memory>
+#include <vector>
+
 namespace RoadRage {
 
 class Game {
 public:
-    Game(Level::Ptr in_pLevel, const sf::Input& in_input);
+    /// \param in_pClient When playing on a server, the connection to it, which
+    ///                   has to outlive the game. Otherwise, 0.
+    Game(const Configuration& in_settings, Level::Ptr in_pLevel, const sf::Input& in_input, Client* in_pClient = 0);
 
     void think();
     void render(sf::RenderTarget& in_rt);
 
 private:
+    void updateEntityLabels(unsigned in_w, unsigned in_h);
+    void updateBenchmarkLabels(unsigned in_w, unsigned in_h);
+
     GameClock m_clock;
 
     Level::Ptr m_pLevel;
 
     const sf::Input& m_input;
+
+    Client* m_pClient;
+    std::unique_ptr<Session> m_pSession;
+
+    Font::Ptr m_pFont;
+    TextRenderer m_text;
+    TextRenderer::Label m_hud;
+    /// How long drawing all text took on the CPU last frame, in seconds.
+    float m_fTextTime;
+
+    bool m_bEntityLabels;
+    std::map<Entity, TextRenderer::Label> m_entityLabels;
+    std::vector<TextRenderer::Label> m_benchmarkLabels;
 };
 
 }
@@ -15,6 +15,12 @@ void GameClock::tick()
     m_fNow = m_clock.GetElapsedTime();
 }
 
+void GameClock::tick(float in_fDeltaT)
+{
+    m_fLastTick = m_fNow;
+    m_fNow += in_fDeltaT;
+}
+
 float GameClock::deltaT() const
 {
     return m_fNow - m_fLastTick;
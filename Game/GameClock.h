@@ -8,6 +8,9 @@ public:
     GameClock();
 
     void tick();
+    /// Moves on by exactly \a in_fDeltaT seconds instead, whatever the time
+    /// really is, for simulating at a fixed rate.
+    void tick(float in_fDeltaT);
 
     float deltaT() const;
     float now() const;
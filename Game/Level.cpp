@@ -2,48 +2,61 @@
 
 #include "Utilities/String.h"
 
-#include <SFML/System/Randomizer.hpp>
-
-#include <random>
 #include <functional>
 
 using namespace RoadRage;
 
-Level::Level(const Configuration& in_settings, const std::string& in_sName)
-    : m_shaderManager()
+/// The size of the cells civilians navigate on, in meters.
+#define D_NAV_CELL_SIZE 1.0f
+/// While chunks get loaded, the navigation gets rebuilt at most that often,
+/// in seconds.
+#define D_NAV_REBUILD_INTERVAL 1.0f
+
+Level::Level(const Configuration& in_settings, const FileSystem& in_fs, const std::string& in_sName, uint32_t in_avatar)
+    : m_shaderManager(in_fs)
     , m_cam(General4x4Matrix::perspectiveProjection(45.0f, to<float>(in_settings.get("Width"))
                                                          / to<float>(in_settings.get("Height"))))
-    , m_csys(m_shaderManager)
-    , m_pAvatar(new Avatar(m_shaderManager))
+    , m_debug(m_shaderManager)
+    , m_workers(to<unsigned>(in_settings.get("WorkerThreads")))
+    , m_queue(m_workers.size())
+    , m_bOcclusionCulling(to<bool>(in_settings.get("OcclusionCulling")))
+    , m_world(in_settings, in_fs, in_sName, m_workers)
+    , m_avatar(in_avatar)
+    , m_bRoadDebug(to<bool>(in_settings.get("RoadDebug")))
+    , m_civilians(m_world.entities(), m_crowd)
+    , m_nNavChunks(0)
+    , m_fNavTime(0.0f)
+    , m_iNavRadius(to<int>(in_settings.get("ChunkRadius")))
+    , m_chunks(in_fs, "Levels/" + in_sName,
+               to<float>(in_settings.get("ChunkSize")),
+               to<int>(in_settings.get("ChunkRadius")),
+               to<std::size_t>(in_settings.get("ChunkMemoryBudget"))*1024*1024,
+               m_shaderManager, m_civilians)
+    , m_fChunkUploadBudget(to<float>(in_settings.get("ChunkUploadBudget"))*0.001f)
 {
     m_cam.pos(Vector(0.5f, 1.5f, 5.0f));
 
-    // Create the randomization engine with a seed.
-    std::mt19937 engine(sf::Randomizer::GetSeed());
-    std::variate_generator<std::mt19937&, std::normal_distribution<>> generatorX(engine,std::normal_distribution<>(0.0f, 5.0f));
-    std::variate_generator<std::mt19937&, std::normal_distribution<>> generatorY(engine,std::normal_distribution<>(0.0f, 5.0f));
-    std::variate_generator<std::mt19937&, std::normal_distribution<>> generatorVelZ(engine,std::normal_distribution<>(0.0f, 1.0f));
-    std::variate_generator<std::mt19937&, std::normal_distribution<>> generatorOri(engine,std::normal_distribution<>(0.0f, 30.0f*deg2rad));
-    std::variate_generator<std::mt19937&, std::normal_distribution<>> generatorOriVel(engine,std::normal_distribution<>(0.0f, 30.0f*deg2rad));
-
-    // This causes an endless loop somehow, even though it should work according to manuals.
-//     auto r_norm = std::bind(rand_norm, eng);
-
-    for(int i = 0 ; i < 20 ; ++i) {
-        Vector pos(generatorX(), generatorY(), -5.0f);
-/*        Vector vel(0.0f, 0.0f, generatorVelZ());
-        float ori = generatorOri();
-        float oriVel = generatorOriVel();*/
-        Vector vel(0.0f, 0.0f, 0.0f);
-        float ori = 0.0f;
-        float oriVel = 0.0f;
-        m_civs.push_back(new Civilian(pos, vel, ori, oriVel, m_shaderManager));
-    }
+    if(to<bool>(in_settings.get("ShaderHotReload")))
+        m_shaderManager.enableHotReload();
+
+    m_occlusion.debug(to<bool>(in_settings.get("OcclusionDebug")));
+
+    m_world.addPlayer(m_avatar);
+    m_carModel.addLevel(std::make_shared<BoxModel>(m_shaderManager), 0.02f)
+              .addLevel(std::make_shared<ImpostorModel>(m_shaderManager, Vector(0.8f, 0.8f, 0.9f)), 0.0f);
+    m_playerModel.addLevel(std::make_shared<BoxModel>(m_shaderManager), 0.02f)
+                 .addLevel(std::make_shared<ImpostorModel>(m_shaderManager, Vector(1.0f, 0.0f, 0.0f)), 0.0f);
+    // Civilians are many and small, so they quickly become impostors.
+    m_civilianModel.addLevel(std::make_shared<BoxModel>(m_shaderManager), 0.05f)
+                   .addLevel(std::make_shared<ImpostorModel>(m_shaderManager, Vector(1.0f, 0.0f, 0.0f)), 0.0f);
+
+    // Already start loading the surroundings of the avatar.
+    m_chunks.update(this->avatar().pos());
 }
 
-Level::Ptr Level::load(const Configuration& in_settings, const std::string& in_sName)
+Level::Ptr Level::load(const Configuration& in_settings, const FileSystem& in_fs, const std::string& in_sName, uint32_t in_avatar)
 {
-    return Level::Ptr(new Level(in_settings, in_sName));
+    return Level::Ptr(new Level(in_settings, in_fs, in_sName, in_avatar));
 }
 
 void Level::think(const GameClock& clock)
@@ -52,42 +65,187 @@ void Level::think(const GameClock& clock)
 //     m_cam.orbitCenter(Vector(5.0f, 0.0f, 0.0f));
 //     m_cam.orbit(Quaternion::rotation(0.0f, 1.0f, 0.0f, clock.now()*speed*deg2rad));
 
-    m_pAvatar->think(clock);
+    // Bring the shaders that finished compiling in the background to use.
+    m_shaderManager.update();
+
+    // The players and the traffic, which keeps out of their way, if it can.
+    m_world.think(clock);
+    const Avatar& avatar = this->avatar();
 
     // Follow the avatar.
     m_cam.pos(Vector(0.0f, 0.0f, 10.0f));
-    m_cam.orbitCenter(m_pAvatar->pos());
+    m_cam.orbitCenter(avatar.pos());
 
     // And the height/angle of the camera is dependend on the avatar's speed.
     const float fMinAngle = 25.0f*deg2rad;
     const float fMaxAngle = 45.0f*deg2rad;
-    float fSpeedPercent = m_pAvatar->speed() / m_pAvatar->maxSpeed();
+    float fSpeedPercent = avatar.speed() / avatar.maxSpeed();
     float fAngle = lerp(fMaxAngle, fMinAngle, clamp(fSpeedPercent*1.5f, 0.0f, 1.0f));
     m_cam.orbit(Quaternion::rotation(1.0f, 0.0f, 0.0f, -fAngle));
 
-    for(auto i = m_civs.begin() ; i != m_civs.end() ; ++i) {
-        (*i)->think(clock);
+    // Keep the world around the avatar loaded.
+    m_chunks.update(avatar.pos());
+    m_chunks.finalize(m_fChunkUploadBudget);
+
+    // The civilians walk all together, as a crowd. The ones that just came
+    // to life join it first.
+    this->updateNavigation(clock);
+    m_civilians.join();
+    m_crowd.step(clock.deltaT(), m_workers);
+    m_civilians.think(clock, m_workers);
+}
+
+void Level::updateNavigation(const GameClock& clock)
+{
+    const float fChunkSize = m_chunks.chunkSize();
+    const ChunkCoord center = ChunkCoord::fromWorld(this->avatar().pos(), fChunkSize);
+    std::size_t nChunks = 0;
+    for(auto i = m_chunks.chunks().begin() ; i != m_chunks.chunks().end() ; ++i) {
+        if(i->second->finalized())
+            ++nChunks;
     }
+
+    // Moving to another chunk moves the whole grid, which can't wait. New
+    // buildings coming to life can, for a bit.
+    const bool bMoved = center != m_navCenter || m_crowd.fields().empty();
+    const bool bChanged = nChunks != m_nNavChunks && clock.now() - m_fNavTime >= D_NAV_REBUILD_INTERVAL;
+    if(!bMoved && !bChanged)
+        return;
+
+    m_navCenter = center;
+    m_nNavChunks = nChunks;
+    m_fNavTime = clock.now();
+
+    // The grid covers all chunks that may be loaded.
+    const int r = m_iNavRadius;
+    const unsigned nCells = static_cast<unsigned>((2*r + 1) * fChunkSize / D_NAV_CELL_SIZE);
+    NavGrid grid;
+    grid.reset((center.x - r) * fChunkSize, (center.z - r) * fChunkSize, nCells, nCells, D_NAV_CELL_SIZE);
+    for(auto i = m_chunks.chunks().begin() ; i != m_chunks.chunks().end() ; ++i) {
+        const std::vector<Building*>& buildings = i->second->buildings();
+        for(auto j = buildings.begin() ; j != buildings.end() ; ++j) {
+            grid.block((*j)->occluder().min, (*j)->occluder().max);
+        }
+    }
+
+    // People walk between the crossings of every other street, which are
+    // at the corners of the chunks. Their amount stays the same.
+    std::vector<Vector> goals;
+    for(int x = -r ; x <= r ; x += 2) {
+        for(int z = -r ; z <= r ; z += 2) {
+            goals.push_back(Vector((center.x + x) * fChunkSize, 0.0f, (center.z + z) * fChunkSize));
+        }
+    }
+    m_crowd.navigation(grid, goals, m_workers);
 }
 
 void Level::render(const GameClock& clock)
 {
-    m_csys.render(m_cam);
-
-    m_pAvatar->render(clock, m_cam);
+    m_frameUniforms.update(m_cam, clock.now());
+
+    m_carLods.resize(m_world.traffic().cars().size());
+
+    m_visible.clear();
+    m_occluders.clear();
+    for(auto i = m_chunks.chunks().begin() ; i != m_chunks.chunks().end() ; ++i) {
+        const std::vector<Building*>& buildings = i->second->buildings();
+        m_visible.insert(m_visible.end(), buildings.begin(), buildings.end());
+        for(auto j = buildings.begin() ; j != buildings.end() ; ++j) {
+            m_occluders.push_back((*j)->occluder());
+        }
+    }
 
-    // TODO: Only those on screen?
-    for(auto i = m_civs.begin() ; i != m_civs.end() ; ++i) {
-        (*i)->render(clock, m_cam);
+    // The occluders are rasterized first, which the workers share as well.
+    if(m_bOcclusionCulling)
+        m_occlusion.render(m_cam, m_occluders, m_workers);
+
+    // Culling and building the packets is spread over the workers, each one
+    // filling its own command list. Only the drawing is left to this thread.
+    m_queue.begin(m_cam, m_bOcclusionCulling ? &m_occlusion : 0);
+    m_workers.parallelFor(m_visible.size(), [this](std::size_t in_begin, std::size_t in_end, unsigned in_worker) {
+        CommandList& cmds = m_queue.list(in_worker);
+        for(std::size_t i = in_begin ; i < in_end ; ++i) {
+            m_visible[i]->submit(cmds);
+        }
+    }, 256);
+    Entities& entities = m_world.entities();
+    entities.eachChunk<Transform, Driver>(m_workers, [this](unsigned in_worker, std::size_t in_n, const Entity*, Transform* in_transforms, Driver* in_drivers) {
+        CommandList& cmds = m_queue.list(in_worker);
+        for(std::size_t i = 0 ; i < in_n ; ++i) {
+            m_carModel.submit(cmds, in_transforms[i].matrix(), m_carLods[in_drivers[i].id]);
+        }
+    });
+    entities.eachChunk<Transform, Civilian, LodState>(m_workers, [this](unsigned in_worker, std::size_t in_n, const Entity*, Transform* in_transforms, Civilian*, LodState* io_lods) {
+        CommandList& cmds = m_queue.list(in_worker);
+        for(std::size_t i = 0 ; i < in_n ; ++i) {
+            m_civilianModel.submit(cmds, in_transforms[i].matrix(), io_lods[i]);
+        }
+    });
+
+    // The few players are left to this thread, too.
+    const std::map<uint32_t, Avatar>& players = m_world.players();
+    for(auto i = m_playerLods.begin() ; i != m_playerLods.end() ; ) {
+        if(players.count(i->first) == 0)
+            m_playerLods.erase(i++);
+        else
+            ++i;
+    }
+    for(auto i = players.begin() ; i != players.end() ; ++i) {
+        const Transform& t = *entities.get<Transform>(i->second.entity());
+        m_playerModel.submit(m_queue.list(0), t.matrix(), m_playerLods[i->first]);
     }
+
+    m_queue.execute();
+
+    if(m_bRoadDebug)
+        m_world.roads().debugDraw(this->avatar().pos(), 100.0f);
+
+    // The world's coordinate system, and whatever else got debug-drawn.
+    debugAxes(AffineMatrix(), 2.0f);
+    m_debug.flush();
 }
 
 Avatar& Level::avatar()
 {
-    return *m_pAvatar;
+    return *m_world.player(m_avatar);
 }
 
 const Avatar& Level::avatar() const
 {
-    return *m_pAvatar;
+    return *m_world.player(m_avatar);
+}
+
+const RenderQueue& Level::renderQueue() const
+{
+    return m_queue;
+}
+
+const Camera& Level::camera() const
+{
+    return m_cam;
+}
+
+ShaderManager& Level::shaderManager()
+{
+    return m_shaderManager;
+}
+
+World& Level::world()
+{
+    return m_world;
+}
+
+const RoadNetwork& Level::roads() const
+{
+    return m_world.roads();
+}
+
+RoutePlanner& Level::routes()
+{
+    return m_world.routes();
+}
+
+const Traffic& Level::traffic() const
+{
+    return m_world.traffic();
 }
@@ -1,16 +1,27 @@
 #pragma once
 
 #include "Avatar.h"
+#include "ChunkStreamer.h"
 #include "Civilian.h"
+#include "Crowd.h"
 #include "GameClock.h"
+#include "World.h"
 
 #include "3d/Camera.h"
+#include "3d/DebugDraw.h"
+#include "3d/LodModel.h"
+#include "3d/OcclusionBuffer.h"
 #include "3d/Shader.h"
+#include "3d/RenderQueue.h"
+#include "3d/UniformBuffer.h"
 #include "Conf/Configuration.h"
+#include "Utilities/FileSystem.h"
+#include "Utilities/ThreadPool.h"
 
+#include <map>
 #include <string>
 #include <memory>
-#include <list>
+#include <vector>
 
 namespace RoadRage {
 
@@ -18,23 +29,77 @@ class Level {
 public:
     typedef std::shared_ptr<Level> Ptr;
 
-    static Level::Ptr load(const Configuration& in_settings, const std::string& in_sName);
+    /// \param in_avatar The id of the local player.
+    static Level::Ptr load(const Configuration& in_settings, const FileSystem& in_fs, const std::string& in_sName, uint32_t in_avatar = 0);
 
     virtual void think(const GameClock& clock);
     virtual void render(const GameClock& clock);
 
     Avatar& avatar();
     const Avatar& avatar() const;
+    /// For the stats of the last frame.
+    const RenderQueue& renderQueue() const;
+    const Camera& camera() const;
+    ShaderManager& shaderManager();
+    World& world();
+    const RoadNetwork& roads() const;
+    RoutePlanner& routes();
+    const Traffic& traffic() const;
 
 protected:
-    Level(const Configuration& in_settings, const std::string& in_sName);
+    Level(const Configuration& in_settings, const FileSystem& in_fs, const std::string& in_sName, uint32_t in_avatar);
+
+    void updateNavigation(const GameClock& clock);
 
     ShaderManager m_shaderManager;
     Camera m_cam;
-    CsysModel m_csys;
+    DebugRenderer m_debug;
+    /// Shared by everything that has work to spread over the cores.
+    ThreadPool m_workers;
+    FrameUniforms m_frameUniforms;
+    /// One command list per worker.
+    RenderQueue m_queue;
+    /// The buildings that get submitted to the queue this frame, gathered up
+    /// front so that the workers can split them among themselves. The
+    /// entities are gone through by chunks for that.
+    std::vector<const Building*> m_visible;
+    /// Buildings hide what's behind them, before it even gets submitted.
+    OcclusionBuffer m_occlusion;
+    std::vector<Occluder> m_occluders;
+    bool m_bOcclusionCulling;
+
+    /// The roads, the traffic and all players, the local one being m_avatar.
+    World m_world;
+    uint32_t m_avatar;
+    bool m_bRoadDebug;
+
+    /// All cars look alike, so they get drawn with the same models, the
+    /// traffic first and the players last, rather than each with its own.
+    LodModel m_carModel;
+    LodModel m_playerModel;
+    /// The traffic's by the cars' ids, only ever touched by the one worker
+    /// submitting that car.
+    std::vector<LodState> m_carLods;
+    std::map<uint32_t, LodState> m_playerLods;
+    /// The same goes for the civilians, whose LodState is a component.
+    LodModel m_civilianModel;
+
+    /// Moves all civilians. Declared before the chunks, as the civilians
+    /// leave it when the chunks die.
+    Crowd m_crowd;
+    /// All civilians, which live among the world's entities.
+    Civilians m_civilians;
+    /// The chunk the crowd's navigation is centered on.
+    ChunkCoord m_navCenter;
+    /// How many chunks were finalized when the navigation got built, and when.
+    std::size_t m_nNavChunks;
+    float m_fNavTime;
+    int m_iNavRadius;
 
-    Avatar* m_pAvatar;
-    std::list<Civilian*> m_civs;
+    /// The world around the avatar, which contains all civilians.
+    ChunkStreamer m_chunks;
+    /// Time per frame we may spend on bringing new chunks to life, in seconds.
+    float m_fChunkUploadBudget;
 };
 
 }
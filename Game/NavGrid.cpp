@@ -0,0 +1,136 @@
+#include "NavGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace RoadRage;
+
+// The eight neighbours of a cell, counter-clockwise starting at +x, as seen
+// from above. The ninth "direction" is standing still.
+static const int g_dx[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+static const int g_dz[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+// The cost of going there, about ten times the distance.
+static const uint32_t g_cost[8] = { 10, 14, 10, 14, 10, 14, 10, 14 };
+#define D_FLOW_MAX_STEP 14
+
+#define D_SQRT_HALF 0.70710678f
+const float FlowField::s_dirX[9] = { 1.0f, D_SQRT_HALF, 0.0f, -D_SQRT_HALF, -1.0f, -D_SQRT_HALF, 0.0f, D_SQRT_HALF, 0.0f };
+const float FlowField::s_dirZ[9] = { 0.0f, D_SQRT_HALF, 1.0f, D_SQRT_HALF, 0.0f, -D_SQRT_HALF, -1.0f, -D_SQRT_HALF, 0.0f };
+
+NavGrid::NavGrid()
+    : m_x0(0.0f)
+    , m_z0(0.0f)
+    , m_fCellSize(1.0f)
+    , m_fInvCellSize(1.0f)
+    , m_w(0)
+    , m_h(0)
+{
+}
+
+void NavGrid::reset(float in_x0, float in_z0, unsigned in_w, unsigned in_h, float in_fCellSize)
+{
+    m_x0 = in_x0;
+    m_z0 = in_z0;
+    m_fCellSize = in_fCellSize;
+    m_fInvCellSize = 1.0f / in_fCellSize;
+    m_w = in_w;
+    m_h = in_h;
+    m_blocked.assign(static_cast<std::size_t>(in_w) * in_h, 0);
+}
+
+void NavGrid::block(const Vector& in_min, const Vector& in_max)
+{
+    const int x0 = std::max(0, static_cast<int>(std::floor((in_min.x() - m_x0) * m_fInvCellSize)));
+    const int z0 = std::max(0, static_cast<int>(std::floor((in_min.z() - m_z0) * m_fInvCellSize)));
+    const int x1 = std::min(static_cast<int>(m_w) - 1, static_cast<int>(std::floor((in_max.x() - m_x0) * m_fInvCellSize)));
+    const int z1 = std::min(static_cast<int>(m_h) - 1, static_cast<int>(std::floor((in_max.z() - m_z0) * m_fInvCellSize)));
+
+    for(int z = z0 ; z <= z1 ; ++z) {
+        for(int x = x0 ; x <= x1 ; ++x) {
+            m_blocked[z * m_w + x] = 1;
+        }
+    }
+}
+
+Vector NavGrid::center(unsigned in_cell) const
+{
+    return Vector(m_x0 + (static_cast<float>(in_cell % m_w) + 0.5f) * m_fCellSize, 0.0f,
+                  m_z0 + (static_cast<float>(in_cell / m_w) + 0.5f) * m_fCellSize);
+}
+
+FlowField::FlowField()
+    : m_nReachable(0)
+{
+}
+
+void FlowField::compute(const NavGrid& in_grid, const Vector& in_goal)
+{
+    const std::size_t n = in_grid.cellCount();
+    m_dirs.assign(n, 8);
+    m_nReachable = 0;
+    if(n == 0)
+        return;
+
+    // The goal may well be inside a building, or even outside of the grid.
+    unsigned goal = 0;
+    if(!in_grid.cell(in_goal.x(), in_goal.z(), goal) || in_grid.blocked(goal)) {
+        float fBest = std::numeric_limits<float>::max();
+        for(unsigned i = 0 ; i < n ; ++i) {
+            const Vector d = in_grid.center(i) - in_goal;
+            const float d2 = d.x()*d.x() + d.z()*d.z();
+            if(!in_grid.blocked(i) && d2 < fBest) {
+                fBest = d2;
+                goal = i;
+            }
+        }
+        if(in_grid.blocked(goal))
+            return;
+    }
+    m_goal = in_grid.center(goal);
+
+    // Dijkstra, going outwards from the goal. Every cell points back to the
+    // one it was reached from, which is its next step towards the goal. As
+    // no step costs more than D_FLOW_MAX_STEP, a ring of buckets, one per
+    // cost, replaces the priority queue.
+    const int w = in_grid.width(), h = in_grid.height();
+    std::vector<uint32_t> cost(n, std::numeric_limits<uint32_t>::max());
+    std::vector<unsigned> buckets[D_FLOW_MAX_STEP + 1];
+    std::size_t nOpen = 1;
+    cost[goal] = 0;
+    buckets[0].push_back(goal);
+    for(uint32_t c = 0 ; nOpen > 0 ; ++c) {
+        std::vector<unsigned>& bucket = buckets[c % (D_FLOW_MAX_STEP + 1)];
+        for(std::size_t k = 0 ; k < bucket.size() ; ++k) {
+            const unsigned cell = bucket[k];
+            --nOpen;
+            if(cost[cell] != c)
+                continue;
+
+            ++m_nReachable;
+            const int x = cell % w, z = cell / w;
+            for(unsigned d = 0 ; d < 8 ; ++d) {
+                const int nx = x + g_dx[d], nz = z + g_dz[d];
+                if(nx < 0 || nz < 0 || nx >= w || nz >= h)
+                    continue;
+
+                const unsigned next = nz * w + nx;
+                if(in_grid.blocked(next))
+                    continue;
+                // Don't cut the corners of buildings.
+                if(g_dx[d] != 0 && g_dz[d] != 0 && (in_grid.blocked(z * w + nx) || in_grid.blocked(nz * w + x)))
+                    continue;
+
+                const uint32_t nc = c + g_cost[d];
+                if(nc < cost[next]) {
+                    cost[next] = nc;
+                    // Looking back, that is the opposite direction.
+                    m_dirs[next] = static_cast<uint8_t>((d + 4) % 8);
+                    buckets[nc % (D_FLOW_MAX_STEP + 1)].push_back(next);
+                    ++nOpen;
+                }
+            }
+        }
+        bucket.clear();
+    }
+}
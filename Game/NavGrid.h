@@ -0,0 +1,82 @@
+#pragma once
+
+#include "3d/Math/Vector.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+namespace RoadRage {
+
+/// Where pedestrians may walk: a grid of square cells on the ground, each of
+/// which is either free or blocked by a building.
+class NavGrid {
+public:
+    NavGrid();
+
+    /// Makes the grid cover the \a in_w x \a in_h cells of \a in_fCellSize
+    /// meters starting at (\a in_x0, \a in_z0), all of them free.
+    void reset(float in_x0, float in_z0, unsigned in_w, unsigned in_h, float in_fCellSize);
+    /// Blocks every cell touched by the box from \a in_min to \a in_max.
+    void block(const Vector& in_min, const Vector& in_max);
+
+    /// Finds the cell containing the point (\a in_x, \a in_z).
+    /// \return false if the point lies outside of the grid.
+    bool cell(float in_x, float in_z, unsigned& out_cell) const
+    {
+        const float fx = (in_x - m_x0) * m_fInvCellSize, fz = (in_z - m_z0) * m_fInvCellSize;
+        if(!(fx >= 0.0f && fz >= 0.0f && fx < static_cast<float>(m_w) && fz < static_cast<float>(m_h)))
+            return false;
+
+        out_cell = static_cast<unsigned>(fz) * m_w + static_cast<unsigned>(fx);
+        return true;
+    }
+    bool blocked(unsigned in_cell) const { return m_blocked[in_cell] != 0; }
+    /// \return The center of \a in_cell, on the ground.
+    Vector center(unsigned in_cell) const;
+
+    unsigned width() const { return m_w; }
+    unsigned height() const { return m_h; }
+    std::size_t cellCount() const { return m_blocked.size(); }
+
+private:
+    float m_x0, m_z0;
+    float m_fCellSize, m_fInvCellSize;
+    unsigned m_w, m_h;
+    std::vector<uint8_t> m_blocked;
+};
+
+/// The way to one goal from every cell of a NavGrid. It is computed once per
+/// goal and then shared by everybody heading there, however many they are,
+/// who just follow the direction of the cell they're in.
+class FlowField {
+public:
+    FlowField();
+
+    /// Finds the shortest paths from every free cell of \a in_grid to the
+    /// free cell nearest to \a in_goal, walking in eight directions.
+    void compute(const NavGrid& in_grid, const Vector& in_goal);
+
+    /// \return The direction to walk in from \a in_cell, as a unit vector in
+    ///         (x, z), or (0, 0) at the goal and where it can't be reached.
+    void dir(unsigned in_cell, float& out_x, float& out_z) const
+    {
+        out_x = s_dirX[m_dirs[in_cell]];
+        out_z = s_dirZ[m_dirs[in_cell]];
+    }
+    /// \return The goal, as the center of its cell.
+    const Vector& goal() const { return m_goal; }
+    /// \return How many cells the goal can be reached from.
+    std::size_t reachable() const { return m_nReachable; }
+
+private:
+    /// The direction of every cell: one of the eight neighbours, or 8 for none.
+    std::vector<uint8_t> m_dirs;
+    Vector m_goal;
+    std::size_t m_nReachable;
+
+    static const float s_dirX[9];
+    static const float s_dirZ[9];
+};
+
+}
@@ -0,0 +1,702 @@
+#include "RoadNetwork.h"
+
+#include "3d/DebugDraw.h"
+#include "Utilities/i18n.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+using namespace RoadRage;
+
+#define D_ROADS_MAGIC "RRRN"
+#define D_ROADS_VERSION 1
+
+/// How far the lanes are from the middle of their street, in meters.
+#define D_LANE_OFFSET 2.0f
+/// The size of the cells of the grid for finding lanes, in meters.
+#define D_ROAD_CELL_SIZE 16.0f
+/// How much farther away a lane going the wrong way seems, in meters.
+#define D_ROAD_HEADING_PENALTY 4.0f
+/// Witness searches give up after settling that many intersections, which
+/// may add a few needless shortcuts but keeps the preprocessing quick.
+#define D_CH_WITNESS_LIMIT 64
+
+namespace {
+    const float g_inf = std::numeric_limits<float>::infinity();
+
+    /// The speed limits streets may have, in m/s: 30, 50 and 70 km/h.
+    const float g_speedLimits[] = { 30.0f / 3.6f, 50.0f / 3.6f, 70.0f / 3.6f };
+
+    typedef std::pair<float, uint32_t> Entry;
+    typedef std::greater<Entry> Later;
+
+    template<class T>
+    void write(std::ofstream& f, const std::vector<T>& in_v)
+    {
+        uint32_t count = static_cast<uint32_t>(in_v.size());
+        f.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        if(count > 0)
+            f.write(reinterpret_cast<const char*>(&in_v[0]), count*sizeof(T));
+    }
+
+    template<class T>
+    bool read(const char*& io_p, const char* in_end, std::vector<T>& out_v)
+    {
+        uint32_t count = 0;
+        if(static_cast<std::size_t>(in_end - io_p) < sizeof(count))
+            return false;
+        std::memcpy(&count, io_p, sizeof(count)); io_p += sizeof(count);
+        if(static_cast<std::size_t>(in_end - io_p) / sizeof(T) < count)
+            return false;
+
+        out_v.resize(count);
+        if(count > 0)
+            std::memcpy(&out_v[0], io_p, count*sizeof(T));
+        io_p += count*sizeof(T);
+        return true;
+    }
+}
+
+RoadNetwork::Search::Search()
+{
+}
+
+void RoadNetwork::Search::reset(std::size_t in_nNodes)
+{
+    if(m_dist[0].size() != in_nNodes) {
+        for(unsigned d = 0 ; d < 2 ; ++d) {
+            m_dist[d].assign(in_nNodes, g_inf);
+            m_prev[d].assign(in_nNodes, D_ROAD_NONE);
+            m_arc[d].assign(in_nNodes, D_ROAD_NONE);
+        }
+    } else {
+        for(auto i = m_touched.begin() ; i != m_touched.end() ; ++i) {
+            m_dist[0][*i] = m_dist[1][*i] = g_inf;
+        }
+    }
+    m_touched.clear();
+    m_open[0].clear();
+    m_open[1].clear();
+}
+
+void RoadNetwork::Search::visit(unsigned in_dir, uint32_t in_node, float in_fDist, uint32_t in_prev, uint32_t in_arc)
+{
+    if(m_dist[0][in_node] == g_inf && m_dist[1][in_node] == g_inf)
+        m_touched.push_back(in_node);
+    m_dist[in_dir][in_node] = in_fDist;
+    m_prev[in_dir][in_node] = in_prev;
+    m_arc[in_dir][in_node] = in_arc;
+}
+
+RoadNetwork::RoadNetwork()
+    : m_fMaxSpeed(1.0f)
+    , m_gridX0(0.0f)
+    , m_gridZ0(0.0f)
+    , m_gridW(0)
+    , m_gridH(0)
+{
+}
+
+RoadNetwork::~RoadNetwork()
+{
+}
+
+void RoadNetwork::generate(float in_fChunkSize, int in_iRadius, unsigned in_seed)
+{
+    // mt19937 gives the same numbers everywhere, its distributions don't.
+    std::mt19937 engine(in_seed);
+    const unsigned nSpeeds = sizeof(g_speedLimits)/sizeof(g_speedLimits[0]);
+
+    // An intersection in the middle of every crossing of two streets.
+    const int n = 2*in_iRadius + 1;
+    const float fStreet = std::min(D_STREET_WIDTH, in_fChunkSize);
+    m_nodes.resize(n*n);
+    for(int z = 0 ; z < n ; ++z) {
+        for(int x = 0 ; x < n ; ++x) {
+            Intersection& i = m_nodes[z*n + x];
+            i.x = (x - in_iRadius) * in_fChunkSize + fStreet * 0.5f;
+            i.z = (z - in_iRadius) * in_fChunkSize + fStreet * 0.5f;
+        }
+    }
+
+    // Every street has its speed limit all along.
+    std::vector<float> rows(n), columns(n);
+    for(int i = 0 ; i < n ; ++i) {
+        rows[i] = g_speedLimits[engine() % nSpeeds];
+        columns[i] = g_speedLimits[engine() % nSpeeds];
+    }
+
+    // And two lanes between every two neighbouring intersections, one each
+    // way, on the right side of the street. They end where the crossing starts.
+    m_lanes.clear();
+    auto connect = [this, fStreet](uint32_t in_a, uint32_t in_b, float in_fSpeed) {
+        const Intersection& a = m_nodes[in_a];
+        const Intersection& b = m_nodes[in_b];
+        const float len = std::sqrt((b.x - a.x)*(b.x - a.x) + (b.z - a.z)*(b.z - a.z));
+        const float dx = (b.x - a.x) / len, dz = (b.z - a.z) / len;
+        // Looking down at the ground, right of (dx, dz) is (-dz, dx).
+        const float rx = -dz * D_LANE_OFFSET, rz = dx * D_LANE_OFFSET;
+        const float cut = fStreet * 0.5f;
+
+        Lane l = { in_a, in_b,
+                   { a.x + dx*cut + rx, a.z + dz*cut + rz },
+                   { b.x - dx*cut + rx, b.z - dz*cut + rz },
+                   len - 2.0f*cut, in_fSpeed };
+        m_lanes.push_back(l);
+    };
+    for(int z = 0 ; z < n ; ++z) {
+        for(int x = 0 ; x < n ; ++x) {
+            const uint32_t id = z*n + x;
+            if(x + 1 < n) {
+                connect(id, id + 1, rows[z]);
+                connect(id + 1, id, rows[z]);
+            }
+            if(z + 1 < n) {
+                connect(id, id + n, columns[x]);
+                connect(id + n, id, columns[x]);
+            }
+        }
+    }
+
+    m_rank.clear();
+    m_upFirst.clear(); m_downFirst.clear();
+    m_up.clear(); m_down.clear();
+    this->index();
+}
+
+void RoadNetwork::index()
+{
+    // The lanes leaving every intersection, by counting sort.
+    m_outFirst.assign(m_nodes.size() + 1, 0);
+    m_fMaxSpeed = 1.0f;
+    for(auto i = m_lanes.begin() ; i != m_lanes.end() ; ++i) {
+        ++m_outFirst[i->from + 1];
+        // Lanes stop short of the intersections, so going from one to the
+        // next is quicker than the speed limit makes it seem.
+        const Intersection& a = m_nodes[i->from];
+        const Intersection& b = m_nodes[i->to];
+        const float d = std::sqrt((b.x - a.x)*(b.x - a.x) + (b.z - a.z)*(b.z - a.z));
+        if(i->length > 0.0f)
+            m_fMaxSpeed = std::max(m_fMaxSpeed, d / this->travelTime(*i));
+    }
+    for(std::size_t i = 0 ; i < m_nodes.size() ; ++i) {
+        m_outFirst[i + 1] += m_outFirst[i];
+    }
+    m_outLanes.resize(m_lanes.size());
+    std::vector<uint32_t> cursor(m_outFirst.begin(), m_outFirst.end() - 1);
+    for(uint32_t i = 0 ; i < m_lanes.size() ; ++i) {
+        m_outLanes[cursor[m_lanes[i].from]++] = i;
+    }
+
+    // And the grid for finding lanes, the same way.
+    m_gridW = m_gridH = 0;
+    m_cellFirst.assign(1, 0);
+    m_cellLanes.clear();
+    if(m_lanes.empty())
+        return;
+
+    float maxX = -g_inf, maxZ = -g_inf;
+    m_gridX0 = m_gridZ0 = g_inf;
+    for(auto i = m_lanes.begin() ; i != m_lanes.end() ; ++i) {
+        m_gridX0 = std::min(m_gridX0, std::min(i->start[0], i->end[0]));
+        m_gridZ0 = std::min(m_gridZ0, std::min(i->start[1], i->end[1]));
+        maxX = std::max(maxX, std::max(i->start[0], i->end[0]));
+        maxZ = std::max(maxZ, std::max(i->start[1], i->end[1]));
+    }
+    m_gridW = static_cast<unsigned>((maxX - m_gridX0) / D_ROAD_CELL_SIZE) + 1;
+    m_gridH = static_cast<unsigned>((maxZ - m_gridZ0) / D_ROAD_CELL_SIZE) + 1;
+
+    auto cells = [this](const Lane& l, unsigned& x0, unsigned& z0, unsigned& x1, unsigned& z1) {
+        x0 = static_cast<unsigned>((std::min(l.start[0], l.end[0]) - m_gridX0) / D_ROAD_CELL_SIZE);
+        z0 = static_cast<unsigned>((std::min(l.start[1], l.end[1]) - m_gridZ0) / D_ROAD_CELL_SIZE);
+        x1 = static_cast<unsigned>((std::max(l.start[0], l.end[0]) - m_gridX0) / D_ROAD_CELL_SIZE);
+        z1 = static_cast<unsigned>((std::max(l.start[1], l.end[1]) - m_gridZ0) / D_ROAD_CELL_SIZE);
+    };
+    m_cellFirst.assign(m_gridW * m_gridH + 1, 0);
+    for(auto i = m_lanes.begin() ; i != m_lanes.end() ; ++i) {
+        unsigned x0, z0, x1, z1;
+        cells(*i, x0, z0, x1, z1);
+        for(unsigned z = z0 ; z <= z1 ; ++z) {
+            for(unsigned x = x0 ; x <= x1 ; ++x) {
+                ++m_cellFirst[z*m_gridW + x + 1];
+            }
+        }
+    }
+    for(unsigned c = 0 ; c < m_gridW * m_gridH ; ++c) {
+        m_cellFirst[c + 1] += m_cellFirst[c];
+    }
+    m_cellLanes.resize(m_cellFirst.back());
+    cursor.assign(m_cellFirst.begin(), m_cellFirst.end() - 1);
+    for(uint32_t i = 0 ; i < m_lanes.size() ; ++i) {
+        unsigned x0, z0, x1, z1;
+        cells(m_lanes[i], x0, z0, x1, z1);
+        for(unsigned z = z0 ; z <= z1 ; ++z) {
+            for(unsigned x = x0 ; x <= x1 ; ++x) {
+                m_cellLanes[cursor[z*m_gridW + x]++] = i;
+            }
+        }
+    }
+}
+
+void RoadNetwork::preprocess()
+{
+    const uint32_t n = static_cast<uint32_t>(m_nodes.size());
+    std::vector<std::vector<Arc>> out(n), in(n);
+    for(uint32_t i = 0 ; i < m_lanes.size() ; ++i) {
+        const Lane& l = m_lanes[i];
+        const Arc o = { l.to, this->travelTime(l), D_ROAD_NONE, i };
+        const Arc r = { l.from, o.time, D_ROAD_NONE, i };
+        out[l.from].push_back(o);
+        in[l.to].push_back(r);
+    }
+
+    std::vector<uint8_t> contracted(n, 0);
+    std::vector<uint32_t> deleted(n, 0);
+
+    // A Dijkstra from in_from that doesn't go through in_via, for finding out
+    // whether a shortcut is needed or there's another way, a witness.
+    std::vector<float> dist(n, g_inf);
+    std::vector<uint32_t> touched;
+    std::vector<Entry> open;
+    auto witness = [&](uint32_t in_from, uint32_t in_via, float in_fMax) {
+        for(auto i = touched.begin() ; i != touched.end() ; ++i) {
+            dist[*i] = g_inf;
+        }
+        touched.clear();
+        open.clear();
+
+        dist[in_from] = 0.0f;
+        touched.push_back(in_from);
+        open.push_back(Entry(0.0f, in_from));
+        for(unsigned settled = 0 ; !open.empty() && settled < D_CH_WITNESS_LIMIT ; ++settled) {
+            std::pop_heap(open.begin(), open.end(), Later());
+            const Entry e = open.back();
+            open.pop_back();
+            if(e.first > dist[e.second])
+                continue;
+            if(e.first > in_fMax)
+                break;
+
+            const std::vector<Arc>& arcs = out[e.second];
+            for(auto a = arcs.begin() ; a != arcs.end() ; ++a) {
+                if(contracted[a->node] || a->node == in_via)
+                    continue;
+
+                const float d = e.first + a->time;
+                if(d < dist[a->node]) {
+                    if(dist[a->node] == g_inf)
+                        touched.push_back(a->node);
+                    dist[a->node] = d;
+                    open.push_back(Entry(d, a->node));
+                    std::push_heap(open.begin(), open.end(), Later());
+                }
+            }
+        }
+    };
+
+    // Goes through the shortcuts contracting in_v would need, calling
+    // in_add(u, x, time) for each.
+    auto shortcuts = [&](uint32_t in_v, const std::function<void (uint32_t, uint32_t, float)>& in_add) {
+        float fMaxOut = 0.0f;
+        for(auto o = out[in_v].begin() ; o != out[in_v].end() ; ++o) {
+            if(!contracted[o->node])
+                fMaxOut = std::max(fMaxOut, o->time);
+        }
+
+        for(auto i = in[in_v].begin() ; i != in[in_v].end() ; ++i) {
+            if(contracted[i->node])
+                continue;
+
+            witness(i->node, in_v, i->time + fMaxOut);
+            for(auto o = out[in_v].begin() ; o != out[in_v].end() ; ++o) {
+                if(contracted[o->node] || o->node == i->node)
+                    continue;
+                if(dist[o->node] > i->time + o->time)
+                    in_add(i->node, o->node, i->time + o->time);
+            }
+        }
+    };
+
+    // The less a contraction changes the graph, the earlier it happens.
+    auto priority = [&](uint32_t in_v) {
+        int nShortcuts = 0, nArcs = 0;
+        shortcuts(in_v, [&nShortcuts](uint32_t, uint32_t, float) { ++nShortcuts; });
+        for(auto i = in[in_v].begin() ; i != in[in_v].end() ; ++i) {
+            nArcs += !contracted[i->node];
+        }
+        for(auto o = out[in_v].begin() ; o != out[in_v].end() ; ++o) {
+            nArcs += !contracted[o->node];
+        }
+        return static_cast<float>(nShortcuts - nArcs + static_cast<int>(deleted[in_v]));
+    };
+
+    std::vector<Entry> queue;
+    for(uint32_t v = 0 ; v < n ; ++v) {
+        queue.push_back(Entry(priority(v), v));
+    }
+    std::make_heap(queue.begin(), queue.end(), Later());
+
+    m_rank.assign(n, 0);
+    for(uint32_t rank = 0 ; !queue.empty() ; ) {
+        std::pop_heap(queue.begin(), queue.end(), Later());
+        const uint32_t v = queue.back().second;
+        queue.pop_back();
+
+        // Priorities change as the neighbours get contracted; only update
+        // them when they come up, and put them back if they got worse.
+        const float p = priority(v);
+        if(!queue.empty() && p > queue.front().first) {
+            queue.push_back(Entry(p, v));
+            std::push_heap(queue.begin(), queue.end(), Later());
+            continue;
+        }
+
+        shortcuts(v, [&](uint32_t u, uint32_t x, float t) {
+            // There may be a way already, just a slower one.
+            for(auto o = out[u].begin() ; o != out[u].end() ; ++o) {
+                if(o->node == x) {
+                    if(t < o->time) {
+                        o->time = t; o->middle = v; o->lane = D_ROAD_NONE;
+                        for(auto i = in[x].begin() ; i != in[x].end() ; ++i) {
+                            if(i->node == u) {
+                                i->time = t; i->middle = v; i->lane = D_ROAD_NONE;
+                            }
+                        }
+                    }
+                    return;
+                }
+            }
+            const Arc o = { x, t, v, D_ROAD_NONE };
+            const Arc i = { u, t, v, D_ROAD_NONE };
+            out[u].push_back(o);
+            in[x].push_back(i);
+        });
+
+        contracted[v] = 1;
+        m_rank[v] = rank++;
+        for(auto i = in[v].begin() ; i != in[v].end() ; ++i) {
+            ++deleted[i->node];
+        }
+        for(auto o = out[v].begin() ; o != out[v].end() ; ++o) {
+            ++deleted[o->node];
+        }
+    }
+
+    // Keep the arcs going up, the ones leaving an intersection for the
+    // forward search and the ones arriving at it for the backward search.
+    m_upFirst.assign(n + 1, 0);
+    m_downFirst.assign(n + 1, 0);
+    m_up.clear();
+    m_down.clear();
+    for(uint32_t v = 0 ; v < n ; ++v) {
+        for(auto o = out[v].begin() ; o != out[v].end() ; ++o) {
+            if(m_rank[o->node] > m_rank[v])
+                m_up.push_back(*o);
+        }
+        m_upFirst[v + 1] = static_cast<uint32_t>(m_up.size());
+
+        for(auto i = in[v].begin() ; i != in[v].end() ; ++i) {
+            if(m_rank[i->node] > m_rank[v])
+                m_down.push_back(*i);
+        }
+        m_downFirst[v + 1] = static_cast<uint32_t>(m_down.size());
+    }
+}
+
+std::size_t RoadNetwork::shortcutCount() const
+{
+    std::size_t n = 0;
+    for(auto a = m_up.begin() ; a != m_up.end() ; ++a) {
+        n += a->lane == D_ROAD_NONE;
+    }
+    for(auto a = m_down.begin() ; a != m_down.end() ; ++a) {
+        n += a->lane == D_ROAD_NONE;
+    }
+    return n;
+}
+
+bool RoadNetwork::load(const char* in_data, std::size_t in_size)
+{
+    const char* const end = in_data + in_size;
+    uint32_t version = 0;
+    if(in_size < 4 + sizeof(version) || std::memcmp(in_data, D_ROADS_MAGIC, 4) != 0)
+        return false;
+    std::memcpy(&version, in_data + 4, sizeof(version));
+    if(version != D_ROADS_VERSION)
+        return false;
+
+    const char* p = in_data + 4 + sizeof(version);
+    if(!read(p, end, m_nodes) || !read(p, end, m_lanes) || !read(p, end, m_rank)
+    || !read(p, end, m_upFirst) || !read(p, end, m_up) || !read(p, end, m_downFirst) || !read(p, end, m_down))
+        return false;
+
+    // Don't trust the file with indices.
+    const std::size_t n = m_nodes.size();
+    for(auto i = m_lanes.begin() ; i != m_lanes.end() ; ++i) {
+        if(i->from >= n || i->to >= n || !(i->speedLimit > 0.0f))
+            return false;
+    }
+    if(!m_rank.empty()) {
+        if(m_rank.size() != n || m_upFirst.size() != n + 1 || m_downFirst.size() != n + 1
+        || m_upFirst.back() != m_up.size() || m_downFirst.back() != m_down.size())
+            return false;
+        for(std::size_t i = 0 ; i < n ; ++i) {
+            if(m_upFirst[i] > m_upFirst[i + 1] || m_downFirst[i] > m_downFirst[i + 1])
+                return false;
+        }
+        for(auto a = m_up.begin() ; a != m_up.end() ; ++a) {
+            if(a->node >= n || (a->lane == D_ROAD_NONE ? a->middle >= n : a->lane >= m_lanes.size()))
+                return false;
+        }
+        for(auto a = m_down.begin() ; a != m_down.end() ; ++a) {
+            if(a->node >= n || (a->lane == D_ROAD_NONE ? a->middle >= n : a->lane >= m_lanes.size()))
+                return false;
+        }
+    }
+
+    this->index();
+    return true;
+}
+
+void RoadNetwork::save(const std::string& in_sFile) const
+{
+    std::ofstream f(in_sFile.c_str(), std::ios::binary | std::ios::trunc);
+
+    uint32_t version = D_ROADS_VERSION;
+    f.write(D_ROADS_MAGIC, 4);
+    f.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    write(f, m_nodes);
+    write(f, m_lanes);
+    write(f, m_rank);
+    write(f, m_upFirst);
+    write(f, m_up);
+    write(f, m_downFirst);
+    write(f, m_down);
+
+    if(!f)
+        throw std::runtime_error(_("Failed to write the road network file ") + in_sFile);
+}
+
+bool RoadNetwork::nearestLane(const Vector& in_pos, const Vector& in_dir, uint32_t& out_lane, float& out_t) const
+{
+    if(m_lanes.empty())
+        return false;
+
+    const float dirLen = std::sqrt(in_dir.x()*in_dir.x() + in_dir.z()*in_dir.z());
+    float fBest = g_inf;
+    auto test = [&](uint32_t in_lane) {
+        const Lane& l = m_lanes[in_lane];
+        const float dx = l.end[0] - l.start[0], dz = l.end[1] - l.start[1];
+        const float len2 = dx*dx + dz*dz;
+        float t = len2 > 0.0f ? ((in_pos.x() - l.start[0])*dx + (in_pos.z() - l.start[1])*dz) / len2 : 0.0f;
+        t = std::max(0.0f, std::min(t, 1.0f));
+        const float px = l.start[0] + dx*t - in_pos.x(), pz = l.start[1] + dz*t - in_pos.z();
+        float d = std::sqrt(px*px + pz*pz);
+        if(dirLen > 0.0f && len2 > 0.0f)
+            d += (1.0f - (in_dir.x()*dx + in_dir.z()*dz) / (dirLen * std::sqrt(len2))) * D_ROAD_HEADING_PENALTY;
+
+        if(d < fBest) {
+            fBest = d;
+            out_lane = in_lane;
+            out_t = t;
+        }
+    };
+
+    // Look at rings of cells ever farther around the one we're in, until the
+    // ones not looked at yet are farther away than the best lane so far.
+    const int w = static_cast<int>(m_gridW), h = static_cast<int>(m_gridH);
+    const int cx = std::max(0, std::min(w - 1, static_cast<int>(std::floor((in_pos.x() - m_gridX0) / D_ROAD_CELL_SIZE))));
+    const int cz = std::max(0, std::min(h - 1, static_cast<int>(std::floor((in_pos.z() - m_gridZ0) / D_ROAD_CELL_SIZE))));
+    for(int r = 0 ; r < std::max(w, h) ; ++r) {
+        for(int z = std::max(cz - r, 0) ; z <= std::min(cz + r, h - 1) ; ++z) {
+            // Only the border of the ring, the inside was done already.
+            const int step = (z == cz - r || z == cz + r) ? 1 : 2*r;
+            for(int x = cx - r ; x <= cx + r ; x += std::max(step, 1)) {
+                if(x < 0 || x >= w)
+                    continue;
+
+                const unsigned c = z*m_gridW + x;
+                for(uint32_t i = m_cellFirst[c] ; i < m_cellFirst[c + 1] ; ++i) {
+                    test(m_cellLanes[i]);
+                }
+            }
+        }
+
+        if(fBest <= r * D_ROAD_CELL_SIZE)
+            break;
+    }
+
+    return fBest != g_inf;
+}
+
+Vector RoadNetwork::pointOnLane(uint32_t in_lane, float in_t) const
+{
+    const Lane& l = m_lanes[in_lane];
+    return Vector(l.start[0] + (l.end[0] - l.start[0])*in_t, 0.0f, l.start[1] + (l.end[1] - l.start[1])*in_t);
+}
+
+bool RoadNetwork::route(uint32_t in_from, uint32_t in_to, Search& io_search, std::vector<uint32_t>& out_lanes) const
+{
+    if(!this->preprocessed())
+        return this->routeAStar(in_from, in_to, io_search, out_lanes);
+
+    out_lanes.clear();
+    if(in_from == in_to)
+        return true;
+
+    // Upwards from both ends at the same time, forward from the start and
+    // backward from the end, until nothing better than the best meeting
+    // point can be found anymore.
+    Search& s = io_search;
+    s.reset(m_nodes.size());
+    s.visit(0, in_from, 0.0f, D_ROAD_NONE, D_ROAD_NONE);
+    s.visit(1, in_to, 0.0f, D_ROAD_NONE, D_ROAD_NONE);
+    s.m_open[0].push_back(Entry(0.0f, in_from));
+    s.m_open[1].push_back(Entry(0.0f, in_to));
+
+    float fBest = g_inf;
+    uint32_t meet = D_ROAD_NONE;
+    for(unsigned dir = 0 ; !s.m_open[0].empty() || !s.m_open[1].empty() ; dir = 1 - dir) {
+        std::vector<Entry>& open = s.m_open[dir];
+        if(open.empty())
+            continue;
+        if(open.front().first >= fBest) {
+            open.clear();
+            continue;
+        }
+
+        std::pop_heap(open.begin(), open.end(), Later());
+        const Entry e = open.back();
+        open.pop_back();
+        if(e.first > s.m_dist[dir][e.second])
+            continue;
+
+        const float other = s.m_dist[1 - dir][e.second];
+        if(e.first + other < fBest) {
+            fBest = e.first + other;
+            meet = e.second;
+        }
+
+        const std::vector<uint32_t>& first = dir == 0 ? m_upFirst : m_downFirst;
+        const std::vector<Arc>& arcs = dir == 0 ? m_up : m_down;
+        for(uint32_t a = first[e.second] ; a < first[e.second + 1] ; ++a) {
+            const float d = e.first + arcs[a].time;
+            if(d < s.m_dist[dir][arcs[a].node]) {
+                s.visit(dir, arcs[a].node, d, e.second, a);
+                open.push_back(Entry(d, arcs[a].node));
+                std::push_heap(open.begin(), open.end(), Later());
+            }
+        }
+    }
+
+    if(meet == D_ROAD_NONE)
+        return false;
+
+    // From the start up to the meeting point, which is found backwards...
+    std::vector<uint32_t> up;
+    for(uint32_t v = meet ; v != in_from ; v = s.m_prev[0][v]) {
+        up.push_back(v);
+    }
+    for(auto v = up.rbegin() ; v != up.rend() ; ++v) {
+        this->unpack(s.m_prev[0][*v], *v, m_up[s.m_arc[0][*v]], out_lanes);
+    }
+    // ...and down from there to the end.
+    for(uint32_t v = meet ; v != in_to ; v = s.m_prev[1][v]) {
+        this->unpack(v, s.m_prev[1][v], m_down[s.m_arc[1][v]], out_lanes);
+    }
+
+    return true;
+}
+
+void RoadNetwork::unpack(uint32_t in_from, uint32_t in_to, const Arc& in_arc, std::vector<uint32_t>& out_lanes) const
+{
+    if(in_arc.lane != D_ROAD_NONE) {
+        out_lanes.push_back(in_arc.lane);
+        return;
+    }
+
+    // The middle was contracted before both ends, so the way from the start
+    // to it arrives at it from above, and the way on leaves it upwards.
+    const uint32_t m = in_arc.middle;
+    const Arc* pIn = 0;
+    for(uint32_t a = m_downFirst[m] ; a < m_downFirst[m + 1] ; ++a) {
+        if(m_down[a].node == in_from && (!pIn || m_down[a].time < pIn->time))
+            pIn = &m_down[a];
+    }
+    const Arc* pOut = 0;
+    for(uint32_t a = m_upFirst[m] ; a < m_upFirst[m + 1] ; ++a) {
+        if(m_up[a].node == in_to && (!pOut || m_up[a].time < pOut->time))
+            pOut = &m_up[a];
+    }
+
+    this->unpack(in_from, m, *pIn, out_lanes);
+    this->unpack(m, in_to, *pOut, out_lanes);
+}
+
+bool RoadNetwork::routeAStar(uint32_t in_from, uint32_t in_to, Search& io_search, std::vector<uint32_t>& out_lanes) const
+{
+    out_lanes.clear();
+    if(in_from == in_to)
+        return true;
+
+    // Nobody gets anywhere faster than along the quickest lane, straight ahead.
+    const Intersection& goal = m_nodes[in_to];
+    auto estimate = [this, &goal](uint32_t in_node) {
+        const Intersection& i = m_nodes[in_node];
+        return std::sqrt((goal.x - i.x)*(goal.x - i.x) + (goal.z - i.z)*(goal.z - i.z)) / m_fMaxSpeed;
+    };
+
+    Search& s = io_search;
+    s.reset(m_nodes.size());
+    s.visit(0, in_from, 0.0f, D_ROAD_NONE, D_ROAD_NONE);
+    std::vector<Entry>& open = s.m_open[0];
+    open.push_back(Entry(estimate(in_from), in_from));
+    while(!open.empty()) {
+        std::pop_heap(open.begin(), open.end(), Later());
+        const uint32_t v = open.back().second;
+        const float f = open.back().first;
+        open.pop_back();
+        if(v == in_to)
+            break;
+        if(f > s.m_dist[0][v] + estimate(v))
+            continue;
+
+        for(uint32_t i = m_outFirst[v] ; i < m_outFirst[v + 1] ; ++i) {
+            const Lane& l = m_lanes[m_outLanes[i]];
+            const float d = s.m_dist[0][v] + this->travelTime(l);
+            if(d < s.m_dist[0][l.to]) {
+                s.visit(0, l.to, d, v, m_outLanes[i]);
+                open.push_back(Entry(d + estimate(l.to), l.to));
+                std::push_heap(open.begin(), open.end(), Later());
+            }
+        }
+    }
+
+    if(s.m_dist[0][in_to] == g_inf)
+        return false;
+
+    for(uint32_t v = in_to ; v != in_from ; v = s.m_prev[0][v]) {
+        out_lanes.push_back(s.m_arc[0][v]);
+    }
+    std::reverse(out_lanes.begin(), out_lanes.end());
+    return true;
+}
+
+void RoadNetwork::debugDraw(const Vector& in_center, float in_fRadius) const
+{
+    for(auto i = m_lanes.begin() ; i != m_lanes.end() ; ++i) {
+        const float dx = i->start[0] - in_center.x(), dz = i->start[1] - in_center.z();
+        if(dx*dx + dz*dz > in_fRadius*in_fRadius)
+            continue;
+
+        // The faster, the greener.
+        const float f = i->speedLimit / g_speedLimits[sizeof(g_speedLimits)/sizeof(g_speedLimits[0]) - 1];
+        debugArrow(Vector(i->start[0], 0.1f, i->start[1]), Vector(i->end[0] - i->start[0], 0.0f, i->end[1] - i->start[1]), Vector(1.0f - f, f, 0.0f));
+    }
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "3d/Math/Vector.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// Streets run along the lower x and z edges of every chunk, this wide. The
+/// chunks put their buildings next to them, the road network its lanes on them.
+#define D_STREET_WIDTH 8.0f
+/// Marks the lack of an intersection or a lane.
+#define D_ROAD_NONE 0xffffffffu
+
+namespace RoadRage {
+
+/// A crossing of streets, where lanes start and end.
+struct Intersection {
+    float x;
+    float z;
+};
+
+/// One direction of a street between two intersections, which is what cars
+/// drive along. This is also the on-disk representation.
+struct Lane {
+    uint32_t from;     ///< The intersection it starts at.
+    uint32_t to;       ///< The intersection it leads to.
+    float start[2];    ///< Where it starts, in (x, z).
+    float end[2];      ///< Where it ends, in (x, z).
+    float length;      ///< In m.
+    float speedLimit;  ///< In m/s.
+};
+
+/// All the roads of a level, as a directed graph of lanes between
+/// intersections, for the AI traffic to find its way around.\n
+/// Routes are the quickest ones, found with a contraction hierarchy: every
+/// intersection gets a rank, and shortcuts are added for the ways through
+/// the less important ones. A query then only needs to go upwards in rank
+/// from both ends, which touches a tiny part of the graph. This is computed
+/// offline and stored with the level; without it, routes fall back to A*.\n
+/// Everything but building it is const and may be used from many threads at
+/// once, each worker having its own Search.
+class RoadNetwork {
+public:
+    /// What a route query needs to remember. One per thread.
+    class Search {
+    public:
+        Search();
+
+    private:
+        friend class RoadNetwork;
+
+        void reset(std::size_t in_nNodes);
+        void visit(unsigned in_dir, uint32_t in_node, float in_fDist, uint32_t in_prev, uint32_t in_arc);
+
+        /// For both directions: how long it takes to every intersection, and
+        /// the intersection and arc it was reached through.
+        std::vector<float> m_dist[2];
+        std::vector<uint32_t> m_prev[2];
+        std::vector<uint32_t> m_arc[2];
+        std::vector<std::pair<float, uint32_t>> m_open[2];
+        /// The intersections touched by the last search, to reset only those.
+        std::vector<uint32_t> m_touched;
+    };
+
+    RoadNetwork();
+    virtual ~RoadNetwork();
+
+    /// Lays out the grid of streets the chunks of \a in_fChunkSize meters
+    /// have, over the (2 \a in_iRadius + 1)^2 chunks around the origin. The
+    /// streets get random speed limits, always the same ones for a \a in_seed.
+    void generate(float in_fChunkSize, int in_iRadius, unsigned in_seed);
+    /// Builds the contraction hierarchy for fast routing. This takes a while.
+    void preprocess();
+    bool preprocessed() const { return !m_rank.empty(); }
+
+    /// Reads the network from the content of a road network file.
+    /// \return false if it is not a valid road network.
+    bool load(const char* in_data, std::size_t in_size);
+    /// Writes the network, including its preprocessing, to \a in_sFile.
+    /// \throws std::runtime_error if the file can't be written.
+    void save(const std::string& in_sFile) const;
+
+    /// Finds the lane nearest to \a in_pos, preferring ones going the way of
+    /// \a in_dir, if given.
+    /// \param out_t Where on the lane it is, 0 being its start and 1 its end.
+    /// \return false if there are no lanes at all.
+    bool nearestLane(const Vector& in_pos, const Vector& in_dir, uint32_t& out_lane, float& out_t) const;
+
+    /// Finds the quickest way from the intersection \a in_from to \a in_to.
+    /// \param out_lanes The lanes to drive along, in order.
+    /// \return false if there is no way.
+    bool route(uint32_t in_from, uint32_t in_to, Search& io_search, std::vector<uint32_t>& out_lanes) const;
+    /// The same, without using the contraction hierarchy.
+    bool routeAStar(uint32_t in_from, uint32_t in_to, Search& io_search, std::vector<uint32_t>& out_lanes) const;
+
+    std::size_t intersectionCount() const { return m_nodes.size(); }
+    const Intersection& intersection(uint32_t in_id) const { return m_nodes[in_id]; }
+    std::size_t laneCount() const { return m_lanes.size(); }
+    const Lane& lane(uint32_t in_id) const { return m_lanes[in_id]; }
+    /// The lanes leaving the intersection \a in_node are the \a i-th ones for
+    /// \a i in [0, outLaneCount(\a in_node)).
+    std::size_t outLaneCount(uint32_t in_node) const { return m_outFirst[in_node + 1] - m_outFirst[in_node]; }
+    uint32_t outLane(uint32_t in_node, std::size_t in_i) const { return m_outLanes[m_outFirst[in_node] + in_i]; }
+    /// \return The amount of shortcuts the preprocessing added.
+    std::size_t shortcutCount() const;
+
+    /// \return The point \a in_t along \a in_lane, on the ground.
+    Vector pointOnLane(uint32_t in_lane, float in_t) const;
+
+    /// Debug-draws all lanes within \a in_fRadius of \a in_center.
+    void debugDraw(const Vector& in_center, float in_fRadius) const;
+
+private:
+    // No copying!
+    RoadNetwork(const RoadNetwork&);
+    RoadNetwork& operator=(const RoadNetwork&);
+
+    /// An edge of the hierarchy: either a lane, or a shortcut through
+    /// \a middle, which was contracted before both its ends.
+    struct Arc {
+        uint32_t node;
+        float time;
+        uint32_t middle; ///< D_ROAD_NONE for lanes.
+        uint32_t lane;   ///< D_ROAD_NONE for shortcuts.
+    };
+
+    void index();
+    void unpack(uint32_t in_from, uint32_t in_to, const Arc& in_arc, std::vector<uint32_t>& out_lanes) const;
+    float travelTime(const Lane& in_lane) const { return in_lane.length / in_lane.speedLimit; }
+
+    std::vector<Intersection> m_nodes;
+    std::vector<Lane> m_lanes;
+
+    /// The lanes leaving every intersection, intersection n having
+    /// m_outLanes[m_outFirst[n] .. m_outFirst[n+1]).
+    std::vector<uint32_t> m_outFirst;
+    std::vector<uint32_t> m_outLanes;
+    /// The quickest any lane gets from one intersection to the next, as the
+    /// crow flies, for A*'s estimation.
+    float m_fMaxSpeed;
+
+    /// The hierarchy: the rank of every intersection, and the arcs going up
+    /// in rank, leaving every intersection for the forward search and
+    /// arriving at it for the backward search.
+    std::vector<uint32_t> m_rank;
+    std::vector<uint32_t> m_upFirst, m_downFirst;
+    std::vector<Arc> m_up, m_down;
+
+    /// A grid of the lanes touching each of its cells, for finding the
+    /// nearest one.
+    float m_gridX0, m_gridZ0;
+    unsigned m_gridW, m_gridH;
+    std::vector<uint32_t> m_cellFirst;
+    std::vector<uint32_t> m_cellLanes;
+};
+
+}
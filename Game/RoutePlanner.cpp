@@ -0,0 +1,60 @@
+#include "RoutePlanner.h"
+
+using namespace RoadRage;
+
+RoutePlanner::RoutePlanner(const RoadNetwork& in_roads, std::size_t in_nCapacity, unsigned in_nWorkers)
+    : m_roads(in_roads)
+    , m_nCapacity(in_nCapacity)
+    , m_searches(in_nWorkers)
+    , m_nHits(0)
+    , m_nMisses(0)
+{
+}
+
+RoutePlanner::~RoutePlanner()
+{
+}
+
+RoutePlanner::Route RoutePlanner::route(uint32_t in_from, uint32_t in_to, unsigned in_worker)
+{
+    const uint64_t key = static_cast<uint64_t>(in_from) << 32 | in_to;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto i = m_index.find(key);
+        if(i != m_index.end()) {
+            ++m_nHits;
+            m_lru.splice(m_lru.begin(), m_lru, i->second);
+            return i->second->second;
+        }
+        ++m_nMisses;
+    }
+
+    std::shared_ptr<std::vector<uint32_t>> pLanes(new std::vector<uint32_t>());
+    if(!m_roads.route(in_from, in_to, m_searches[in_worker], *pLanes))
+        return Route();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_nCapacity == 0 || m_index.find(key) != m_index.end())
+        return pLanes;
+
+    m_lru.push_front(Entry(key, pLanes));
+    m_index[key] = m_lru.begin();
+    if(m_lru.size() > m_nCapacity) {
+        m_index.erase(m_lru.back().first);
+        m_lru.pop_back();
+    }
+    return pLanes;
+}
+
+void RoutePlanner::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lru.clear();
+    m_index.clear();
+}
+
+std::size_t RoutePlanner::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lru.size();
+}
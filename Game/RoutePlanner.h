@@ -0,0 +1,65 @@
+#pragma once
+
+#include "RoadNetwork.h"
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+namespace RoadRage {
+
+/// Hands out routes through a RoadNetwork to many threads at once, keeping
+/// the most recently asked for ones around: the AI traffic mostly drives
+/// between the same few places, so most requests never reach the network.\n
+/// Routes are shared and immutable, they stay valid for as long as somebody
+/// holds on to them, even once they've been dropped from the cache.
+class RoutePlanner {
+public:
+    /// The lanes to drive along, in order.
+    typedef std::shared_ptr<const std::vector<uint32_t>> Route;
+
+    /// \param in_nCapacity How many routes to remember at most.
+    /// \param in_nWorkers How many threads may ask for routes at the same time.
+    RoutePlanner(const RoadNetwork& in_roads, std::size_t in_nCapacity, unsigned in_nWorkers);
+    virtual ~RoutePlanner();
+
+    /// \return The quickest way from the intersection \a in_from to \a in_to,
+    ///         or null if there is none.
+    /// \param in_worker Which of the threads is asking; no two threads may
+    ///                  use the same one at once.
+    Route route(uint32_t in_from, uint32_t in_to, unsigned in_worker);
+
+    /// Forgets all routes, for when the network changed.
+    void clear();
+
+    std::size_t hits() const { return m_nHits; }
+    std::size_t misses() const { return m_nMisses; }
+    std::size_t size() const;
+
+private:
+    // No copying!
+    RoutePlanner(const RoutePlanner&);
+    RoutePlanner& operator=(const RoutePlanner&);
+
+    typedef std::pair<uint64_t, Route> Entry;
+
+    const RoadNetwork& m_roads;
+    std::size_t m_nCapacity;
+    std::vector<RoadNetwork::Search> m_searches;
+
+    /// The routes from the most to the least recently used, and where each
+    /// one is in that list, all guarded by m_mutex. The searches run outside
+    /// of the lock, so two threads may both compute the same missing route.
+    mutable std::mutex m_mutex;
+    std::list<Entry> m_lru;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> m_index;
+    std::atomic<std::size_t> m_nHits;
+    std::atomic<std::size_t> m_nMisses;
+};
+
+}
@@ -0,0 +1,345 @@
+#include "Traffic.h"
+
+#include "Utilities/ThreadPool.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace RoadRage;
+
+/// The size of the cells of the spatial hash, in meters.
+#define D_TRAFFIC_CELL_SIZE 16.0f
+/// How far ahead drivers look for others, in meters.
+#define D_TRAFFIC_SIGHT 40.0f
+/// How far to the side of a car another one is still in its way, in meters.
+#define D_TRAFFIC_LANE_HALF_WIDTH 1.5f
+/// How many places the cars drive to.
+#define D_TRAFFIC_DESTINATIONS 256
+/// How many routes may be asked for per frame.
+#define D_TRAFFIC_ROUTES_PER_FRAME 8
+/// Whatever isn't limited by what's ahead pretends to follow something this
+/// fast, in m/s.
+#define D_TRAFFIC_FREE_SPEED 1000.0f
+/// Idle cars only decide on every that many turns of theirs, and only move
+/// on every that many frames, by as much.
+#define D_TRAFFIC_IDLE_TURNS 4
+
+static inline uint32_t mix(uint32_t in_x)
+{
+    in_x ^= in_x >> 16;
+    in_x *= 0x7feb352du;
+    in_x ^= in_x >> 15;
+    in_x *= 0x846ca68bu;
+    in_x ^= in_x >> 16;
+    return in_x;
+}
+
+Traffic::Traffic(Entities& io_entities, const RoadNetwork& in_roads, RoutePlanner& io_routes, unsigned in_nDecisionFrames, float in_fActiveRadius)
+    : m_entities(io_entities)
+    , m_roads(in_roads)
+    , m_routes(io_routes)
+    , m_nDecisionFrames(std::max(1u, in_nDecisionFrames))
+    , m_frame(0)
+    , m_fActiveRadius(in_fActiveRadius)
+    , m_routeBudget(0)
+    , m_bucketMask(0)
+    , m_bHashAll(true)
+    , m_fTime(0.0f)
+    , m_fDecisionTime(0.0f)
+    , m_nDecisions(0)
+    , m_nActive(0)
+{
+}
+
+Traffic::~Traffic()
+{
+    for(auto i = m_cars.begin() ; i != m_cars.end() ; ++i) {
+        m_entities.destroy(i->entity());
+    }
+}
+
+void Traffic::populate(std::size_t in_nCars, unsigned in_seed)
+{
+    for(auto i = m_cars.begin() ; i != m_cars.end() ; ++i) {
+        m_entities.destroy(i->entity());
+    }
+    m_cars.clear();
+    m_destinations.clear();
+    if(m_roads.laneCount() == 0)
+        return;
+
+    // The clients and the server have to make the same cars in the same
+    // order. mt19937 gives the same numbers everywhere, its distributions
+    // don't.
+    std::mt19937 engine(in_seed);
+    const uint32_t nNodes = static_cast<uint32_t>(m_roads.intersectionCount());
+    const uint32_t nLanes = static_cast<uint32_t>(m_roads.laneCount());
+    for(unsigned i = 0 ; i < D_TRAFFIC_DESTINATIONS ; ++i) {
+        m_destinations.push_back(engine() % nNodes);
+    }
+    for(std::size_t i = 0 ; i < in_nCars ; ++i) {
+        const uint32_t l = engine() % nLanes;
+        const float fAlong = (engine() >> 8) * (1.0f / 16777216.0f);
+        const Entity e = TrafficCar::create(m_entities, m_roads, l, fAlong, static_cast<uint32_t>(i));
+        m_cars.push_back(TrafficCar(m_entities, m_roads, e));
+    }
+
+    m_batch.resize(m_cars.size());
+
+    // About two buckets per car keeps the collisions rare.
+    uint32_t nBuckets = 1;
+    while(nBuckets < 2*(m_cars.size() + 1))
+        nBuckets *= 2;
+    m_bucketMask = nBuckets - 1;
+    m_bucketStart.resize(nBuckets + 1);
+    m_bucketActive.resize(nBuckets);
+    m_bHashAll = true;
+}
+
+void Traffic::think(const GameClock& clock, const std::vector<const Car*>& in_players, ThreadPool& io_workers)
+{
+    sf::Clock timer;
+    if(m_cars.empty())
+        return;
+
+    this->hash(in_players);
+    this->activate(in_players);
+
+    // This frame's share of the cars decides how to drive until their next
+    // turn, which is that many frames away. The idle ones of them only on
+    // every few turns, taking turns again, and for that much longer.
+    const std::size_t nCars = m_cars.size();
+    const unsigned turn = m_frame / m_nDecisionFrames;
+    const unsigned phase = m_frame++ % m_nDecisionFrames;
+    const std::size_t nDeciding = (nCars + m_nDecisionFrames - 1 - phase) / m_nDecisionFrames;
+    const float fInterval = m_nDecisionFrames * std::max(clock.deltaT(), 1.0f / 60.0f);
+    const uint32_t frame = mix(m_frame);
+    m_routeBudget = D_TRAFFIC_ROUTES_PER_FRAME;
+    m_nDecisions = 0;
+    io_workers.parallelFor(nDeciding, [this, turn, phase, fInterval, frame](std::size_t in_begin, std::size_t in_end, unsigned in_worker) {
+        std::size_t nDecisions = 0;
+        for(std::size_t k = in_begin ; k < in_end ; ++k) {
+            const std::size_t i = phase + k * m_nDecisionFrames;
+            TrafficCar& car = m_cars[i];
+            float fSpeed = 0.0f;
+            if(!m_bucketActive[m_bucketOf[i]]) {
+                if((turn + k) % D_TRAFFIC_IDLE_TURNS != 0)
+                    continue;
+                const float fGap = this->gap(i, fSpeed);
+                car.drive(fGap, fSpeed, fInterval * D_TRAFFIC_IDLE_TURNS);
+                ++nDecisions;
+                continue;
+            }
+
+            if(car.needsRoute() && m_routeBudget.fetch_sub(1) > 0) {
+                const uint32_t to = m_destinations[mix(car.id() ^ frame) % m_destinations.size()];
+                car.route(m_routes.route(car.nextIntersection(), to, in_worker));
+            }
+
+            const float fGap = this->gap(i, fSpeed);
+            car.drive(fGap, fSpeed, fInterval);
+            ++nDecisions;
+        }
+        m_nDecisions += nDecisions;
+    }, 64);
+    m_fDecisionTime = timer.GetElapsedTime();
+
+    // And all of them drive on, as Car::think would have them, the idle ones
+    // taking turns again, in bigger steps. Those go after the others, so that
+    // each get stepped in one go.
+    m_moving.clear();
+    for(std::size_t i = 0 ; i < nCars ; ++i) {
+        if(m_bucketActive[m_bucketOf[i]])
+            m_moving.push_back(static_cast<uint32_t>(i));
+    }
+    const std::size_t nActive = m_moving.size();
+    for(std::size_t i = m_frame % D_TRAFFIC_IDLE_TURNS ; i < nCars ; i += D_TRAFFIC_IDLE_TURNS) {
+        if(!m_bucketActive[m_bucketOf[i]])
+            m_moving.push_back(static_cast<uint32_t>(i));
+    }
+    const float fDeltaT = clock.deltaT();
+    io_workers.parallelFor(m_moving.size(), [this, nActive, fDeltaT](std::size_t in_begin, std::size_t in_end, unsigned) {
+        for(std::size_t k = in_begin ; k < in_end ; ++k) {
+            TrafficCar& car = m_cars[m_moving[k]];
+            m_batch.load(k, car.transform(), car.driving());
+        }
+        const std::size_t split = std::min(std::max(nActive, in_begin), in_end);
+        m_batch.step(in_begin, split, fDeltaT);
+        m_batch.step(split, in_end, fDeltaT * D_TRAFFIC_IDLE_TURNS);
+        for(std::size_t k = in_begin ; k < in_end ; ++k) {
+            TrafficCar& car = m_cars[m_moving[k]];
+            m_batch.store(k, car.transform(), car.driving());
+        }
+    }, 256);
+
+    m_fTime = timer.GetElapsedTime();
+}
+
+uint32_t Traffic::bucket(int in_x, int in_z) const
+{
+    // Neighbouring cells along x end up in neighbouring buckets.
+    return (static_cast<uint32_t>(in_z) * 19349663u + static_cast<uint32_t>(in_x)) & m_bucketMask;
+}
+
+void Traffic::hash(const std::vector<const Car*>& in_players)
+{
+    // Players come and go, so the arrays grow with them.
+    const std::size_t n = m_cars.size() + in_players.size();
+    m_x.resize(n); m_z.resize(n);
+    m_fx.resize(n); m_fz.resize(n);
+    m_speed.resize(n); m_half.resize(n);
+    m_bucketOf.resize(n);
+    m_sorted.resize(n);
+
+    // Only the cars that moved since are looked at again, which leaves out
+    // most of the idle ones.
+    auto load = [this](std::size_t i) {
+        const Transform& t = m_cars[i].transform();
+        const Driving& d = m_cars[i].driving();
+        m_x[i] = t.pos.x(); m_z[i] = t.pos.z();
+        m_fx[i] = -std::sin(d.steeringAngle);
+        m_fz[i] = -std::cos(d.steeringAngle);
+        m_speed[i] = d.speed;
+        m_half[i] = t.scale.z();
+    };
+    if(m_bHashAll) {
+        for(std::size_t i = 0 ; i < m_cars.size() ; ++i) {
+            load(i);
+        }
+        m_bHashAll = false;
+    } else {
+        for(auto i = m_moving.begin() ; i != m_moving.end() ; ++i) {
+            load(*i);
+        }
+    }
+    for(std::size_t i = m_cars.size() ; i < n ; ++i) {
+        const Car& player = *in_players[i - m_cars.size()];
+        const Vector p = player.pos();
+        m_x[i] = p.x(); m_z[i] = p.z();
+        m_fx[i] = -std::sin(player.heading());
+        m_fz[i] = -std::cos(player.heading());
+        m_speed[i] = player.speed();
+        m_half[i] = player.scale().z();
+    }
+
+    // Counting sort by bucket: count, sum up to the ends of the buckets,
+    // then fill them from the back, which leaves their starts behind.
+    std::fill(m_bucketStart.begin(), m_bucketStart.end(), 0);
+    for(std::size_t i = 0 ; i < n ; ++i) {
+        m_bucketOf[i] = this->bucket(static_cast<int>(std::floor(m_x[i] / D_TRAFFIC_CELL_SIZE)),
+                                     static_cast<int>(std::floor(m_z[i] / D_TRAFFIC_CELL_SIZE)));
+        ++m_bucketStart[m_bucketOf[i]];
+    }
+    for(uint32_t b = 1 ; b <= m_bucketMask + 1 ; ++b) {
+        m_bucketStart[b] += m_bucketStart[b - 1];
+    }
+    for(std::size_t i = 0 ; i < n ; ++i) {
+        m_sorted[--m_bucketStart[m_bucketOf[i]]] = static_cast<uint32_t>(i);
+    }
+}
+
+void Traffic::activate(const std::vector<const Car*>& in_players)
+{
+    std::fill(m_bucketActive.begin(), m_bucketActive.end(), 0);
+    for(auto i = in_players.begin() ; i != in_players.end() ; ++i) {
+        const Vector& p = (*i)->pos();
+        const int x0 = static_cast<int>(std::floor((p.x() - m_fActiveRadius) / D_TRAFFIC_CELL_SIZE));
+        const int z0 = static_cast<int>(std::floor((p.z() - m_fActiveRadius) / D_TRAFFIC_CELL_SIZE));
+        const int x1 = static_cast<int>(std::floor((p.x() + m_fActiveRadius) / D_TRAFFIC_CELL_SIZE));
+        const int z1 = static_cast<int>(std::floor((p.z() + m_fActiveRadius) / D_TRAFFIC_CELL_SIZE));
+        for(int cz = z0 ; cz <= z1 ; ++cz) {
+            for(int cx = x0 ; cx <= x1 ; ++cx) {
+                m_bucketActive[this->bucket(cx, cz)] = 1;
+            }
+        }
+    }
+
+    m_nActive = 0;
+    for(std::size_t i = 0 ; i < m_cars.size() ; ++i) {
+        m_nActive += m_bucketActive[m_bucketOf[i]];
+    }
+}
+
+void Traffic::near(float in_fX, float in_fZ, float in_fRadius, std::vector<std::pair<float, uint32_t>>& out_cars) const
+{
+    if(m_sorted.empty())
+        return;
+
+    const int x0 = static_cast<int>(std::floor((in_fX - in_fRadius) / D_TRAFFIC_CELL_SIZE));
+    const int z0 = static_cast<int>(std::floor((in_fZ - in_fRadius) / D_TRAFFIC_CELL_SIZE));
+    const int x1 = static_cast<int>(std::floor((in_fX + in_fRadius) / D_TRAFFIC_CELL_SIZE));
+    const int z1 = static_cast<int>(std::floor((in_fZ + in_fRadius) / D_TRAFFIC_CELL_SIZE));
+    for(int cz = z0 ; cz <= z1 ; ++cz) {
+        for(int cx = x0 ; cx <= x1 ; ++cx) {
+            const uint32_t b = this->bucket(cx, cz);
+            for(uint32_t k = m_bucketStart[b] ; k < m_bucketStart[b + 1] ; ++k) {
+                // Not the players, and only once: other cells of the ones
+                // looked at may share the bucket.
+                const uint32_t j = m_sorted[k];
+                if(j >= m_cars.size() || static_cast<int>(std::floor(m_x[j] / D_TRAFFIC_CELL_SIZE)) != cx
+                                      || static_cast<int>(std::floor(m_z[j] / D_TRAFFIC_CELL_SIZE)) != cz)
+                    continue;
+                const float dx = m_x[j] - in_fX, dz = m_z[j] - in_fZ;
+                const float d2 = dx*dx + dz*dz;
+                if(d2 <= in_fRadius*in_fRadius)
+                    out_cars.push_back(std::make_pair(d2, j));
+            }
+        }
+    }
+}
+
+float Traffic::gap(std::size_t in_car, float& out_fSpeed) const
+{
+    const std::size_t players = m_cars.size();
+    const float x = m_x[in_car], z = m_z[in_car];
+    const float fx = m_fx[in_car], fz = m_fz[in_car];
+
+    // All the cells between the car and as far as it looks.
+    const float ex = x + fx * D_TRAFFIC_SIGHT, ez = z + fz * D_TRAFFIC_SIGHT;
+    const int x0 = static_cast<int>(std::floor((std::min(x, ex) - D_TRAFFIC_LANE_HALF_WIDTH) / D_TRAFFIC_CELL_SIZE));
+    const int z0 = static_cast<int>(std::floor((std::min(z, ez) - D_TRAFFIC_LANE_HALF_WIDTH) / D_TRAFFIC_CELL_SIZE));
+    const int x1 = static_cast<int>(std::floor((std::max(x, ex) + D_TRAFFIC_LANE_HALF_WIDTH) / D_TRAFFIC_CELL_SIZE));
+    const int z1 = static_cast<int>(std::floor((std::max(z, ez) + D_TRAFFIC_LANE_HALF_WIDTH) / D_TRAFFIC_CELL_SIZE));
+
+    float fGap = D_TRAFFIC_SIGHT;
+    out_fSpeed = D_TRAFFIC_FREE_SPEED;
+    for(int cz = z0 ; cz <= z1 ; ++cz) {
+        for(int cx = x0 ; cx <= x1 ; ++cx) {
+            const uint32_t b = this->bucket(cx, cz);
+            for(uint32_t k = m_bucketStart[b] ; k < m_bucketStart[b + 1] ; ++k) {
+                const uint32_t j = m_sorted[k];
+                const float dx = m_x[j] - x, dz = m_z[j] - z;
+                // There are no collisions between cars, so what's already
+                // alongside is of no concern anymore.
+                const float ahead = dx*fx + dz*fz;
+                if(j == in_car || ahead <= m_half[in_car] || ahead > D_TRAFFIC_SIGHT + m_half[j])
+                    continue;
+                if(std::abs(dx*fz - dz*fx) > D_TRAFFIC_LANE_HALF_WIDTH)
+                    continue;
+
+                // There are no traffic lights yet, so cars only queue up
+                // behind the ones going their way, rather than gridlock at
+                // the crossings. The players are in the way of everybody.
+                const float same = m_fx[j]*fx + m_fz[j]*fz;
+                if(j < players && same < 0.5f)
+                    continue;
+                // Taking a turn, two cars may each be in the other's way. The
+                // first one goes first.
+                if(j < players && j > in_car && -dx*m_fx[j] - dz*m_fz[j] > 0.0f
+                && std::abs(dx*m_fz[j] - dz*m_fx[j]) <= D_TRAFFIC_LANE_HALF_WIDTH)
+                    continue;
+
+                const float g = ahead - m_half[in_car] - m_half[j];
+                if(g < fGap) {
+                    fGap = g;
+                    out_fSpeed = m_speed[j] * same;
+                }
+            }
+        }
+    }
+
+    return fGap;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "CarBatch.h"
+#include "TrafficCar.h"
+
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace RoadRage {
+
+class ThreadPool;
+
+/// All the cars the computer drives around the city.\n
+/// They all move on every frame, but only a share of them decides how to
+/// drive on each one: every car does so once every few frames, the cars
+/// taking turns, which keeps the cost of the frames the same. Those
+/// decisions look for what's ahead in a spatial hash of all cars, rebuilt
+/// every frame, and get spread over the workers. So do the route requests,
+/// which are limited to a few per frame, too; cars without a route drive
+/// around at random until they get one.\n
+/// Cars far from all players are idle: nobody sees what they do, so they
+/// decide and move a few times less often, and drive around at random.
+/// The spatial hash only looks at the cars again once they moved, so idle
+/// cars put elsewhere from the outside are seen there once they move next.
+class Traffic {
+public:
+    /// \param in_nDecisionFrames Every car decides once in that many frames.
+    /// \param in_fActiveRadius How near to a player cars are to not be idle, in meters.
+    /// The cars are made among \a io_entities, which must outlive the traffic.
+    Traffic(Entities& io_entities, const RoadNetwork& in_roads, RoutePlanner& io_routes, unsigned in_nDecisionFrames, float in_fActiveRadius);
+    virtual ~Traffic();
+
+    /// Replaces all cars by \a in_nCars new ones, spread over the roads.
+    void populate(std::size_t in_nCars, unsigned in_seed);
+
+    /// Lets the cars drive, watching out for each other and \a in_players.
+    void think(const GameClock& clock, const std::vector<const Car*>& in_players, ThreadPool& io_workers);
+
+    const std::vector<TrafficCar>& cars() const { return m_cars; }
+    std::vector<TrafficCar>& cars() { return m_cars; }
+    /// Appends the cars that were within \a in_fRadius meters of (\a in_fX,
+    /// \a in_fZ) as of the start of the last think to \a out_cars, as their
+    /// squared distance and index, going by the spatial hash.
+    void near(float in_fX, float in_fZ, float in_fRadius, std::vector<std::pair<float, uint32_t>>& out_cars) const;
+    /// \return How long the last think took, and the decisions of it only, in seconds.
+    float time() const { return m_fTime; }
+    float decisionTime() const { return m_fDecisionTime; }
+    /// \return How many cars made a decision during the last think.
+    std::size_t decisions() const { return m_nDecisions; }
+    /// \return How many cars were near enough to a player not to be idle.
+    std::size_t active() const { return m_nActive; }
+
+private:
+    // No copying!
+    Traffic(const Traffic&);
+    Traffic& operator=(const Traffic&);
+
+    void hash(const std::vector<const Car*>& in_players);
+    /// Marks the buckets within m_fActiveRadius of \a in_players.
+    void activate(const std::vector<const Car*>& in_players);
+    /// \return How much room car \a in_car has in front of it, in meters.
+    /// \param out_fSpeed How fast whatever limits that room is going its way.
+    float gap(std::size_t in_car, float& out_fSpeed) const;
+    uint32_t bucket(int in_x, int in_z) const;
+
+    Entities& m_entities;
+    const RoadNetwork& m_roads;
+    RoutePlanner& m_routes;
+    std::vector<TrafficCar> m_cars;
+    /// Where the cars go. Few enough that cars share their routes.
+    std::vector<uint32_t> m_destinations;
+
+    unsigned m_nDecisionFrames;
+    unsigned m_frame;
+    float m_fActiveRadius;
+    std::atomic<int> m_routeBudget;
+
+    /// Where every car is, where it's heading to, how fast and how long it
+    /// is, as of the start of the frame, with the players' cars last.
+    std::vector<float> m_x, m_z, m_fx, m_fz, m_speed, m_half;
+    /// The cars in bucket b of the spatial hash are
+    /// m_sorted[m_bucketStart[b] .. m_bucketStart[b+1]).
+    std::vector<uint32_t> m_bucketStart;
+    std::vector<uint32_t> m_bucketOf;
+    std::vector<uint32_t> m_sorted;
+    uint32_t m_bucketMask;
+    /// Whether the cars in a bucket may be near a player. Buckets are shared
+    /// by cells, so some may not be.
+    std::vector<uint8_t> m_bucketActive;
+    /// Whether all cars need to be hashed anew, rather than only the ones
+    /// that moved during the last frame.
+    bool m_bHashAll;
+
+    /// Moves all the cars at once, after they decided how, or rather the
+    /// ones among m_moving, the active ones first.
+    CarBatch m_batch;
+    std::vector<uint32_t> m_moving;
+
+    float m_fTime;
+    float m_fDecisionTime;
+    std::atomic<std::size_t> m_nDecisions;
+    std::size_t m_nActive;
+};
+
+}
@@ -0,0 +1,223 @@
+#include "TrafficCar.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace RoadRage;
+
+/// How far ahead of itself a car steers towards, at least and per m/s.
+#define D_TRAFFIC_LOOKAHEAD 4.0f
+#define D_TRAFFIC_LOOKAHEAD_PER_SPEED 0.5f
+/// How fast cars take turns, in m/s.
+#define D_TRAFFIC_TURN_SPEED 5.0f
+/// How hard drivers plan to slow down, in m/s^2. Braking is much harder.
+#define D_TRAFFIC_DECEL 3.0f
+/// How much room drivers leave to what's ahead, in meters and seconds.
+#define D_TRAFFIC_MIN_GAP 2.0f
+#define D_TRAFFIC_HEADWAY 1.0f
+/// How far off their speed drivers let themselves be before doing
+/// something about it, and before braking instead of rolling, in m/s.
+#define D_TRAFFIC_SPEED_SLACK 1.0f
+#define D_TRAFFIC_BRAKE_SLACK 3.0f
+/// Below that speed, in m/s, cars don't bother steering.
+#define D_TRAFFIC_STOP_SPEED 0.5f
+/// How hard drivers step on the gas when setting off, in m/s^2.
+#define D_TRAFFIC_START_ACCEL 2.5f
+/// A car this far from its lane, in meters, looks for another one.
+#define D_TRAFFIC_LOST_DISTANCE 10.0f
+
+static inline uint32_t mix(uint32_t in_x)
+{
+    in_x ^= in_x >> 16;
+    in_x *= 0x7feb352du;
+    in_x ^= in_x >> 15;
+    in_x *= 0x846ca68bu;
+    in_x ^= in_x >> 16;
+    return in_x;
+}
+
+Driver::Driver(uint32_t in_id, uint32_t in_lane, float in_fTemper)
+    : id(in_id)
+    , nRandom(0)
+    , lane(in_lane)
+    , next(in_lane)
+    , routePos(0)
+    , fTemper(in_fTemper)
+{
+}
+
+Entity TrafficCar::create(Entities& io_entities, const RoadNetwork& in_roads, uint32_t in_lane, float in_t, uint32_t in_id)
+{
+    // The car model turns the whole car by the steering angle, so that is
+    // where it's heading. Let it go all the way around.
+    const Lane& l = in_roads.lane(in_lane);
+    const float fHeading = std::atan2(l.start[0] - l.end[0], l.start[1] - l.end[1]);
+    const Entity e = io_entities.create(Transform(in_roads.pointOnLane(in_lane, in_t) + Vector(0.0f, 0.75f, 0.0f), fHeading, Vector(0.9f, 0.75f, 2.2f)),
+                                        Driving(),
+                                        Driver(in_id, in_lane, 0.9f + 0.2f * static_cast<float>(mix(in_id) >> 16) / 65535.0f));
+
+    TrafficCar car(io_entities, in_roads, e);
+    car.maxSteeringAngle(360.0f*deg2rad);
+    car.steeringAngle(fHeading);
+    Driver& d = car.driver();
+    d.next = car.nextLane(d);
+    return e;
+}
+
+TrafficCar::TrafficCar(Entities& io_entities, const RoadNetwork& in_roads, Entity in_entity)
+    : Car(io_entities, in_entity)
+    , m_pRoads(&in_roads)
+{
+}
+
+TrafficCar::~TrafficCar()
+{
+}
+
+void TrafficCar::drive(float in_fGap, float in_fGapSpeed, float in_fInterval)
+{
+    const RoadNetwork& roads = *m_pRoads;
+    Driver& d = this->driver();
+
+    // Where on its lane the car is, in meters from its start. Once past its
+    // end, the next one takes over.
+    const Vector p = this->pos();
+    auto along = [&p](const Lane& l, float& out_fSide) {
+        const float dx = (l.end[0] - l.start[0]) / l.length, dz = (l.end[1] - l.start[1]) / l.length;
+        const float x = p.x() - l.start[0], z = p.z() - l.start[1];
+        out_fSide = std::abs(x*dz - z*dx);
+        return x*dx + z*dz;
+    };
+    float fSide = 0.0f;
+    float s = along(roads.lane(d.lane), fSide);
+    if(s > roads.lane(d.lane).length) {
+        d.lane = d.next;
+        d.next = this->nextLane(d);
+        s = along(roads.lane(d.lane), fSide);
+    }
+
+    // Got pushed off the road somehow.
+    if(fSide > D_TRAFFIC_LOST_DISTANCE) {
+        float t = 0.0f;
+        if(roads.nearestLane(p, this->forward(), d.lane, t)) {
+            d.route.reset();
+            d.next = this->nextLane(d);
+            s = along(roads.lane(d.lane), fSide);
+        }
+    }
+
+    const Lane& l = roads.lane(d.lane);
+    const Lane& next = roads.lane(d.next);
+    const float fLeft = std::max(l.length - s, 0.0f);
+
+    // Steer towards a point ahead on the lane, or around the corner already.
+    const float fSpeed = this->speed();
+    const float fAhead = D_TRAFFIC_LOOKAHEAD + fSpeed * D_TRAFFIC_LOOKAHEAD_PER_SPEED;
+    const Vector target = fAhead < fLeft
+                        ? roads.pointOnLane(d.lane, (std::max(s, 0.0f) + fAhead) / l.length)
+                        : roads.pointOnLane(d.next, std::min((fAhead - fLeft) / next.length, 1.0f));
+    if(fSpeed > D_TRAFFIC_STOP_SPEED) {
+        float fTurn = std::atan2(p.x() - target.x(), p.z() - target.z()) - this->steeringAngle();
+        while(fTurn > pi) fTurn -= 2.0f*pi;
+        while(fTurn < -pi) fTurn += 2.0f*pi;
+        this->steeringVel(fTurn / in_fInterval);
+    } else {
+        this->steeringVel(0.0f);
+    }
+
+    // The speed limit, unless there's a turn or a slower street coming up
+    // which we need to slow down for in time...
+    const float fCos = ((l.end[0] - l.start[0])*(next.end[0] - next.start[0])
+                      + (l.end[1] - l.start[1])*(next.end[1] - next.start[1])) / (l.length * next.length);
+    float fNext = next.speedLimit * d.fTemper;
+    if(fCos < 0.9f)
+        fNext = std::min(fNext, D_TRAFFIC_TURN_SPEED);
+    float fTarget = std::min(l.speedLimit * d.fTemper, std::sqrt(fNext*fNext + 2.0f*D_TRAFFIC_DECEL*fLeft));
+
+    // ...or something in the way.
+    const float fRoom = in_fGap - D_TRAFFIC_MIN_GAP - fSpeed * D_TRAFFIC_HEADWAY;
+    const float fGapSpeed = std::max(in_fGapSpeed, 0.0f);
+    fTarget = std::min(fTarget, fRoom > 0.0f ? std::sqrt(fGapSpeed*fGapSpeed + 2.0f*D_TRAFFIC_DECEL*fRoom) : 0.0f);
+
+    if(fSpeed > fTarget + D_TRAFFIC_SPEED_SLACK) {
+        this->state(fSpeed > fTarget + D_TRAFFIC_BRAKE_SLACK || in_fGap < D_TRAFFIC_MIN_GAP ? CarState::Breaking : CarState::Rolling);
+    } else if(fTarget <= 0.0f) {
+        this->state(CarState::Standing);
+    } else {
+        // Speeding up to the target, and cruising there.
+        this->maxSpeed(fTarget);
+        this->state(CarState::Driving);
+    }
+}
+
+bool TrafficCar::needsRoute() const
+{
+    const Driver& d = this->driver();
+    return !d.route || d.routePos >= d.route->size();
+}
+
+void TrafficCar::route(const RoutePlanner::Route& in_route)
+{
+    // The route leads on from the lane after the current one, unless it
+    // starts by turning around, which is best left to chance.
+    const RoadNetwork& roads = *m_pRoads;
+    Driver& d = this->driver();
+    const Lane& next = roads.lane(d.next);
+    d.route.reset();
+    d.routePos = 0;
+    if(in_route && !in_route->empty() && roads.lane((*in_route)[0]).from == next.to
+    && roads.lane((*in_route)[0]).to != next.from)
+        d.route = in_route;
+}
+
+uint32_t TrafficCar::nextIntersection() const
+{
+    return m_pRoads->lane(this->driver().next).to;
+}
+
+Vector TrafficCar::forward() const
+{
+    return Vector(-std::sin(this->steeringAngle()), 0.0f, -std::cos(this->steeringAngle()));
+}
+
+float TrafficCar::halfLength() const
+{
+    return this->scale().z();
+}
+
+bool TrafficCar::onEnteringNewState(CarState::Enum next)
+{
+    // Step on the gas right away, rather than starting from wherever
+    // braking left it.
+    if(next == CarState::Driving)
+        this->accel(std::max(this->accel(), D_TRAFFIC_START_ACCEL));
+
+    return Car::onEnteringNewState(next);
+}
+
+uint32_t TrafficCar::nextLane(Driver& io_driver) const
+{
+    const RoadNetwork& roads = *m_pRoads;
+    const Lane& l = roads.lane(io_driver.lane);
+    if(io_driver.route && io_driver.routePos < io_driver.route->size() && roads.lane((*io_driver.route)[io_driver.routePos]).from == l.to)
+        return (*io_driver.route)[io_driver.routePos++];
+    io_driver.route.reset();
+
+    // Anywhere but back, unless it's a dead end.
+    const std::size_t n = roads.outLaneCount(l.to);
+    if(n == 0)
+        return io_driver.lane;
+
+    const std::size_t first = TrafficCar::random(io_driver) % n;
+    for(std::size_t i = 0 ; i < n ; ++i) {
+        const uint32_t out = roads.outLane(l.to, (first + i) % n);
+        if(roads.lane(out).to != l.from)
+            return out;
+    }
+    return roads.outLane(l.to, first);
+}
+
+uint32_t TrafficCar::random(Driver& io_driver)
+{
+    return mix(io_driver.id ^ mix(io_driver.nRandom++ ^ 0x9e3779b9u));
+}
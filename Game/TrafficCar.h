@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Car.h"
+#include "RoadNetwork.h"
+#include "RoutePlanner.h"
+
+#include <stdint.h>
+
+namespace RoadRage {
+
+/// Makes a car one of the ambient traffic, with what its driver has in mind.
+struct Driver {
+    Driver(uint32_t in_id, uint32_t in_lane, float in_fTemper);
+
+    uint32_t id;
+    /// How many random numbers it drew so far.
+    uint32_t nRandom;
+
+    uint32_t lane;
+    /// The lane after the current one, picked ahead for looking ahead.
+    uint32_t next;
+    RoutePlanner::Route route;
+    /// Which lane of the route comes after next.
+    std::size_t routePos;
+    /// How fast this driver likes to go, relative to the speed limit.
+    float fTemper;
+};
+
+/// A car of the ambient traffic, driven by the computer through the same
+/// states as the avatar is by the keyboard. It follows the lanes of the
+/// roads, keeps to their speed limits, slows down for turns and brakes for
+/// whatever is ahead of it. Where it goes is up to its route, or chance if it
+/// has none.\n
+/// The decisions are made a few times a second only, by drive; the Traffic
+/// moves the car on every frame, according to the last decision.
+class TrafficCar : public Car {
+public:
+    /// Adds a new car to \a io_entities, on \a in_lane, \a in_t along it, 0
+    /// being its start and 1 its end. \a in_id makes every car choose
+    /// differently.
+    static Entity create(Entities& io_entities, const RoadNetwork& in_roads, uint32_t in_lane, float in_t, uint32_t in_id);
+
+    TrafficCar(Entities& io_entities, const RoadNetwork& in_roads, Entity in_entity);
+    virtual ~TrafficCar();
+
+    /// Decides how to drive for the next \a in_fInterval seconds.
+    /// \param in_fGap How much room there is in front of the car, in meters.
+    /// \param in_fGapSpeed How fast whatever limits that room goes, in m/s.
+    void drive(float in_fGap, float in_fGapSpeed, float in_fInterval);
+
+    /// \return Whether the car would like a new route, which then leads from
+    ///         nextIntersection. Routes that start by turning around there
+    ///         get refused, the car will ask again from further on.
+    bool needsRoute() const;
+    void route(const RoutePlanner::Route& in_route);
+    /// \return The intersection at the end of the lane after the current one.
+    uint32_t nextIntersection() const;
+    uint32_t id() const { return this->driver().id; }
+
+    /// Where the car is heading, which isn't quite where it's facing.
+    Vector forward() const;
+    /// Half the length of the car, in meters.
+    float halfLength() const;
+
+protected:
+    virtual bool onEnteringNewState(CarState::Enum next);
+
+private:
+    uint32_t nextLane(Driver& io_driver) const;
+    /// \return A random number, different for every call.
+    static uint32_t random(Driver& io_driver);
+
+    Driver& driver() { return *m_pEntities->get<Driver>(m_entity); }
+    const Driver& driver() const { return *m_pEntities->get<Driver>(m_entity); }
+
+    const RoadNetwork* m_pRoads;
+};
+
+}
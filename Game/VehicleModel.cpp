@@ -0,0 +1,211 @@
+#include "VehicleModel.h"
+
+#include "Utilities/Math.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace RoadRage;
+
+/// In m/s^2.
+#define D_VEHICLE_GRAVITY 9.81f
+/// The shape of the tires' force curve: past the peak, it drops to 90%.
+#define D_VEHICLE_TIRE_SHAPE 1.3f
+/// Below this speed in m/s, the slip angles are taken as if driving this
+/// fast, and the tires' lateral forces fade out towards standing. Slip angles
+/// are meaningless when (nearly) standing: they'd make the car jitter, and
+/// the steering alone would turn it on the spot.
+#define D_VEHICLE_SLIP_MIN_SPEED 1.0f
+/// The gearbox shifts up above this share of the redline, down below the other.
+#define D_VEHICLE_SHIFT_UP 0.9f
+#define D_VEHICLE_SHIFT_DOWN 0.4f
+/// The most it may be asked to advance at once, in s. More would only be a hitch.
+#define D_VEHICLE_MAX_ADVANCE 0.25f
+
+VehicleParams::VehicleParams()
+    : mass(1300.0f)
+    , yawInertia(2200.0f)
+    , cgToFront(1.2f)
+    , cgToRear(1.4f)
+    , cgHeight(0.55f)
+    , maxSteering(35.0f*deg2rad)
+    , corneringFront(90000.0f)
+    , corneringRear(110000.0f)
+    , grip(1.0f)
+    , wheelRadius(0.32f)
+    , engineTorque(320.0f)
+    , enginePower(120000.0f)
+    , engineIdle(85.0f)
+    , engineRedline(680.0f)
+    , finalDrive(3.7f)
+    , efficiency(0.85f)
+    , brakeForce(16000.0f)
+    , brakeBias(0.65f)
+    , drag(0.4f)
+    , rollingResistance(0.012f)
+{
+    static const float ratios[] = {3.4f, 2.2f, 1.5f, 1.15f, 0.92f};
+    gears.assign(ratios, ratios + sizeof(ratios)/sizeof(ratios[0]));
+}
+
+VehicleModel::VehicleModel(const VehicleParams& in_params, float in_fSubstepRate)
+    : m_params(in_params)
+    , m_fSubstep(1.0f / clamp(in_fSubstepRate, 30.0f, 1000.0f))
+    , m_fLeftover(0.0f)
+    , m_fWheelbase(in_params.cgToFront + in_params.cgToRear)
+    , m_fThrottle(0.0f)
+    , m_fBrake(0.0f)
+    , m_fSteering(0.0f)
+    , m_fSteeringSin(0.0f)
+    , m_fSteeringCos(1.0f)
+    , m_fX(0.0f)
+    , m_fZ(0.0f)
+    , m_fHeading(0.0f)
+    , m_fVx(0.0f)
+    , m_fVy(0.0f)
+    , m_fYawRate(0.0f)
+    , m_fAx(0.0f)
+    , m_gear(0)
+{
+    if(m_params.gears.empty())
+        m_params.gears.push_back(1.0f);
+
+    // The tire curves are as steep as the cornering stiffness at the load
+    // of standing. As that stiffness grows with the load just like the
+    // grip does, that's all it takes for every load.
+    const float fLoadFront = m_params.mass * D_VEHICLE_GRAVITY * m_params.cgToRear / m_fWheelbase;
+    const float fLoadRear = m_params.mass * D_VEHICLE_GRAVITY * m_params.cgToFront / m_fWheelbase;
+    m_fShapeFront = m_params.corneringFront / (D_VEHICLE_TIRE_SHAPE * m_params.grip * fLoadFront);
+    m_fShapeRear = m_params.corneringRear / (D_VEHICLE_TIRE_SHAPE * m_params.grip * fLoadRear);
+}
+
+VehicleModel::~VehicleModel()
+{
+}
+
+void VehicleModel::place(float in_fX, float in_fZ, float in_fHeading, float in_fSpeed)
+{
+    m_fX = in_fX;
+    m_fZ = in_fZ;
+    m_fHeading = in_fHeading;
+    m_fVx = std::max(in_fSpeed, 0.0f);
+    m_fVy = m_fYawRate = m_fAx = 0.0f;
+    m_fLeftover = 0.0f;
+
+    // In the gear it would be in, driving that fast.
+    m_gear = 0;
+    while(m_gear + 1 < m_params.gears.size() && this->engineSpeed() > D_VEHICLE_SHIFT_UP * m_params.engineRedline)
+        ++m_gear;
+}
+
+VehicleModel::Motion VehicleModel::motion() const
+{
+    Motion m;
+    m.fVy = m_fVy;
+    m.fYawRate = m_fYawRate;
+    m.gear = m_gear;
+    m.fLeftover = m_fLeftover;
+    return m;
+}
+
+void VehicleModel::motion(const Motion& in_motion)
+{
+    m_fVy = in_motion.fVy;
+    m_fYawRate = in_motion.fYawRate;
+    m_gear = std::min<unsigned>(in_motion.gear, static_cast<unsigned>(m_params.gears.size()) - 1);
+    m_fLeftover = clamp(in_motion.fLeftover, 0.0f, m_fSubstep);
+}
+
+void VehicleModel::controls(float in_fThrottle, float in_fBrake, float in_fSteering)
+{
+    m_fThrottle = clamp(in_fThrottle, 0.0f, 1.0f);
+    m_fBrake = clamp(in_fBrake, 0.0f, 1.0f);
+
+    // The steering stays the same for all substeps until the next call.
+    m_fSteering = clamp(in_fSteering, -m_params.maxSteering, m_params.maxSteering);
+    m_fSteeringSin = std::sin(m_fSteering);
+    m_fSteeringCos = std::cos(m_fSteering);
+}
+
+void VehicleModel::advance(float in_fDeltaT)
+{
+    // Frames of a whole amount of substeps shouldn't miss one to rounding.
+    m_fLeftover += std::min(in_fDeltaT, D_VEHICLE_MAX_ADVANCE);
+    while(m_fLeftover >= m_fSubstep * 0.999f) {
+        this->substep();
+        m_fLeftover -= m_fSubstep;
+    }
+}
+
+float VehicleModel::engineSpeed() const
+{
+    return m_fVx / m_params.wheelRadius * this->wheelsPerEngine();
+}
+
+void VehicleModel::substep()
+{
+    const VehicleParams& p = m_params;
+    const float h = m_fSubstep;
+    const float a = p.cgToFront, b = p.cgToRear;
+    const float fSin = m_fSteeringSin, fCos = m_fSteeringCos;
+
+    // Accelerating pushes the car's weight onto the rear wheels, braking
+    // onto the front ones, which is what the tires' grip depends on.
+    const float fTransfer = p.mass * m_fAx * p.cgHeight / m_fWheelbase;
+    const float fGripFront = p.grip * std::max(p.mass * D_VEHICLE_GRAVITY * b / m_fWheelbase - fTransfer, 0.0f);
+    const float fGripRear = p.grip * std::max(p.mass * D_VEHICLE_GRAVITY * a / m_fWheelbase + fTransfer, 0.0f);
+
+    // The engine drives the rear wheels, and the brakes only ever slow the
+    // car down: there's no going backwards.
+    float fDrive = 0.0f;
+    if(m_fThrottle > 0.0f) {
+        const float fEngine = std::max(this->engineSpeed(), p.engineIdle);
+        if(fEngine < p.engineRedline)
+            fDrive = m_fThrottle * std::min(p.engineTorque, p.enginePower / fEngine)
+                   * this->wheelsPerEngine() * p.efficiency / p.wheelRadius;
+    }
+    const float fBrake = m_fVx > 0.0f ? m_fBrake * p.brakeForce : 0.0f;
+    const float fxFront = clamp(-fBrake * p.brakeBias, -fGripFront, fGripFront);
+    const float fxRear = clamp(fDrive - fBrake * (1.0f - p.brakeBias), -fGripRear, fGripRear);
+
+    // Whatever grip the tires have left goes into the lateral force of
+    // their slip angle, the angle between where they point and go. Slowly,
+    // that fades with how fast each axle moves, down to nothing standing.
+    const float fVx = std::max(m_fVx, D_VEHICLE_SLIP_MIN_SPEED);
+    const float fVyFront = m_fVy + a * m_fYawRate, fVyRear = m_fVy - b * m_fYawRate;
+    const float fFadeFront = std::min(std::sqrt(m_fVx*m_fVx + fVyFront*fVyFront) / D_VEHICLE_SLIP_MIN_SPEED, 1.0f);
+    const float fFadeRear = std::min(std::sqrt(m_fVx*m_fVx + fVyRear*fVyRear) / D_VEHICLE_SLIP_MIN_SPEED, 1.0f);
+    const float fSlipFront = std::atan2(fVyFront, fVx) - m_fSteering;
+    const float fSlipRear = std::atan2(fVyRear, fVx);
+    const float fyFront = -fFadeFront * std::sqrt(std::max(fGripFront*fGripFront - fxFront*fxFront, 0.0f))
+                        * std::sin(D_VEHICLE_TIRE_SHAPE * std::atan(m_fShapeFront * fSlipFront));
+    const float fyRear = -fFadeRear * std::sqrt(std::max(fGripRear*fGripRear - fxRear*fxRear, 0.0f))
+                       * std::sin(D_VEHICLE_TIRE_SHAPE * std::atan(m_fShapeRear * fSlipRear));
+
+    // Everything in the car's frame: x forward, y to the left.
+    const float fResist = -p.drag * m_fVx * m_fVx - (m_fVx > 0.0f ? p.rollingResistance * p.mass * D_VEHICLE_GRAVITY : 0.0f);
+    const float fx = fxRear + fxFront * fCos - fyFront * fSin + fResist;
+    const float fy = fyRear + fxFront * fSin + fyFront * fCos;
+    const float fTorque = a * (fyFront * fCos + fxFront * fSin) - b * fyRear;
+
+    // Semi-implicit Euler: first the velocities, then the positions with them.
+    m_fAx = fx / p.mass;
+    const float fOldVx = m_fVx;
+    m_fVx = std::max(m_fVx + h * (m_fAx + m_fVy * m_fYawRate), 0.0f);
+    m_fVy += h * (fy / p.mass - fOldVx * m_fYawRate);
+    m_fYawRate += h * fTorque / p.yawInertia;
+
+    m_fHeading += h * m_fYawRate;
+    if(m_fHeading > 2.0f*pi) m_fHeading -= 2.0f*pi;
+    if(m_fHeading < -2.0f*pi) m_fHeading += 2.0f*pi;
+    const float fHeadingSin = std::sin(m_fHeading), fHeadingCos = std::cos(m_fHeading);
+    m_fX += h * (-fHeadingSin * m_fVx - fHeadingCos * m_fVy);
+    m_fZ += h * (-fHeadingCos * m_fVx + fHeadingSin * m_fVy);
+
+    // The automatic gearbox.
+    const float fEngine = this->engineSpeed();
+    if(fEngine > D_VEHICLE_SHIFT_UP * p.engineRedline && m_gear + 1 < p.gears.size())
+        ++m_gear;
+    else if(fEngine < D_VEHICLE_SHIFT_DOWN * p.engineRedline && m_gear > 0)
+        --m_gear;
+}
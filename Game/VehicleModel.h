@@ -0,0 +1,122 @@
+#pragma once
+
+#include <vector>
+
+namespace RoadRage {
+
+/// What a car is like, physically. The defaults are those of an ordinary
+/// rear-wheel-driven sedan. Everything is in SI units.
+struct VehicleParams {
+    VehicleParams();
+
+    float mass;             ///< In kg.
+    float yawInertia;       ///< Around the vertical axis through the center of gravity, in kg m^2.
+    float cgToFront;        ///< From the center of gravity to the front axle, in m.
+    float cgToRear;         ///< From the center of gravity to the rear axle, in m.
+    float cgHeight;         ///< How high up the center of gravity is, in m.
+    float maxSteering;      ///< How far the front wheels turn, in rad.
+
+    float corneringFront;   ///< Lateral force of the front tires per slip angle, at rest, in N/rad.
+    float corneringRear;    ///< The same for the rear tires.
+    float grip;             ///< The tires' friction coefficient with the road.
+
+    float wheelRadius;      ///< In m.
+    float engineTorque;     ///< The most the engine gives, in Nm.
+    float enginePower;      ///< And never more than this, in W.
+    float engineIdle;       ///< The slowest the engine turns, the clutch slipping below, in rad/s.
+    float engineRedline;    ///< The fastest it may turn, in rad/s.
+    std::vector<float> gears; ///< The gear ratios, first one first.
+    float finalDrive;       ///< The ratio of the differential.
+    float efficiency;       ///< How much of the engine's torque gets to the wheels.
+
+    float brakeForce;       ///< Of all the brakes together, in N.
+    float brakeBias;        ///< The share of it at the front.
+    float drag;             ///< Air resistance per squared speed, in N s^2/m^2.
+    float rollingResistance;///< As a share of the weight.
+};
+
+/// A car's driving physics as a bicycle model: both wheels of an axle are
+/// merged into one, and the car moves in the plane. The tires get the
+/// forces of their slip angles from a simplified Pacejka curve, scaled by
+/// the load on them, which moves between the axles under acceleration.
+/// Together with the drive and brake forces, they may use no more than
+/// their grip. The engine drives the rear wheels through an automatic
+/// gearbox; there is no reverse gear.\n
+/// The forces change far quicker than frames come, so the model is stepped
+/// at its own fixed rate, as often as fits into the time it's asked to
+/// advance, carrying the rest over to the next time. That keeps it stable,
+/// and the same whatever the frame rate is.
+class VehicleModel {
+public:
+    /// \param in_fSubstepRate How often per second to step, at most 1kHz.
+    VehicleModel(const VehicleParams& in_params = VehicleParams(), float in_fSubstepRate = 1000.0f);
+    virtual ~VehicleModel();
+
+    /// Puts the car at (\a in_fX, \a in_fZ), heading into \a in_fHeading,
+    /// which is in the same sense as Transform::ori, going straight at
+    /// \a in_fSpeed m/s.
+    void place(float in_fX, float in_fZ, float in_fHeading, float in_fSpeed = 0.0f);
+
+    /// What place leaves out, but driving on depends on: how the car slides
+    /// and turns, its gear, and how far into the next substep it is.
+    struct Motion {
+        float fVy, fYawRate;
+        unsigned gear;
+        float fLeftover;
+    };
+    Motion motion() const;
+    /// Puts that back to \a in_motion, leaving where the car is be.
+    void motion(const Motion& in_motion);
+
+    /// What the driver does until the next call.
+    /// \param in_fThrottle From 0 to 1.
+    /// \param in_fBrake From 0 to 1.
+    /// \param in_fSteering The angle of the front wheels, positive to the
+    ///                     left. It's clamped to VehicleParams::maxSteering.
+    void controls(float in_fThrottle, float in_fBrake, float in_fSteering);
+
+    /// Moves on by \a in_fDeltaT seconds, up to a quarter of a second.
+    void advance(float in_fDeltaT);
+
+    float x() const { return m_fX; }
+    float z() const { return m_fZ; }
+    float heading() const { return m_fHeading; }
+    /// Along the car, in m/s.
+    float forwardSpeed() const { return m_fVx; }
+    /// Across the car, positive to the left, in m/s.
+    float lateralSpeed() const { return m_fVy; }
+    /// In rad/s, positive to the left.
+    float yawRate() const { return m_fYawRate; }
+    /// Along the car, in m/s^2.
+    float forwardAccel() const { return m_fAx; }
+    /// Towards the center of the turn, in m/s^2.
+    float lateralAccel() const { return m_fVx * m_fYawRate; }
+    /// Starting at 0 for the first gear.
+    unsigned gear() const { return m_gear; }
+    /// In rad/s.
+    float engineSpeed() const;
+    float substepRate() const { return 1.0f / m_fSubstep; }
+    const VehicleParams& params() const { return m_params; }
+
+private:
+    void substep();
+    float wheelsPerEngine() const { return m_params.gears[m_gear] * m_params.finalDrive; }
+
+    VehicleParams m_params;
+    float m_fSubstep;
+    float m_fLeftover;
+
+    // Derived from the params once.
+    float m_fWheelbase;
+    float m_fShapeFront, m_fShapeRear;
+
+    float m_fThrottle, m_fBrake;
+    float m_fSteering, m_fSteeringSin, m_fSteeringCos;
+
+    float m_fX, m_fZ, m_fHeading;
+    float m_fVx, m_fVy, m_fYawRate;
+    float m_fAx;
+    unsigned m_gear;
+};
+
+}
@@ -0,0 +1,87 @@
+#include "World.h"
+
+#include "Utilities/Hash.h"
+#include "Utilities/String.h"
+#include "Utilities/ThreadPool.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace RoadRage;
+
+World::World(const Configuration& in_settings, const FileSystem& in_fs, const std::string& in_sName, ThreadPool& io_workers)
+    : m_sName(in_sName)
+    , m_workers(io_workers)
+    , m_routes(m_roads, to<std::size_t>(in_settings.get("RouteCacheSize")), io_workers.size())
+    , m_traffic(m_entities, m_roads, m_routes, to<unsigned>(in_settings.get("TrafficDecisionFrames")),
+                to<float>(in_settings.get("TrafficActiveRadius")))
+    , m_bThinkPlayers(true)
+    , m_bVehiclePhysics(to<bool>(in_settings.get("VehiclePhysics")))
+    , m_fSubstepRate(to<float>(in_settings.get("VehicleSubstepRate")))
+{
+    // The roads are made and preprocessed by roadrage_roads. Without them,
+    // they are laid out along the generated chunks, which makes routing
+    // slower as there is no time to preprocess them here.
+    FileView roads = in_fs.read("Levels/" + in_sName + "/roads.bin");
+    if(!roads.valid() || !m_roads.load(roads.data(), roads.size())) {
+        m_roads.generate(to<float>(in_settings.get("ChunkSize")),
+                         to<int>(in_settings.get("RoadNetworkRadius")),
+                         static_cast<unsigned>(fnv1a("Levels/" + in_sName)));
+    }
+
+    // The same level always has the same cars, so that everybody starts out
+    // with the same traffic.
+    m_traffic.populate(to<std::size_t>(in_settings.get("TrafficCars")),
+                       static_cast<unsigned>(fnv1a("Levels/" + in_sName)));
+}
+
+World::~World()
+{
+}
+
+Avatar& World::addPlayer(uint32_t in_id)
+{
+    auto i = m_players.find(in_id);
+    if(i != m_players.end())
+        return i->second;
+
+    Avatar& player = m_players.insert(std::make_pair(in_id, Avatar(m_entities, Avatar::create(m_entities, in_id)))).first->second;
+    if(m_bVehiclePhysics)
+        player.physics(VehicleParams(), m_fSubstepRate);
+
+    m_playerCars.push_back(&player);
+    return player;
+}
+
+void World::removePlayer(uint32_t in_id)
+{
+    auto i = m_players.find(in_id);
+    if(i == m_players.end())
+        return;
+
+    m_playerCars.erase(std::find(m_playerCars.begin(), m_playerCars.end(), &i->second));
+    m_entities.destroy(i->second.entity());
+    m_players.erase(i);
+}
+
+Avatar* World::player(uint32_t in_id)
+{
+    auto i = m_players.find(in_id);
+    return i == m_players.end() ? 0 : &i->second;
+}
+
+const Avatar* World::player(uint32_t in_id) const
+{
+    auto i = m_players.find(in_id);
+    return i == m_players.end() ? 0 : &i->second;
+}
+
+void World::think(const GameClock& clock)
+{
+    for(auto i = m_players.begin() ; m_bThinkPlayers && i != m_players.end() ; ++i) {
+        i->second.think(clock);
+    }
+
+    // The traffic keeps out of the players' way, if it can.
+    m_traffic.think(clock, m_playerCars, m_workers);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Avatar.h"
+#include "Entities.h"
+#include "GameClock.h"
+#include "RoadNetwork.h"
+#include "RoutePlanner.h"
+#include "Traffic.h"
+
+#include "Conf/Configuration.h"
+#include "Utilities/FileSystem.h"
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace RoadRage {
+
+class ThreadPool;
+
+/// Everything of a level the players share: the roads, the traffic on them
+/// and the players' cars. This is what the server simulates for everybody,
+/// and what a client mirrors of it. There's nothing graphical in here; that,
+/// and what's only around a player anyways, like the buildings and the
+/// civilians, is the Level's. The cars are entities, which the Level adds
+/// its civilians to.
+class World {
+public:
+    World(const Configuration& in_settings, const FileSystem& in_fs, const std::string& in_sName, ThreadPool& io_workers);
+    virtual ~World();
+
+    /// Adds the car of player \a in_id at the origin.
+    /// \return The new car, or the existing one if there already is one.
+    Avatar& addPlayer(uint32_t in_id);
+    void removePlayer(uint32_t in_id);
+    /// \return The car of player \a in_id, if there is one.
+    Avatar* player(uint32_t in_id);
+    const Avatar* player(uint32_t in_id) const;
+    const std::map<uint32_t, Avatar>& players() const { return m_players; }
+
+    /// Moves everything on by one frame.
+    void think(const GameClock& clock);
+    /// On a client, the players' cars are driven by the Prediction and the
+    /// Interpolation instead, and on the server by their clients' inputs, so
+    /// that think leaves them be.
+    void thinkPlayers(bool in_b) { m_bThinkPlayers = in_b; }
+
+    const std::string& name() const { return m_sName; }
+    Entities& entities() { return m_entities; }
+    const Entities& entities() const { return m_entities; }
+    const RoadNetwork& roads() const { return m_roads; }
+    RoutePlanner& routes() { return m_routes; }
+    const RoutePlanner& routes() const { return m_routes; }
+    Traffic& traffic() { return m_traffic; }
+    const Traffic& traffic() const { return m_traffic; }
+
+private:
+    // No copying!
+    World(const World&);
+    World& operator=(const World&);
+
+    std::string m_sName;
+    ThreadPool& m_workers;
+
+    /// Everything there is, the traffic's cars and the players' ones among
+    /// it, which must go after it.
+    Entities m_entities;
+
+    /// Where the AI traffic drives, and the routes it takes.
+    RoadNetwork m_roads;
+    RoutePlanner m_routes;
+    Traffic m_traffic;
+
+    std::map<uint32_t, Avatar> m_players;
+    /// The same, for the traffic to watch out for.
+    std::vector<const Car*> m_playerCars;
+    bool m_bThinkPlayers;
+    bool m_bVehiclePhysics;
+    float m_fSubstepRate;
+};
+
+}
@@ -0,0 +1,94 @@
+#include "BitStream.h"
+
+#include <algorithm>
+
+using namespace RoadRage;
+
+BitWriter::BitWriter()
+    : m_nBits(0)
+{
+}
+
+void BitWriter::clear()
+{
+    m_bytes.clear();
+    m_nBits = 0;
+}
+
+void BitWriter::write(uint32_t in_value, unsigned in_nBits)
+{
+    for(unsigned done = 0 ; done < in_nBits ; ) {
+        const unsigned bit = m_nBits & 7;
+        if(bit == 0)
+            m_bytes.push_back(0);
+
+        // As much as still fits into the current byte at once.
+        const unsigned n = std::min(8 - bit, in_nBits - done);
+        const uint32_t chunk = (in_value >> done) & ((1u << n) - 1);
+        m_bytes.back() |= static_cast<uint8_t>(chunk << bit);
+        done += n;
+        m_nBits += n;
+    }
+}
+
+void BitWriter::writeVar(uint32_t in_value)
+{
+    // The prefix tells the size: 0, 10, 110 or 111, read lowest bit first.
+    if(in_value < (1u << 4)) {
+        this->write(0, 1);
+        this->write(in_value, 4);
+    } else if(in_value < (1u << 8)) {
+        this->write(1, 2);
+        this->write(in_value, 8);
+    } else if(in_value < (1u << 16)) {
+        this->write(3, 3);
+        this->write(in_value, 16);
+    } else {
+        this->write(7, 3);
+        this->write(in_value, 32);
+    }
+}
+
+unsigned BitWriter::varBits(uint32_t in_value)
+{
+    return in_value < (1u << 4) ? 5 : in_value < (1u << 8) ? 10 : in_value < (1u << 16) ? 19 : 35;
+}
+
+BitReader::BitReader(const void* in_pData, std::size_t in_nBytes)
+    : m_pData(static_cast<const uint8_t*>(in_pData))
+    , m_nBits(in_nBytes * 8)
+    , m_pos(0)
+    , m_bOverrun(false)
+{
+}
+
+uint32_t BitReader::read(unsigned in_nBits)
+{
+    if(m_pos + in_nBits > m_nBits) {
+        m_bOverrun = true;
+        m_pos = m_nBits;
+        return 0;
+    }
+
+    uint32_t value = 0;
+    for(unsigned done = 0 ; done < in_nBits ; ) {
+        const unsigned bit = m_pos & 7;
+        const unsigned n = std::min(8 - bit, in_nBits - done);
+        const uint32_t chunk = (m_pData[m_pos >> 3] >> bit) & ((1u << n) - 1);
+        value |= chunk << done;
+        done += n;
+        m_pos += n;
+    }
+    return value;
+}
+
+uint32_t BitReader::readVar()
+{
+    if(this->read(1) == 0)
+        return this->read(4);
+    if(this->read(1) == 0)
+        return this->read(8);
+    if(this->read(1) == 0)
+        return this->read(16);
+    return this->read(32);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+namespace RoadRage {
+
+/// Packs values of any number of bits tightly one after the other, lowest
+/// bits first.
+class BitWriter {
+public:
+    BitWriter();
+
+    /// Starts over, keeping the memory.
+    void clear();
+    /// Writes the lowest \a in_nBits of \a in_value, up to 32.
+    void write(uint32_t in_value, unsigned in_nBits);
+    /// Writes \a in_value in as few bits as fit its size: small ones take 5
+    /// bits, the largest ones 35.
+    void writeVar(uint32_t in_value);
+    /// The same, for values that may be negative.
+    void writeSigned(int32_t in_value) { this->writeVar(zigzag(in_value)); }
+
+    /// \return How many bits writeVar takes for \a in_value.
+    static unsigned varBits(uint32_t in_value);
+    static unsigned signedBits(int32_t in_value) { return varBits(zigzag(in_value)); }
+
+    std::size_t bits() const { return m_nBits; }
+    /// The bits written so far, the last byte filled up with zeros.
+    const std::vector<uint8_t>& bytes() const { return m_bytes; }
+
+private:
+    /// Interleaves negative and positive numbers, so that the small ones of
+    /// both stay small.
+    static uint32_t zigzag(int32_t in_value) { return (static_cast<uint32_t>(in_value) << 1) ^ static_cast<uint32_t>(in_value >> 31); }
+
+    std::vector<uint8_t> m_bytes;
+    std::size_t m_nBits;
+};
+
+/// Reads what a BitWriter wrote. Reading past the end gives zeros and makes
+/// it fail.
+class BitReader {
+public:
+    BitReader(const void* in_pData, std::size_t in_nBytes);
+
+    uint32_t read(unsigned in_nBits);
+    uint32_t readVar();
+    int32_t readSigned() { const uint32_t v = this->readVar(); return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1); }
+
+    /// \return Whether everything read so far was there.
+    bool ok() const { return !m_bOverrun; }
+
+private:
+    const uint8_t* m_pData;
+    std::size_t m_nBits;
+    std::size_t m_pos;
+    bool m_bOverrun;
+};
+
+}
@@ -0,0 +1,192 @@
+#include "Client.h"
+
+#include "Utilities/Math.h"
+#include "Utilities/i18n.h"
+
+#include <SFML/System/Sleep.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace RoadRage;
+
+/// While connecting, hello is said again that often, in seconds, in case it
+/// or the welcome got lost.
+#define D_CLIENT_HELLO_INTERVAL 0.25f
+
+Client::Client(const std::string& in_sServer, unsigned short in_port, float in_fTimeout)
+    : m_server(in_sServer)
+    , m_port(in_port)
+    , m_player(0)
+    , m_fTickRate(0.0f)
+    , m_input(0)
+    , m_usedInput(0)
+    , m_bBye(false)
+    , m_fLatency(0.0f)
+    , m_fJitter(0.0f)
+    , m_fLoss(0.0f)
+    , m_nBytesSent(0)
+    , m_nBytesReceived(0)
+    , m_nSnapshots(0)
+{
+    if(m_server == sf::IpAddress::None || m_socket.Bind(sf::Socket::AnyPort) != sf::Socket::Done)
+        throw std::runtime_error(_("Failed to reach the server ") + in_sServer);
+    m_socket.SetBlocking(false);
+
+    sf::Packet packet;
+    sf::Clock timeout, hello;
+    for(bool bFirst = true ; timeout.GetElapsedTime() < in_fTimeout ; bFirst = false) {
+        if(bFirst || hello.GetElapsedTime() >= D_CLIENT_HELLO_INTERVAL) {
+            beginMessage(packet, NetMessage::Hello);
+            packet << static_cast<sf::Uint16>(D_NET_VERSION);
+            this->send(packet);
+            hello.Reset();
+        }
+
+        sf::IpAddress address;
+        unsigned short port = 0;
+        NetMessage::Enum msg;
+        while(m_socket.Receive(packet, address, port) == sf::Socket::Done) {
+            m_nBytesReceived += packet.GetDataSize();
+            if(address != m_server || port != m_port || !readMessage(packet, msg) || msg != NetMessage::Welcome)
+                continue;
+
+            sf::Uint32 player = 0;
+            if(packet >> player >> m_sLevel >> m_fTickRate) {
+                m_player = player;
+                m_lastHeard.Reset();
+                return;
+            }
+        }
+        sf::Sleep(0.005f);
+    }
+
+    throw std::runtime_error(_("The server doesn't answer: ") + in_sServer);
+}
+
+Client::~Client()
+{
+    // There's no later to send it at.
+    this->simulate(0.0f, 0.0f, 0.0f);
+    sf::Packet packet;
+    beginMessage(packet, NetMessage::Bye);
+    this->send(packet);
+}
+
+uint32_t Client::send(const CarInput& in_input)
+{
+    // The ones the server used are of no more use, and the ones that didn't
+    // make it after that many tries are too late anyways.
+    m_inputs.push_back(in_input);
+    ++m_input;
+    while(m_inputs.size() > D_NET_MAX_INPUTS || m_input - m_inputs.size() + 1 <= m_usedInput) {
+        m_inputs.pop_front();
+    }
+
+    sf::Packet packet;
+    beginMessage(packet, NetMessage::Input);
+    packet << static_cast<sf::Uint32>(m_input) << static_cast<sf::Uint32>(m_snapshots.newest())
+           << static_cast<sf::Uint8>(m_inputs.size());
+    for(auto i = m_inputs.begin() ; i != m_inputs.end() ; ++i) {
+        packet << *i;
+    }
+    this->send(packet);
+    this->flush();
+    return m_input;
+}
+
+bool Client::receive(Snapshot& out_snapshot)
+{
+    sf::Packet packet;
+    sf::IpAddress address;
+    unsigned short port = 0;
+    while(m_socket.Receive(packet, address, port) == sf::Socket::Done) {
+        m_nBytesReceived += packet.GetDataSize();
+        float fWhen = 0.0f;
+        if(address != m_server || port != m_port || packet.GetDataSize() == 0 || !this->delay(fWhen))
+            continue;
+        m_incoming.insert(std::make_pair(fWhen, std::vector<char>(packet.GetData(), packet.GetData() + packet.GetDataSize())));
+    }
+    this->flush();
+
+    const float fNow = m_time.GetElapsedTime();
+    while(!m_incoming.empty() && m_incoming.begin()->first <= fNow) {
+        packet.Clear();
+        packet.Append(&m_incoming.begin()->second[0], m_incoming.begin()->second.size());
+        m_incoming.erase(m_incoming.begin());
+        if(this->handle(packet, out_snapshot))
+            return true;
+    }
+    return false;
+}
+
+bool Client::handle(sf::Packet& io_packet, Snapshot& out_snapshot)
+{
+    NetMessage::Enum msg;
+    if(!readMessage(io_packet, msg))
+        return false;
+
+    m_lastHeard.Reset();
+    if(msg == NetMessage::Bye) {
+        m_bBye = true;
+    } else if(msg == NetMessage::Snapshot) {
+        // Late ones are of no use anymore, the decoder drops them.
+        ++m_nSnapshots;
+        BitReader bits(io_packet.GetData() + D_NET_HEADER_SIZE, io_packet.GetDataSize() - D_NET_HEADER_SIZE);
+        if(m_snapshots.decode(bits, out_snapshot)) {
+            m_usedInput = std::max(m_usedInput, out_snapshot.lastInput);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Client::lost() const
+{
+    return m_bBye || m_lastHeard.GetElapsedTime() > D_NET_TIMEOUT;
+}
+
+void Client::simulate(float in_fLatency, float in_fJitter, float in_fLoss)
+{
+    m_fLatency = std::max(in_fLatency, 0.0f);
+    m_fJitter = std::max(in_fJitter, 0.0f);
+    m_fLoss = clamp(in_fLoss, 0.0f, 1.0f);
+    m_random.seed(m_socket.GetLocalPort());
+}
+
+void Client::send(sf::Packet& io_packet)
+{
+    float fWhen = 0.0f;
+    if(!this->delay(fWhen))
+        return;
+
+    if(fWhen > m_time.GetElapsedTime()) {
+        m_outgoing.insert(std::make_pair(fWhen, std::vector<char>(io_packet.GetData(), io_packet.GetData() + io_packet.GetDataSize())));
+    } else if(m_socket.Send(io_packet, m_server, m_port) == sf::Socket::Done) {
+        m_nBytesSent += io_packet.GetDataSize();
+    }
+}
+
+void Client::flush()
+{
+    const float fNow = m_time.GetElapsedTime();
+    sf::Packet packet;
+    while(!m_outgoing.empty() && m_outgoing.begin()->first <= fNow) {
+        packet.Clear();
+        packet.Append(&m_outgoing.begin()->second[0], m_outgoing.begin()->second.size());
+        m_outgoing.erase(m_outgoing.begin());
+        if(m_socket.Send(packet, m_server, m_port) == sf::Socket::Done)
+            m_nBytesSent += packet.GetDataSize();
+    }
+}
+
+bool Client::delay(float& out_fWhen)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    out_fWhen = m_time.GetElapsedTime();
+    if(m_fLoss > 0.0f && unit(m_random) < m_fLoss)
+        return false;
+    if(m_fLatency > 0.0f || m_fJitter > 0.0f)
+        out_fWhen += std::max(m_fLatency + (2.0f*unit(m_random) - 1.0f) * m_fJitter, 0.0f);
+    return true;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "Protocol.h"
+#include "Snapshot.h"
+#include "SnapshotCodec.h"
+
+#include "Game/CarInput.h"
+
+#include <SFML/Network/IpAddress.hpp>
+#include <SFML/Network/UdpSocket.hpp>
+#include <SFML/System/Clock.hpp>
+
+#include <deque>
+#include <map>
+#include <random>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace RoadRage {
+
+/// A player's connection to a Server. It tells the server what the player
+/// does, and hands out what the server says the world is like.
+class Client {
+public:
+    /// Says hello to the server at \a in_sServer:\a in_port and waits to be
+    /// welcomed, throwing if it isn't within \a in_fTimeout seconds.
+    Client(const std::string& in_sServer, unsigned short in_port, float in_fTimeout = D_NET_TIMEOUT);
+    /// Says goodbye.
+    virtual ~Client();
+
+    /// Tells the server what the player does this tick, along with what it
+    /// did the ticks before that the server didn't use yet.
+    /// \return The number of the input, counting from 1.
+    uint32_t send(const CarInput& in_input);
+    /// Looks for the next snapshot that came in, in order. Call it until
+    /// there are none left, as the ones after it wait for the next call.
+    /// \return Whether there was one, then it's in \a out_snapshot.
+    bool receive(Snapshot& out_snapshot);
+    /// \return Whether the server went silent, or said goodbye.
+    bool lost() const;
+
+    /// Pretends to be on a worse network than it is, for trying out how the
+    /// game copes with one: everything going out and coming in takes
+    /// \a in_fLatency seconds, give or take up to \a in_fJitter, and gets lost
+    /// with a chance of \a in_fLoss. All zero for the network as it is.
+    void simulate(float in_fLatency, float in_fJitter, float in_fLoss);
+
+    /// \return The id of our player's car in the world.
+    uint32_t player() const { return m_player; }
+    /// \return The level the server plays.
+    const std::string& level() const { return m_sLevel; }
+    float tickRate() const { return m_fTickRate; }
+    /// \return How many bytes went out and came in so far, UDP payload only.
+    uint64_t bytesSent() const { return m_nBytesSent; }
+    uint64_t bytesReceived() const { return m_nBytesReceived; }
+    /// \return How many snapshots came in so far.
+    uint32_t snapshots() const { return m_nSnapshots; }
+
+private:
+    // No copying!
+    Client(const Client&);
+    Client& operator=(const Client&);
+
+    void send(sf::Packet& io_packet);
+    /// Sends what's due, of what the simulated network holds back.
+    void flush();
+    /// \return Whether the simulated network loses a datagram, and if not, when it arrives.
+    bool delay(float& out_fWhen);
+    bool handle(sf::Packet& io_packet, Snapshot& out_snapshot);
+
+    sf::UdpSocket m_socket;
+    sf::IpAddress m_server;
+    unsigned short m_port;
+
+    uint32_t m_player;
+    std::string m_sLevel;
+    float m_fTickRate;
+
+    /// The number of the last input sent, the inputs the server didn't use
+    /// yet as far as we know, up to that one, and the last one it did use.
+    uint32_t m_input;
+    std::deque<CarInput> m_inputs;
+    uint32_t m_usedInput;
+    SnapshotDecoder m_snapshots;
+    sf::Clock m_lastHeard;
+    bool m_bBye;
+
+    /// The simulated network, and what it holds back on the way out and in,
+    /// by the time it's due.
+    float m_fLatency, m_fJitter, m_fLoss;
+    std::mt19937 m_random;
+    sf::Clock m_time;
+    std::multimap<float, std::vector<char>> m_outgoing;
+    std::multimap<float, std::vector<char>> m_incoming;
+
+    uint64_t m_nBytesSent;
+    uint64_t m_nBytesReceived;
+    uint32_t m_nSnapshots;
+};
+
+}
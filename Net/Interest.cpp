@@ -0,0 +1,118 @@
+#include "Interest.h"
+
+#include "Game/World.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace RoadRage;
+
+/// Up to which part of the radius cars are in full view, getting due every
+/// tick. Beyond, they get due the less often the farther away they are.
+#define D_INTEREST_NEAR 0.25f
+/// How often the farthest cars get due at least, as a part of the ticks.
+#define D_INTEREST_MIN_RATE 0.25f
+/// The priority of a car that just came into view, which beats all that
+/// were just sent and most of those that have been waiting.
+#define D_INTEREST_ENTER_PRIORITY 2.0f
+
+Interest::Interest(float in_fRadius, std::size_t in_nMaxTraffic)
+    : m_fRadius(in_fRadius)
+    , m_nMaxTraffic(in_nMaxTraffic)
+    , m_nEntered(0)
+    , m_nLeft(0)
+{
+}
+
+float Interest::rate(float in_fDist2) const
+{
+    const float fNear = D_INTEREST_NEAR * m_fRadius;
+    if(in_fDist2 <= fNear*fNear)
+        return 1.0f;
+    return std::max(fNear / std::sqrt(in_fDist2), D_INTEREST_MIN_RATE);
+}
+
+std::size_t Interest::update(const World& in_world, uint32_t in_local, Snapshot& out_snapshot)
+{
+    const Avatar* pCar = in_world.player(in_local);
+    const Vector center = pCar ? pCar->pos() : Vector();
+
+    // The client's own car always, for its prediction, and whoever's around.
+    out_snapshot.players.clear();
+    const std::map<uint32_t, Avatar>& avatars = in_world.players();
+    for(auto i = avatars.begin() ; i != avatars.end() ; ++i) {
+        if(i->first != in_local && (i->second.pos() - center).len() > m_fRadius)
+            continue;
+        out_snapshot.players.push_back(Snapshot::Entry(i->first, i->second));
+        out_snapshot.players.back().input = i->second.input();
+    }
+
+    // The traffic in view, the nearest of it if there's too much around.
+    m_near.clear();
+    in_world.traffic().near(center.x(), center.z(), m_fRadius, m_near);
+    if(m_near.size() > m_nMaxTraffic) {
+        std::nth_element(m_near.begin(), m_near.begin() + m_nMaxTraffic, m_near.end());
+        m_near.resize(m_nMaxTraffic);
+    }
+    std::sort(m_near.begin(), m_near.end(), [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) {
+        return a.second < b.second;
+    });
+
+    // Going through it along with what was in view before, both sorted by id,
+    // tells which cars stay, which came and which left.
+    m_next.clear();
+    m_nEntered = 0;
+    m_nLeft = 0;
+    auto o = m_view.begin();
+    for(auto i = m_near.begin() ; i != m_near.end() ; ++i) {
+        for( ; o != m_view.end() && o->id < i->second ; ++o)
+            ++m_nLeft;
+
+        Viewed v;
+        v.id = i->second;
+        v.fDist2 = i->first;
+        if(o != m_view.end() && o->id == v.id) {
+            v.fPriority = o->fPriority + this->rate(v.fDist2);
+            ++o;
+        } else {
+            v.fPriority = D_INTEREST_ENTER_PRIORITY;
+            ++m_nEntered;
+        }
+        m_next.push_back(v);
+    }
+    m_nLeft += m_view.end() - o;
+    m_view.swap(m_next);
+
+    // The ones that are due go first, the ones waiting longest first, and of
+    // those the nearest. Those in view but not due still need to be in there,
+    // or else they'd count as gone.
+    m_due.clear();
+    for(std::size_t i = 0 ; i < m_view.size() ; ++i) {
+        if(m_view[i].fPriority >= 1.0f)
+            m_due.push_back(static_cast<uint32_t>(i));
+    }
+    std::sort(m_due.begin(), m_due.end(), [this](uint32_t a, uint32_t b) {
+        const Viewed& va = m_view[a];
+        const Viewed& vb = m_view[b];
+        return va.fPriority != vb.fPriority ? va.fPriority > vb.fPriority : va.fDist2 < vb.fDist2;
+    });
+
+    const std::vector<TrafficCar>& cars = in_world.traffic().cars();
+    out_snapshot.traffic.clear();
+    for(auto i = m_due.begin() ; i != m_due.end() ; ++i) {
+        const uint32_t id = m_view[*i].id;
+        out_snapshot.traffic.push_back(Snapshot::Entry(id, cars[id]));
+    }
+    for(auto i = m_view.begin() ; i != m_view.end() ; ++i) {
+        if(i->fPriority < 1.0f)
+            out_snapshot.traffic.push_back(Snapshot::Entry(i->id, cars[i->id]));
+    }
+    return m_due.size();
+}
+
+void Interest::sent(std::size_t in_n)
+{
+    for(std::size_t i = 0 ; i < in_n && i < m_due.size() ; ++i) {
+        m_view[m_due[i]].fPriority = 0.0f;
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Snapshot.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace RoadRage {
+
+class World;
+
+/// What one client gets to see of the world, and how badly it needs to see
+/// it again. That's the players and the traffic within a radius around its
+/// car, the latter as found by the traffic's own spatial hash. Every car in
+/// view gains priority every tick, the more the nearer it is: the nearest
+/// ones once per tick, the farthest ones a quarter of that.
+/// The ones that gained a whole tick's worth are due, and go out the most
+/// important first, as much as fits, after which they start over. Cars that
+/// come into view go first, the ones that left are told to be gone.
+class Interest {
+public:
+    /// \param in_fRadius How far the client sees, in meters.
+    /// \param in_nMaxTraffic How many traffic cars it sees at most, the
+    ///                       nearest ones if there are more around.
+    Interest(float in_fRadius, std::size_t in_nMaxTraffic);
+
+    /// Looks around the car of player \a in_local, putting all players and
+    /// traffic in view into \a out_snapshot. The traffic that's due comes
+    /// first, the most important first.
+    /// \return How much of the traffic is due.
+    std::size_t update(const World& in_world, uint32_t in_local, Snapshot& out_snapshot);
+    /// The first \a in_n of the cars that were due went out, or the client
+    /// has them as they are already.
+    void sent(std::size_t in_n);
+
+    /// \return How many traffic cars are in view, and how many of them came
+    ///         into view and left it during the last update.
+    std::size_t viewed() const { return m_view.size(); }
+    std::size_t entered() const { return m_nEntered; }
+    std::size_t left() const { return m_nLeft; }
+
+private:
+    struct Viewed {
+        uint32_t id;
+        float fPriority;
+        float fDist2;
+    };
+
+    /// \return How much priority a car at a squared distance of \a in_fDist2
+    ///         gains per tick.
+    float rate(float in_fDist2) const;
+
+    float m_fRadius;
+    std::size_t m_nMaxTraffic;
+    /// Sorted by id.
+    std::vector<Viewed> m_view;
+    /// Which of m_view went out last, in that order.
+    std::vector<uint32_t> m_due;
+    std::size_t m_nEntered, m_nLeft;
+
+    // Reused every tick, to not allocate.
+    std::vector<Viewed> m_next;
+    std::vector<std::pair<float, uint32_t>> m_near;
+};
+
+}
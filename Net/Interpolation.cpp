@@ -0,0 +1,126 @@
+#include "Interpolation.h"
+
+#include "Game/World.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace RoadRage;
+
+/// How much of the difference to a new snapshot's tick the estimate of the
+/// server's tick catches up on at once, so that the jitter doesn't make the
+/// cars shake.
+#define D_INTERPOLATION_CATCHUP 0.1f
+/// For how long traffic nobody told about is held in place, in seconds.
+/// Standing cars don't change, so they don't get told about.
+#define D_INTERPOLATION_HOLD 1.0f
+
+Interpolation::Interpolation(float in_fTickRate, float in_fDelay)
+    : m_fTickRate(in_fTickRate)
+    , m_fDelay(in_fDelay * in_fTickRate)
+    , m_fTick(0.0f)
+    , m_newest(0)
+    , m_nStarved(0)
+{
+}
+
+void Interpolation::push(const Snapshot& in_snapshot, uint32_t in_local)
+{
+    // The first one, or after a hiccup, that's when the server is now.
+    const float fTick = static_cast<float>(in_snapshot.tick);
+    if(m_newest == 0 || std::abs(fTick - m_fTick) > m_fTickRate)
+        m_fTick = fTick;
+    else
+        m_fTick += (fTick - m_fTick) * D_INTERPOLATION_CATCHUP;
+    m_newest = std::max(m_newest, in_snapshot.tick);
+
+    // Players that aren't in here left.
+    for(auto i = m_players.begin() ; i != m_players.end() ; ) {
+        auto j = std::lower_bound(in_snapshot.players.begin(), in_snapshot.players.end(), i->first,
+                                  [](const Snapshot::Entry& e, uint32_t id) { return e.id < id; });
+        if(j != in_snapshot.players.end() && j->id == i->first)
+            ++i;
+        else
+            m_players.erase(i++);
+    }
+
+    Sample s;
+    s.tick = in_snapshot.tick;
+    for(auto i = in_snapshot.players.begin() ; i != in_snapshot.players.end() ; ++i) {
+        if(i->id == in_local)
+            continue;
+        s.entry = *i;
+        m_players[i->id].push_back(s);
+    }
+    for(auto i = in_snapshot.traffic.begin() ; i != in_snapshot.traffic.end() ; ++i) {
+        s.entry = *i;
+        m_traffic[i->id].push_back(s);
+    }
+}
+
+void Interpolation::think(float in_fDeltaT)
+{
+    m_fTick += in_fDeltaT * m_fTickRate;
+    const float fTick = this->tick();
+
+    // Only the last sample before now is of any use still.
+    for(auto i = m_players.begin() ; i != m_players.end() ; ++i) {
+        while(i->second.size() > 1 && i->second[1].tick <= fTick)
+            i->second.pop_front();
+    }
+    for(auto i = m_traffic.begin() ; i != m_traffic.end() ; ) {
+        while(i->second.size() > 1 && i->second[1].tick <= fTick)
+            i->second.pop_front();
+        if(i->second.back().tick + D_INTERPOLATION_HOLD * m_fTickRate < fTick)
+            m_traffic.erase(i++);
+        else
+            ++i;
+    }
+}
+
+void Interpolation::apply(World& io_world, uint32_t in_local)
+{
+    const float fTick = this->tick();
+    Snapshot::Entry e;
+
+    m_nStarved = 0;
+    for(auto i = m_players.begin() ; i != m_players.end() ; ++i) {
+        if(!sample(i->second, fTick, e))
+            ++m_nStarved;
+        Avatar& avatar = io_world.addPlayer(i->first);
+        avatar.control(e.input);
+        e.put(avatar);
+    }
+    std::vector<uint32_t> gone;
+    const std::map<uint32_t, Avatar>& avatars = io_world.players();
+    for(auto i = avatars.begin() ; i != avatars.end() ; ++i) {
+        if(i->first != in_local && m_players.count(i->first) == 0)
+            gone.push_back(i->first);
+    }
+    for(auto i = gone.begin() ; i != gone.end() ; ++i) {
+        io_world.removePlayer(*i);
+    }
+
+    std::vector<TrafficCar>& cars = io_world.traffic().cars();
+    for(auto i = m_traffic.begin() ; i != m_traffic.end() ; ++i) {
+        if(i->first >= cars.size())
+            continue;
+        sample(i->second, fTick, e);
+        e.put(cars[i->first]);
+    }
+}
+
+bool Interpolation::sample(const Track& in_track, float in_fTick, Snapshot::Entry& out_entry)
+{
+    // think leaves the last sample before in_fTick at the front.
+    if(in_track.size() == 1 || in_fTick <= in_track.front().tick) {
+        out_entry = in_track.front().entry;
+        return in_fTick <= in_track.front().tick;
+    }
+
+    const Sample& a = in_track[0];
+    const Sample& b = in_track[1];
+    out_entry = Snapshot::Entry::lerp(a.entry, b.entry, std::min((in_fTick - a.tick) / (b.tick - a.tick), 1.0f));
+    return true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Snapshot.h"
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <stdint.h>
+
+namespace RoadRage {
+
+class World;
+
+/// Shows the cars the client doesn't drive itself a little in the past, in
+/// between the two snapshots around that time, rather than jumping along
+/// with each one as it comes in. How far in the past makes up the jitter
+/// buffer: snapshots coming in late or not at all don't stop the cars, as
+/// long as a later one came in by then.
+class Interpolation {
+public:
+    /// \param in_fTickRate The server's.
+    /// \param in_fDelay How far behind the newest snapshot to show the cars,
+    ///                  in seconds. A few ticks' worth is plenty.
+    Interpolation(float in_fTickRate, float in_fDelay);
+
+    /// Takes the players of \a in_snapshot but \a in_local, and its traffic.
+    void push(const Snapshot& in_snapshot, uint32_t in_local);
+    /// Moves on by \a in_fDeltaT seconds, forgetting what's past.
+    void think(float in_fDeltaT);
+    /// Puts the cars of \a io_world where they were at tick(). The players
+    /// come and go as the newest snapshot says, \a in_local staying whatever
+    /// happens. The traffic no snapshot told about for a while keeps driving
+    /// as the client's own drivers see fit.
+    void apply(World& io_world, uint32_t in_local);
+
+    /// \return The server's tick the cars are shown at.
+    float tick() const { return m_fTick - m_fDelay; }
+    /// \return How many of the other players had no snapshot after tick()
+    ///         the last time they were shown, and were held in place.
+    std::size_t starved() const { return m_nStarved; }
+    /// \return How many traffic cars it shows.
+    std::size_t traffic() const { return m_traffic.size(); }
+
+private:
+    struct Sample {
+        uint32_t tick;
+        Snapshot::Entry entry;
+    };
+    typedef std::deque<Sample> Track;
+
+    /// Puts into \a out_entry where \a in_track was at \a in_fTick.
+    /// \return Whether it had a sample after that.
+    static bool sample(const Track& in_track, float in_fTick, Snapshot::Entry& out_entry);
+
+    std::map<uint32_t, Track> m_players;
+    std::map<uint32_t, Track> m_traffic;
+
+    float m_fTickRate;
+    /// In ticks.
+    float m_fDelay;
+    /// What the server's tick is by now, as far as we know.
+    float m_fTick;
+    uint32_t m_newest;
+
+    std::size_t m_nStarved;
+};
+
+}
@@ -0,0 +1,111 @@
+#include "Prediction.h"
+
+#include "Game/Avatar.h"
+
+#include "Utilities/Math.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace RoadRage;
+
+/// How far the server's car may be off of ours before it gets corrected:
+/// in meters, radians and m/s. A little more than what the snapshots'
+/// quantization and the floats' rounding make of it.
+#define D_PREDICTION_POS_TOLERANCE 0.05f
+#define D_PREDICTION_ORI_TOLERANCE (1.0f*deg2rad)
+#define D_PREDICTION_SPEED_TOLERANCE 0.1f
+
+namespace {
+    /// \return Whether \a in_a is too far off \a in_b, telling how far it is
+    ///         in \a out_fDist.
+    bool off(const Snapshot::Entry& in_a, const Snapshot::Entry& in_b, float& out_fDist)
+    {
+        const float dx = in_a.x() - in_b.x();
+        const float dz = in_a.z() - in_b.z();
+        out_fDist = std::sqrt(dx*dx + dz*dz);
+        const float dOri = std::abs(static_cast<int16_t>(in_a.qOri - in_b.qOri)) / 65536.0f * 2.0f*pi;
+        return out_fDist > D_PREDICTION_POS_TOLERANCE
+            || dOri > D_PREDICTION_ORI_TOLERANCE
+            || std::abs(in_a.speed() - in_b.speed()) > D_PREDICTION_SPEED_TOLERANCE;
+    }
+}
+
+Prediction::Prediction(float in_fTickRate, std::size_t in_nMaxReplay)
+    : m_bUsed(false)
+    , m_nMaxReplay(std::max<std::size_t>(in_nMaxReplay, 1))
+    , m_fTick(1.0f / in_fTickRate)
+    , m_nCorrections(0)
+    , m_nReplayed(0)
+    , m_nWorstReplay(0)
+    , m_fReplayTime(0.0f)
+    , m_fWorstReplayTime(0.0f)
+    , m_fError(0.0f)
+{
+}
+
+void Prediction::step(Avatar& io_car, uint32_t in_seq, const CarInput& in_input)
+{
+    Step step;
+    step.seq = in_seq;
+    step.input = in_input;
+    this->drive(io_car, step);
+    m_steps.push_back(step);
+
+    // A server that far behind makes us correct from the newest we know.
+    while(m_steps.size() > m_nMaxReplay) {
+        m_used = m_steps.front();
+        m_bUsed = true;
+        m_steps.pop_front();
+    }
+}
+
+bool Prediction::reconcile(Avatar& io_car, const Snapshot::Entry& in_server, uint32_t in_lastInput, const Snapshot::Motion* in_pMotion)
+{
+    while(!m_steps.empty() && m_steps.front().seq <= in_lastInput) {
+        m_used = m_steps.front();
+        m_bUsed = true;
+        m_steps.pop_front();
+    }
+
+    // Only the input the server says it used last can tell whether we're
+    // right. Before the first, or once it got dropped, the server's right.
+    float fError = 0.0f;
+    const bool bOff = !m_bUsed || m_used.seq != in_lastInput || off(m_used.after, in_server, fError);
+    if(!bOff)
+        return false;
+
+    // Putting the car there leaves it going straight, which is all there
+    // is to it without physics.
+    sf::Clock timer;
+    in_server.put(io_car);
+    VehicleModel* pPhysics = io_car.physics();
+    if(pPhysics && in_pMotion)
+        in_pMotion->put(*pPhysics);
+    m_used.seq = in_lastInput;
+    m_used.after = in_server;
+    m_bUsed = true;
+    for(auto i = m_steps.begin() ; i != m_steps.end() ; ++i) {
+        this->drive(io_car, *i);
+    }
+    const float fTime = timer.GetElapsedTime();
+
+    ++m_nCorrections;
+    m_nReplayed += m_steps.size();
+    m_nWorstReplay = std::max(m_nWorstReplay, m_steps.size());
+    m_fReplayTime += fTime;
+    m_fWorstReplayTime = std::max(m_fWorstReplayTime, fTime);
+    m_fError = fError;
+    return true;
+}
+
+void Prediction::drive(Avatar& io_car, Step& io_step)
+{
+    // Just as the server does it.
+    io_car.control(io_step.input);
+    m_clock.tick(m_fTick);
+    io_car.think(m_clock);
+    io_step.after = Snapshot::Entry(io_car.id(), io_car);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Snapshot.h"
+
+#include "Game/CarInput.h"
+#include "Game/GameClock.h"
+
+#include <cstddef>
+#include <deque>
+#include <stdint.h>
+
+namespace RoadRage {
+
+class Avatar;
+
+/// Drives the local player's car right away, rather than a round trip later
+/// when the server's snapshot tells where it went. It does so just as the
+/// server does, one input per tick, remembering each of them along with
+/// where it got the car to. Once the server tells where it really is after
+/// one of them, that's compared to what we got: if it's off, the car is put
+/// back to where the server has it, moving as the server has it, too, and
+/// all inputs after that one get replayed on top.
+class Prediction {
+public:
+    /// \param in_fTickRate The server's.
+    /// \param in_nMaxReplay How many inputs to remember at most, which is
+    ///                      what bounds the cost of a correction. The ones
+    ///                      before that count as being right.
+    Prediction(float in_fTickRate, std::size_t in_nMaxReplay);
+
+    /// Drives \a io_car one tick on as \a in_input says, which is input
+    /// number \a in_seq.
+    void step(Avatar& io_car, uint32_t in_seq, const CarInput& in_input);
+    /// The server says the car is at \a in_server after its input number
+    /// \a in_lastInput, moving as \a in_pMotion says if its car drives with
+    /// physics; corrects \a io_car if that's not what we got. Without the
+    /// motion, a corrected car goes straight, neither sliding nor turning.
+    /// \return Whether it needed correcting.
+    bool reconcile(Avatar& io_car, const Snapshot::Entry& in_server, uint32_t in_lastInput, const Snapshot::Motion* in_pMotion);
+
+    /// \return How many inputs the server didn't use yet, as far as we know.
+    std::size_t pending() const { return m_steps.size(); }
+    /// \return How many corrections there were so far, and how many inputs
+    ///         they replayed, all of them and the most at once.
+    unsigned corrections() const { return m_nCorrections; }
+    std::size_t replayed() const { return m_nReplayed; }
+    std::size_t worstReplay() const { return m_nWorstReplay; }
+    /// \return How long replaying took, all of it and the longest one, in seconds.
+    float replayTime() const { return m_fReplayTime; }
+    float worstReplayTime() const { return m_fWorstReplayTime; }
+    /// \return How far off the last correction was, in meters.
+    float error() const { return m_fError; }
+
+private:
+    /// An input, and where it got the car to.
+    struct Step {
+        uint32_t seq;
+        CarInput input;
+        Snapshot::Entry after;
+    };
+
+    /// Drives \a io_car one tick on with \a io_step's input, remembering where to.
+    void drive(Avatar& io_car, Step& io_step);
+
+    /// The inputs not known to be used by the server, oldest first, and the
+    /// last one that is.
+    std::deque<Step> m_steps;
+    Step m_used;
+    bool m_bUsed;
+    std::size_t m_nMaxReplay;
+
+    /// Goes on by exactly one of the server's ticks at a time.
+    GameClock m_clock;
+    float m_fTick;
+
+    unsigned m_nCorrections;
+    std::size_t m_nReplayed;
+    std::size_t m_nWorstReplay;
+    float m_fReplayTime;
+    float m_fWorstReplayTime;
+    float m_fError;
+};
+
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Game/CarInput.h"
+
+#include <SFML/Network/Packet.hpp>
+
+#include <stdint.h>
+
+namespace RoadRage {
+
+/// Every datagram starts with this, anything else gets ignored.
+#define D_NET_MAGIC 0x52524e54u // "RRNT"
+/// Clients only get in when they speak the same version as the server.
+#define D_NET_VERSION 4
+/// After that many seconds without hearing anything from the other side,
+/// it is gone.
+#define D_NET_TIMEOUT 5.0f
+/// The most inputs an Input message takes along.
+#define D_NET_MAX_INPUTS 8
+
+/// What the client and the server tell each other, over UDP. Each message is
+/// a single datagram starting with D_NET_MAGIC and the message's kind.\n
+/// A client says Hello (with D_NET_VERSION) until the server welcomes it,
+/// telling it its player id, the level and the tick rate. From then on, the
+/// client sends an Input every tick, with the tick of the newest snapshot it
+/// got, the number of its newest input and the last few inputs the server
+/// didn't use yet, so that a lost one doesn't get lost for good. The server
+/// uses them in order, one per tick, the client's car only moving on with
+/// them, and sends a Snapshot of the world around the client's car every
+/// tick, made by a SnapshotEncoder, along with the number of the last input
+/// it used and how the car moves after it. Either side may say Bye to quit.
+/// Nothing gets resent: a lost Snapshot soon has a newer one following it.
+namespace NetMessage {
+    enum Enum {
+        Hello,
+        Welcome,
+        Input,
+        Snapshot,
+        Bye
+    };
+}
+
+/// Starts a message of kind \a in_msg in \a out_packet.
+inline void beginMessage(sf::Packet& out_packet, NetMessage::Enum in_msg)
+{
+    out_packet.Clear();
+    out_packet << static_cast<sf::Uint32>(D_NET_MAGIC) << static_cast<sf::Uint8>(in_msg);
+}
+
+/// How many bytes beginMessage takes, after which a Snapshot's bits start.
+#define D_NET_HEADER_SIZE 5
+
+/// \return Whether \a io_packet is one of ours, then telling its kind in
+///         \a out_msg and leaving the rest of it to be read.
+inline bool readMessage(sf::Packet& io_packet, NetMessage::Enum& out_msg)
+{
+    sf::Uint32 magic = 0;
+    sf::Uint8 msg = 0;
+    if(!(io_packet >> magic >> msg) || magic != D_NET_MAGIC || msg > NetMessage::Bye)
+        return false;
+
+    out_msg = static_cast<NetMessage::Enum>(msg);
+    return true;
+}
+
+inline sf::Packet& operator<<(sf::Packet& out_packet, const CarInput& in_input)
+{
+    return out_packet << static_cast<sf::Int8>(in_input.steering) << static_cast<sf::Int8>(in_input.pedals);
+}
+
+inline sf::Packet& operator>>(sf::Packet& io_packet, CarInput& out_input)
+{
+    sf::Int8 steering = 0, pedals = 0;
+    if(io_packet >> steering >> pedals)
+        out_input = CarInput(steering, pedals);
+    return io_packet;
+}
+
+}
@@ -0,0 +1,241 @@
+#include "Server.h"
+#include "Protocol.h"
+
+#include "Game/World.h"
+
+#include "Utilities/String.h"
+#include "Utilities/i18n.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+using namespace RoadRage;
+
+/// Nobody gets in once there are that many players.
+#define D_SERVER_MAX_CLIENTS 256
+/// The most traffic a snapshot tells of.
+#define D_SERVER_MAX_TRAFFIC 1024
+/// The most inputs waiting to be used, a client that's further ahead than
+/// that loses the oldest ones.
+#define D_SERVER_MAX_QUEUED_INPUTS (2*D_NET_MAX_INPUTS)
+/// How many inputs of a client wait before the first gets used, and again
+/// after they ran out, so that the ones coming in a little late or resent
+/// after a loss are there in time all the same.
+#define D_SERVER_INPUT_BUFFER 2
+
+Server::Server(World& io_world, unsigned short in_port, float in_fTickRate, float in_fSnapshotRadius, std::size_t in_nBandwidth)
+    : m_world(io_world)
+    , m_fTickRate(in_fTickRate)
+    , m_fSnapshotRadius(in_fSnapshotRadius)
+    , m_nSnapshotBytes(std::min<std::size_t>(static_cast<std::size_t>(in_nBandwidth / in_fTickRate),
+                                             sf::UdpSocket::MaxDatagramSize - D_NET_HEADER_SIZE))
+    , m_tick(0)
+    , m_nextPlayer(1)
+    , m_fTickTime(0.0f)
+    , m_fThinkTime(0.0f)
+    , m_fReplicationTime(0.0f)
+    , m_nViewed(0)
+    , m_nEntered(0)
+    , m_nLeft(0)
+    , m_nBytesSent(0)
+    , m_nBytesReceived(0)
+{
+    if(m_socket.Bind(in_port) != sf::Socket::Done)
+        throw std::runtime_error(_("Failed to listen on UDP port ") + to_s(in_port));
+    m_socket.SetBlocking(false);
+
+    // The players' cars only go on with their inputs, see tick.
+    m_world.thinkPlayers(false);
+}
+
+Server::~Server()
+{
+    // Let the clients know right away, rather than having them time out.
+    for(auto i = m_clients.begin() ; i != m_clients.end() ; ++i) {
+        beginMessage(m_packet, NetMessage::Bye);
+        this->send(m_packet, i->second);
+    }
+}
+
+void Server::tick()
+{
+    sf::Clock timer;
+
+    this->receive();
+
+    // The world's clock only ever moves on by whole ticks, which is what the
+    // clients' timeouts are measured in, too.
+    m_clock.tick(1.0f / m_fTickRate);
+    ++m_tick;
+    sf::Clock thinkTimer;
+
+    // One input per tick, as the clients predict it: a car only ever moves
+    // on with an input, so that its client's input number n always is the
+    // n-th tick it drove, just as the client has it. A client whose inputs
+    // are late waits for them, before the first one, too.
+    for(auto i = m_clients.begin() ; i != m_clients.end() ; ++i) {
+        Client& client = i->second;
+        client.bBuffering = client.inputs.size() < (client.bBuffering ? D_SERVER_INPUT_BUFFER : 1);
+        if(client.bBuffering)
+            continue;
+        if(Avatar* pCar = m_world.player(client.player)) {
+            pCar->control(client.inputs.front());
+            pCar->think(m_clock);
+        }
+        client.inputs.pop_front();
+        ++client.lastInput;
+    }
+    m_world.think(m_clock);
+    m_fThinkTime = thinkTimer.GetElapsedTime();
+
+    sf::Clock replicationTimer;
+    m_nViewed = m_nEntered = m_nLeft = 0;
+
+    std::vector<uint64_t> gone;
+    for(auto i = m_clients.begin() ; i != m_clients.end() ; ++i) {
+        Client& client = i->second;
+        if(m_clock.now() - client.lastHeard > D_NET_TIMEOUT) {
+            gone.push_back(i->first);
+            continue;
+        }
+
+        const std::size_t nDue = client.interest.update(m_world, client.player, m_snapshot);
+        m_snapshot.tick = m_tick;
+        m_snapshot.lastInput = client.lastInput;
+        const Avatar* pCar = m_world.player(client.player);
+        m_snapshot.bMotion = pCar && pCar->physics();
+        if(m_snapshot.bMotion)
+            m_snapshot.motion = Snapshot::Motion(*pCar->physics());
+        client.interest.sent(client.snapshots.encode(m_snapshot, m_nSnapshotBytes, m_bits, nDue));
+        m_nViewed += client.interest.viewed();
+        m_nEntered += client.interest.entered();
+        m_nLeft += client.interest.left();
+
+        beginMessage(m_packet, NetMessage::Snapshot);
+        m_packet.Append(&m_bits.bytes()[0], m_bits.bytes().size());
+        this->send(m_packet, client);
+    }
+    for(auto i = gone.begin() ; i != gone.end() ; ++i) {
+        auto j = m_clients.find(*i);
+        m_world.removePlayer(j->second.player);
+        m_clients.erase(j);
+    }
+    m_fReplicationTime = replicationTimer.GetElapsedTime();
+
+    m_fTickTime = timer.GetElapsedTime();
+}
+
+void Server::receive()
+{
+    sf::Packet packet;
+    sf::IpAddress address;
+    unsigned short port = 0;
+    while(m_socket.Receive(packet, address, port) == sf::Socket::Done) {
+        m_nBytesReceived += packet.GetDataSize();
+        this->handle(packet, address, port);
+    }
+}
+
+void Server::handle(sf::Packet& io_packet, const sf::IpAddress& in_address, unsigned short in_port)
+{
+    NetMessage::Enum msg;
+    if(!readMessage(io_packet, msg))
+        return;
+
+    const uint64_t key = static_cast<uint64_t>(in_address.ToInteger()) << 16 | in_port;
+    auto i = m_clients.find(key);
+    if(i == m_clients.end()) {
+        // Strangers only get to say hello, in the right version.
+        sf::Uint16 version = 0;
+        if(msg != NetMessage::Hello || !(io_packet >> version) || version != D_NET_VERSION)
+            return;
+        if(m_clients.size() >= D_SERVER_MAX_CLIENTS)
+            return;
+
+        Client client(m_fSnapshotRadius, D_SERVER_MAX_TRAFFIC);
+        client.address = in_address;
+        client.port = in_port;
+        client.player = m_nextPlayer++;
+        client.lastInput = 0;
+        client.bBuffering = true;
+        client.lastHeard = m_clock.now();
+        i = m_clients.insert(std::make_pair(key, client)).first;
+
+        // Side by side, so that they don't start out in a crash.
+        m_world.addPlayer(client.player).place(Vector(4.0f * (client.player % 16), 0.0f, 0.0f), 0.0f, 0.0f);
+    }
+
+    Client& client = i->second;
+    client.lastHeard = m_clock.now();
+    switch(msg) {
+    case NetMessage::Hello:
+        // It didn't get the welcome yet, or it's the first time.
+        this->welcome(client);
+        break;
+    case NetMessage::Input: {
+        sf::Uint32 seq = 0, ack = 0;
+        sf::Uint8 n = 0;
+        if(!(io_packet >> seq >> ack >> n) || n > D_NET_MAX_INPUTS || n > seq)
+            break;
+        client.snapshots.ack(ack);
+        // Oldest first, the newest being number seq.
+        for(uint32_t j = seq - n + 1 ; j <= seq ; ++j) {
+            CarInput input;
+            if(!(io_packet >> input))
+                break;
+            this->queue(client, j, input);
+        }
+        break;
+    }
+    case NetMessage::Bye:
+        m_world.removePlayer(client.player);
+        m_clients.erase(i);
+        break;
+    case NetMessage::Welcome:
+    case NetMessage::Snapshot:
+        break;
+    }
+}
+
+void Server::queue(Client& io_client, uint32_t in_seq, const CarInput& in_input)
+{
+    // Datagrams may come in out of order, and take the last few inputs along
+    // anyways, so most of them are known already.
+    const uint32_t next = io_client.lastInput + static_cast<uint32_t>(io_client.inputs.size()) + 1;
+    if(in_seq < next)
+        return;
+
+    // The ones that got lost for good are as the one before, most likely.
+    // Too many of them would be dropped right away anyways.
+    if(in_seq - next >= D_SERVER_MAX_QUEUED_INPUTS) {
+        io_client.inputs.clear();
+        io_client.lastInput = in_seq - 1;
+    }
+    while(io_client.inputs.size() + 1 < in_seq - io_client.lastInput) {
+        const Avatar* pCar = m_world.player(io_client.player);
+        io_client.inputs.push_back(!io_client.inputs.empty() ? io_client.inputs.back() : pCar ? pCar->input() : CarInput());
+    }
+    io_client.inputs.push_back(in_input);
+
+    while(io_client.inputs.size() > D_SERVER_MAX_QUEUED_INPUTS) {
+        io_client.inputs.pop_front();
+        ++io_client.lastInput;
+    }
+}
+
+void Server::welcome(const Client& in_client)
+{
+    beginMessage(m_packet, NetMessage::Welcome);
+    m_packet << static_cast<sf::Uint32>(in_client.player) << m_world.name() << m_fTickRate;
+    this->send(m_packet, in_client);
+}
+
+void Server::send(sf::Packet& io_packet, const Client& in_client)
+{
+    // A full send buffer only drops this one, which UDP might have done anyways.
+    if(m_socket.Send(io_packet, in_client.address, in_client.port) == sf::Socket::Done)
+        m_nBytesSent += io_packet.GetDataSize();
+}
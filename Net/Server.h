@@ -0,0 +1,115 @@
+#pragma once
+
+#include "BitStream.h"
+#include "Interest.h"
+#include "Snapshot.h"
+#include "SnapshotCodec.h"
+
+#include "Game/GameClock.h"
+
+#include <SFML/Network/IpAddress.hpp>
+#include <SFML/Network/Packet.hpp>
+#include <SFML/Network/UdpSocket.hpp>
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <stdint.h>
+
+namespace RoadRage {
+
+class World;
+
+/// Runs the one true World everybody plays in, at a fixed tick rate. Every
+/// tick, it takes the next input of each client, moves the world on by
+/// exactly one tick and sends each client a snapshot of what's around its
+/// car, as far as its Interest has it due. There's nothing graphical to it,
+/// so it runs headless.
+class Server {
+public:
+    /// Listens on UDP port \a in_port, throwing if that's taken.
+    /// \param in_fSnapshotRadius How far around their car clients get to see
+    ///                           the traffic, in meters.
+    /// \param in_nBandwidth How many bytes a second each client may get, at
+    ///                      most. What doesn't fit waits for later snapshots.
+    Server(World& io_world, unsigned short in_port, float in_fTickRate, float in_fSnapshotRadius, std::size_t in_nBandwidth);
+    virtual ~Server();
+
+    /// Handles everything that came in since the last tick, moves the world
+    /// on by one tick and sends out the snapshots. Doesn't wait for anything:
+    /// calling it at the tick rate is up to the caller.
+    void tick();
+
+    float tickRate() const { return m_fTickRate; }
+    unsigned short port() const { return m_socket.GetLocalPort(); }
+    std::size_t clientCount() const { return m_clients.size(); }
+    /// \return How long the last tick took, all of it, the world's think
+    ///         and making and sending the snapshots, in seconds.
+    float tickTime() const { return m_fTickTime; }
+    float thinkTime() const { return m_fThinkTime; }
+    float replicationTime() const { return m_fReplicationTime; }
+    /// \return How many traffic cars all clients had in view during the
+    ///         last tick, and how many came into and left their views.
+    std::size_t viewed() const { return m_nViewed; }
+    std::size_t entered() const { return m_nEntered; }
+    std::size_t left() const { return m_nLeft; }
+    /// \return How many bytes went out and came in so far, UDP payload only.
+    uint64_t bytesSent() const { return m_nBytesSent; }
+    uint64_t bytesReceived() const { return m_nBytesReceived; }
+
+private:
+    // No copying!
+    Server(const Server&);
+    Server& operator=(const Server&);
+
+    struct Client {
+        Client(float in_fRadius, std::size_t in_nMaxTraffic) : interest(in_fRadius, in_nMaxTraffic) {}
+
+        sf::IpAddress address;
+        unsigned short port;
+        uint32_t player;
+        /// The number of the last input used, and the ones after it that
+        /// came in already, to be used one per tick, like the client did.
+        uint32_t lastInput;
+        std::deque<CarInput> inputs;
+        /// Whether it's waiting for more inputs to come in, before using them.
+        bool bBuffering;
+        /// When we last heard of it, in the clock's time.
+        float lastHeard;
+        Interest interest;
+        SnapshotEncoder snapshots;
+    };
+
+    void receive();
+    void queue(Client& io_client, uint32_t in_seq, const CarInput& in_input);
+    void handle(sf::Packet& io_packet, const sf::IpAddress& in_address, unsigned short in_port);
+    void welcome(const Client& in_client);
+    void send(sf::Packet& io_packet, const Client& in_client);
+
+    World& m_world;
+    sf::UdpSocket m_socket;
+    float m_fTickRate;
+    float m_fSnapshotRadius;
+    /// The most one snapshot may take, in bytes.
+    std::size_t m_nSnapshotBytes;
+
+    GameClock m_clock;
+    uint32_t m_tick;
+    /// Keyed by address and port together.
+    std::map<uint64_t, Client> m_clients;
+    uint32_t m_nextPlayer;
+
+    // Reused every tick, to not allocate.
+    sf::Packet m_packet;
+    Snapshot m_snapshot;
+    BitWriter m_bits;
+
+    float m_fTickTime;
+    float m_fThinkTime;
+    float m_fReplicationTime;
+    std::size_t m_nViewed, m_nEntered, m_nLeft;
+    uint64_t m_nBytesSent;
+    uint64_t m_nBytesReceived;
+};
+
+}
@@ -0,0 +1,55 @@
+#include "Session.h"
+#include "Client.h"
+
+#include "Conf/Configuration.h"
+#include "Game/World.h"
+
+#include "Utilities/String.h"
+
+#include <algorithm>
+
+using namespace RoadRage;
+
+/// How many ticks the local car catches up on after a long frame, at most.
+#define D_SESSION_MAX_TICKS 4
+
+Session::Session(const Configuration& in_settings, Client& io_client, World& io_world)
+    : m_client(io_client)
+    , m_world(io_world)
+    , m_player(io_client.player())
+    , m_prediction(io_client.tickRate(), to<std::size_t>(in_settings.get("PredictionReplayLimit")))
+    , m_interpolation(io_client.tickRate(), to<float>(in_settings.get("InterpolationDelay")))
+    , m_fSinceTick(0.0f)
+{
+    m_client.simulate(to<float>(in_settings.get("NetLatency")), to<float>(in_settings.get("NetJitter")),
+                      to<float>(in_settings.get("NetLoss")));
+    m_world.addPlayer(m_player);
+    m_world.thinkPlayers(false);
+}
+
+void Session::think(float in_fDeltaT, const CarInput& in_input)
+{
+    Avatar& car = *m_world.player(m_player);
+
+    // The local car goes on in whole ticks, just like on the server, so that
+    // they can be replayed. A frame too long to catch up on drops the rest.
+    const float fTick = 1.0f / m_client.tickRate();
+    m_fSinceTick = std::min(m_fSinceTick + in_fDeltaT, D_SESSION_MAX_TICKS * fTick);
+    for( ; m_fSinceTick >= fTick ; m_fSinceTick -= fTick) {
+        m_prediction.step(car, m_client.send(in_input), in_input);
+    }
+
+    while(m_client.receive(m_snapshot)) {
+        m_interpolation.push(m_snapshot, m_player);
+        for(auto i = m_snapshot.players.begin() ; i != m_snapshot.players.end() ; ++i) {
+            if(i->id == m_player)
+                m_prediction.reconcile(car, *i, m_snapshot.lastInput, m_snapshot.bMotion ? &m_snapshot.motion : 0);
+        }
+    }
+    m_interpolation.think(in_fDeltaT);
+}
+
+void Session::apply()
+{
+    m_interpolation.apply(m_world, m_player);
+}
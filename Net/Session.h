@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Interpolation.h"
+#include "Prediction.h"
+#include "Snapshot.h"
+
+#include "Game/CarInput.h"
+
+#include <stdint.h>
+
+namespace RoadRage {
+
+class Client;
+class Configuration;
+class World;
+
+/// A player's side of a game on a server: the local car is driven right
+/// away by the Prediction, in the server's ticks, while all other cars are
+/// shown by the Interpolation. The client's World just mirrors what the
+/// snapshots say, but for the traffic nobody told about, which keeps driving
+/// on its own.
+class Session {
+public:
+    /// \param io_client The connection to the server, which has to outlive the session.
+    /// \param io_world The client's world, which has to outlive the session.
+    Session(const Configuration& in_settings, Client& io_client, World& io_world);
+
+    /// Moves on by \a in_fDeltaT seconds: drives the local car as \a in_input
+    /// says for each of the server's ticks in there, telling the server so,
+    /// and takes in the snapshots that came in.
+    void think(float in_fDeltaT, const CarInput& in_input);
+    /// Puts the other cars where they are shown, after the world's think
+    /// moved the traffic.
+    void apply();
+
+    /// \return The newest snapshot.
+    const Snapshot& snapshot() const { return m_snapshot; }
+    const Prediction& prediction() const { return m_prediction; }
+    const Interpolation& interpolation() const { return m_interpolation; }
+
+private:
+    // No copying!
+    Session(const Session&);
+    Session& operator=(const Session&);
+
+    Client& m_client;
+    World& m_world;
+    uint32_t m_player;
+
+    Prediction m_prediction;
+    Interpolation m_interpolation;
+    Snapshot m_snapshot;
+    /// How long ago, in seconds, the local car last drove a tick on.
+    float m_fSinceTick;
+};
+
+}
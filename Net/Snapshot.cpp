@@ -0,0 +1,145 @@
+#include "Snapshot.h"
+
+#include "Game/VehicleModel.h"
+#include "Game/World.h"
+
+#include "Utilities/Math.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace RoadRage;
+
+/// Steps per meter of the positions, per m/s of the speed and per m/s^2 of
+/// the acceleration.
+#define D_SNAPSHOT_POS_UNITS 128.0f
+#define D_SNAPSHOT_SPEED_UNITS 64.0f
+#define D_SNAPSHOT_ACCEL_UNITS 64.0f
+/// Steps per m/s of the sliding, and per rad/s of the turning.
+#define D_SNAPSHOT_SLIDE_UNITS 512.0f
+#define D_SNAPSHOT_YAW_UNITS 2048.0f
+/// Steps per radian of the angles, a whole turn being all 16 bits.
+#define D_SNAPSHOT_ANGLE_UNITS (65536.0f / (2.0f*pi))
+
+namespace {
+    int32_t quantize(float in_f, float in_fUnits, float in_fMax)
+    {
+        return static_cast<int32_t>(std::floor(clamp(in_f * in_fUnits, -in_fMax, in_fMax) + 0.5f));
+    }
+
+    uint16_t quantizeAngle(float in_f)
+    {
+        // Into [0, 2pi) first, which float can't keep exactly for large angles.
+        float f = std::fmod(in_f, 2.0f*pi);
+        if(f < 0.0f)
+            f += 2.0f*pi;
+        return static_cast<uint16_t>(static_cast<uint32_t>(f * D_SNAPSHOT_ANGLE_UNITS + 0.5f) & 0xffff);
+    }
+
+    float angle(uint16_t in_q)
+    {
+        // Back into [-pi, pi).
+        return static_cast<int16_t>(in_q) / D_SNAPSHOT_ANGLE_UNITS;
+    }
+
+    int32_t step(int32_t in_from, int32_t in_delta, float in_f)
+    {
+        return in_from + static_cast<int32_t>(std::floor(in_delta * in_f + 0.5f));
+    }
+}
+
+Snapshot::Entry::Entry()
+    : id(0)
+    , qx(0), qz(0)
+    , qOri(0), qSteering(0)
+    , qSpeed(0), qAccel(0)
+    , state(0)
+{
+}
+
+Snapshot::Entry::Entry(uint32_t in_id, float in_fX, float in_fZ, float in_fOri, float in_fSteering, float in_fSpeed, float in_fAccel, uint8_t in_state)
+    : id(in_id)
+    , qx(quantize(in_fX, D_SNAPSHOT_POS_UNITS, 2e9f))
+    , qz(quantize(in_fZ, D_SNAPSHOT_POS_UNITS, 2e9f))
+    , qOri(quantizeAngle(in_fOri))
+    , qSteering(quantizeAngle(in_fSteering))
+    , qSpeed(static_cast<int16_t>(quantize(in_fSpeed, D_SNAPSHOT_SPEED_UNITS, 32767.0f)))
+    , qAccel(static_cast<int16_t>(quantize(in_fAccel, D_SNAPSHOT_ACCEL_UNITS, 32767.0f)))
+    , state(in_state)
+{
+}
+
+Snapshot::Entry::Entry(uint32_t in_id, const Car& in_car)
+{
+    const Transform& t = in_car.transform();
+    const Driving& d = in_car.driving();
+    *this = Entry(in_id, t.pos.x(), t.pos.z(), t.ori, d.steeringAngle, d.speed, d.accel, static_cast<uint8_t>(d.state));
+}
+
+void Snapshot::Entry::put(Car& io_car) const
+{
+    // The state first, as entering some of them changes the speed.
+    io_car.state(static_cast<CarState::Enum>(std::min<uint8_t>(state, CarState::Destroyed)));
+    io_car.place(Vector(this->x(), io_car.pos().y(), this->z()), this->ori(), this->speed());
+    io_car.steeringAngle(this->steering());
+    io_car.accel(this->accel());
+}
+
+Snapshot::Entry Snapshot::Entry::lerp(const Entry& in_a, const Entry& in_b, float in_f)
+{
+    Entry e = in_b;
+    e.qx = step(in_a.qx, in_b.qx - in_a.qx, in_f);
+    e.qz = step(in_a.qz, in_b.qz - in_a.qz, in_f);
+    e.qOri = static_cast<uint16_t>(step(in_a.qOri, static_cast<int16_t>(in_b.qOri - in_a.qOri), in_f));
+    e.qSteering = static_cast<uint16_t>(step(in_a.qSteering, static_cast<int16_t>(in_b.qSteering - in_a.qSteering), in_f));
+    e.qSpeed = static_cast<int16_t>(step(in_a.qSpeed, in_b.qSpeed - in_a.qSpeed, in_f));
+    e.qAccel = static_cast<int16_t>(step(in_a.qAccel, in_b.qAccel - in_a.qAccel, in_f));
+    return e;
+}
+
+float Snapshot::Entry::x() const { return qx / D_SNAPSHOT_POS_UNITS; }
+float Snapshot::Entry::z() const { return qz / D_SNAPSHOT_POS_UNITS; }
+float Snapshot::Entry::ori() const { return angle(qOri); }
+float Snapshot::Entry::steering() const { return angle(qSteering); }
+float Snapshot::Entry::speed() const { return qSpeed / D_SNAPSHOT_SPEED_UNITS; }
+float Snapshot::Entry::accel() const { return qAccel / D_SNAPSHOT_ACCEL_UNITS; }
+
+bool Snapshot::Entry::operator==(const Entry& in_o) const
+{
+    return id == in_o.id && qx == in_o.qx && qz == in_o.qz && qOri == in_o.qOri && qSteering == in_o.qSteering
+        && qSpeed == in_o.qSpeed && qAccel == in_o.qAccel && state == in_o.state
+        && input.steering == in_o.input.steering && input.pedals == in_o.input.pedals;
+}
+
+Snapshot::Motion::Motion()
+    : qVy(0), qYawRate(0)
+    , gear(0)
+    , qLeftover(0)
+{
+}
+
+Snapshot::Motion::Motion(const VehicleModel& in_physics)
+{
+    const VehicleModel::Motion m = in_physics.motion();
+    qVy = static_cast<int16_t>(quantize(m.fVy, D_SNAPSHOT_SLIDE_UNITS, 32767.0f));
+    qYawRate = static_cast<int16_t>(quantize(m.fYawRate, D_SNAPSHOT_YAW_UNITS, 32767.0f));
+    gear = static_cast<uint8_t>(std::min(m.gear, 255u));
+    qLeftover = static_cast<uint8_t>(quantize(m.fLeftover * in_physics.substepRate(), 256.0f, 255.0f));
+}
+
+void Snapshot::Motion::put(VehicleModel& io_physics) const
+{
+    VehicleModel::Motion m;
+    m.fVy = qVy / D_SNAPSHOT_SLIDE_UNITS;
+    m.fYawRate = qYawRate / D_SNAPSHOT_YAW_UNITS;
+    m.gear = gear;
+    m.fLeftover = qLeftover / 256.0f / io_physics.substepRate();
+    io_physics.motion(m);
+}
+
+Snapshot::Snapshot()
+    : tick(0)
+    , lastInput(0)
+    , bMotion(false)
+{
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Game/CarInput.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace RoadRage {
+
+class Car;
+class VehicleModel;
+
+/// The state of the world as the server sees it during one tick, as far as
+/// one client gets to see it: the cars around its own. That's all a client
+/// needs, as everything else either doesn't move or only matters locally.\n
+/// It's all quantized already, to the precision the clients need, which is
+/// what a SnapshotEncoder sends as it is.
+struct Snapshot {
+    /// A car, its position to within a centimeter, its angles to within a
+    /// hundredth of a degree and its speed to within a few centimeters per
+    /// second.
+    struct Entry {
+        Entry();
+        Entry(uint32_t in_id, const Car& in_car);
+        Entry(uint32_t in_id, float in_fX, float in_fZ, float in_fOri, float in_fSteering, float in_fSpeed, float in_fAccel, uint8_t in_state);
+
+        /// Puts \a io_car into this state.
+        void put(Car& io_car) const;
+        /// \return The state \a in_f of the way from \a in_a to \a in_b, the
+        ///         angles turning the short way, and the rest as in \a in_b.
+        static Entry lerp(const Entry& in_a, const Entry& in_b, float in_f);
+
+        float x() const;
+        float z() const;
+        float ori() const;
+        float steering() const;
+        float speed() const;
+        float accel() const;
+
+        bool operator==(const Entry& in_o) const;
+        bool operator!=(const Entry& in_o) const { return !(*this == in_o); }
+
+        /// The player's id, or the car's index in Traffic::cars.
+        uint32_t id;
+        int32_t qx, qz;
+        /// Whole turns are of no interest, so the angles wrap around.
+        uint16_t qOri, qSteering;
+        int16_t qSpeed, qAccel;
+        uint8_t state;
+        /// What the player last did; unused for the traffic.
+        CarInput input;
+    };
+
+    /// How the client's own car slides and turns, which its entry doesn't
+    /// tell, but driving on from there with physics depends on. The sliding
+    /// to within a few millimeters per second, the turning to within a
+    /// thousandth of a radian per second.
+    struct Motion {
+        Motion();
+        explicit Motion(const VehicleModel& in_physics);
+
+        /// Puts \a io_physics into this motion, leaving where it is be.
+        void put(VehicleModel& io_physics) const;
+
+        int16_t qVy, qYawRate;
+        uint8_t gear;
+        /// How far into its next substep the car is, in 256ths of one.
+        uint8_t qLeftover;
+    };
+
+    Snapshot();
+
+    uint32_t tick;
+    /// The number of the last input of the client's that went into it.
+    uint32_t lastInput;
+    /// Whether the client's car drives with physics, and how it moves then.
+    bool bMotion;
+    Motion motion;
+    std::vector<Entry> players;
+    std::vector<Entry> traffic;
+};
+
+}
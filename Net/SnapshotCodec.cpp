@@ -0,0 +1,323 @@
+#include "SnapshotCodec.h"
+
+#include <algorithm>
+
+using namespace RoadRage;
+
+namespace {
+    typedef Snapshot::Entry Entry;
+
+    /// Takes what would be written, only to count the bits.
+    struct BitCounter {
+        BitCounter() : bits(0) {}
+        void write(uint32_t, unsigned in_nBits) { bits += in_nBits; }
+        void writeVar(uint32_t in_value) { bits += BitWriter::varBits(in_value); }
+        void writeSigned(int32_t in_value) { bits += BitWriter::signedBits(in_value); }
+
+        std::size_t bits;
+    };
+
+    /// The players are sorted by id too, as they come from a map.
+    const Entry* find(const std::vector<Entry>& in_entries, uint32_t in_id)
+    {
+        auto i = std::lower_bound(in_entries.begin(), in_entries.end(), in_id,
+                                  [](const Entry& e, uint32_t id) { return e.id < id; });
+        return i != in_entries.end() && i->id == in_id ? &*i : 0;
+    }
+
+    bool byId(const Entry* in_a, const Entry* in_b)
+    {
+        return in_a->id < in_b->id;
+    }
+
+    /// Writes \a in_e as the change to \a in_pBase, or whole if there is none.
+    template<typename Out>
+    void writeEntry(Out& out, const Entry& in_e, const Entry* in_pBase, bool in_bInput)
+    {
+        const uint32_t input = static_cast<uint32_t>(in_e.input.steering + 1) | static_cast<uint32_t>(in_e.input.pedals + 1) << 2;
+        if(!in_pBase) {
+            out.writeSigned(in_e.qx);
+            out.writeSigned(in_e.qz);
+            out.write(in_e.qOri, 16);
+            out.write(in_e.qSteering, 16);
+            out.writeSigned(in_e.qSpeed);
+            out.writeSigned(in_e.qAccel);
+            out.write(in_e.state, 3);
+            if(in_bInput)
+                out.write(input, 4);
+            return;
+        }
+
+        // Which of the values changed, and by how much.
+        const Entry& b = *in_pBase;
+        const bool bInput = in_bInput && (in_e.input.steering != b.input.steering || in_e.input.pedals != b.input.pedals);
+        const uint32_t mask = (in_e.qx != b.qx)
+                            | (in_e.qz != b.qz) << 1
+                            | (in_e.qOri != b.qOri) << 2
+                            | (in_e.qSteering != b.qSteering) << 3
+                            | (in_e.qSpeed != b.qSpeed) << 4
+                            | (in_e.qAccel != b.qAccel) << 5
+                            | (in_e.state != b.state) << 6
+                            | bInput << 7;
+        out.write(mask, in_bInput ? 8 : 7);
+        if(mask & 1)
+            out.writeSigned(in_e.qx - b.qx);
+        if(mask & 2)
+            out.writeSigned(in_e.qz - b.qz);
+        if(mask & 4)
+            out.writeSigned(static_cast<int16_t>(in_e.qOri - b.qOri));
+        if(mask & 8)
+            out.writeSigned(static_cast<int16_t>(in_e.qSteering - b.qSteering));
+        if(mask & 16)
+            out.writeSigned(in_e.qSpeed - b.qSpeed);
+        if(mask & 32)
+            out.writeSigned(in_e.qAccel - b.qAccel);
+        if(mask & 64)
+            out.write(in_e.state, 3);
+        if(mask & 128)
+            out.write(input, 4);
+    }
+
+    /// Reads what writeEntry wrote, into \a out_e, which has the id already.
+    void readEntry(BitReader& io_bits, Entry& out_e, const Entry* in_pBase, bool in_bInput)
+    {
+        uint32_t mask = 0xff;
+        if(in_pBase) {
+            const uint32_t id = out_e.id;
+            out_e = *in_pBase;
+            out_e.id = id;
+            mask = io_bits.read(in_bInput ? 8 : 7);
+        } else if(!in_bInput) {
+            mask = 0x7f;
+        }
+
+        const Entry b = in_pBase ? *in_pBase : Entry();
+        if(mask & 1)
+            out_e.qx = b.qx + io_bits.readSigned();
+        if(mask & 2)
+            out_e.qz = b.qz + io_bits.readSigned();
+        if(mask & 4)
+            out_e.qOri = static_cast<uint16_t>(in_pBase ? b.qOri + io_bits.readSigned() : io_bits.read(16));
+        if(mask & 8)
+            out_e.qSteering = static_cast<uint16_t>(in_pBase ? b.qSteering + io_bits.readSigned() : io_bits.read(16));
+        if(mask & 16)
+            out_e.qSpeed = static_cast<int16_t>(b.qSpeed + io_bits.readSigned());
+        if(mask & 32)
+            out_e.qAccel = static_cast<int16_t>(b.qAccel + io_bits.readSigned());
+        if(mask & 64)
+            out_e.state = static_cast<uint8_t>(io_bits.read(3));
+        if(mask & 128) {
+            const uint32_t input = io_bits.read(4);
+            out_e.input = CarInput(static_cast<int8_t>(input & 3) - 1, static_cast<int8_t>(input >> 2) - 1);
+        }
+    }
+
+    /// A snapshot that got lost, or is no more, is as good as none at all.
+    const Snapshot& lookup(const std::vector<Snapshot>& in_history, uint32_t in_tick)
+    {
+        static const Snapshot none;
+        const Snapshot& s = in_history[in_tick % in_history.size()];
+        return in_tick != 0 && s.tick == in_tick ? s : none;
+    }
+
+    /// Puts into \a out_known what the client has afterwards: what it had,
+    /// but what went out of reach, with \a in_updates on top.
+    void merge(const Snapshot& in_base, const std::vector<uint32_t>& in_removed, const std::vector<const Entry*>& in_updates, std::vector<Entry>& out_known)
+    {
+        out_known.clear();
+        auto r = in_removed.begin();
+        auto u = in_updates.begin();
+        for(auto b = in_base.traffic.begin() ; b != in_base.traffic.end() ; ++b) {
+            for( ; u != in_updates.end() && (*u)->id < b->id ; ++u)
+                out_known.push_back(**u);
+            while(r != in_removed.end() && *r < b->id)
+                ++r;
+            if(u != in_updates.end() && (*u)->id == b->id)
+                out_known.push_back(**u++);
+            else if(r == in_removed.end() || *r != b->id)
+                out_known.push_back(*b);
+        }
+        for( ; u != in_updates.end() ; ++u)
+            out_known.push_back(**u);
+    }
+}
+
+SnapshotEncoder::SnapshotEncoder()
+    : m_history(D_SNAPSHOT_HISTORY)
+    , m_acked(0)
+    , m_baseline(0)
+{
+}
+
+void SnapshotEncoder::ack(uint32_t in_tick)
+{
+    m_acked = std::max(m_acked, in_tick);
+}
+
+std::size_t SnapshotEncoder::encode(const Snapshot& in_snapshot, std::size_t in_nMaxBytes, BitWriter& out_bits, std::size_t in_nDue)
+{
+    const Snapshot& base = lookup(m_history, m_acked);
+    m_baseline = base.tick;
+
+    out_bits.clear();
+    out_bits.write(in_snapshot.tick, 32);
+    out_bits.write(m_baseline, 32);
+    out_bits.write(in_snapshot.lastInput, 32);
+    out_bits.write(in_snapshot.bMotion, 1);
+    if(in_snapshot.bMotion) {
+        out_bits.writeSigned(in_snapshot.motion.qVy);
+        out_bits.writeSigned(in_snapshot.motion.qYawRate);
+        out_bits.writeVar(in_snapshot.motion.gear);
+        out_bits.write(in_snapshot.motion.qLeftover, 8);
+    }
+
+    // All the players, always.
+    out_bits.writeVar(static_cast<uint32_t>(in_snapshot.players.size()));
+    uint32_t prev = 0;
+    for(auto i = in_snapshot.players.begin() ; i != in_snapshot.players.end() ; ++i) {
+        out_bits.writeVar(i->id - prev);
+        writeEntry(out_bits, *i, find(base.players, i->id), true);
+        prev = i->id;
+    }
+
+    // The traffic that went out of reach since.
+    m_ids.clear();
+    for(auto i = in_snapshot.traffic.begin() ; i != in_snapshot.traffic.end() ; ++i) {
+        m_ids.push_back(i->id);
+    }
+    std::sort(m_ids.begin(), m_ids.end());
+    m_removed.clear();
+    auto j = m_ids.begin();
+    for(auto i = base.traffic.begin() ; i != base.traffic.end() ; ++i) {
+        while(j != m_ids.end() && *j < i->id)
+            ++j;
+        if(j == m_ids.end() || *j != i->id)
+            m_removed.push_back(i->id);
+    }
+    out_bits.writeVar(static_cast<uint32_t>(m_removed.size()));
+    prev = 0;
+    for(auto i = m_removed.begin() ; i != m_removed.end() ; ++i) {
+        out_bits.writeVar(*i - prev);
+        prev = *i;
+    }
+
+    // Then the traffic that's due and changed, as much of it as fits, most
+    // important first. The ids are counted as if they were written whole,
+    // which they never take more than.
+    const std::size_t nMaxBits = in_nMaxBytes * 8;
+    const std::size_t nDue = std::min(in_nDue, in_snapshot.traffic.size());
+    std::size_t nBits = out_bits.bits() + BitWriter::varBits(static_cast<uint32_t>(nDue));
+    std::size_t nDone = 0;
+    m_sent.clear();
+    for( ; nDone < nDue ; ++nDone) {
+        const Entry& e = in_snapshot.traffic[nDone];
+        const Entry* pBase = find(base.traffic, e.id);
+        if(pBase && *pBase == e)
+            continue;
+
+        BitCounter cost;
+        cost.writeVar(e.id);
+        writeEntry(cost, e, pBase, false);
+        if(nBits + cost.bits > nMaxBits)
+            break;
+        nBits += cost.bits;
+        m_sent.push_back(&e);
+    }
+
+    std::sort(m_sent.begin(), m_sent.end(), byId);
+    out_bits.writeVar(static_cast<uint32_t>(m_sent.size()));
+    prev = 0;
+    for(auto i = m_sent.begin() ; i != m_sent.end() ; ++i) {
+        out_bits.writeVar((*i)->id - prev);
+        writeEntry(out_bits, **i, find(base.traffic, (*i)->id), false);
+        prev = (*i)->id;
+    }
+
+    // And remember what the client will have, once it gets it. That may
+    // well take the place of the baseline, so only once done with it.
+    merge(base, m_removed, m_sent, m_known);
+    Snapshot& known = m_history[in_snapshot.tick % m_history.size()];
+    known.traffic.swap(m_known);
+    known.players = in_snapshot.players;
+    known.tick = in_snapshot.tick;
+    known.lastInput = in_snapshot.lastInput;
+    return nDone;
+}
+
+SnapshotDecoder::SnapshotDecoder()
+    : m_history(D_SNAPSHOT_HISTORY)
+    , m_newest(0)
+{
+}
+
+bool SnapshotDecoder::decode(BitReader& io_bits, Snapshot& out_snapshot)
+{
+    const uint32_t tick = io_bits.read(32);
+    const uint32_t baseline = io_bits.read(32);
+    const uint32_t lastInput = io_bits.read(32);
+    const bool bMotion = io_bits.read(1) != 0;
+    Snapshot::Motion motion;
+    if(bMotion) {
+        motion.qVy = static_cast<int16_t>(io_bits.readSigned());
+        motion.qYawRate = static_cast<int16_t>(io_bits.readSigned());
+        motion.gear = static_cast<uint8_t>(std::min<uint32_t>(io_bits.readVar(), 255));
+        motion.qLeftover = static_cast<uint8_t>(io_bits.read(8));
+    }
+    if(!io_bits.ok() || tick <= m_newest)
+        return false;
+
+    const Snapshot& base = lookup(m_history, baseline);
+    if(base.tick != baseline)
+        return false;
+
+    out_snapshot.tick = tick;
+    out_snapshot.lastInput = lastInput;
+    out_snapshot.bMotion = bMotion;
+    out_snapshot.motion = motion;
+
+    // Nobody has that many players, anything more is garbage.
+    const uint32_t nPlayers = io_bits.readVar();
+    if(nPlayers > 0xffff)
+        return false;
+    out_snapshot.players.resize(nPlayers);
+    uint32_t id = 0;
+    for(auto i = out_snapshot.players.begin() ; i != out_snapshot.players.end() ; ++i) {
+        id += io_bits.readVar();
+        i->id = id;
+        readEntry(io_bits, *i, find(base.players, id), true);
+    }
+
+    std::vector<uint32_t> removed(std::min<uint32_t>(io_bits.readVar(), static_cast<uint32_t>(base.traffic.size())));
+    id = 0;
+    for(auto i = removed.begin() ; i != removed.end() ; ++i) {
+        id += io_bits.readVar();
+        *i = id;
+    }
+
+    const uint32_t nTraffic = io_bits.readVar();
+    if(!io_bits.ok() || nTraffic > 0xffffff)
+        return false;
+    out_snapshot.traffic.resize(nTraffic);
+    id = 0;
+    for(auto i = out_snapshot.traffic.begin() ; i != out_snapshot.traffic.end() ; ++i) {
+        id += io_bits.readVar();
+        i->id = id;
+        readEntry(io_bits, *i, find(base.traffic, id), false);
+    }
+    if(!io_bits.ok())
+        return false;
+
+    std::vector<const Entry*> updates;
+    for(auto i = out_snapshot.traffic.begin() ; i != out_snapshot.traffic.end() ; ++i) {
+        updates.push_back(&*i);
+    }
+    std::vector<Entry> traffic;
+    merge(base, removed, updates, traffic);
+    Snapshot& known = m_history[tick % m_history.size()];
+    known.traffic.swap(traffic);
+    known.players = out_snapshot.players;
+    known.tick = tick;
+    known.lastInput = lastInput;
+    m_newest = tick;
+    return true;
+}
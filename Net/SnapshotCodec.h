@@ -0,0 +1,75 @@
+#pragma once
+
+#include "BitStream.h"
+#include "Snapshot.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+namespace RoadRage {
+
+/// How many of the last snapshots are remembered, for the next ones to be
+/// sent as changes to. A second's worth, at the usual tick rates.
+#define D_SNAPSHOT_HISTORY 32
+
+/// The server's side of the snapshots of one client. Each one goes out as
+/// the change to the last one the client acknowledged, bit-packed: only the
+/// cars that changed since, only the values of them that did, and those as
+/// the difference to what the client has. Cars the client doesn't have yet
+/// go out whole, and there is a list of the ones that went out of reach.\n
+/// Only the cars that are due may go, the ones that matter most first, and
+/// as many as fit into the budget. The rest stays as the client last got
+/// it, until a later snapshot has room for them.
+class SnapshotEncoder {
+public:
+    SnapshotEncoder();
+
+    /// The client got the snapshot of tick \a in_tick.
+    void ack(uint32_t in_tick);
+    /// Writes \a in_snapshot into \a out_bits, taking up \a in_nMaxBytes at
+    /// most unless the players alone need more. Only the first \a in_nDue
+    /// of its traffic cars are due, the others are only there to not be
+    /// taken for gone.
+    /// \return How many of its traffic cars, from the first on, the client
+    ///         has as they are once it gets this.
+    std::size_t encode(const Snapshot& in_snapshot, std::size_t in_nMaxBytes, BitWriter& out_bits, std::size_t in_nDue = static_cast<std::size_t>(-1));
+
+    /// \return The tick of the snapshot the last one was a change to, 0 if none.
+    uint32_t baseline() const { return m_baseline; }
+
+private:
+    /// What the client has once it got the snapshot of the same tick, the
+    /// traffic sorted by id.
+    std::vector<Snapshot> m_history;
+    uint32_t m_acked;
+    uint32_t m_baseline;
+
+    // Reused for every snapshot, to not allocate.
+    std::vector<uint32_t> m_removed;
+    std::vector<const Snapshot::Entry*> m_sent;
+    std::vector<uint32_t> m_ids;
+    std::vector<Snapshot::Entry> m_known;
+};
+
+/// The client's side of the snapshots: reads what a SnapshotEncoder wrote,
+/// remembering enough of them to read the next ones.
+class SnapshotDecoder {
+public:
+    SnapshotDecoder();
+
+    /// Reads a snapshot from \a io_bits.
+    /// \return Whether it's newer than all before and all of it could be read.
+    ///         Then \a out_snapshot has all players, and only those traffic
+    ///         cars that changed.
+    bool decode(BitReader& io_bits, Snapshot& out_snapshot);
+
+    /// \return The tick of the newest snapshot read, for acknowledging.
+    uint32_t newest() const { return m_newest; }
+
+private:
+    std::vector<Snapshot> m_history;
+    uint32_t m_newest;
+};
+
+}
@@ -12,6 +12,9 @@
 #include "Game/GameClock.h"
 #include "Game/Level.h"
 
+#include "Net/Client.h"
+
+#include "Utilities/FileSystem.h"
 #include "Utilities/Path.h"
 #include "Utilities/String.h"
 #include "Utilities/i18n.h"
@@ -19,6 +22,8 @@
 #include <SFML/Window.hpp>
 #include <SFML/Graphics.hpp>
 
+#include <memory>
+
 using namespace RoadRage;
 
 int DisplayError(const std::string& what);
@@ -38,7 +43,8 @@ try {
         throw(_("Shaders are not supported by your graphics card!"));
 
     // Load the settings
-    Configuration settings(getUserDir() + "/conf.xml", RoadRageDefaultSettings());
+    const sf::VideoMode desktop = sf::VideoMode::GetDesktopMode();
+    Configuration settings(getUserDir() + "/conf.xml", RoadRageDefaultSettings(desktop.Width, desktop.Height));
 
     // Create the main window
     long unsigned int style = to<bool>(settings.get("Fullscreen")) ? sf::Style::Fullscreen : sf::Style::Default;
@@ -55,8 +61,19 @@ try {
     glEnable(GL_DEPTH_TEST);
     glDepthMask(GL_TRUE);
 
-    // Load the game engine with the level we want to play.
-    Game game(Level::load(settings, "BlaBla"), window.GetInput());
+    // All the data comes from the cooked archive, if there is one. Everything
+    // that isn't in there (or all of it, during development) is read from Data/.
+    FileSystem fs("Data");
+    fs.mount(settings.get("AssetArchive"));
+
+    // Load the game engine with the level we want to play, or the server
+    // plays, along with our car on it.
+    std::unique_ptr<Client> pClient;
+    if(!settings.get("Server").empty())
+        pClient.reset(new Client(settings.get("Server"), to<unsigned short>(settings.get("ServerPort"))));
+    Level::Ptr pLevel = pClient ? Level::load(settings, fs, pClient->level(), pClient->player())
+                                : Level::load(settings, fs, "BlaBla");
+    Game game(settings, pLevel, window.GetInput(), pClient.get());
 
     // Start the game loop
     while(window.IsOpened())
@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "Conf/Configuration.h"
+#include "Conf/RoadRageDefaultSettings.h"
+
+#include "Game/World.h"
+
+#include "Net/Server.h"
+
+#include "Utilities/FileSystem.h"
+#include "Utilities/Path.h"
+#include "Utilities/String.h"
+#include "Utilities/ThreadPool.h"
+
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Sleep.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace RoadRage;
+
+/// How often the server tells how it's doing, in seconds.
+#define D_SERVER_REPORT_INTERVAL 5.0f
+
+////////////////////////////////////////////////////////////
+/// The headless server: simulates a level for all the players connected to
+/// it, without any window or graphics, at the ServerTickRate of the
+/// settings. It runs until killed, or for the given amount of seconds.
+///
+/// Usage: roadrage_server [level name] [port] [seconds]
+///
+/// \return Application exit code
+///
+////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+try {
+    Configuration settings(getUserDir() + "/conf.xml", RoadRageDefaultSettings());
+
+    const std::string sLevel = argc > 1 ? argv[1] : "BlaBla";
+    const unsigned short port = static_cast<unsigned short>(argc > 2 ? std::atoi(argv[2]) : to<int>(settings.get("ServerPort")));
+    const float fSeconds = argc > 3 ? static_cast<float>(std::atof(argv[3])) : 0.0f;
+    const float fTickRate = std::max(to<float>(settings.get("ServerTickRate")), 1.0f);
+
+    FileSystem fs("Data");
+    fs.mount(settings.get("AssetArchive"));
+
+    ThreadPool workers(to<unsigned>(settings.get("WorkerThreads")));
+    World world(settings, fs, sLevel, workers);
+    Server server(world, port, fTickRate, to<float>(settings.get("SnapshotRadius")),
+                  to<std::size_t>(settings.get("SnapshotBandwidth")));
+    std::cout << "Serving " << sLevel << " on port " << server.port() << " at " << fTickRate << " ticks/s, "
+              << world.traffic().cars().size() << " traffic cars" << std::endl;
+
+    sf::Clock clock, report;
+    float fNextTick = 0.0f, fWorstTick = 0.0f;
+    while(fSeconds <= 0.0f || clock.GetElapsedTime() < fSeconds) {
+        server.tick();
+        fWorstTick = std::max(fWorstTick, server.tickTime());
+
+        if(report.GetElapsedTime() >= D_SERVER_REPORT_INTERVAL) {
+            std::cout << server.clientCount() << " clients, tick " << server.tickTime() * 1000.0f << "ms ("
+                      << fWorstTick * 1000.0f << "ms worst), " << server.bytesSent() / 1024 << "kB out, "
+                      << server.bytesReceived() / 1024 << "kB in" << std::endl;
+            report.Reset();
+            fWorstTick = 0.0f;
+        }
+
+        // Keep to the tick rate, but don't try to catch up on more than a
+        // tick when falling behind.
+        fNextTick = std::max(fNextTick + 1.0f / fTickRate, clock.GetElapsedTime() - 1.0f / fTickRate);
+        const float fWait = fNextTick - clock.GetElapsedTime();
+        if(fWait > 0.0f)
+            sf::Sleep(fWait);
+    }
+
+    return EXIT_SUCCESS;
+} catch(const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
+}
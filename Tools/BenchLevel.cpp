@@ -0,0 +1,38 @@
+#include "BenchLevel.h"
+
+#include "Conf/Configuration.h"
+#include "Game/RoadNetwork.h"
+#include "Utilities/FileSystem.h"
+#include "Utilities/Hash.h"
+#include "Utilities/Path.h"
+#include "Utilities/String.h"
+
+#include <iostream>
+#include <stdexcept>
+
+using namespace RoadRage;
+
+std::string RoadRage::prepareLevel(const Configuration& in_settings, const std::string& in_sLevel)
+{
+    const std::string sRoot = getUserDir() + "/bench";
+    const std::string sDir = sRoot + "/Levels/" + in_sLevel;
+
+    // The same roads the world lays out without any.
+    RoadNetwork roads;
+    roads.generate(to<float>(in_settings.get("ChunkSize")), to<int>(in_settings.get("RoadNetworkRadius")),
+                   static_cast<unsigned>(fnv1a("Levels/" + in_sLevel)));
+
+    FileSystem fs(sRoot);
+    FileView cached = fs.readLoose("Levels/" + in_sLevel + "/roads.bin");
+    RoadNetwork loaded;
+    if(cached.valid() && loaded.load(cached.data(), cached.size()) && loaded.preprocessed()
+    && loaded.intersectionCount() == roads.intersectionCount() && loaded.laneCount() == roads.laneCount())
+        return sRoot;
+
+    std::cout << "Preprocessing the roads into " << sDir << "..." << std::endl;
+    roads.preprocess();
+    if(!createDirectories(sDir))
+        throw std::runtime_error("Failed to create " + sDir);
+    roads.save(sDir + "/roads.bin");
+    return sRoot;
+}
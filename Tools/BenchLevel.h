@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+namespace RoadRage {
+
+class Configuration;
+
+/// Makes the level \a in_sLevel come with its roads preprocessed, as
+/// roadrage_roads does for the game's levels, or the traffic would find its
+/// routes by A*, several times slower than in game. That takes a few seconds,
+/// so they are kept in the user's directory for the next runs.
+/// \return The root of the data the level is in.
+std::string prepareLevel(const Configuration& in_settings, const std::string& in_sLevel);
+
+}
@@ -0,0 +1,327 @@
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "3d/MeshData.h"
+#include "3d/TextureData.h"
+#include "Utilities/Archive.h"
+#include "Utilities/Hash.h"
+#include "Utilities/Path.h"
+#include "Utilities/String.h"
+
+#include <SFML/System/Clock.hpp>
+
+// We only need stb_image's decoders, which don't need an OpenGL context,
+// unlike sf::Image.
+#include "sfml2/src/SFML/Graphics/stb_image/stb_image.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+using namespace RoadRage;
+
+// Bump this whenever the output of a cooking step changes, so that all
+// entries cooked by an older version get cooked again.
+#define D_COOK_VERSION "1"
+
+namespace {
+    std::string extension(const std::string& in_sFile)
+    {
+        std::size_t dot = in_sFile.find_last_of('.');
+        std::size_t slash = in_sFile.find_last_of('/');
+        if(dot == std::string::npos || (slash != std::string::npos && dot < slash))
+            return "";
+        return in_sFile.substr(dot + 1);
+    }
+
+    std::string withExtension(const std::string& in_sFile, const std::string& in_sExt)
+    {
+        return in_sFile.substr(0, in_sFile.size() - extension(in_sFile).size()) + in_sExt;
+    }
+
+    enum AssetType { ShaderAsset, MeshAsset, TextureAsset, RawAsset };
+
+    AssetType assetType(const std::string& in_sFile)
+    {
+        std::string ext = extension(in_sFile);
+        if(ext == "vert" || ext == "frag" || ext == "geom")
+            return ShaderAsset;
+        if(ext == "obj" || ext == "rrmesh")
+            return MeshAsset;
+        if(ext == "png" || ext == "jpg" || ext == "jpeg" || ext == "bmp" || ext == "tga" || ext == "psd")
+            return TextureAsset;
+        return RawAsset;
+    }
+
+    /// \return The name of the cooked asset within the archive.
+    std::string cookedName(const std::string& in_sFile)
+    {
+        switch(assetType(in_sFile)) {
+        case MeshAsset: return withExtension(in_sFile, "rrmesh");
+        case TextureAsset: return withExtension(in_sFile, "rrtex");
+        default: return in_sFile;
+        }
+    }
+
+    /// Removes all comments and all leading and trailing whitespace, but keeps
+    /// every line, so that the line numbers in the driver's messages still
+    /// match the source file.
+    std::string minifyShader(const std::string& in_sSrc)
+    {
+        std::string out, line;
+        bool bInBlockComment = false;
+        for(std::size_t i = 0 ; i <= in_sSrc.size() ; ++i) {
+            char c = i < in_sSrc.size() ? in_sSrc[i] : '\n';
+            char next = i + 1 < in_sSrc.size() ? in_sSrc[i+1] : '\0';
+
+            if(c == '\r')
+                continue;
+
+            if(c == '\n') {
+                std::size_t b = line.find_first_not_of(" \t");
+                std::size_t e = line.find_last_not_of(" \t");
+                if(b != std::string::npos)
+                    out += line.substr(b, e - b + 1);
+                if(i < in_sSrc.size())
+                    out += '\n';
+                line.clear();
+                continue;
+            }
+
+            if(bInBlockComment) {
+                if(c == '*' && next == '/') {
+                    bInBlockComment = false;
+                    ++i;
+                }
+            } else if(c == '/' && next == '*') {
+                bInBlockComment = true;
+                line += ' ';
+                ++i;
+            } else if(c == '/' && next == '/') {
+                // Skip to the end of the line, but let the newline through.
+                while(i + 1 < in_sSrc.size() && in_sSrc[i+1] != '\n')
+                    ++i;
+            } else {
+                line += c;
+            }
+        }
+
+        return out;
+    }
+
+    /// Without an OpenGL context we can't really compile the shader, but
+    /// we can catch the most common mistakes before they reach the game.
+    /// \param in_sSrc The minified source, without any comments.
+    /// \throws std::runtime_error describing the first problem found.
+    void validateShader(const std::string& in_sName, const std::string& in_sSrc)
+    {
+        std::size_t first = in_sSrc.find_first_not_of('\n');
+        if(first == std::string::npos || in_sSrc.compare(first, 8, "#version") != 0)
+            throw std::runtime_error(in_sName + ": the first statement must be a #version directive");
+
+        int depth[3] = {0, 0, 0};
+        const char* open = "({[";
+        const char* close = ")}]";
+        int line = 1;
+        for(std::size_t i = 0 ; i < in_sSrc.size() ; ++i) {
+            char c = in_sSrc[i];
+            if(c == '\n')
+                ++line;
+            for(int k = 0 ; k < 3 ; ++k) {
+                if(c == open[k])
+                    ++depth[k];
+                if(c == close[k] && --depth[k] < 0)
+                    throw std::runtime_error(in_sName + ":" + to_s(line) + ": unmatched '" + c + "'");
+            }
+        }
+        for(int k = 0 ; k < 3 ; ++k) {
+            if(depth[k] != 0)
+                throw std::runtime_error(in_sName + ": unclosed '" + open[k] + "'");
+        }
+
+        std::size_t pos = in_sSrc.find("void main");
+        if(pos != std::string::npos)
+            pos = in_sSrc.find_first_not_of(" \t\n", pos + 9);
+        if(pos == std::string::npos || in_sSrc[pos] != '(')
+            throw std::runtime_error(in_sName + ": there is no main function");
+    }
+
+    std::vector<char> cookShader(const std::string& in_sName, const std::vector<char>& in_src)
+    {
+        std::string sMin = minifyShader(std::string(in_src.begin(), in_src.end()));
+        validateShader(in_sName, sMin);
+        return std::vector<char>(sMin.begin(), sMin.end());
+    }
+
+    std::vector<char> cookMesh(const std::string& in_sName, const std::vector<char>& in_src)
+    {
+        MeshData mesh;
+        bool bOk = extension(in_sName) == "obj" ? mesh.loadObj(&in_src[0], in_src.size())
+                                                : mesh.loadBinary(&in_src[0], in_src.size());
+        if(!bOk || mesh.indices().empty())
+            throw std::runtime_error(in_sName + ": not a valid mesh");
+
+        mesh.optimize();
+        return mesh.toBinary();
+    }
+
+    std::vector<char> cookTexture(const std::string& in_sName, const std::vector<char>& in_src)
+    {
+        int w = 0, h = 0, comp = 0;
+        stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(&in_src[0]), static_cast<int>(in_src.size()), &w, &h, &comp, 4);
+        if(!pixels)
+            throw std::runtime_error(in_sName + ": can't decode the image: " + stbi_failure_reason());
+
+        std::vector<unsigned char> level(pixels, pixels + w*h*4);
+        stbi_image_free(pixels);
+
+        TextureHeader header;
+        std::memcpy(header.magic, TextureMagic, 4);
+        header.version = TextureVersion;
+        header.width = w;
+        header.height = h;
+        header.nLevels = 1;
+        header.reserved = 0;
+
+        std::vector<char> out(reinterpret_cast<const char*>(&header), reinterpret_cast<const char*>(&header + 1));
+        out.insert(out.end(), level.begin(), level.end());
+
+        // Generate all mipmap levels with a box filter, so the game doesn't
+        // have to do it while loading.
+        while(w > 1 || h > 1) {
+            int nw = std::max(w / 2, 1), nh = std::max(h / 2, 1);
+            std::vector<unsigned char> next(nw*nh*4);
+            for(int y = 0 ; y < nh ; ++y) {
+                for(int x = 0 ; x < nw ; ++x) {
+                    int x0 = std::min(2*x, w-1), x1 = std::min(2*x+1, w-1);
+                    int y0 = std::min(2*y, h-1), y1 = std::min(2*y+1, h-1);
+                    for(int c = 0 ; c < 4 ; ++c) {
+                        int sum = level[(y0*w+x0)*4+c] + level[(y0*w+x1)*4+c]
+                                + level[(y1*w+x0)*4+c] + level[(y1*w+x1)*4+c];
+                        next[(y*nw+x)*4+c] = static_cast<unsigned char>((sum + 2) / 4);
+                    }
+                }
+            }
+
+            out.insert(out.end(), next.begin(), next.end());
+            level.swap(next);
+            w = nw;
+            h = nh;
+            ++header.nLevels;
+        }
+
+        std::memcpy(&out[0], &header, sizeof(header));
+        return out;
+    }
+
+    std::vector<char> cook(const std::string& in_sName, const std::vector<char>& in_src)
+    {
+        if(in_src.empty())
+            return in_src;
+
+        switch(assetType(in_sName)) {
+        case ShaderAsset: return cookShader(in_sName, in_src);
+        case MeshAsset: return cookMesh(in_sName, in_src);
+        case TextureAsset: return cookTexture(in_sName, in_src);
+        default: return in_src;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////
+/// Offline asset cooker: turns everything in the data directory into the
+/// form the game uses at runtime and packs it all into one archive.
+/// Shaders get stripped and checked, meshes optimized and textures decoded.
+///
+/// If the archive exists already, only the assets whose source changed since
+/// then are cooked again, the others are taken over as they are.
+///
+/// Usage: roadrage_cook <data directory> <output.rrpak>
+///
+/// \return Application exit code
+///
+////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+try {
+    if(argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <data directory> <output.rrpak>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string sDataDir = argv[1];
+    std::string sOut = argv[2];
+
+    sf::Clock clock;
+    Archive previous;
+    previous.open(sOut);
+
+    ArchiveWriter writer;
+    std::vector<std::string> files = listFilesRecursive(sDataDir);
+    std::size_t nCooked = 0, nReused = 0, nFailed = 0;
+    bool bChanged = files.size() != previous.entryCount();
+
+    for(auto i = files.begin() ; i != files.end() ; ++i) {
+        std::string sName = cookedName(*i);
+        if(writer.has(sName)) {
+            std::cerr << *i << ": there is another source for " << sName << ", skipping it" << std::endl;
+            ++nFailed;
+            continue;
+        }
+
+        std::ifstream f((sDataDir + "/" + *i).c_str(), std::ios::binary);
+        if(!f) {
+            std::cerr << *i << ": can't read it" << std::endl;
+            ++nFailed;
+            continue;
+        }
+        std::vector<char> src((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+        // The source's name is part of the hash, so that renaming e.g. a .obj
+        // to a .rrmesh makes it get cooked again.
+        uint64_t hash = fnv1a(*i + "@" D_COOK_VERSION);
+        if(!src.empty())
+            hash = fnv1a(&src[0], src.size(), hash);
+
+        const ArchiveEntry* old = previous.find(sName);
+        if(old && old->sourceHash == hash) {
+            writer.add(sName, previous.data(*old), old->size, hash);
+            ++nReused;
+            continue;
+        }
+
+        try {
+            std::vector<char> cooked = cook(*i, src);
+            writer.add(sName, cooked.empty() ? 0 : &cooked[0], cooked.size(), hash);
+            ++nCooked;
+            bChanged = true;
+        } catch(const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            ++nFailed;
+        }
+    }
+
+    if(nFailed > 0) {
+        std::cerr << nFailed << " assets failed, not writing " << sOut << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // The writer has its own copy of everything by now.
+    previous.close();
+    if(bChanged)
+        writer.write(sOut);
+
+    std::cout << "Cooked " << nCooked << " assets, " << nReused << " were up to date, took "
+              << clock.GetElapsedTime()*1000.0f << "ms" << (bChanged ? "" : "; nothing to write") << std::endl;
+
+    return EXIT_SUCCESS;
+} catch(const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
+}
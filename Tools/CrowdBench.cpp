@@ -0,0 +1,125 @@
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "Game/Crowd.h"
+#include "Utilities/ThreadPool.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace RoadRage;
+
+/// The same layout as the procedurally generated chunks: streets along the
+/// lower edges of every block, and four buildings on the rest of it.
+void city(NavGrid& out_grid, std::vector<Vector>& out_goals, unsigned in_nBlocks)
+{
+    const float fBlock = 32.0f, fStreet = 8.0f, fMargin = 1.0f;
+    const float fLot = (fBlock - fStreet) * 0.5f;
+
+    // One more street closes off the city.
+    const unsigned nCells = static_cast<unsigned>(in_nBlocks * fBlock + fStreet);
+    out_grid.reset(0.0f, 0.0f, nCells, nCells, 1.0f);
+    for(unsigned bx = 0 ; bx < in_nBlocks ; ++bx) {
+        for(unsigned bz = 0 ; bz < in_nBlocks ; ++bz) {
+            for(unsigned i = 0 ; i < 4 ; ++i) {
+                const float x = bx * fBlock + fStreet + (i & 1 ? fLot : 0.0f);
+                const float z = bz * fBlock + fStreet + (i & 2 ? fLot : 0.0f);
+                out_grid.block(Vector(x + fMargin, 0.0f, z + fMargin), Vector(x + fLot - fMargin, 1.0f, z + fLot - fMargin));
+            }
+        }
+    }
+
+    // People walk between the crossings of every fourth street.
+    for(unsigned bx = 0 ; bx <= in_nBlocks ; bx += 4) {
+        for(unsigned bz = 0 ; bz <= in_nBlocks ; bz += 4) {
+            out_goals.push_back(Vector(bx * fBlock + fStreet * 0.5f, 0.0f, bz * fBlock + fStreet * 0.5f));
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////
+/// Benchmarks the crowd simulation of the civilians: a city full of people
+/// walking between crossings, stepped at 60Hz with more and more worker
+/// threads.
+///
+/// Usage: roadrage_crowdbench [agents] [steps] [city size in blocks]
+///
+/// \return Application exit code
+///
+////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+try {
+    const std::size_t nAgents = argc > 1 ? std::max(1, std::atoi(argv[1])) : 50000;
+    const unsigned nSteps = argc > 2 ? std::max(1, std::atoi(argv[2])) : 600;
+    const unsigned nBlocks = argc > 3 ? std::max(1, std::atoi(argv[3])) : 16;
+    const float fDeltaT = 1.0f / 60.0f;
+
+    NavGrid grid;
+    std::vector<Vector> goals;
+    city(grid, goals, nBlocks);
+
+    std::cout << nAgents << " agents, " << goals.size() << " goals, " << grid.width() << "x" << grid.height() << " cells" << std::endl;
+
+    const unsigned nMaxWorkers = std::max(1u, std::thread::hardware_concurrency());
+    for(unsigned nWorkers = 1 ; ; nWorkers = std::min(nWorkers * 2, nMaxWorkers)) {
+        ThreadPool workers(nWorkers);
+        Crowd crowd;
+
+        sf::Clock clock;
+        crowd.navigation(grid, goals, workers);
+        const float tFields = clock.GetElapsedTime();
+
+        // Everybody starts on a random spot of the streets.
+        std::mt19937 engine(1);
+        std::uniform_int_distribution<unsigned> cell(0, static_cast<unsigned>(grid.cellCount() - 1));
+        std::uniform_real_distribution<float> jitter(-0.5f, 0.5f);
+        while(crowd.agentCount() < nAgents) {
+            const unsigned c = cell(engine);
+            if(!grid.blocked(c))
+                crowd.add(grid.center(c) + Vector(jitter(engine), 0.0f, jitter(engine)));
+        }
+
+        float tMax = 0.0f;
+        clock.Reset();
+        for(unsigned step = 0 ; step < nSteps ; ++step) {
+            const float t0 = clock.GetElapsedTime();
+            crowd.step(fDeltaT, workers);
+            tMax = std::max(tMax, clock.GetElapsedTime() - t0);
+        }
+        const float tStep = clock.GetElapsedTime() / nSteps;
+
+        // Check that people actually walk, and where they shouldn't.
+        float fSpeed = 0.0f;
+        std::size_t nInside = 0;
+        for(Crowd::Agent a = 0 ; a < crowd.agentCount() ; ++a) {
+            fSpeed += crowd.vel(a).len();
+            unsigned c;
+            if(grid.cell(crowd.pos(a).x(), crowd.pos(a).z(), c) && grid.blocked(c))
+                ++nInside;
+        }
+
+        std::cout << "  " << nWorkers << " workers: fields " << tFields * 1000.0f << "ms, step "
+                  << tStep * 1000.0f << "ms (max " << tMax * 1000.0f << "ms), "
+                  << nAgents / tStep / 1e6f << "M agents/s, avg speed " << fSpeed / crowd.agentCount() << "m/s, "
+                  << crowd.arrivals() << " arrivals, " << nInside << " inside buildings" << std::endl;
+
+        if(nWorkers == nMaxWorkers)
+            break;
+    }
+
+    return EXIT_SUCCESS;
+} catch(const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
+}
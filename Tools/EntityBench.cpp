@@ -0,0 +1,310 @@
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "Game/Civilian.h"
+#include "Game/Entities.h"
+#include "Utilities/Math.h"
+#include "Utilities/ThreadPool.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace RoadRage;
+
+/// A component telling the entities apart, which must stay with its entity
+/// wherever that one gets moved to.
+struct Id {
+    explicit Id(uint32_t in_n = 0) : n(in_n) {}
+    uint32_t n;
+};
+
+/// A component owning memory, which must neither leak nor be freed twice
+/// when moved around.
+struct Name {
+    explicit Name(uint32_t in_n) : p(new uint32_t(in_n)) {}
+    std::unique_ptr<uint32_t> p;
+};
+
+/// A civilian the way it was before the entities, to compare against: an
+/// object of its own on the heap, thinking through a virtual call, with all
+/// the state of a MobileEntity whether it's used or not, and a LodModel of
+/// its own, whose levels it shared with nobody.
+class LegacyCivilian {
+public:
+    LegacyCivilian(const Vector& in_pos, const Vector& in_vel, float in_fOri, float in_fAngularVel)
+        : m_pos(in_pos), m_fOri(in_fOri), m_scale(0.1f, 0.5f, 1.0f), m_bModelMatrixDirty(true)
+        , m_vel(in_vel), m_fAngularVel(in_fAngularVel), m_fAngularAccel(0.0f)
+        , m_fHysteresis(0.15f), m_fRadius(0.0f), m_pCrowd(0), m_agent(0)
+    {
+        // As much as the box and the impostor took, without drawing them.
+        m_levels.push_back(Level(std::make_shared<std::array<char, sizeof(BoxModel)>>(), 0.05f));
+        m_levels.push_back(Level(std::make_shared<std::array<char, sizeof(ImpostorModel)>>(), 0.0f));
+    }
+    virtual ~LegacyCivilian() {}
+
+    /// What MobileEntity::think and Civilian::think did.
+    virtual void think(const GameClock& clock)
+    {
+        if(!m_pCrowd) {
+            const float fDeltaT = clock.deltaT();
+            if(!nearZero(m_accel.len()))
+                m_vel += m_accel * fDeltaT;
+            if(!nearZero(m_vel.len()))
+                this->pos(m_pos + m_vel * fDeltaT);
+            if(!nearZero(m_fAngularAccel))
+                m_fAngularVel += m_fAngularAccel * fDeltaT;
+            if(!nearZero(m_fAngularVel))
+                this->ori(m_fOri + m_fAngularVel * fDeltaT);
+            if(!nearZero(m_scaleAccel.len()))
+                m_scaleVel += m_scaleAccel * fDeltaT;
+            if(!nearZero(m_scaleVel.len()))
+                this->scale(m_scale + m_scaleVel * fDeltaT);
+            return;
+        }
+
+        const Vector v = m_pCrowd->vel(m_agent);
+        this->pos(m_pCrowd->pos(m_agent));
+        m_vel = v;
+        if(v.x()*v.x() + v.z()*v.z() > 0.01f)
+            this->ori(std::atan2(v.x(), v.z()));
+    }
+
+    void join(Crowd& io_crowd)
+    {
+        m_pCrowd = &io_crowd;
+        m_agent = io_crowd.add(m_pos);
+    }
+
+    /// \return How many bytes this civilian takes, its models included.
+    std::size_t memoryUsage() const
+    {
+        return sizeof(LegacyCivilian) + m_levels.capacity() * sizeof(Level) + sizeof(BoxModel) + sizeof(ImpostorModel);
+    }
+
+private:
+    typedef std::pair<std::shared_ptr<void>, float> Level;
+
+    // Like those of VisibleEntity, which have the model matrix recomputed.
+    void pos(const Vector& in_pos) { m_pos = in_pos; m_bModelMatrixDirty = true; }
+    void ori(float in_fOri) { m_fOri = in_fOri; m_bModelMatrixDirty = true; }
+    void scale(const Vector& in_scale) { m_scale = in_scale; m_bModelMatrixDirty = true; }
+
+    // VisibleEntity
+    Vector m_pos;
+    float m_fOri;
+    Vector m_scale;
+    AffineMatrix m_cachedModelMatrix;
+    bool m_bModelMatrixDirty;
+    // MobileEntity
+    Vector m_vel;
+    Vector m_accel;
+    float m_fAngularVel;
+    float m_fAngularAccel;
+    Vector m_scaleVel;
+    Vector m_scaleAccel;
+    // Civilian, and its LodModel
+    std::vector<Level> m_levels;
+    float m_fHysteresis;
+    float m_fRadius;
+    LodState m_lod;
+    Crowd* m_pCrowd;
+    Crowd::Agent m_agent;
+};
+
+/// Checks \a in_b, telling about \a in_sWhat if it doesn't hold.
+bool check(const char* in_sWhat, bool in_b)
+{
+    if(!in_b)
+        std::cout << "  " << in_sWhat << " FAILED" << std::endl;
+    return in_b;
+}
+
+/// Creates, changes and destroys entities at random, checking that handles
+/// and components stay true to them all the while.
+/// \return false if they don't.
+bool validate(std::size_t in_nEntities, ThreadPool& io_workers)
+{
+    std::cout << "Entities: " << in_nEntities << " made, changed and destroyed at random" << std::endl;
+    Entities entities;
+    std::vector<Entity> alive, dead;
+    std::mt19937 engine(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    bool bOk = true;
+
+    for(uint32_t i = 0 ; i < in_nEntities ; ++i) {
+        alive.push_back(i % 3 == 0 ? entities.create(Id(i), Transform(Vector(static_cast<float>(i), 0.0f, 0.0f)))
+                                   : entities.create(Id(i), Transform(Vector(static_cast<float>(i), 0.0f, 0.0f)), Name(i)));
+    }
+
+    for(unsigned round = 0 ; round < 4 ; ++round) {
+        // Some go, some come, taking over the indices of the ones gone.
+        for(std::size_t i = 0 ; i < alive.size() ; ) {
+            if(unit(engine) < 0.25f) {
+                entities.destroy(alive[i]);
+                dead.push_back(alive[i]);
+                alive[i] = alive.back();
+                alive.pop_back();
+            } else {
+                ++i;
+            }
+        }
+        const std::size_t nNew = dead.size() / 2;
+        for(std::size_t i = 0 ; i < nNew ; ++i) {
+            const Entity e = entities.create(Transform(), Id());
+            entities.get<Transform>(e)->pos = Vector(static_cast<float>(e.index), 0.0f, 0.0f);
+            entities.get<Id>(e)->n = e.index;
+            alive.push_back(e);
+        }
+
+        // Others get components, or lose them, which moves them over to
+        // other archetypes.
+        for(auto i = alive.begin() ; i != alive.end() ; ++i) {
+            const float r = unit(engine);
+            if(r < 0.2f)
+                entities.add(*i, Motion(Vector(1.0f, 0.0f, 0.0f)));
+            else if(r < 0.4f)
+                entities.remove<Motion>(*i);
+            else if(r < 0.5f)
+                entities.remove<Name>(*i);
+        }
+
+        bOk &= check("Entity count", entities.size() == alive.size());
+        for(auto i = dead.begin() ; i != dead.end() ; ++i) {
+            bOk &= check("Destroyed entity gone", !entities.alive(*i) && !entities.get<Id>(*i));
+        }
+        for(auto i = alive.begin() ; i != alive.end() ; ++i) {
+            const Id* pId = entities.get<Id>(*i);
+            const Transform* pTransform = entities.get<Transform>(*i);
+            const Name* pName = entities.get<Name>(*i);
+            bOk &= check("Components kept", pId && pTransform && pTransform->pos.x() == static_cast<float>(pId->n));
+            bOk &= check("Owned memory kept", !pName || *pName->p == pId->n);
+        }
+
+        // Going through them finds every one exactly once.
+        std::size_t nSeen = 0, nMoving = 0;
+        entities.each<Id, Transform>([&nSeen](Entity, Id& in_id, Transform& in_transform) {
+            nSeen += in_transform.pos.x() == static_cast<float>(in_id.n);
+        });
+        std::vector<std::size_t> moving(io_workers.size(), 0);
+        entities.eachChunk<Transform, Motion>(io_workers, [&moving](unsigned in_worker, std::size_t in_n, const Entity*, Transform*, Motion*) {
+            moving[in_worker] += in_n;
+        });
+        for(auto i = moving.begin() ; i != moving.end() ; ++i) {
+            nMoving += *i;
+        }
+        bOk &= check("Each", nSeen == alive.size());
+        bOk &= check("Each chunk", nMoving == entities.count<Transform, Motion>());
+        if(!bOk)
+            break;
+    }
+
+    return bOk;
+}
+
+////////////////////////////////////////////////////////////
+/// Checks the entities' handles, generations and archetypes on random
+/// changes, then measures what the civilians cost: the memory per civilian,
+/// and the time per civilian of moving them, walking on their own and along
+/// with the crowd, with one worker and with all of them. The same goes for
+/// the civilians as they were before the entities, on one worker, as they
+/// thought then, to compare against.
+///
+/// Usage: roadrage_entitybench [civilians] [steps]
+///
+/// \return Application exit code, failing if the entities lose track of
+///         their components
+///
+////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+try {
+    const std::size_t nCivilians = argc > 1 ? std::max(1, std::atoi(argv[1])) : 100000;
+    const unsigned nSteps = argc > 2 ? std::max(1, std::atoi(argv[2])) : 600;
+
+    ThreadPool workers;
+    if(!validate(nCivilians / 4 + 1, workers)) {
+        std::cerr << "The entities lost track of their components!" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << nCivilians << " civilians, " << nSteps << " steps" << std::endl;
+
+    // Those before first, spawned the same way, in between the allocations
+    // of one another as they were.
+    GameClock clock;
+    {
+        Crowd crowd;
+        std::vector<std::unique_ptr<LegacyCivilian>> legacy;
+        std::mt19937 engine(1);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::size_t nBytes = 0;
+        for(std::size_t i = 0 ; i < nCivilians ; ++i) {
+            legacy.push_back(std::unique_ptr<LegacyCivilian>(new LegacyCivilian(
+                Vector(unit(engine) * 1000.0f, 0.0f, unit(engine) * 1000.0f),
+                Vector(unit(engine) - 0.5f, 0.0f, unit(engine) - 0.5f), unit(engine) * pi, 0.0f)));
+            nBytes += legacy.back()->memoryUsage() + sizeof(legacy.back());
+        }
+        std::cout << "As objects: " << static_cast<float>(nBytes) / nCivilians << " bytes per civilian" << std::endl;
+
+        for(unsigned bCrowd = 0 ; bCrowd < 2 ; ++bCrowd) {
+            if(bCrowd) {
+                for(auto i = legacy.begin() ; i != legacy.end() ; ++i) {
+                    (*i)->join(crowd);
+                }
+            }
+
+            sf::Clock timer;
+            for(unsigned step = 0 ; step < nSteps ; ++step) {
+                clock.tick(1.0f / 60.0f);
+                for(auto i = legacy.begin() ; i != legacy.end() ; ++i) {
+                    (*i)->think(clock);
+                }
+            }
+            std::cout << "  " << (bCrowd ? "in the crowd" : "on their own") << ", 1 worker: "
+                      << timer.GetElapsedTime() / (nSteps * nCivilians) * 1e9f << "ns per civilian and step" << std::endl;
+        }
+    }
+
+    Entities entities;
+    Crowd crowd;
+    Civilians civilians(entities, crowd);
+    std::mt19937 engine(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for(std::size_t i = 0 ; i < nCivilians ; ++i) {
+        civilians.spawn(Vector(unit(engine) * 1000.0f, 0.0f, unit(engine) * 1000.0f),
+                        Vector(unit(engine) - 0.5f, 0.0f, unit(engine) - 0.5f), unit(engine) * pi, 0.0f);
+    }
+    std::cout << "As entities: " << static_cast<float>(entities.memoryUsage()) / nCivilians << " bytes per civilian" << std::endl;
+
+    ThreadPool one(1);
+    for(unsigned bCrowd = 0 ; bCrowd < 2 ; ++bCrowd) {
+        if(bCrowd)
+            civilians.join();
+
+        ThreadPool* pools[] = {&one, &workers};
+        for(unsigned p = 0 ; p < (workers.size() > 1 ? 2u : 1u) ; ++p) {
+            sf::Clock timer;
+            for(unsigned step = 0 ; step < nSteps ; ++step) {
+                clock.tick(1.0f / 60.0f);
+                civilians.think(clock, *pools[p]);
+            }
+            std::cout << "  " << (bCrowd ? "in the crowd" : "on their own") << ", " << pools[p]->size() << (pools[p]->size() > 1 ? " workers: " : " worker: ")
+                      << timer.GetElapsedTime() / (nSteps * nCivilians) * 1e9f << "ns per civilian and step" << std::endl;
+        }
+    }
+
+    return EXIT_SUCCESS;
+} catch(const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
+}
@@ -0,0 +1,71 @@
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "3d/MeshData.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+using namespace RoadRage;
+
+void printStats(const std::string& what, const MeshData::Stats& s)
+{
+    std::cout << what << ": "
+              << s.nVertices << " vertices (" << s.vertexBytes << " bytes), "
+              << s.nTriangles << " triangles (" << s.indexBytes << " bytes of indices), "
+              << "ACMR " << s.acmr << std::endl;
+}
+
+////////////////////////////////////////////////////////////
+/// Offline mesh optimizer: reads a mesh (.obj or .rrmesh), runs the whole
+/// optimization pipeline on it and writes it in our binary format. It also
+/// reports how long loading takes and how much memory the mesh needs, before
+/// and after.
+///
+/// Usage: roadrage_meshopt <input.obj|input.rrmesh> <output.rrmesh>
+///
+/// \return Application exit code
+///
+////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+try {
+    if(argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <input.obj|input.rrmesh> <output.rrmesh>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    sf::Clock clock;
+    MeshData mesh;
+    if(!mesh.loadFile(argv[1]))
+        throw std::runtime_error(std::string("Can't load the mesh ") + argv[1]);
+    float tLoadRaw = clock.GetElapsedTime();
+    printStats("Input", mesh.stats());
+
+    clock.Reset();
+    mesh.optimize();
+    float tOptimize = clock.GetElapsedTime();
+    printStats("Output", mesh.stats());
+
+    mesh.saveBinary(argv[2]);
+
+    // And this is what it costs the game to load it now.
+    clock.Reset();
+    MeshData reloaded;
+    if(!reloaded.loadFile(argv[2]))
+        throw std::runtime_error(std::string("Can't read back the mesh ") + argv[2]);
+    float tLoadBinary = clock.GetElapsedTime();
+
+    std::cout << "Loading the input took " << tLoadRaw*1000.0f << "ms, optimizing "
+              << tOptimize*1000.0f << "ms, loading the output " << tLoadBinary*1000.0f << "ms" << std::endl;
+
+    return EXIT_SUCCESS;
+} catch(const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
+}
@@ -0,0 +1,240 @@
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "Conf/Configuration.h"
+#include "Conf/RoadRageDefaultSettings.h"
+
+#include "Game/World.h"
+
+#include "Net/Client.h"
+#include "Net/Server.h"
+
+#include "Tools/BenchLevel.h"
+
+#include "Utilities/FileSystem.h"
+#include "Utilities/String.h"
+#include "Utilities/ThreadPool.h"
+
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Sleep.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace RoadRage;
+
+/// How many of the server's ticks may take longer than the time between two,
+/// as a part of them. The clients' inputs wait in a buffer of two, which
+/// makes up for one that's late now and then, not for a server that can't
+/// keep up.
+#define D_NETBENCH_MAX_LATE_TICKS 0.05f
+
+/// What the server's ticks took and did.
+struct TickStats {
+    TickStats() : nTicks(0), nLate(0), fTotal(0.0f), fThink(0.0f), fReplication(0.0f), fWorst(0.0f), nViewed(0), nEntered(0), nLeft(0) {}
+
+    unsigned nTicks, nLate;
+    float fTotal, fThink, fReplication, fWorst;
+    uint64_t nViewed, nEntered, nLeft;
+};
+
+/// Notes down what \a in_server's last tick took and did.
+void count(const Server& in_server, TickStats& io_stats)
+{
+    ++io_stats.nTicks;
+    io_stats.fTotal += in_server.tickTime();
+    io_stats.fThink += in_server.thinkTime();
+    io_stats.fReplication += in_server.replicationTime();
+    io_stats.nViewed += in_server.viewed();
+    io_stats.nEntered += in_server.entered();
+    io_stats.nLeft += in_server.left();
+    io_stats.fWorst = std::max(io_stats.fWorst, in_server.tickTime());
+    if(in_server.tickTime() > 1.0f / in_server.tickRate())
+        ++io_stats.nLate;
+}
+
+/// Ticks \a io_server at its tick rate until \a in_bStop is set, for the bots
+/// to connect.
+void serve(Server& io_server, const std::atomic<bool>& in_bStop)
+{
+    sf::Clock clock;
+    float fNextTick = 0.0f;
+    while(!in_bStop) {
+        io_server.tick();
+
+        fNextTick += 1.0f / io_server.tickRate();
+        const float fWait = fNextTick - clock.GetElapsedTime();
+        if(fWait > 0.0f)
+            sf::Sleep(fWait);
+    }
+}
+
+/// What a bot saw of its own car.
+struct BotCar {
+    BotCar() : bSeen(false), fFirstX(0.0f), fFirstZ(0.0f), fLastX(0.0f), fLastZ(0.0f) {}
+
+    bool bSeen;
+    float fFirstX, fFirstZ;
+    float fLastX, fLastZ;
+};
+
+////////////////////////////////////////////////////////////
+/// Runs a server on loopback and that many bots driving around on it for that
+/// many seconds, the server ticking in between the bots. Then tells
+/// how long the server's ticks took, which is how much of its cores it
+/// needs, what the clients had in view, and how much bandwidth every client
+/// used. Fails if a bot didn't get any snapshots, or its car didn't move, or
+/// if the server's ticks take longer than the time between two, on average or
+/// more than every now and then.
+///
+/// By default, that's 64 players in a city of 100k cars, on a single core.
+/// The city's roads get preprocessed on the first run, which takes a while.
+///
+/// Usage: roadrage_netbench [bots] [seconds] [traffic cars] [server threads] [road network radius]
+///
+/// \return Application exit code
+///
+////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+try {
+    const std::size_t nBots = argc > 1 ? std::max(1, std::atoi(argv[1])) : 64;
+    const float fSeconds = argc > 2 ? static_cast<float>(std::max(0.5, std::atof(argv[2]))) : 10.0f;
+
+    // The server on a single core, unless told otherwise, and a city large
+    // enough for the cars not to be stuck in one big jam.
+    Configuration settings((RoadRageDefaultSettings()));
+    settings.set("TrafficCars", argc > 3 ? argv[3] : "100000");
+    const unsigned nThreads = argc > 4 ? static_cast<unsigned>(std::max(1, std::atoi(argv[4]))) : 1;
+    settings.set("RoadNetworkRadius", argc > 5 ? argv[5] : "96");
+
+    FileSystem fs(prepareLevel(settings, "NetBench"));
+    ThreadPool workers(nThreads);
+    World world(settings, fs, "NetBench", workers);
+    Server server(world, 0, to<float>(settings.get("ServerTickRate")), to<float>(settings.get("SnapshotRadius")),
+                  to<std::size_t>(settings.get("SnapshotBandwidth")));
+
+    sf::Clock total;
+    bool bOk = true;
+    std::vector<BotCar> cars(nBots);
+    std::vector<std::unique_ptr<Client>> bots;
+    TickStats ticks;
+    try {
+        // Connecting takes the server to answer on its own. Once everybody's
+        // in, it ticks in between the bots, which they would hold up on a
+        // single core otherwise, making its ticks look longer than they are.
+        std::atomic<bool> bConnected(false);
+        std::thread thread(serve, std::ref(server), std::cref(bConnected));
+        try {
+            for(std::size_t i = 0 ; i < nBots ; ++i) {
+                bots.push_back(std::unique_ptr<Client>(new Client("127.0.0.1", server.port())));
+            }
+        } catch(...) {
+            bConnected = true;
+            thread.join();
+            throw;
+        }
+        bConnected = true;
+        thread.join();
+
+        // Every bot drives full throttle, steering its own way every second,
+        // sending its input every tick like a game does.
+        sf::Clock clock;
+        Snapshot snapshot;
+        const unsigned nTicksPerSecond = static_cast<unsigned>(server.tickRate());
+        for(unsigned tick = 0 ; clock.GetElapsedTime() < fSeconds ; ++tick) {
+            server.tick();
+            count(server, ticks);
+
+            for(std::size_t i = 0 ; i < nBots ; ++i) {
+                const int8_t steering = static_cast<int8_t>((tick / nTicksPerSecond + i) % 3) - 1;
+                bots[i]->send(CarInput(steering, 1));
+                while(bots[i]->receive(snapshot)) {
+                    for(auto j = snapshot.players.begin() ; j != snapshot.players.end() ; ++j) {
+                        if(j->id != bots[i]->player())
+                            continue;
+                        if(!cars[i].bSeen) {
+                            cars[i].fFirstX = j->x();
+                            cars[i].fFirstZ = j->z();
+                            cars[i].bSeen = true;
+                        }
+                        cars[i].fLastX = j->x();
+                        cars[i].fLastZ = j->z();
+                    }
+                }
+            }
+
+            const float fWait = (tick + 1) / server.tickRate() - clock.GetElapsedTime();
+            if(fWait > 0.0f)
+                sf::Sleep(fWait);
+        }
+    } catch(const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        bOk = false;
+    }
+
+    // Connecting all the bots takes a while, too.
+    const float fTotal = total.GetElapsedTime();
+
+    std::cout << nBots << " bots, " << world.traffic().cars().size() << " traffic cars, "
+              << server.tickRate() << " ticks/s for " << fTotal << "s, server on " << nThreads << " thread(s)" << std::endl;
+    if(ticks.nTicks > 0) {
+        const float fAverage = ticks.fTotal / ticks.nTicks;
+        std::cout << "Tick: " << fAverage * 1000.0f << "ms on average, of which "
+                  << ticks.fThink / ticks.nTicks * 1000.0f << "ms thinking and "
+                  << ticks.fReplication / ticks.nTicks * 1000.0f << "ms replicating, " << ticks.fWorst * 1000.0f
+                  << "ms worst, " << ticks.nLate << " of " << ticks.nTicks << " ticks over their "
+                  << 1000.0f / server.tickRate() << "ms" << std::endl;
+        if(fAverage > 1.0f / server.tickRate() || ticks.nLate > D_NETBENCH_MAX_LATE_TICKS * ticks.nTicks) {
+            std::cerr << "The server doesn't keep up with its " << server.tickRate() << " ticks/s" << std::endl;
+            bOk = false;
+        }
+        std::cout << "Server CPU: " << fAverage * server.tickRate() * 100.0f << "% of "
+                  << (nThreads > 1 ? "its cores" : "a core") << std::endl;
+        std::cout << "Interest: " << static_cast<float>(ticks.nViewed) / ticks.nTicks / nBots << " cars in view, "
+                  << static_cast<float>(ticks.nEntered) / ticks.nTicks / nBots << " entering and "
+                  << static_cast<float>(ticks.nLeft) / ticks.nTicks / nBots << " leaving per tick, per client" << std::endl;
+    }
+
+    // With that many bots, only the spread of them is of interest.
+    float fMinDown = 0.0f, fMaxDown = 0.0f, fSumDown = 0.0f, fSumUp = 0.0f;
+    unsigned nMinSnapshots = 0;
+    for(std::size_t i = 0 ; i < bots.size() ; ++i) {
+        const Client& bot = *bots[i];
+        const float fMoved = std::sqrt((cars[i].fLastX - cars[i].fFirstX)*(cars[i].fLastX - cars[i].fFirstX)
+                                     + (cars[i].fLastZ - cars[i].fFirstZ)*(cars[i].fLastZ - cars[i].fFirstZ));
+        const float fDown = bot.bytesReceived() / fTotal / 1024.0f;
+        fMinDown = i == 0 ? fDown : std::min(fMinDown, fDown);
+        fMaxDown = std::max(fMaxDown, fDown);
+        fSumDown += fDown;
+        fSumUp += bot.bytesSent() / fTotal / 1024.0f;
+        nMinSnapshots = i == 0 ? bot.snapshots() : std::min(nMinSnapshots, bot.snapshots());
+
+        if(bot.snapshots() == 0 || !cars[i].bSeen || fMoved < 1.0f) {
+            std::cerr << "Bot " << bot.player() << " didn't get to drive: " << bot.snapshots()
+                      << " snapshots, drove " << fMoved << "m" << std::endl;
+            bOk = false;
+        }
+    }
+    if(!bots.empty()) {
+        std::cout << "Per client: " << fSumDown / bots.size() << "kB/s down on average, " << fMinDown << " to "
+                  << fMaxDown << "kB/s, " << fSumUp / bots.size() << "kB/s up, at least " << nMinSnapshots
+                  << " snapshots" << std::endl;
+    }
+    std::cout << "Server: " << server.bytesSent() / fTotal / 1024.0f << "kB/s out, "
+              << server.bytesReceived() / fTotal / 1024.0f << "kB/s in" << std::endl;
+
+    return bOk && bots.size() == nBots ? EXIT_SUCCESS : EXIT_FAILURE;
+} catch(const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
+}
@@ -0,0 +1,198 @@
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "3d/OcclusionBuffer.h"
+#include "Utilities/Math.h"
+#include "Utilities/ThreadPool.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace RoadRage;
+
+/// A synthetic city: its buildings, the people walking around in it and
+/// where we look at it from.
+struct City {
+    std::string name;
+    std::vector<Occluder> buildings;
+    std::vector<Occluder> people;
+    Vector eye;
+    float yaw;
+};
+
+/// Adds \a in_n pedestrians, standing anywhere in the \a in_fSize wide square
+/// that isn't inside a building.
+void addPeople(City& io_city, float in_fSize, std::size_t in_n, std::mt19937& io_engine)
+{
+    std::uniform_real_distribution<float> pos(0.0f, in_fSize);
+    while(io_city.people.size() < in_n) {
+        float x = pos(io_engine), z = pos(io_engine);
+
+        bool bInside = false;
+        for(auto b = io_city.buildings.begin() ; b != io_city.buildings.end() && !bInside ; ++b) {
+            bInside = x > b->min.x() - 0.5f && x < b->max.x() + 0.5f && z > b->min.z() - 0.5f && z < b->max.z() + 0.5f;
+        }
+
+        if(!bInside)
+            io_city.people.push_back(Occluder(Vector(x - 0.3f, 0.0f, z - 0.3f), Vector(x + 0.3f, 1.8f, z + 0.3f)));
+    }
+}
+
+/// Manhattan: blocks of four buildings of any height, along straight streets.
+City grid(std::size_t in_nBlocks, std::size_t in_nPeople)
+{
+    const float fBlock = 40.0f, fStreet = 12.0f;
+    std::mt19937 engine(1);
+    std::uniform_real_distribution<float> height(10.0f, 60.0f);
+
+    City city;
+    city.name = "grid";
+    for(std::size_t bx = 0 ; bx < in_nBlocks ; ++bx) {
+        for(std::size_t bz = 0 ; bz < in_nBlocks ; ++bz) {
+            const float x0 = fStreet + bx * (fBlock + fStreet);
+            const float z0 = fStreet + bz * (fBlock + fStreet);
+            for(unsigned i = 0 ; i < 4 ; ++i) {
+                const float x = x0 + (i & 1 ? fBlock * 0.5f : 0.0f);
+                const float z = z0 + (i & 2 ? fBlock * 0.5f : 0.0f);
+                city.buildings.push_back(Occluder(Vector(x + 1.0f, 0.0f, z + 1.0f), Vector(x + fBlock * 0.5f - 1.0f, height(engine), z + fBlock * 0.5f - 1.0f)));
+            }
+        }
+    }
+
+    // Standing on a street, looking down another.
+    const float fSize = fStreet + in_nBlocks * (fBlock + fStreet);
+    addPeople(city, fSize, in_nPeople, engine);
+    city.eye = Vector(fStreet * 0.5f, 1.7f, fSize - fStreet * 0.5f);
+    city.yaw = 0.0f;
+    return city;
+}
+
+/// A downtown of tall towers scattered without any order.
+City towers(std::size_t in_nTowers, std::size_t in_nPeople)
+{
+    const float fSize = 600.0f;
+    std::mt19937 engine(2);
+    std::uniform_real_distribution<float> pos(20.0f, fSize - 20.0f);
+    std::uniform_real_distribution<float> side(8.0f, 25.0f);
+    std::uniform_real_distribution<float> height(40.0f, 150.0f);
+
+    City city;
+    city.name = "towers";
+    for(std::size_t i = 0 ; i < in_nTowers ; ++i) {
+        const float x = pos(engine), z = pos(engine), w = side(engine), d = side(engine);
+        city.buildings.push_back(Occluder(Vector(x, 0.0f, z), Vector(x + w, height(engine), z + d)));
+    }
+
+    addPeople(city, fSize, in_nPeople, engine);
+    city.eye = Vector(5.0f, 1.7f, fSize - 5.0f);
+    city.yaw = -45.0f*deg2rad;
+    return city;
+}
+
+/// Suburbs: lots of small, low houses, which hide way less.
+City suburb(std::size_t in_nRows, std::size_t in_nPeople)
+{
+    const float fLot = 20.0f;
+    std::mt19937 engine(3);
+    std::uniform_real_distribution<float> height(4.0f, 9.0f);
+    std::uniform_real_distribution<float> side(8.0f, 14.0f);
+
+    City city;
+    city.name = "suburb";
+    for(std::size_t x = 0 ; x < in_nRows ; ++x) {
+        for(std::size_t z = 0 ; z < in_nRows ; ++z) {
+            const float x0 = 10.0f + x * fLot, z0 = 10.0f + z * fLot;
+            city.buildings.push_back(Occluder(Vector(x0 + 3.0f, 0.0f, z0 + 3.0f), Vector(x0 + 3.0f + side(engine), height(engine), z0 + 3.0f + side(engine))));
+        }
+    }
+
+    const float fSize = 20.0f + in_nRows * fLot;
+    addPeople(city, fSize, in_nPeople, engine);
+    city.eye = Vector(5.0f, 1.7f, fSize - 5.0f);
+    city.yaw = -30.0f*deg2rad;
+    return city;
+}
+
+////////////////////////////////////////////////////////////
+/// Benchmarks the software occlusion culling on a few synthetic city layouts,
+/// with more and more worker threads. Optionally writes what the culling sees
+/// of every city as PGM images, for checking it by eye.
+///
+/// Usage: roadrage_occlusionbench [frames] [image prefix]
+///
+/// \return Application exit code
+///
+////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+try {
+    const unsigned nFrames = argc > 1 ? std::max(1, std::atoi(argv[1])) : 100;
+    const std::string sImages = argc > 2 ? argv[2] : "";
+
+    std::vector<City> cities;
+    cities.push_back(grid(16, 20000));
+    cities.push_back(towers(600, 20000));
+    cities.push_back(suburb(40, 20000));
+
+    // The occlusion buffer's aspect ratio, with the game's field of view.
+    const General4x4Matrix proj = General4x4Matrix::perspectiveProjection(45.0f, static_cast<float>(D_OCCLUSION_WIDTH) / D_OCCLUSION_HEIGHT, 0.5f);
+
+    const unsigned nMaxWorkers = std::max(1u, std::thread::hardware_concurrency());
+    for(auto city = cities.begin() ; city != cities.end() ; ++city) {
+        const AffineMatrix view = AffineMatrix::rotationY(-city->yaw) * AffineMatrix::translation(-city->eye.x(), -city->eye.y(), -city->eye.z());
+        const General4x4Matrix viewProj = proj * General4x4Matrix(view);
+
+        std::cout << city->name << ": " << city->buildings.size() << " buildings, " << city->people.size() << " people" << std::endl;
+
+        for(unsigned nWorkers = 1 ; ; nWorkers = std::min(nWorkers * 2, nMaxWorkers)) {
+            ThreadPool workers(nWorkers);
+            OcclusionBuffer buffer;
+            std::atomic<std::size_t> nHidden(0);
+
+            float tRender = 0.0f, tTest = 0.0f;
+            sf::Clock clock;
+            for(unsigned frame = 0 ; frame < nFrames ; ++frame) {
+                clock.Reset();
+                buffer.render(viewProj, city->buildings, workers);
+                tRender += clock.GetElapsedTime();
+
+                clock.Reset();
+                nHidden = 0;
+                workers.parallelFor(city->people.size(), [&](std::size_t in_begin, std::size_t in_end, unsigned) {
+                    std::size_t n = 0;
+                    for(std::size_t i = in_begin ; i < in_end ; ++i) {
+                        if(!buffer.visible(city->people[i].min, city->people[i].max))
+                            ++n;
+                    }
+                    nHidden += n;
+                }, 256);
+                tTest += clock.GetElapsedTime();
+            }
+
+            std::cout << "  " << nWorkers << " workers: rasterizing " << buffer.faceCount() << " faces "
+                      << tRender / nFrames * 1000.0f << "ms, testing " << tTest / nFrames * 1000.0f << "ms, "
+                      << nHidden * 100 / city->people.size() << "% hidden" << std::endl;
+
+            if(nWorkers == nMaxWorkers) {
+                if(!sImages.empty() && !buffer.writeImage(sImages + city->name + ".pgm"))
+                    throw std::runtime_error("Can't write the image " + sImages + city->name + ".pgm");
+                break;
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+} catch(const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
+}
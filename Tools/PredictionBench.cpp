@@ -0,0 +1,198 @@
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "Conf/Configuration.h"
+#include "Conf/RoadRageDefaultSettings.h"
+
+#include "Game/GameClock.h"
+#include "Game/World.h"
+
+#include "Net/Client.h"
+#include "Net/Server.h"
+#include "Net/Session.h"
+
+#include "Utilities/FileSystem.h"
+#include "Utilities/String.h"
+#include "Utilities/ThreadPool.h"
+
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Sleep.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace RoadRage;
+
+/// How many players drive around, each seeing the others interpolated.
+#define D_PREDICTIONBENCH_BOTS 4
+/// How fast the bots' games run, in frames per second, which isn't the
+/// server's tick rate on purpose.
+#define D_PREDICTIONBENCH_FRAME_RATE 60.0f
+/// The most corrections a bot may need per second. Driving as the server
+/// does, only the first placement and the inputs that got lost for good
+/// should need one, and the inputs get resent.
+#define D_PREDICTIONBENCH_MAX_CORRECTION_RATE 0.5f
+
+/// Ticks \a io_server at its tick rate until \a in_bStop is set.
+void serve(Server& io_server, const std::atomic<bool>& in_bStop)
+{
+    sf::Clock clock;
+    for(unsigned tick = 1 ; !in_bStop ; ++tick) {
+        io_server.tick();
+        const float fWait = tick / io_server.tickRate() - clock.GetElapsedTime();
+        if(fWait > 0.0f)
+            sf::Sleep(fWait);
+    }
+}
+
+/// A player with a game of its own, but no window.
+struct Bot {
+    Bot(const Configuration& in_settings, const FileSystem& in_fs, ThreadPool& io_workers, unsigned short in_port)
+        : client("127.0.0.1", in_port)
+        , world(in_settings, in_fs, client.level(), io_workers)
+        , session(in_settings, client, world)
+        , nFrames(0)
+        , nStarved(0)
+        , bPlaced(false)
+    {
+    }
+
+    Client client;
+    World world;
+    Session session;
+
+    /// How many frames it played, and in how many of those the other
+    /// players had to be held in place for lack of snapshots.
+    unsigned nFrames;
+    unsigned nStarved;
+    /// Where the server first put its car.
+    bool bPlaced;
+    Vector start;
+};
+
+////////////////////////////////////////////////////////////
+/// Runs a server on loopback in a thread of its own, and a few bots playing
+/// on it through a simulated bad network, predicting their own cars and
+/// interpolating the others'. Then tells how often their predictions had to
+/// be corrected and what replaying the inputs cost, and how often the
+/// interpolation ran out of snapshots. Fails if a bot didn't get to drive,
+/// needed more than D_PREDICTIONBENCH_MAX_CORRECTION_RATE corrections a
+/// second, or a correction replayed more inputs than PredictionReplayLimit.
+///
+/// Usage: roadrage_predictionbench [latency ms] [jitter ms] [loss %] [seconds]
+///
+/// \return Application exit code
+///
+////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+try {
+    // The simulated network is the client's, so there and back again.
+    Configuration settings((RoadRageDefaultSettings()));
+    settings.set("NetLatency", to_s((argc > 1 ? std::atof(argv[1]) : 50.0) / 1000.0));
+    settings.set("NetJitter", to_s((argc > 2 ? std::atof(argv[2]) : 10.0) / 1000.0));
+    settings.set("NetLoss", to_s((argc > 3 ? std::atof(argv[3]) : 5.0) / 100.0));
+    const float fSeconds = argc > 4 ? static_cast<float>(std::max(1.0, std::atof(argv[4]))) : 10.0f;
+    settings.set("TrafficCars", "500");
+
+    FileSystem fs("Data");
+    ThreadPool serverWorkers(to<unsigned>(settings.get("WorkerThreads")));
+    World world(settings, fs, "PredictionBench", serverWorkers);
+    Server server(world, 0, to<float>(settings.get("ServerTickRate")), to<float>(settings.get("SnapshotRadius")),
+                  to<std::size_t>(settings.get("SnapshotBandwidth")));
+
+    std::atomic<bool> bStop(false);
+    std::thread thread(serve, std::ref(server), std::cref(bStop));
+
+    bool bOk = true;
+    ThreadPool workers(to<unsigned>(settings.get("WorkerThreads")));
+    std::vector<std::unique_ptr<Bot>> bots;
+    try {
+        for(std::size_t i = 0 ; i < D_PREDICTIONBENCH_BOTS ; ++i) {
+            bots.push_back(std::unique_ptr<Bot>(new Bot(settings, fs, workers, server.port())));
+        }
+
+        // Every bot drives, steering its own way every second and braking
+        // now and then, which is what's hard to predict.
+        sf::Clock clock;
+        GameClock frames;
+        for(unsigned frame = 0 ; clock.GetElapsedTime() < fSeconds ; ++frame) {
+            frames.tick();
+            for(std::size_t i = 0 ; i < bots.size() ; ++i) {
+                Bot& bot = *bots[i];
+                const unsigned second = static_cast<unsigned>(frames.now()) + static_cast<unsigned>(i);
+                const CarInput input(static_cast<int8_t>(second % 3) - 1, second % 5 == 4 ? -1 : 1);
+
+                bot.session.think(frames.deltaT(), input);
+                bot.world.think(frames);
+                bot.session.apply();
+
+                if(!bot.bPlaced && bot.session.prediction().corrections() > 0) {
+                    bot.start = bot.world.player(bot.client.player())->pos();
+                    bot.bPlaced = true;
+                }
+                ++bot.nFrames;
+                if(bot.session.interpolation().starved() > 0)
+                    ++bot.nStarved;
+            }
+
+            const float fWait = (frame + 1) / D_PREDICTIONBENCH_FRAME_RATE - clock.GetElapsedTime();
+            if(fWait > 0.0f)
+                sf::Sleep(fWait);
+        }
+    } catch(const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        bOk = false;
+    }
+
+    bStop = true;
+    thread.join();
+
+    std::cout << bots.size() << " bots at " << settings.get("NetLatency") << "s latency, " << settings.get("NetJitter")
+              << "s jitter and " << to<float>(settings.get("NetLoss")) * 100.0f << "% loss each way, "
+              << server.tickRate() << " ticks/s for " << fSeconds << "s" << std::endl;
+
+    const std::size_t nLimit = to<std::size_t>(settings.get("PredictionReplayLimit"));
+    for(auto i = bots.begin() ; i != bots.end() ; ++i) {
+        const Bot& bot = **i;
+        const Prediction& prediction = bot.session.prediction();
+        const Avatar& car = *bot.world.player(bot.client.player());
+        const unsigned nCorrections = std::max(prediction.corrections(), 1u);
+
+        std::cout << "Bot " << bot.client.player() << ": " << bot.client.snapshots() << " snapshots, "
+                  << prediction.corrections() << " corrections, replaying "
+                  << static_cast<float>(prediction.replayed()) / nCorrections << " ticks in "
+                  << prediction.replayTime() / nCorrections * 1000.0f << "ms on average, "
+                  << prediction.worstReplay() << " ticks in " << prediction.worstReplayTime() * 1000.0f
+                  << "ms worst; " << prediction.pending() << " ticks ahead; others held in "
+                  << 100.0f * bot.nStarved / std::max(bot.nFrames, 1u) << "% of the frames; at "
+                  << car.pos().to_s() << std::endl;
+
+        if(bot.client.snapshots() == 0 || !bot.bPlaced || (car.pos() - bot.start).len() < 1.0f) {
+            std::cerr << "Bot " << bot.client.player() << " didn't get to drive" << std::endl;
+            bOk = false;
+        }
+        if(prediction.corrections() > D_PREDICTIONBENCH_MAX_CORRECTION_RATE * fSeconds) {
+            std::cerr << "Bot " << bot.client.player() << " needed more than " << D_PREDICTIONBENCH_MAX_CORRECTION_RATE
+                      << " corrections a second" << std::endl;
+            bOk = false;
+        }
+        if(prediction.worstReplay() > nLimit) {
+            std::cerr << "Bot " << bot.client.player() << " replayed more than " << nLimit << " ticks" << std::endl;
+            bOk = false;
+        }
+    }
+
+    return bOk && bots.size() == D_PREDICTIONBENCH_BOTS ? EXIT_SUCCESS : EXIT_FAILURE;
+} catch(const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
+}
@@ -0,0 +1,139 @@
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "Game/RoadNetwork.h"
+#include "Game/RoutePlanner.h"
+#include "Utilities/Hash.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace RoadRage;
+
+/// \return How long driving along \a in_lanes takes, in seconds.
+float travelTime(const RoadNetwork& in_roads, const std::vector<uint32_t>& in_lanes)
+{
+    float t = 0.0f;
+    for(auto i = in_lanes.begin() ; i != in_lanes.end() ; ++i) {
+        t += in_roads.lane(*i).length / in_roads.lane(*i).speedLimit;
+    }
+    return t;
+}
+
+////////////////////////////////////////////////////////////
+/// Lays out and preprocesses the road network of a level, the same one the
+/// game generates when there is none, and writes it to the level's
+/// roads.bin. Then benchmarks routing on it: A*, the contraction hierarchy,
+/// which must find routes just as quick, and the route cache, with the AI
+/// traffic's habit of going to the same few places.
+///
+/// Usage: roadrage_roads <output file> [level name] [radius] [chunk size] [queries]
+///
+/// \return Application exit code
+///
+////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+try {
+    if(argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <output file> [level name] [radius] [chunk size] [queries]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::string sLevel = argc > 2 ? argv[2] : "Test";
+    const int iRadius = argc > 3 ? std::max(1, std::atoi(argv[3])) : 32;
+    const float fChunkSize = argc > 4 ? static_cast<float>(std::max(1.0, std::atof(argv[4]))) : 32.0f;
+    const unsigned nQueries = argc > 5 ? std::max(1, std::atoi(argv[5])) : 10000;
+
+    RoadNetwork roads;
+    sf::Clock clock;
+    roads.generate(fChunkSize, iRadius, static_cast<unsigned>(fnv1a("Levels/" + sLevel)));
+    const float tGenerate = clock.GetElapsedTime();
+    clock.Reset();
+    roads.preprocess();
+    const float tPreprocess = clock.GetElapsedTime();
+    roads.save(argv[1]);
+
+    // Make sure the game can read it back.
+    std::ifstream f(argv[1], std::ios::binary);
+    const std::string sFile((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    RoadNetwork loaded;
+    if(!loaded.load(sFile.data(), sFile.size()) || !loaded.preprocessed() || loaded.laneCount() != roads.laneCount())
+        throw std::runtime_error("The road network file " + std::string(argv[1]) + " doesn't read back");
+
+    std::cout << roads.intersectionCount() << " intersections, " << roads.laneCount() << " lanes, "
+              << roads.shortcutCount() << " shortcuts; generated in " << tGenerate * 1000.0f
+              << "ms, preprocessed in " << tPreprocess * 1000.0f << "ms" << std::endl;
+
+    // Random trips all over the city.
+    std::mt19937 engine(1);
+    std::uniform_int_distribution<uint32_t> node(0, static_cast<uint32_t>(roads.intersectionCount() - 1));
+    std::vector<std::pair<uint32_t, uint32_t>> trips(nQueries);
+    for(auto i = trips.begin() ; i != trips.end() ; ++i) {
+        *i = std::make_pair(node(engine), node(engine));
+    }
+
+    RoadNetwork::Search search;
+    std::vector<uint32_t> lanes;
+    std::vector<float> times(nQueries);
+    clock.Reset();
+    for(unsigned i = 0 ; i < nQueries ; ++i) {
+        roads.routeAStar(trips[i].first, trips[i].second, search, lanes);
+        times[i] = travelTime(roads, lanes);
+    }
+    const float tAStar = clock.GetElapsedTime();
+
+    unsigned nWrong = 0;
+    clock.Reset();
+    for(unsigned i = 0 ; i < nQueries ; ++i) {
+        roads.route(trips[i].first, trips[i].second, search, lanes);
+        const float t = travelTime(roads, lanes);
+        if(std::abs(t - times[i]) > 1e-3f * std::max(1.0f, t))
+            ++nWrong;
+        // And the lanes have to actually connect.
+        for(std::size_t l = 1 ; l < lanes.size() ; ++l) {
+            if(roads.lane(lanes[l - 1]).to != roads.lane(lanes[l]).from) {
+                ++nWrong;
+                break;
+            }
+        }
+    }
+    const float tCH = clock.GetElapsedTime();
+
+    std::cout << "A*: " << tAStar / nQueries * 1e6f << "us per route, contraction hierarchy: "
+              << tCH / nQueries * 1e6f << "us per route, " << nWrong << " different" << std::endl;
+
+    // The traffic heads for a few hundred destinations, from wherever it is.
+    RoutePlanner planner(roads, 4096, 1);
+    std::uniform_int_distribution<unsigned> destination(0, 255);
+    std::vector<uint32_t> destinations(256);
+    for(auto i = destinations.begin() ; i != destinations.end() ; ++i) {
+        *i = node(engine);
+    }
+    std::uniform_int_distribution<uint32_t> start(0, std::min<uint32_t>(15, static_cast<uint32_t>(roads.intersectionCount() - 1)));
+    clock.Reset();
+    for(unsigned i = 0 ; i < nQueries ; ++i) {
+        planner.route(start(engine), destinations[destination(engine)], 0);
+    }
+    const float tCached = clock.GetElapsedTime();
+
+    std::cout << "Cached: " << tCached / nQueries * 1e6f << "us per route, " << planner.hits() << " hits, "
+              << planner.misses() << " misses" << std::endl;
+
+    return nWrong == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+} catch(const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
+}
@@ -0,0 +1,234 @@
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "Net/BitStream.h"
+#include "Net/Snapshot.h"
+#include "Net/SnapshotCodec.h"
+
+#include "Game/Car.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace RoadRage;
+
+/// How many ticks every run takes, and how many of them the acks lag behind,
+/// like they would with a round trip of 100ms at 30 ticks a second.
+#define D_SNAPSHOTBENCH_TICKS 90
+#define D_SNAPSHOTBENCH_ACK_DELAY 3
+/// What every car would take unquantized: its id, position, orientation,
+/// steering, speed and acceleration as floats, and its state.
+#define D_SNAPSHOTBENCH_NAIVE_BYTES (4 + 6*4 + 1)
+
+/// A city full of cars, a third of them standing, the others driving around
+/// in wide curves.
+class City {
+public:
+    City(std::size_t in_nCars, unsigned in_seed)
+        : m_engine(in_seed)
+    {
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        // As dense as the traffic of the game, about 2000 cars per square km.
+        const float fSide = std::sqrt(in_nCars / 2000.0f) * 1000.0f;
+        for(std::size_t i = 0 ; i < in_nCars ; ++i) {
+            Car c;
+            c.x = (unit(m_engine) - 0.5f) * fSide;
+            c.z = (unit(m_engine) - 0.5f) * fSide;
+            c.ori = unit(m_engine) * 2.0f * pi;
+            c.speed = unit(m_engine) < 0.33f ? 0.0f : 5.0f + 15.0f * unit(m_engine);
+            c.turn = (unit(m_engine) - 0.5f) * 0.2f;
+            m_cars.push_back(c);
+        }
+    }
+
+    void step(float in_fDeltaT)
+    {
+        for(auto i = m_cars.begin() ; i != m_cars.end() ; ++i) {
+            if(i->speed == 0.0f)
+                continue;
+            i->ori += i->turn * in_fDeltaT;
+            i->x -= std::sin(i->ori) * i->speed * in_fDeltaT;
+            i->z -= std::cos(i->ori) * i->speed * in_fDeltaT;
+        }
+    }
+
+    /// All cars, the nearest to the origin first, like the server sorts them.
+    void capture(uint32_t in_tick, Snapshot& out_snapshot) const
+    {
+        out_snapshot.tick = in_tick;
+        out_snapshot.lastInput = in_tick;
+        out_snapshot.players.assign(1, Snapshot::Entry(1, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, CarState::Standing));
+        // Every other tick, the player's car drives with physics, sliding
+        // and turning either way.
+        out_snapshot.bMotion = in_tick % 2 == 0;
+        out_snapshot.motion.qVy = static_cast<int16_t>(in_tick * 37 % 2001) - 1000;
+        out_snapshot.motion.qYawRate = static_cast<int16_t>(in_tick * 53 % 4001) - 2000;
+        out_snapshot.motion.gear = static_cast<uint8_t>(in_tick % 6);
+        out_snapshot.motion.qLeftover = static_cast<uint8_t>(in_tick * 11);
+
+        std::vector<std::pair<float, uint32_t>> order;
+        for(std::size_t i = 0 ; i < m_cars.size() ; ++i) {
+            order.push_back(std::make_pair(m_cars[i].x*m_cars[i].x + m_cars[i].z*m_cars[i].z, static_cast<uint32_t>(i)));
+        }
+        std::sort(order.begin(), order.end());
+
+        out_snapshot.traffic.clear();
+        for(auto i = order.begin() ; i != order.end() ; ++i) {
+            const Car& c = m_cars[i->second];
+            out_snapshot.traffic.push_back(Snapshot::Entry(i->second, c.x, c.z, c.ori, c.ori, c.speed, 0.0f,
+                                                           c.speed > 0.0f ? CarState::Driving : CarState::Standing));
+        }
+    }
+
+private:
+    struct Car {
+        float x, z, ori, speed, turn;
+    };
+
+    std::vector<Car> m_cars;
+    std::mt19937 m_engine;
+};
+
+/// What a run found out.
+struct Result {
+    Result() : nFullBytes(0), nDeltaBytes(0), nDone(0), fEncode(0.0f), fDecode(0.0f), nMismatches(0) {}
+
+    std::size_t nFullBytes;
+    std::size_t nDeltaBytes;
+    std::size_t nDone;
+    float fEncode, fDecode;
+    std::size_t nMismatches;
+};
+
+/// Sends the snapshots of \a in_nCars cars for a while, within \a in_nMaxBytes
+/// each, and checks that the client always has just what the server sent.
+Result run(std::size_t in_nCars, std::size_t in_nMaxBytes)
+{
+    City city(in_nCars, 42);
+    SnapshotEncoder encoder;
+    SnapshotDecoder decoder;
+    BitWriter bits;
+    Snapshot snapshot, decoded;
+    Result result;
+
+    // What the client has of every car, and when it got it.
+    std::vector<Snapshot::Entry> known(in_nCars);
+    std::vector<bool> bKnown(in_nCars, false);
+
+    for(uint32_t tick = 1 ; tick <= D_SNAPSHOTBENCH_TICKS ; ++tick) {
+        city.step(1.0f / 30.0f);
+        city.capture(tick, snapshot);
+        if(tick > D_SNAPSHOTBENCH_ACK_DELAY)
+            encoder.ack(tick - D_SNAPSHOTBENCH_ACK_DELAY);
+
+        sf::Clock clock;
+        const std::size_t nDone = encoder.encode(snapshot, in_nMaxBytes, bits);
+        const float fEncode = clock.GetElapsedTime();
+
+        clock.Reset();
+        BitReader reader(&bits.bytes()[0], bits.bytes().size());
+        const bool bOk = decoder.decode(reader, decoded);
+        const float fDecode = clock.GetElapsedTime();
+
+        if(!bOk || decoded.tick != tick || decoded.players.size() != 1 || decoded.players[0] != snapshot.players[0])
+            ++result.nMismatches;
+        else if(decoded.bMotion != snapshot.bMotion || (snapshot.bMotion && (decoded.motion.qVy != snapshot.motion.qVy
+                || decoded.motion.qYawRate != snapshot.motion.qYawRate || decoded.motion.gear != snapshot.motion.gear
+                || decoded.motion.qLeftover != snapshot.motion.qLeftover)))
+            ++result.nMismatches;
+
+        // Whatever came in is the newest state of those cars.
+        for(auto i = decoded.traffic.begin() ; i != decoded.traffic.end() ; ++i) {
+            known[i->id] = *i;
+            bKnown[i->id] = true;
+        }
+
+        if(tick == 1) {
+            result.nFullBytes = bits.bytes().size();
+        } else {
+            result.nDeltaBytes += bits.bytes().size();
+            result.nDone += nDone;
+            result.fEncode += fEncode;
+            result.fDecode += fDecode;
+        }
+
+        // Without a budget, the client has all cars as they are.
+        if(in_nMaxBytes == std::numeric_limits<std::size_t>::max()) {
+            if(nDone != snapshot.traffic.size())
+                ++result.nMismatches;
+            for(auto i = snapshot.traffic.begin() ; i != snapshot.traffic.end() ; ++i) {
+                if(!bKnown[i->id] || known[i->id] != *i)
+                    ++result.nMismatches;
+            }
+        } else if(bits.bytes().size() > std::max<std::size_t>(in_nMaxBytes, 64)) {
+            ++result.nMismatches;
+        }
+    }
+
+    const std::size_t nDelta = D_SNAPSHOTBENCH_TICKS - 1;
+    result.nDeltaBytes /= nDelta;
+    result.nDone /= nDelta;
+    result.fEncode /= nDelta;
+    result.fDecode /= nDelta;
+    return result;
+}
+
+////////////////////////////////////////////////////////////
+/// Benchmarks the snapshot encoding: how long encoding and decoding them
+/// takes for cities of the given amounts of cars, and how many bytes they
+/// take, the first one whole and the following ones as changes, compared to
+/// sending all the floats as they are. Then once more, within the budget
+/// of a client's snapshot. Fails if the client ever gets something else
+/// than what the server sent.
+///
+/// Usage: roadrage_snapshotbench [budget in bytes] [cars...]
+///
+/// \return Application exit code
+///
+////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+try {
+    // 32kB/s at 30 ticks a second, as is the default.
+    const std::size_t nBudget = argc > 1 ? std::max(64, std::atoi(argv[1])) : 1092;
+    std::vector<std::size_t> counts;
+    for(int i = 2 ; i < argc ; ++i) {
+        counts.push_back(std::max(1, std::atoi(argv[i])));
+    }
+    if(counts.empty()) {
+        counts.push_back(1000);
+        counts.push_back(10000);
+        counts.push_back(100000);
+    }
+
+    std::size_t nMismatches = 0;
+    for(auto i = counts.begin() ; i != counts.end() ; ++i) {
+        const Result all = run(*i, std::numeric_limits<std::size_t>::max());
+        const Result budget = run(*i, nBudget);
+        nMismatches += all.nMismatches + budget.nMismatches;
+
+        std::cout << *i << " cars: naive " << *i * D_SNAPSHOTBENCH_NAIVE_BYTES << " bytes, whole "
+                  << all.nFullBytes << " bytes, changes " << all.nDeltaBytes << " bytes ("
+                  << static_cast<float>(all.nDeltaBytes) / *i << " per car), encode "
+                  << all.fEncode * 1000.0f << "ms, decode " << all.fDecode * 1000.0f << "ms" << std::endl;
+        std::cout << "    within " << nBudget << " bytes: " << budget.nDeltaBytes << " bytes, "
+                  << budget.nDone << " cars up to date, encode " << budget.fEncode * 1000.0f << "ms, decode "
+                  << budget.fDecode * 1000.0f << "ms" << std::endl;
+        if(all.nMismatches + budget.nMismatches > 0)
+            std::cerr << "    " << all.nMismatches + budget.nMismatches << " mismatches!" << std::endl;
+    }
+
+    return nMismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+} catch(const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
+}
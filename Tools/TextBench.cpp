@@ -0,0 +1,151 @@
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "3d/TextLayout.h"
+#include "Utilities/String.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace RoadRage;
+
+/// A monospace font of 14 pixels, as big as the game's, made up so that no
+/// GL context is needed for it.
+FontMetrics::Ptr font()
+{
+    std::vector<FontMetrics::Glyph> glyphs(D_FONT_CHAR_COUNT);
+    for(unsigned i = 0 ; i < D_FONT_CHAR_COUNT ; ++i) {
+        FontMetrics::Glyph& g = glyphs[i];
+        const bool bSpace = D_FONT_FIRST_CHAR + i == ' ';
+        g.x0 = 1.0f; g.x1 = bSpace ? 1.0f : 7.0f;
+        g.y0 = -10.0f; g.y1 = 0.0f;
+        g.u0 = (i % 32) / 32.0f; g.u1 = g.u0 + 1.0f / 32.0f;
+        g.v0 = (i / 32) / 8.0f; g.v1 = g.v0 + 1.0f / 8.0f;
+        g.advance = 8.0f;
+    }
+    return FontMetrics::Ptr(new FontMetrics(14, 17.0f, glyphs));
+}
+
+/// What the text of a frame took.
+struct FrameStats {
+    FrameStats() : fTime(0.0f), nBytes(0) {}
+
+    float fTime;
+    /// What would go to the GPU.
+    std::size_t nBytes;
+};
+
+/// Updates \a io_text and tells how much of it needs uploading.
+std::size_t upload(TextLayout& io_text)
+{
+    io_text.update();
+    std::size_t nVertices = io_text.rebuilt() ? io_text.vertices().size() : 0;
+    for(auto i = io_text.patched().begin() ; i != io_text.patched().end() ; ++i) {
+        nVertices += i->second;
+    }
+    return nVertices * sizeof(TextLayout::Vertex)
+         + (io_text.moved() || io_text.rebuilt() ? io_text.positions().size() * sizeof(float) : 0);
+}
+
+/// A debug HUD of \a in_nLines lines, which change every frame.
+std::string hud(unsigned in_frame, unsigned in_nLines)
+{
+    std::string s;
+    for(unsigned i = 0 ; i < in_nLines ; ++i) {
+        s += "Line " + to_s(i) + ": " + to_s(in_frame * (i + 1) % 10000) + " things, " + to_s(in_frame % 100) + "ms\n";
+    }
+    return s;
+}
+
+////////////////////////////////////////////////////////////
+/// Benchmarks laying out the text the game draws, without a GL context: that
+/// many labels plus a debug HUD, for that many frames, and how much of the
+/// vertex buffer and the labels' positions would get uploaded per frame.
+///  - Moving: all labels jump around every frame, and one of them changes
+///    its text, as the game's TextBenchmarkLabels have them.
+///  - Changing: every label changes its text every frame, which fits its slot.
+///  - From scratch: all text laid out anew every frame, as the game did
+///    before the labels, with a fresh sf::Text each.
+///
+/// Usage: roadrage_textbench [labels] [frames]
+///
+/// \return Application exit code, failing if moving labels or changing their
+///         text within their slots rebuilt the whole vertex buffer
+///
+////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+try {
+    const std::size_t nLabels = argc > 1 ? std::min(std::max(1, std::atoi(argv[1])), D_MAX_LABELS - 1) : D_MAX_LABELS - 1;
+    const unsigned nFrames = argc > 2 ? std::max(1, std::atoi(argv[2])) : 600;
+    const unsigned nHudLines = 20;
+    const float fWidth = 1280.0f, fHeight = 720.0f;
+
+    const FontMetrics::Ptr pFont = font();
+    std::mt19937 engine(1);
+    std::uniform_real_distribution<float> x(0.0f, fWidth), y(0.0f, fHeight);
+    std::uniform_int_distribution<std::size_t> pick(0, nLabels - 1);
+    std::cout << nLabels << " labels and a HUD of " << nHudLines << " lines, " << nFrames << " frames" << std::endl;
+
+    bool bOk = true;
+    const char* sScenarios[] = { "Moving", "Changing", "From scratch" };
+    for(unsigned scenario = 0 ; scenario < 3 ; ++scenario) {
+        std::unique_ptr<TextLayout> pText(new TextLayout(pFont));
+        std::vector<TextLayout::Label> labels;
+        const TextLayout::Label hudLabel = pText->add(hud(0, nHudLines));
+        for(std::size_t i = 0 ; i < nLabels ; ++i) {
+            labels.push_back(pText->add("Label " + to_s(i), x(engine), y(engine), Vector(1.0f, 1.0f, 0.0f)));
+        }
+        upload(*pText);
+        const std::size_t nRebuilds = pText->rebuildCount();
+
+        FrameStats stats;
+        std::size_t nScratchRebuilds = 0;
+        for(unsigned frame = 1 ; frame <= nFrames ; ++frame) {
+            sf::Clock timer;
+            if(scenario == 0) {
+                for(auto i = labels.begin() ; i != labels.end() ; ++i) {
+                    pText->pos(*i, x(engine), y(engine));
+                }
+                const std::size_t i = pick(engine);
+                pText->text(labels[i], (frame % 2 ? "LABEL " : "Label ") + to_s(i));
+            } else if(scenario == 1) {
+                for(std::size_t i = 0 ; i < labels.size() ; ++i) {
+                    pText->text(labels[i], "Label " + to_s((i + frame) % nLabels));
+                }
+            } else {
+                nScratchRebuilds += pText->rebuildCount();
+                pText.reset(new TextLayout(pFont));
+                for(std::size_t i = 0 ; i < nLabels ; ++i) {
+                    pText->add("Label " + to_s(i), x(engine), y(engine), Vector(1.0f, 1.0f, 0.0f));
+                }
+            }
+            pText->text(scenario == 2 ? pText->add() : hudLabel, hud(frame, nHudLines));
+            stats.nBytes += upload(*pText);
+            stats.fTime += timer.GetElapsedTime();
+        }
+
+        std::cout << "  " << sScenarios[scenario] << ": " << stats.fTime / nFrames * 1e6f << "us and "
+                  << static_cast<float>(stats.nBytes) / nFrames / 1024.0f << "kB to upload per frame, "
+                  << pText->glyphCount() << " glyphs, " << nScratchRebuilds + pText->rebuildCount() << " rebuilds, "
+                  << pText->patchCount() << " patches" << std::endl;
+        if(scenario < 2 && pText->rebuildCount() != nRebuilds) {
+            std::cerr << sScenarios[scenario] << " labels rebuilt the vertex buffer!" << std::endl;
+            bOk = false;
+        }
+    }
+
+    return bOk ? EXIT_SUCCESS : EXIT_FAILURE;
+} catch(const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
+}
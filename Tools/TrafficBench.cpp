@@ -0,0 +1,139 @@
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "Conf/Configuration.h"
+#include "Conf/RoadRageDefaultSettings.h"
+
+#include "Game/World.h"
+
+#include "Tools/BenchLevel.h"
+
+#include "Utilities/FileSystem.h"
+#include "Utilities/String.h"
+#include "Utilities/ThreadPool.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace RoadRage;
+
+/// How long the traffic's decisions may take per frame, on average, in seconds.
+#define D_TRAFFICBENCH_MAX_DECISION_TIME 0.002f
+
+/// How many frames to let the traffic settle before measuring it.
+#define D_TRAFFICBENCH_WARMUP_FRAMES 30
+
+/// What the frames took and did.
+struct FrameStats {
+    FrameStats() : nFrames(0), fWorld(0.0f), fTraffic(0.0f), fDecisions(0.0f), fWorstDecisions(0.0f), nActive(0), nDecisions(0) {}
+
+    unsigned nFrames;
+    float fWorld, fTraffic, fDecisions, fWorstDecisions;
+    uint64_t nActive, nDecisions;
+};
+
+////////////////////////////////////////////////////////////
+/// Lets the ambient traffic of a city drive for that many frames at 30 fps,
+/// the way the game does it, with that many players driving around in it.
+/// Then tells what the world's, the traffic's and the cars' decisions'
+/// frames took, how many cars were active and decided per frame, how many
+/// routes had to be searched and how fast the cars went. Fails if the
+/// decisions take more than D_TRAFFICBENCH_MAX_DECISION_TIME per frame on
+/// average, or if the cars don't drive.
+///
+/// By default, that's the game's 2000 cars in its city, with one player, on
+/// a single core. The city's roads get preprocessed on the first run.
+///
+/// Usage: roadrage_trafficbench [traffic cars] [road network radius] [players] [frames] [vehicle physics]
+///
+/// \return Application exit code
+///
+////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+try {
+    Configuration settings((RoadRageDefaultSettings()));
+    if(argc > 1)
+        settings.set("TrafficCars", argv[1]);
+    if(argc > 2)
+        settings.set("RoadNetworkRadius", argv[2]);
+    const unsigned nPlayers = argc > 3 ? static_cast<unsigned>(std::max(0, std::atoi(argv[3]))) : 1;
+    const unsigned nFrames = argc > 4 ? static_cast<unsigned>(std::max(1, std::atoi(argv[4]))) : 300;
+    if(argc > 5)
+        settings.set("VehiclePhysics", argv[5]);
+
+    FileSystem fs(prepareLevel(settings, "TrafficBench"));
+    ThreadPool workers(1);
+    World world(settings, fs, "TrafficBench", workers);
+
+    // The players drive in circles around the middle of the city, some of
+    // them left, some right and some straight on.
+    for(unsigned i = 1 ; i <= nPlayers ; ++i) {
+        Avatar& player = world.addPlayer(i);
+        player.place(Vector(4.0f * (i % 16), 0.0f, 4.0f * (i / 16)), 0.0f, 0.0f);
+        player.control(CarInput(static_cast<int8_t>(i % 3) - 1, 1));
+    }
+
+    GameClock clock;
+    FrameStats stats;
+    for(unsigned frame = 0 ; frame < D_TRAFFICBENCH_WARMUP_FRAMES + nFrames ; ++frame) {
+        clock.tick(1.0f / 30.0f);
+        sf::Clock timer;
+        world.think(clock);
+        const float fWorld = timer.GetElapsedTime();
+        if(frame < D_TRAFFICBENCH_WARMUP_FRAMES)
+            continue;
+
+        const Traffic& traffic = world.traffic();
+        ++stats.nFrames;
+        stats.fWorld += fWorld;
+        stats.fTraffic += traffic.time();
+        stats.fDecisions += traffic.decisionTime();
+        stats.fWorstDecisions = std::max(stats.fWorstDecisions, traffic.decisionTime());
+        stats.nActive += traffic.active();
+        stats.nDecisions += traffic.decisions();
+    }
+
+    const std::vector<TrafficCar>& cars = world.traffic().cars();
+    float fSpeed = 0.0f;
+    std::size_t nStanding = 0;
+    for(auto i = cars.begin() ; i != cars.end() ; ++i) {
+        fSpeed += i->speed();
+        if(i->state() == CarState::Standing)
+            ++nStanding;
+    }
+    fSpeed /= std::max<std::size_t>(cars.size(), 1);
+
+    std::cout << cars.size() << " traffic cars on " << world.roads().laneCount() << " lanes, " << nPlayers
+              << " player(s), " << stats.nFrames << " frames" << std::endl;
+    std::cout << "Frame: " << stats.fWorld / stats.nFrames * 1000.0f << "ms for the world, "
+              << stats.fTraffic / stats.nFrames * 1000.0f << "ms for the traffic, of which "
+              << stats.fDecisions / stats.nFrames * 1000.0f << "ms deciding, "
+              << stats.fWorstDecisions * 1000.0f << "ms worst" << std::endl;
+    std::cout << "Cars: " << static_cast<float>(stats.nActive) / stats.nFrames << " active and "
+              << static_cast<float>(stats.nDecisions) / stats.nFrames << " deciding per frame, "
+              << world.routes().misses() << " routes searched, " << fSpeed << "m/s on average, "
+              << nStanding << " standing" << std::endl;
+
+    bool bOk = true;
+    if(stats.fDecisions / stats.nFrames > D_TRAFFICBENCH_MAX_DECISION_TIME) {
+        std::cerr << "The traffic's decisions take over " << D_TRAFFICBENCH_MAX_DECISION_TIME * 1000.0f
+                  << "ms per frame" << std::endl;
+        bOk = false;
+    }
+    if(!cars.empty() && fSpeed < 1.0f) {
+        std::cerr << "The traffic doesn't drive" << std::endl;
+        bOk = false;
+    }
+
+    return bOk ? EXIT_SUCCESS : EXIT_FAILURE;
+} catch(const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
+}
@@ -0,0 +1,253 @@
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include "Game/Car.h"
+#include "Game/CarBatch.h"
+#include "Game/Entities.h"
+#include "Game/VehicleModel.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace RoadRage;
+
+/// Puts both \a io_a and \a io_b into the same random state, with random limits.
+void randomize(Car& io_a, Car& io_b, std::mt19937& io_engine)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const float fMaxSteering = (unit(io_engine) < 0.5f ? 45.0f : 360.0f) * deg2rad;
+    const float fMaxSpeed = (20.0f + 130.0f * unit(io_engine)) * kmh2ms;
+    const float fSteering = (unit(io_engine) * 2.0f - 1.0f) * fMaxSteering;
+    const float fSpeed = unit(io_engine) * fMaxSpeed;
+    const float fOri = (unit(io_engine) * 2.0f - 1.0f) * pi;
+    const Vector pos((unit(io_engine) - 0.5f) * 1000.0f, 0.75f, (unit(io_engine) - 0.5f) * 1000.0f);
+
+    Car* cars[] = {&io_a, &io_b};
+    for(unsigned i = 0 ; i < 2 ; ++i) {
+        cars[i]->maxSteeringAngle(fMaxSteering).maxSpeed(fMaxSpeed);
+        cars[i]->steeringVel(0.0f).steeringAngle(fSteering).speed(fSpeed);
+        cars[i]->ori(fOri);
+        cars[i]->pos(pos);
+    }
+}
+
+/// Gives both \a io_a and \a io_b the same random orders, like a driver would.
+void order(Car& io_a, Car& io_b, std::mt19937& io_engine)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const CarState::Enum states[] = {CarState::Driving, CarState::Driving, CarState::Breaking, CarState::Rolling, CarState::Standing};
+    const CarState::Enum state = states[std::uniform_int_distribution<unsigned>(0, 4)(io_engine)];
+    // Going straight every now and then, to get snapped to it.
+    const float fSteeringVel = unit(io_engine) < 0.25f ? 0.0f : (unit(io_engine) * 2.0f - 1.0f) * 90.0f * deg2rad;
+
+    io_a.state(state);
+    io_b.state(state);
+    io_a.steeringVel(fSteeringVel);
+    io_b.steeringVel(fSteeringVel);
+}
+
+/// Drives \a io_car for \a in_fTime seconds at \a in_fFps, keeping the same controls.
+void drive(VehicleModel& io_car, float in_fTime, float in_fFps)
+{
+    for(unsigned i = 0 ; i < static_cast<unsigned>(in_fTime * in_fFps + 0.5f) ; ++i) {
+        io_car.advance(1.0f / in_fFps);
+    }
+}
+
+/// Checks \a in_fValue to be within [\a in_fMin, \a in_fMax], telling so.
+bool check(const char* in_sWhat, float in_fValue, float in_fMin, float in_fMax)
+{
+    const bool bOk = in_fValue >= in_fMin && in_fValue <= in_fMax;
+    std::cout << "  " << in_sWhat << ": " << in_fValue << " (" << in_fMin << " to " << in_fMax << ")"
+              << (bOk ? "" : " FAILED") << std::endl;
+    return bOk;
+}
+
+/// Runs the vehicle physics through the usual tests of real cars, at
+/// \a in_fRate substeps a second, and benchmarks them.
+/// \return false if the car doesn't behave like one.
+bool validate(float in_fRate)
+{
+    const VehicleParams params;
+    const float g = 9.81f;
+    const float fWheelbase = params.cgToFront + params.cgToRear;
+    bool bOk = true;
+    std::cout << "Vehicle physics at " << in_fRate << " substeps/s" << std::endl;
+
+    // Flooring it from standing.
+    VehicleModel car(params, in_fRate);
+    car.place(0.0f, 0.0f, 0.0f);
+    car.controls(1.0f, 0.0f, 0.0f);
+    float t = 0.0f;
+    for( ; car.forwardSpeed() < 100.0f*kmh2ms && t < 30.0f ; t += 1.0f / 60.0f) {
+        car.advance(1.0f / 60.0f);
+    }
+    bOk &= check("0-100km/h in s", t, 4.0f, 12.0f);
+    bOk &= check("and went sideways by m", std::abs(car.x()), 0.0f, 0.001f);
+
+    // Full braking from 100km/h can't be much better than the grip allows,
+    // only the air and rolling resistance help a bit, and shouldn't be much
+    // worse, as the wheels don't lock.
+    const float v = 100.0f*kmh2ms;
+    car.place(0.0f, 0.0f, 0.0f, v);
+    car.controls(0.0f, 1.0f, 0.0f);
+    drive(car, 10.0f, 60.0f);
+    bOk &= check("braking distance from 100km/h in m", -car.z(), 0.9f * v*v / (2.0f * params.grip * g), 1.3f * v*v / (2.0f * params.grip * g));
+
+    // Standing, turning the wheel doesn't move the car, braking or not.
+    for(unsigned bBrake = 0 ; bBrake < 2 ; ++bBrake) {
+        car.place(0.0f, 0.0f, 0.0f);
+        car.controls(0.0f, static_cast<float>(bBrake), params.maxSteering);
+        drive(car, 5.0f, 60.0f);
+        bOk &= check(bBrake ? "5s standing braked and steering, turned by rad" : "5s standing and steering, turned by rad",
+                     std::abs(car.heading()), 0.0f, 0.001f);
+        bOk &= check("and moved by m", std::sqrt(car.x()*car.x() + car.z()*car.z()), 0.0f, 0.001f);
+    }
+
+    // The skidpad: a fixed steering angle, going faster and faster. Slowly,
+    // the car follows the circle the geometry of the steering gives; the
+    // faster, the more it understeers, until the tires are at their limit.
+    const float fSteering = std::atan(fWheelbase / 40.0f);
+    car.place(0.0f, 0.0f, 0.0f, 3.0f);
+    float fTarget = 3.0f, fRadius = 0.0f, fLateral = 0.0f;
+    for(unsigned i = 0 ; i < 60*90 ; ++i) {
+        fTarget += 0.3f / 60.0f;
+        const float fError = fTarget - car.forwardSpeed();
+        car.controls(clamp(fError * 0.5f, 0.0f, 1.0f), 0.0f, fSteering);
+        car.advance(1.0f / 60.0f);
+        if(i == 60*5)
+            fRadius = car.forwardSpeed() / car.yawRate();
+        fLateral = std::max(fLateral, std::abs(car.lateralAccel()));
+    }
+    bOk &= check("skidpad radius at low speed in m", fRadius, 40.0f * 0.95f, 40.0f * 1.05f);
+    bOk &= check("skidpad lateral acceleration in g", fLateral / g, 0.8f * params.grip, 1.0f * params.grip);
+
+    // The same drive at different frame rates ends up in the same place.
+    VehicleModel slow(params, in_fRate), fast(params, in_fRate);
+    slow.controls(1.0f, 0.0f, 0.1f);
+    fast.controls(1.0f, 0.0f, 0.1f);
+    drive(slow, 5.0f, 30.0f);
+    drive(fast, 5.0f, 144.0f);
+    bOk &= check("5s at 30 and 144fps apart by m", std::sqrt((slow.x() - fast.x())*(slow.x() - fast.x()) + (slow.z() - fast.z())*(slow.z() - fast.z())), 0.0f, 0.02f);
+
+    // And what a car costs.
+    sf::Clock timer;
+    const unsigned nCars = 100;
+    std::vector<VehicleModel> cars(nCars, VehicleModel(params, in_fRate));
+    for(unsigned i = 0 ; i < nCars ; ++i) {
+        cars[i].controls(1.0f, 0.0f, 0.01f * i);
+        drive(cars[i], 10.0f, 60.0f);
+    }
+    std::cout << "  " << timer.GetElapsedTime() / (nCars * 600) * 1e6f << "us per car and 60Hz frame" << std::endl;
+
+    return bOk;
+}
+
+////////////////////////////////////////////////////////////
+/// Checks the batch vehicle integrator against Car::think, and benchmarks
+/// both: two identical sets of cars, one stepped the one way, the other the
+/// other, at 60Hz, getting the same random orders twice a second. Then
+/// validates and benchmarks the vehicle physics.
+///
+/// Usage: roadrage_vehiclebench [cars] [steps] [substeps/s]
+///
+/// \return Application exit code, failing if the two drift apart, or the
+///         physics fail their validation
+///
+////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+try {
+    const std::size_t nCars = argc > 1 ? std::max(1, std::atoi(argv[1])) : 10000;
+    const unsigned nSteps = argc > 2 ? std::max(1, std::atoi(argv[2])) : 600;
+    const float fRate = argc > 3 ? static_cast<float>(std::atof(argv[3])) : 1000.0f;
+    const float fDeltaT = 1.0f / 60.0f;
+    // In m and rad, after ten seconds of driving in single precision.
+    const float fTolerance = 0.01f;
+
+    Entities entities;
+    std::vector<Car> scalar, batched;
+    std::mt19937 engine(1);
+    for(std::size_t i = 0 ; i < nCars ; ++i) {
+        scalar.push_back(Car(entities, Car::create(entities, Transform())));
+        batched.push_back(Car(entities, Car::create(entities, Transform())));
+        randomize(scalar[i], batched[i], engine);
+    }
+
+    CarBatch batch;
+    batch.resize(nCars);
+    GameClock clock;
+    float tScalar = 0.0f, tBatch = 0.0f, tStep = 0.0f;
+    float fPos = 0.0f, fAngle = 0.0f, fSpeed = 0.0f;
+    std::size_t nStates = 0;
+    sf::Clock timer;
+    for(unsigned step = 0 ; step < nSteps ; ++step) {
+        if(step % 30 == 0) {
+            for(std::size_t i = 0 ; i < nCars ; ++i) {
+                order(scalar[i], batched[i], engine);
+            }
+        }
+
+        clock.tick(fDeltaT);
+        timer.Reset();
+        for(std::size_t i = 0 ; i < nCars ; ++i) {
+            scalar[i].think(clock);
+        }
+        tScalar += timer.GetElapsedTime();
+
+        timer.Reset();
+        for(std::size_t i = 0 ; i < nCars ; ++i) {
+            batch.load(i, batched[i].transform(), batched[i].driving());
+        }
+        const float t0 = timer.GetElapsedTime();
+        batch.step(0, nCars, clock.deltaT());
+        tStep += timer.GetElapsedTime() - t0;
+        for(std::size_t i = 0 ; i < nCars ; ++i) {
+            batch.store(i, batched[i].transform(), batched[i].driving());
+        }
+        tBatch += timer.GetElapsedTime();
+
+        for(std::size_t i = 0 ; i < nCars ; ++i) {
+            const Car& a = scalar[i];
+            const Car& b = batched[i];
+            fPos = std::max(fPos, (a.pos() - b.pos()).len());
+            // Both wrap at a full turn, but may do so a step apart.
+            fAngle = std::max(fAngle, std::abs(std::remainder(a.steeringAngle() - b.steeringAngle(), 2.0f*pi)));
+            fAngle = std::max(fAngle, std::abs(std::remainder(a.ori() - b.ori(), 2.0f*pi)));
+            fSpeed = std::max(fSpeed, std::abs(a.speed() - b.speed()));
+            fSpeed = std::max(fSpeed, std::abs(a.accel() - b.accel()));
+            if(a.state() != b.state())
+                ++nStates;
+        }
+    }
+
+    std::cout << nCars << " cars, " << nSteps << " steps" << std::endl;
+    std::cout << "  Car::think " << tScalar / nSteps * 1000.0f << "ms per step, batch "
+              << tBatch / nSteps * 1000.0f << "ms (" << tStep / nSteps * 1000.0f << "ms without loading and storing), "
+              << nCars * nSteps / tStep / 1e6f << "M cars/s" << std::endl;
+    std::cout << "  largest difference: position " << fPos << "m, angles " << fAngle << "rad, speed and acceleration "
+              << fSpeed << ", " << nStates << " different states" << std::endl;
+
+    if(fPos > fTolerance || fAngle > fTolerance || fSpeed > fTolerance || nStates > 0) {
+        std::cerr << "The batch integrator doesn't drive like Car::think!" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if(!validate(fRate)) {
+        std::cerr << "The vehicle physics don't drive like a car!" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+} catch(const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
+}
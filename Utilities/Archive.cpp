@@ -0,0 +1,242 @@
+#include "Archive.h"
+
+#include "Utilities/i18n.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(_MSC_VER)
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+using namespace RoadRage;
+
+#define D_ARCHIVE_MAGIC "RRPK"
+#define D_ARCHIVE_VERSION 1
+
+// Entries are aligned so that whatever is stored in them can be used in-place.
+#define D_ARCHIVE_ALIGN 16
+
+Archive::Archive()
+    : m_base(0)
+    , m_size(0)
+#if defined(_MSC_VER)
+    , m_hFile(INVALID_HANDLE_VALUE)
+    , m_hMapping(0)
+#endif
+    , m_entries(0)
+    , m_names(0)
+    , m_nEntries(0)
+{
+}
+
+Archive::~Archive()
+{
+    this->close();
+}
+
+void Archive::close()
+{
+#if defined(_MSC_VER)
+    if(m_base)
+        UnmapViewOfFile(m_base);
+    if(m_hMapping)
+        CloseHandle(m_hMapping);
+    if(m_hFile != INVALID_HANDLE_VALUE)
+        CloseHandle(m_hFile);
+    m_hMapping = 0;
+    m_hFile = INVALID_HANDLE_VALUE;
+#else
+    if(m_base)
+        munmap(const_cast<char*>(m_base), m_size);
+#endif
+
+    m_base = 0;
+    m_size = 0;
+    m_entries = 0;
+    m_names = 0;
+    m_nEntries = 0;
+}
+
+bool Archive::open(const std::string& in_sFile)
+{
+    this->close();
+
+#if defined(_MSC_VER)
+    m_hFile = CreateFileA(in_sFile.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(m_hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(m_hFile, &size) || size.QuadPart < static_cast<LONGLONG>(sizeof(ArchiveHeader))) {
+        this->close();
+        return false;
+    }
+
+    m_hMapping = CreateFileMappingA(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(m_hMapping)
+        m_base = static_cast<const char*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+    if(!m_base) {
+        this->close();
+        return false;
+    }
+    m_size = static_cast<std::size_t>(size.QuadPart);
+#else
+    int fd = ::open(in_sFile.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(ArchiveHeader))) {
+        ::close(fd);
+        return false;
+    }
+
+    // The mapping keeps the file alive on its own, we don't need the fd anymore.
+    void* p = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(p == MAP_FAILED)
+        return false;
+
+    m_base = static_cast<const char*>(p);
+    m_size = st.st_size;
+#endif
+
+    ArchiveHeader h;
+    std::memcpy(&h, m_base, sizeof(h));
+    if(std::memcmp(h.magic, D_ARCHIVE_MAGIC, 4) != 0 || h.version != D_ARCHIVE_VERSION) {
+        this->close();
+        return false;
+    }
+
+    // Don't trust anything in there, a truncated file shouldn't crash us.
+    uint64_t entriesSize = static_cast<uint64_t>(h.nEntries) * sizeof(ArchiveEntry);
+    if(h.tocOffset > m_size || h.tocSize > m_size - h.tocOffset || entriesSize > h.tocSize || h.tocOffset % D_ARCHIVE_ALIGN != 0) {
+        this->close();
+        return false;
+    }
+
+    const ArchiveEntry* entries = reinterpret_cast<const ArchiveEntry*>(m_base + h.tocOffset);
+    uint64_t namesSize = h.tocSize - entriesSize;
+    for(uint32_t i = 0 ; i < h.nEntries ; ++i) {
+        const ArchiveEntry& e = entries[i];
+        if(e.offset > m_size || e.size > m_size - e.offset || static_cast<uint64_t>(e.nameOffset) + e.nameLength > namesSize) {
+            this->close();
+            return false;
+        }
+    }
+
+    m_entries = entries;
+    m_names = reinterpret_cast<const char*>(m_entries + h.nEntries);
+    m_nEntries = h.nEntries;
+    return true;
+}
+
+const ArchiveEntry* Archive::find(const std::string& in_sName) const
+{
+    // The table of contents is sorted by name.
+    std::size_t lo = 0, hi = m_nEntries;
+    while(lo < hi) {
+        std::size_t mid = (lo + hi) / 2;
+        const ArchiveEntry& e = m_entries[mid];
+        int cmp = in_sName.compare(0, std::string::npos, m_names + e.nameOffset, e.nameLength);
+        if(cmp == 0)
+            return &e;
+        if(cmp < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    return 0;
+}
+
+std::string Archive::name(const ArchiveEntry& in_entry) const
+{
+    return std::string(m_names + in_entry.nameOffset, in_entry.nameLength);
+}
+
+const char* Archive::data(const ArchiveEntry& in_entry) const
+{
+    return m_base + in_entry.offset;
+}
+
+void ArchiveWriter::add(const std::string& in_sName, const void* in_data, std::size_t in_size, uint64_t in_sourceHash)
+{
+    Item item;
+    item.name = in_sName;
+    item.data.assign(static_cast<const char*>(in_data), static_cast<const char*>(in_data) + in_size);
+    item.sourceHash = in_sourceHash;
+    m_items.push_back(item);
+}
+
+bool ArchiveWriter::has(const std::string& in_sName) const
+{
+    for(auto i = m_items.begin() ; i != m_items.end() ; ++i) {
+        if(i->name == in_sName)
+            return true;
+    }
+
+    return false;
+}
+
+void ArchiveWriter::write(const std::string& in_sFile) const
+{
+    std::vector<Item> items(m_items);
+    std::sort(items.begin(), items.end());
+
+    std::vector<ArchiveEntry> entries(items.size());
+    std::string names;
+    std::vector<char> out(sizeof(ArchiveHeader), 0);
+
+    for(std::size_t i = 0 ; i < items.size() ; ++i) {
+        out.resize((out.size() + D_ARCHIVE_ALIGN - 1) / D_ARCHIVE_ALIGN * D_ARCHIVE_ALIGN, 0);
+
+        entries[i].offset = out.size();
+        entries[i].size = items[i].data.size();
+        entries[i].sourceHash = items[i].sourceHash;
+        entries[i].nameOffset = static_cast<uint32_t>(names.size());
+        entries[i].nameLength = static_cast<uint32_t>(items[i].name.size());
+        names += items[i].name;
+
+        out.insert(out.end(), items[i].data.begin(), items[i].data.end());
+    }
+
+    out.resize((out.size() + D_ARCHIVE_ALIGN - 1) / D_ARCHIVE_ALIGN * D_ARCHIVE_ALIGN, 0);
+
+    ArchiveHeader h;
+    std::memcpy(h.magic, D_ARCHIVE_MAGIC, 4);
+    h.version = D_ARCHIVE_VERSION;
+    h.nEntries = static_cast<uint32_t>(entries.size());
+    h.reserved = 0;
+    h.tocOffset = out.size();
+    h.tocSize = entries.size()*sizeof(ArchiveEntry) + names.size();
+    std::memcpy(&out[0], &h, sizeof(h));
+
+    if(!entries.empty())
+        out.insert(out.end(), reinterpret_cast<const char*>(&entries[0]), reinterpret_cast<const char*>(&entries[0] + entries.size()));
+    out.insert(out.end(), names.begin(), names.end());
+
+    std::string sTmp = in_sFile + ".tmp";
+    {
+        std::ofstream f(sTmp.c_str(), std::ios::binary | std::ios::trunc);
+        f.write(&out[0], out.size());
+        if(!f)
+            throw std::runtime_error(_("Failed to write the archive ") + sTmp);
+    }
+
+#if defined(_MSC_VER)
+    // Windows' rename doesn't replace existing files.
+    std::remove(in_sFile.c_str());
+#endif
+    if(std::rename(sTmp.c_str(), in_sFile.c_str()) != 0)
+        throw std::runtime_error(_("Failed to write the archive ") + in_sFile);
+}
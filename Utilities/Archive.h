@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace RoadRage {
+
+/// The layout of an asset archive (.rrpak) as written by roadrage_cook:
+///
+///   ArchiveHeader
+///   the data of every entry, each one aligned to D_ARCHIVE_ALIGN bytes
+///   the table of contents: nEntries ArchiveEntry, sorted by name,
+///                          followed by all the names one after the other.
+///
+/// Everything is little-endian, as we only run on such machines anyway.
+struct ArchiveHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t nEntries;
+    uint32_t reserved;
+    uint64_t tocOffset;
+    uint64_t tocSize;
+};
+
+struct ArchiveEntry {
+    uint64_t offset;     ///< Where the data starts, from the start of the file.
+    uint64_t size;       ///< The size of the data, in bytes.
+    uint64_t sourceHash; ///< The hash of the source this entry was cooked from.
+    uint32_t nameOffset; ///< Where the name starts, from the end of the entries.
+    uint32_t nameLength;
+};
+
+/// Gives read access to an asset archive. The archive is mapped into memory
+/// when opening it, all data accesses afterwards are just pointer lookups and
+/// the OS only reads the pages we actually touch.
+class Archive {
+public:
+    Archive();
+    virtual ~Archive();
+
+    /// Closes the currently open archive, if any, and opens \a in_sFile.
+    /// \return false if the file doesn't exist or isn't a valid archive.
+    bool open(const std::string& in_sFile);
+    bool isOpen() const { return m_base != 0; }
+    void close();
+
+    /// \return The entry with the name \a in_sName or 0 if there is none.
+    /// It stays valid for as long as the archive is open, just like the data.
+    const ArchiveEntry* find(const std::string& in_sName) const;
+    std::string name(const ArchiveEntry& in_entry) const;
+    const char* data(const ArchiveEntry& in_entry) const;
+
+    std::size_t entryCount() const { return m_nEntries; }
+    const ArchiveEntry& entry(std::size_t in_i) const { return m_entries[in_i]; }
+
+private:
+    // No copying!
+    Archive(const Archive&);
+    Archive& operator=(const Archive&);
+
+    const char* m_base; ///< Where the whole archive is mapped.
+    std::size_t m_size;
+#if defined(_MSC_VER)
+    void* m_hFile;
+    void* m_hMapping;
+#endif
+    const ArchiveEntry* m_entries;
+    const char* m_names;
+    std::size_t m_nEntries;
+};
+
+/// Collects entries in memory and writes them out as an archive.
+class ArchiveWriter {
+public:
+    /// Adds an entry to the archive. The data is copied.
+    void add(const std::string& in_sName, const void* in_data, std::size_t in_size, uint64_t in_sourceHash);
+    bool has(const std::string& in_sName) const;
+
+    /// Writes the archive. It is first written to a temporary file which then
+    /// replaces \a in_sFile, so a failed cook never leaves a broken archive.
+    /// \throws std::runtime_error if the file can't be written.
+    void write(const std::string& in_sFile) const;
+
+private:
+    struct Item {
+        std::string name;
+        std::vector<char> data;
+        uint64_t sourceHash;
+
+        bool operator<(const Item& o) const { return name < o.name; }
+    };
+
+    std::vector<Item> m_items;
+};
+
+}
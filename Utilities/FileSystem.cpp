@@ -0,0 +1,111 @@
+#include "FileSystem.h"
+
+#include "Utilities/i18n.h"
+
+#include <fstream>
+#include <iostream>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+using namespace RoadRage;
+
+FileView::FileView()
+    : m_data(0)
+    , m_size(0)
+{
+}
+
+FileView::FileView(const char* in_data, std::size_t in_size)
+    : m_data(in_data)
+    , m_size(in_size)
+{
+}
+
+FileSystem::FileSystem(const std::string& in_sRoot)
+    : m_sRoot(in_sRoot)
+    , m_archiveTime(0)
+{
+}
+
+FileSystem::~FileSystem()
+{
+}
+
+bool FileSystem::mount(const std::string& in_sArchive)
+{
+    if(!m_archive.open(in_sArchive))
+        return false;
+
+    struct stat st;
+    m_archiveTime = stat(in_sArchive.c_str(), &st) == 0 ? st.st_mtime : 0;
+
+    std::cerr << _("Mounted ") << in_sArchive << _(" containing ") << m_archive.entryCount() << _(" files") << std::endl;
+    return true;
+}
+
+FileView FileSystem::read(const std::string& in_sPath) const
+{
+    FileView view;
+
+    if(const ArchiveEntry* e = m_archive.find(in_sPath)) {
+        if(this->newerThanArchive(in_sPath)) {
+            FileView loose = this->readLoose(in_sPath);
+            if(loose.valid())
+                return loose;
+        }
+
+        view.m_data = m_archive.data(*e);
+        view.m_size = static_cast<std::size_t>(e->size);
+        return view;
+    }
+
+    return this->readLoose(in_sPath);
+}
+
+FileView FileSystem::readLoose(const std::string& in_sPath) const
+{
+    FileView view;
+
+    std::ifstream f(this->loosePath(in_sPath).c_str(), std::ios::binary);
+    if(!f)
+        return view;
+
+    // Read the whole file in one go, straight into its final place.
+    f.seekg(0, std::ios::end);
+    std::streamoff size = f.tellg();
+    f.seekg(0, std::ios::beg);
+    if(size < 0)
+        return view;
+
+    view.m_owned.reset(new std::vector<char>(static_cast<std::size_t>(size) + 1, '\0'));
+    if(size > 0 && !f.read(&(*view.m_owned)[0], size))
+        return FileView();
+
+    // The extra null character makes it safe to use the content as C string.
+    view.m_data = &(*view.m_owned)[0];
+    view.m_size = static_cast<std::size_t>(size);
+    return view;
+}
+
+bool FileSystem::newerThanArchive(const std::string& in_sPath) const
+{
+    // Without the data directory, as once shipped, this is a failing stat.
+    struct stat st;
+    if(stat(this->loosePath(in_sPath).c_str(), &st) != 0 || st.st_mtime <= m_archiveTime)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_overriddenMutex);
+    if(m_overridden.insert(in_sPath).second)
+        std::cerr << _("Reading ") << this->loosePath(in_sPath) << _(" rather than the archive's, which is older") << std::endl;
+    return true;
+}
+
+bool FileSystem::exists(const std::string& in_sPath) const
+{
+    if(m_archive.find(in_sPath))
+        return true;
+
+    std::ifstream f(this->loosePath(in_sPath).c_str(), std::ios::binary);
+    return f.good();
+}
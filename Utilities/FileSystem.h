@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Archive.h"
+
+#include <cstddef>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace RoadRage {
+
+/// A read-only view of the whole content of a file. If the file comes from the
+/// archive, this points right into the mapped archive and nothing got copied.
+/// Loose files are read into memory which the view (and its copies) own.
+class FileView {
+public:
+    FileView();
+    /// A view of some memory that outlives the view, like a string literal.
+    FileView(const char* in_data, std::size_t in_size);
+
+    /// \return false if the file couldn't be found.
+    bool valid() const { return m_data != 0; }
+    const char* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+    /// Copies the content into a string, for those who really need one.
+    std::string str() const { return std::string(m_data ? m_data : "", m_size); }
+
+private:
+    friend class FileSystem;
+
+    const char* m_data;
+    std::size_t m_size;
+    std::shared_ptr<std::vector<char>> m_owned;
+};
+
+/// This is where all the game's data comes from. It serves the files from the
+/// cooked archive, if there is one, and falls back to the loose files in the
+/// data directory for anything that isn't in there, which is what happens
+/// during development. A loose file that changed after the archive was cooked
+/// wins over the archive's, so a stale archive doesn't hide edited assets.
+/// Reading is thread-safe.
+class FileSystem {
+public:
+    /// \param in_sRoot The directory the loose files live in.
+    FileSystem(const std::string& in_sRoot = "Data");
+    virtual ~FileSystem();
+
+    /// Makes the content of the archive \a in_sArchive available.
+    /// \return false if there is no (valid) archive at that place.
+    bool mount(const std::string& in_sArchive);
+
+    /// \param in_sPath The path of the file, relative to the data directory
+    ///                 and with '/' as separator, like "Shaders/Civilian.vert".
+    /// \return The content of the file, which is invalid if it doesn't exist.
+    FileView read(const std::string& in_sPath) const;
+    /// Like read, but always reads the loose file, even if the archive has it.
+    /// This is what's needed when the loose file just changed.
+    FileView readLoose(const std::string& in_sPath) const;
+    bool exists(const std::string& in_sPath) const;
+
+    /// \return Where the loose file \a in_sPath is, or would be, on disk.
+    std::string loosePath(const std::string& in_sPath) const { return m_sRoot + "/" + in_sPath; }
+
+private:
+    // No copying!
+    FileSystem(const FileSystem&);
+    FileSystem& operator=(const FileSystem&);
+
+    /// \return Whether the loose file \a in_sPath changed after the archive
+    ///         was made.
+    bool newerThanArchive(const std::string& in_sPath) const;
+
+    std::string m_sRoot;
+    Archive m_archive;
+    std::time_t m_archiveTime;
+
+    /// The loose files read instead of the archive's so far, to only tell once.
+    mutable std::set<std::string> m_overridden;
+    mutable std::mutex m_overriddenMutex;
+};
+
+}
@@ -0,0 +1,65 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+
+#if defined(__linux__)
+#  include <sys/inotify.h>
+#  include <unistd.h>
+#endif
+
+using namespace RoadRage;
+
+FileWatcher::FileWatcher(const std::string& in_sDir)
+    : m_fd(-1)
+{
+#if defined(__linux__)
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(m_fd < 0)
+        return;
+
+    // Editors either write the file in-place or write a new one and move it
+    // over the old one, we want to catch both.
+    if(inotify_add_watch(m_fd, in_sDir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#if defined(__linux__)
+    if(m_fd >= 0)
+        close(m_fd);
+#endif
+}
+
+std::vector<std::string> FileWatcher::changes()
+{
+    std::vector<std::string> names;
+
+#if defined(__linux__)
+    if(m_fd < 0)
+        return names;
+
+    // Aligned as inotify_event, as the kernel writes those in there.
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    while(true) {
+        ssize_t len = read(m_fd, buf, sizeof(buf));
+        if(len <= 0)
+            break;
+
+        for(char* p = buf ; p < buf + len ; ) {
+            const inotify_event* ev = reinterpret_cast<const inotify_event*>(p);
+            if(ev->len > 0) {
+                std::string sName = ev->name;
+                if(std::find(names.begin(), names.end(), sName) == names.end())
+                    names.push_back(sName);
+            }
+            p += sizeof(inotify_event) + ev->len;
+        }
+    }
+#endif
+
+    return names;
+}
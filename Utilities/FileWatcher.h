@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace RoadRage {
+
+/// Tells which files in a directory got written to. This is only implemented
+/// with inotify for now, on other systems it just never sees any change.
+class FileWatcher {
+public:
+    /// \param in_sDir The directory to watch, not including subdirectories.
+    FileWatcher(const std::string& in_sDir);
+    virtual ~FileWatcher();
+
+    /// \return false if the directory can't be watched.
+    bool valid() const { return m_fd >= 0; }
+
+    /// Never blocks.
+    /// \return The names of the files, relative to the watched directory, that
+    ///         were written to since the last call. Every name only once.
+    std::vector<std::string> changes();
+
+private:
+    // No copying!
+    FileWatcher(const FileWatcher&);
+    FileWatcher& operator=(const FileWatcher&);
+
+    int m_fd;
+};
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+
+namespace RoadRage {
+
+static const uint64_t fnv1aSeed = 14695981039346656037ULL;
+
+/// Computes the 64-bit FNV-1a hash of a block of memory. It is neither the
+/// fastest nor the strongest hash around, but it is simple, stable across
+/// platforms and good enough for identifying content.
+/// \param in_data The memory to hash.
+/// \param in_size The amount of bytes to hash.
+/// \param in_seed Pass the result of a previous call in order to hash
+///                several blocks as if they were one.
+inline uint64_t fnv1a(const void* in_data, std::size_t in_size, uint64_t in_seed = fnv1aSeed)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(in_data);
+    uint64_t h = in_seed;
+    for(std::size_t i = 0 ; i < in_size ; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+inline uint64_t fnv1a(const std::string& in_s, uint64_t in_seed = fnv1aSeed)
+{
+    return fnv1a(in_s.data(), in_s.size(), in_seed);
+}
+
+}
@@ -1,5 +1,15 @@
 #include "Path.h"
 
+#include <cstdlib>
+
+#if defined(_MSC_VER)
+#  include <windows.h>
+#  include <direct.h>
+#else
+#  include <dirent.h>
+#  include <sys/stat.h>
+#endif
+
 std::string getUserDir()
 {
     std::string path;
@@ -12,3 +22,79 @@ std::string getUserDir()
 #endif
     return path;
 }
+
+bool createDirectories(const std::string& in_sDir)
+{
+    for(std::size_t i = 1 ; i <= in_sDir.size() ; ++i) {
+        if(i < in_sDir.size() && in_sDir[i] != '/' && in_sDir[i] != '\\')
+            continue;
+
+        // Failing because it exists already is fine, everything else we
+        // notice when trying to create the next level, or below.
+        std::string sPart = in_sDir.substr(0, i);
+#if defined(_MSC_VER)
+        _mkdir(sPart.c_str());
+#else
+        mkdir(sPart.c_str(), 0755);
+#endif
+    }
+
+#if defined(_MSC_VER)
+    DWORD attribs = GetFileAttributesA(in_sDir.c_str());
+    return attribs != INVALID_FILE_ATTRIBUTES && (attribs & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    struct stat st;
+    return stat(in_sDir.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+static void listFilesRecursive(const std::string& in_sDir, const std::string& in_sPrefix, std::vector<std::string>& out_files)
+{
+#if defined(_MSC_VER)
+    WIN32_FIND_DATAA data;
+    HANDLE h = FindFirstFileA((in_sDir + "/" + in_sPrefix + "*").c_str(), &data);
+    if(h == INVALID_HANDLE_VALUE)
+        return;
+
+    do {
+        std::string sName = data.cFileName;
+        if(sName.empty() || sName[0] == '.')
+            continue;
+
+        if(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            listFilesRecursive(in_sDir, in_sPrefix + sName + "/", out_files);
+        else
+            out_files.push_back(in_sPrefix + sName);
+    } while(FindNextFileA(h, &data));
+
+    FindClose(h);
+#else
+    DIR* dir = opendir((in_sDir + "/" + in_sPrefix).c_str());
+    if(!dir)
+        return;
+
+    while(dirent* ent = readdir(dir)) {
+        std::string sName = ent->d_name;
+        if(sName.empty() || sName[0] == '.')
+            continue;
+
+        struct stat st;
+        if(stat((in_sDir + "/" + in_sPrefix + sName).c_str(), &st) != 0)
+            continue;
+
+        if(S_ISDIR(st.st_mode))
+            listFilesRecursive(in_sDir, in_sPrefix + sName + "/", out_files);
+        else if(S_ISREG(st.st_mode))
+            out_files.push_back(in_sPrefix + sName);
+    }
+
+    closedir(dir);
+#endif
+}
+
+std::vector<std::string> listFilesRecursive(const std::string& in_sDir)
+{
+    std::vector<std::string> files;
+    listFilesRecursive(in_sDir, "", files);
+    return files;
+}
@@ -1,5 +1,14 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 std::string getUserDir();
+
+/// Creates the directory \a in_sDir, including all missing parents.
+/// \return false if it doesn't exist and couldn't be created.
+bool createDirectories(const std::string& in_sDir);
+
+/// Lists all files in \a in_sDir and its subdirectories, skipping hidden ones.
+/// \return The paths of the files relative to \a in_sDir, using '/' as separator.
+std::vector<std::string> listFilesRecursive(const std::string& in_sDir);
@@ -0,0 +1,106 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+using namespace RoadRage;
+
+ThreadPool::ThreadPool(unsigned in_nWorkers)
+    : m_pJob(0)
+    , m_n(0)
+    , m_range(0)
+    , m_next(0)
+    , m_generation(0)
+    , m_nBusy(0)
+    , m_bQuit(false)
+{
+    if(in_nWorkers == 0)
+        in_nWorkers = std::max(1u, std::thread::hardware_concurrency());
+
+    // The thread starting a loop is a worker too.
+    for(unsigned i = 1 ; i < in_nWorkers ; ++i) {
+        m_threads.push_back(std::thread(&ThreadPool::workerThread, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bQuit = true;
+    }
+    m_wakeup.notify_all();
+
+    for(auto i = m_threads.begin() ; i != m_threads.end() ; ++i) {
+        i->join();
+    }
+}
+
+void ThreadPool::parallelFor(std::size_t in_n, const Job& in_job, std::size_t in_minRange)
+{
+    if(in_n == 0)
+        return;
+
+    // Not worth waking anybody up.
+    if(m_threads.empty() || in_n <= in_minRange) {
+        in_job(0, in_n, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pJob = &in_job;
+        m_n = in_n;
+        // A few ranges per worker, so that those who are faster (or didn't
+        // get interrupted) can take over some of the others' work.
+        m_range = std::max(in_minRange, in_n / (this->size() * 4));
+        m_next = 0;
+        m_nBusy = static_cast<unsigned>(m_threads.size());
+        ++m_generation;
+    }
+    m_wakeup.notify_all();
+
+    this->work(0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(m_nBusy > 0) {
+        m_done.wait(lock);
+    }
+    m_pJob = 0;
+}
+
+void ThreadPool::work(unsigned in_id)
+{
+    while(true) {
+        std::size_t begin = m_next.fetch_add(m_range);
+        if(begin >= m_n)
+            return;
+
+        (*m_pJob)(begin, std::min(m_n, begin + m_range), in_id);
+    }
+}
+
+void ThreadPool::workerThread(unsigned in_id)
+{
+    unsigned seen = 0;
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while(!m_bQuit && m_generation == seen) {
+                m_wakeup.wait(lock);
+            }
+
+            if(m_bQuit)
+                return;
+
+            seen = m_generation;
+        }
+
+        this->work(in_id);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(--m_nBusy == 0)
+                m_done.notify_one();
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace RoadRage {
+
+/// A fixed set of worker threads that share the iterations of loops among
+/// themselves. The thread starting a loop works on it too and only returns
+/// once all the iterations are done, so no synchronization is needed around.
+class ThreadPool {
+public:
+    /// What gets called for the iterations [begin, end), by worker \a worker.
+    /// Every worker only runs one range at a time, so everything indexed by
+    /// the worker needs no locking.
+    typedef std::function<void (std::size_t begin, std::size_t end, unsigned worker)> Job;
+
+    /// \param in_nWorkers How many threads work on a loop, including the one
+    ///                    starting it. 0 means as many as there are cores.
+    ThreadPool(unsigned in_nWorkers = 0);
+    virtual ~ThreadPool();
+
+    /// \return How many workers there are, including the calling thread. The
+    ///         \a worker passed to jobs is always less than that.
+    unsigned size() const { return static_cast<unsigned>(m_threads.size()) + 1; }
+
+    /// Runs \a in_job on all the iterations in [0, \a in_n) and waits for them
+    /// to be done. The iterations are handed out in ranges of at least
+    /// \a in_minRange, so that tiny loops don't spend their time synchronizing.
+    /// Must only be called by one thread at a time.
+    void parallelFor(std::size_t in_n, const Job& in_job, std::size_t in_minRange = 64);
+
+private:
+    // No copying!
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    void workerThread(unsigned in_id);
+    void work(unsigned in_id);
+
+    // The loop currently being run.
+    const Job* m_pJob;
+    std::size_t m_n;
+    std::size_t m_range;
+    std::atomic<std::size_t> m_next;
+
+    // Communication with the workers, all guarded by m_mutex.
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::condition_variable m_done;
+    unsigned m_generation;
+    unsigned m_nBusy;
+    bool m_bQuit;
+
+    std::vector<std::thread> m_threads;
+};
+
+}